@@ -9,8 +9,13 @@
  */
 #include "fboss/agent/ApplyThriftConfig.h"
 
+#include <folly/Conv.h>
 #include <folly/FileUtil.h>
+#include <folly/Optional.h>
+#include <folly/String.h>
 #include <folly/gen/Base.h>
+#include <folly/logging/xlog.h>
+#include <gflags/gflags.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 
 #include "fboss/agent/FbossError.h"
@@ -45,7 +50,10 @@
 #include <algorithm>
 #include <boost/container/flat_set.hpp>
 #include <boost/container/flat_map.hpp>
+#include <chrono>
 #include <cmath>
+#include <limits>
+#include <tuple>
 #include <folly/Range.h>
 #include <utility>
 #include <vector>
@@ -68,8 +76,138 @@ const uint8_t kV6LinkLocalAddrMask{64};
 // Needed until CoPP is removed from code and put into config
 const int kAclStartPriority = 100000;
 
+/*
+ * Returns the priorities of the ACLs named in names, in order of decreasing
+ * precedence, keeping as many ACLs as possible at their priority in
+ * origAcls. The others are spread out over the gaps between them. When a
+ * gap is too small for the ACLs that go in it, it is widened one kept ACL
+ * at a time into whichever neighbouring gap has the most room left, so only
+ * the ACLs near the insert are moved. New ACLs past the last kept one are
+ * given priorities gap apart.
+ */
+std::vector<int> allocateAclPriorities(
+    const std::vector<std::string>& names,
+    const facebook::fboss::AclMap& origAcls,
+    int gap) {
+  auto n = names.size();
+  std::vector<folly::Optional<int>> origPriorities(n);
+  for (size_t i = 0; i < n; ++i) {
+    auto origAcl = origAcls.getEntryIf(names[i]);
+    if (origAcl) {
+      origPriorities[i] = origAcl->getPriority();
+    }
+  }
+
+  // Keep the longest run of ACLs whose priorities are still in order
+  std::vector<size_t> tails;
+  std::vector<ssize_t> prev(n, -1);
+  for (size_t i = 0; i < n; ++i) {
+    if (!origPriorities[i]) {
+      continue;
+    }
+    auto it = std::lower_bound(
+        tails.begin(),
+        tails.end(),
+        *origPriorities[i],
+        [&](size_t j, int priority) { return *origPriorities[j] < priority; });
+    if (it != tails.begin()) {
+      prev[i] = *(it - 1);
+    }
+    if (it == tails.end()) {
+      tails.push_back(i);
+    } else {
+      *it = i;
+    }
+  }
+  std::vector<bool> keep(n, false);
+  for (ssize_t i = tails.empty() ? -1 : tails.back(); i >= 0; i = prev[i]) {
+    keep[i] = true;
+  }
+
+  // The ACLs in [i, j) go between the kept ACLs at i - 1 and j, or the
+  // start of the ACL priorities and the end of the list if there are none
+  auto lowerBound = [&](size_t i) {
+    return i == 0 ? kAclStartPriority - 1 : *origPriorities[i - 1];
+  };
+  auto slack = [&](size_t i, size_t j) {
+    if (j == n) {
+      return std::numeric_limits<int64_t>::max();
+    }
+    return static_cast<int64_t>(*origPriorities[j]) - lowerBound(i) - 1 -
+        static_cast<int64_t>(j - i);
+  };
+  size_t i = 0;
+  while (i < n) {
+    if (keep[i]) {
+      ++i;
+      continue;
+    }
+    auto j = i;
+    while (j < n && !keep[j]) {
+      ++j;
+    }
+    while (slack(i, j) < 0) {
+      // Move the kept ACL on either side into the gap, taking in the gap
+      // beyond it, and go with the side that leaves the most room
+      auto left = i > 0 ? i - 1 : 0;
+      while (left > 0 && !keep[left - 1]) {
+        --left;
+      }
+      auto right = j + 1;
+      while (right < n && !keep[right]) {
+        ++right;
+      }
+      if (i > 0 && slack(left, j) > slack(i, right)) {
+        keep[i - 1] = false;
+        i = left;
+      } else {
+        keep[j] = false;
+        j = right;
+      }
+    }
+    i = j;
+  }
+
+  std::vector<int> priorities(n);
+  i = 0;
+  while (i < n) {
+    if (keep[i]) {
+      priorities[i] = *origPriorities[i];
+      ++i;
+      continue;
+    }
+    auto j = i;
+    while (j < n && !keep[j]) {
+      ++j;
+    }
+    auto lo = i == 0 ? kAclStartPriority - 1 : priorities[i - 1];
+    if (j == n) {
+      for (auto k = i; k < n; ++k) {
+        lo += gap;
+        priorities[k] = lo;
+      }
+    } else {
+      auto step = (*origPriorities[j] - lo) / static_cast<int>(j - i + 1);
+      for (auto k = i; k < j; ++k) {
+        priorities[k] = lo + step * static_cast<int>(k - i + 1);
+      }
+    }
+    i = j;
+  }
+  return priorities;
+}
+
 } // anonymous namespace
 
+DEFINE_bool(incremental_config_apply, false,
+    "Only rebuild the parts of the switch state whose config changed since "
+    "the last config applied. Changes made to those parts of the state "
+    "other than through the config are then no longer reverted by "
+    "reapplying the same config");
+DEFINE_int32(acl_priority_gap, 10,
+    "Gap between the priorities given to new ACLs, leaving room to insert "
+    "ACLs later without moving the ones around them");
+
 namespace facebook { namespace fboss {
 
 /*
@@ -88,7 +226,8 @@ class ThriftConfigApplier {
     : orig_(orig),
       cfg_(config),
       platform_(platform),
-      prevCfg_(prevCfg) {}
+      prevCfg_(prevCfg),
+      incremental_(prevCfg && FLAGS_incremental_config_apply) {}
 
   std::shared_ptr<SwitchState> run();
 
@@ -116,6 +255,36 @@ class ThriftConfigApplier {
     }
   }
 
+  /*
+   * Whether the config fields returned by getFields, as a tuple of
+   * references, differ between prevCfg_ and cfg_. Without incremental_
+   * every section counts as changed.
+   */
+  template <typename GetFields>
+  bool configChanged(GetFields getFields) const {
+    return !incremental_ || !(getFields(*prevCfg_) == getFields(*cfg_));
+  }
+
+  /*
+   * Run applyFn, which applies one section of the config to new_, if the
+   * config of the section changed, and time it.
+   */
+  template <typename ApplyFn>
+  void applySection(folly::StringPiece name, bool changed, ApplyFn applyFn) {
+    if (!changed) {
+      skippedSections_.push_back(name.str());
+      return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    applyFn();
+    sectionTimes_.emplace_back(
+        name.str(),
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start));
+  }
+
+  void logSectionTimes(std::chrono::microseconds total) const;
+
   // Interface route prefix. IPAddress has mask applied
   typedef std::pair<folly::IPAddress, uint8_t> Prefix;
   typedef std::pair<InterfaceID, folly::IPAddress> IntfAddress;
@@ -234,6 +403,12 @@ class ThriftConfigApplier {
   const cfg::SwitchConfig* cfg_{nullptr};
   const Platform* platform_{nullptr};
   const cfg::SwitchConfig* prevCfg_{nullptr};
+  // Only apply the sections of cfg_ that differ from prevCfg_
+  const bool incremental_{false};
+
+  std::vector<std::pair<std::string, std::chrono::microseconds>>
+      sectionTimes_;
+  std::vector<std::string> skippedSections_;
 
   struct VlanIpInfo {
     VlanIpInfo(uint8_t mask, MacAddress mac, InterfaceID intf)
@@ -259,76 +434,125 @@ class ThriftConfigApplier {
 shared_ptr<SwitchState> ThriftConfigApplier::run() {
   new_ = orig_->clone();
   bool changed = false;
-
-  {
+  auto start = std::chrono::steady_clock::now();
+
+  // The config each section is built from, sections built from the state of
+  // other sections count those in too
+  typedef const cfg::SwitchConfig& Cfg;
+  bool controlPlaneChanged = configChanged([](Cfg c) {
+    return std::tie(
+        c.cpuQueues, c.cpuTrafficPolicy, c.__isset.cpuTrafficPolicy);
+  });
+  bool portsChanged = configChanged([](Cfg c) {
+    return std::tie(
+        c.ports,
+        c.vlanPorts,
+        c.dataPlaneTrafficPolicy,
+        c.__isset.dataPlaneTrafficPolicy);
+  });
+  bool aggPortsChanged = portsChanged || configChanged([](Cfg c) {
+    return std::tie(c.aggregatePorts, c.lacp, c.__isset.lacp);
+  });
+  bool mirrorsChanged = portsChanged ||
+      configChanged([](Cfg c) { return std::tie(c.mirrors); });
+  bool aclsChanged = mirrorsChanged || configChanged([](Cfg c) {
+    return std::tie(
+        c.acls,
+        c.trafficCounters,
+        c.dataPlaneTrafficPolicy,
+        c.__isset.dataPlaneTrafficPolicy);
+  });
+  bool qosPoliciesChanged =
+      configChanged([](Cfg c) { return std::tie(c.qosPolicies); });
+  bool intfsChanged =
+      configChanged([](Cfg c) { return std::tie(c.interfaces); });
+  // updateVlans() needs what updateInterfaces() gathers
+  bool vlansChanged = intfsChanged || configChanged([](Cfg c) {
+    return std::tie(c.vlans, c.vlanPorts);
+  });
+  bool staticRoutesChanged = intfsChanged || configChanged([](Cfg c) {
+    return std::tie(
+        c.staticRoutesWithNhops,
+        c.__isset.staticRoutesWithNhops,
+        c.staticRoutesToNull,
+        c.__isset.staticRoutesToNull,
+        c.staticRoutesToCPU,
+        c.__isset.staticRoutesToCPU);
+  });
+  bool sflowCollectorsChanged =
+      configChanged([](Cfg c) { return std::tie(c.sFlowCollectors); });
+  bool loadBalancersChanged =
+      configChanged([](Cfg c) { return std::tie(c.loadBalancers); });
+
+  applySection("controlPlane", controlPlaneChanged, [&]() {
     auto newControlPlane = updateControlPlane();
     if (newControlPlane) {
       new_->resetControlPlane(std::move(newControlPlane));
       changed = true;
     }
-  }
+  });
 
   processVlanPorts();
 
-  {
+  applySection("ports", portsChanged, [&]() {
     auto newPorts = updatePorts();
     if (newPorts) {
       new_->resetPorts(std::move(newPorts));
       changed = true;
     }
-  }
+  });
 
-  {
+  applySection("aggregatePorts", aggPortsChanged, [&]() {
     auto newAggPorts = updateAggregatePorts();
     if (newAggPorts) {
       new_->resetAggregatePorts(std::move(newAggPorts));
       changed = true;
     }
-  }
+  });
 
   // updateMirrors must be called after updatePorts, mirror needs ports!
-  {
+  applySection("mirrors", mirrorsChanged, [&]() {
     auto newMirrors = updateMirrors();
     if (newMirrors) {
       new_->resetMirrors(std::move(newMirrors));
       changed = true;
     }
-  }
+  });
 
   // updateAcls must be called after updateMirrors, acls may need mirror!
-  {
+  applySection("acls", aclsChanged, [&]() {
     auto newAcls = updateAcls();
     if (newAcls) {
       new_->resetAcls(std::move(newAcls));
       changed = true;
     }
-  }
+  });
 
-  {
+  applySection("qosPolicies", qosPoliciesChanged, [&]() {
     auto newQosPolicies = updateQosPolicies();
     if (newQosPolicies) {
       new_->resetQosPolicies(std::move(newQosPolicies));
       changed = true;
     }
-  }
+  });
 
-  {
+  applySection("interfaces", vlansChanged, [&]() {
     auto newIntfs = updateInterfaces();
     if (newIntfs) {
       new_->resetIntfs(std::move(newIntfs));
       changed = true;
     }
-  }
+  });
 
   // Note: updateInterfaces() must be called before updateVlans(),
   // as updateInterfaces() populates the vlanInterfaces_ data structure.
-  {
+  applySection("vlans", vlansChanged, [&]() {
     auto newVlans = updateVlans();
     if (newVlans) {
       new_->resetVlans(std::move(newVlans));
       changed = true;
     }
-  }
+  });
 
   // Note: updateInterfaces() must be called before updateInterfaceRoutes(),
   // as updateInterfaces() populates the intfRouteTables_ data structure.
@@ -336,15 +560,15 @@ shared_ptr<SwitchState> ThriftConfigApplier::run() {
   // RouteTable as this will take the RouteTable from orig_ and add Interface
   // routes. Calling this after other RouteTable updates will result in other
   // routes getting removed during updateInterfaceRoutes()
-  {
+  applySection("interfaceRoutes", intfsChanged, [&]() {
     auto newTables = updateInterfaceRoutes();
     if (newTables) {
       new_->resetRouteTables(newTables);
       changed = true;
     }
-  }
+  });
 
-  {
+  applySection("staticRoutes", staticRoutesChanged, [&]() {
     // Retrieve RouteTableMap from new_ as this will have
     // all the routes updated until now. Pass this to syncStaticRoutes
     // so that routes added until now would not be excluded.
@@ -354,7 +578,7 @@ shared_ptr<SwitchState> ThriftConfigApplier::run() {
       new_->resetRouteTables(std::move(newerTables));
       changed = true;
     }
-  }
+  });
 
   auto newVlans = new_->getVlans();
   VlanID dfltVlan(cfg_->defaultVlan);
@@ -450,15 +674,15 @@ shared_ptr<SwitchState> ThriftConfigApplier::run() {
   }
 
   // Add sFlow collectors
-  {
+  applySection("sflowCollectors", sflowCollectorsChanged, [&]() {
     auto newCollectors = updateSflowCollectors();
     if (newCollectors) {
       new_->resetSflowCollectors(std::move(newCollectors));
       changed = true;
     }
-  }
+  });
 
-  {
+  applySection("loadBalancers", loadBalancersChanged, [&]() {
     LoadBalancerConfigApplier loadBalancerConfigApplier(
         orig_->getLoadBalancers(), cfg_->get_loadBalancers(), platform_);
     auto newLoadBalancers = loadBalancerConfigApplier.updateLoadBalancers();
@@ -466,7 +690,10 @@ shared_ptr<SwitchState> ThriftConfigApplier::run() {
       new_->resetLoadBalancers(std::move(newLoadBalancers));
       changed = true;
     }
-  }
+  });
+
+  logSectionTimes(std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start));
 
   if (!changed) {
     return nullptr;
@@ -474,6 +701,18 @@ shared_ptr<SwitchState> ThriftConfigApplier::run() {
   return new_;
 }
 
+void ThriftConfigApplier::logSectionTimes(
+    std::chrono::microseconds total) const {
+  std::string times;
+  for (const auto& section : sectionTimes_) {
+    folly::toAppend(" ", section.first, "=", section.second.count(), "us",
+                    &times);
+  }
+  XLOG(INFO) << "Applied config in " << total.count() << "us, sections:"
+             << times << (skippedSections_.empty() ? "" : ", unchanged: ")
+             << folly::join(" ", skippedSections_);
+}
+
 void ThriftConfigApplier::processVlanPorts() {
   // Build the Port --> Vlan mappings
   //
@@ -1097,19 +1336,18 @@ std::shared_ptr<AclMap> ThriftConfigApplier::updateAcls() {
   AclMap::NodeContainer newAcls;
   bool changed = false;
   int numExistingProcessed = 0;
-  int priority = kAclStartPriority;
+
+  // The ACLs to program in order of decreasing precedence, with the action
+  // from the traffic policy using them
+  std::vector<std::pair<const cfg::AclEntry*, folly::Optional<MatchAction>>>
+      aclCfgs;
 
   // Start with the DROP acls, these should have highest priority
-  auto acls = folly::gen::from(cfg_->acls)
-    | folly::gen::filter([](const cfg::AclEntry& entry) {
-          return entry.actionType == cfg::AclActionType::DENY;
-      })
-    | folly::gen::map([&](const cfg::AclEntry& entry) {
-          auto acl = updateAcl(entry, priority++, &numExistingProcessed,
-            &changed);
-          return std::make_pair(acl->getID(), acl);
-      })
-    | folly::gen::appendTo(newAcls);
+  for (const auto& entry : cfg_->acls) {
+    if (entry.actionType == cfg::AclActionType::DENY) {
+      aclCfgs.emplace_back(&entry, folly::none);
+    }
+  }
 
   // Let's get a map of acls to name so we don't have to search the acl list
   // for every new use
@@ -1129,9 +1367,7 @@ std::shared_ptr<AclMap> ThriftConfigApplier::updateAcls() {
 
   // Generates new acls from template
   auto addToAcls = [&] (const cfg::TrafficPolicyConfig& policy,
-                        bool isCoppAcl=false)
-      -> const std::vector<std::pair<std::string, std::shared_ptr<AclEntry>>> {
-    std::vector<std::pair<std::string, std::shared_ptr<AclEntry>>> entries;
+                        bool isCoppAcl=false) {
     for (const auto& mta : policy.matchToAction) {
       auto a = aclByName.find(mta.matcher);
       if (a == aclByName.end()) {
@@ -1139,10 +1375,10 @@ std::shared_ptr<AclMap> ThriftConfigApplier::updateAcls() {
             " found.");
       }
 
-      auto aclCfg = *(a->second);
+      const auto* aclCfg = a->second;
 
       // We've already added any DENY acls
-      if (aclCfg.actionType == cfg::AclActionType::DENY) {
+      if (aclCfg->actionType == cfg::AclActionType::DENY) {
         continue;
       }
 
@@ -1171,33 +1407,43 @@ std::shared_ptr<AclMap> ThriftConfigApplier::updateAcls() {
       if (mta.action.__isset.egressMirror) {
         matchAction.setEgressMirror(mta.action.egressMirror);
       }
-
-      auto acl = updateAcl(aclCfg, priority++, &numExistingProcessed,
-        &changed, &matchAction);
-
-      if (acl->getAclAction().hasValue()) {
-        const auto& inMirror = acl->getAclAction().value().getIngressMirror();
-        const auto& egMirror = acl->getAclAction().value().getIngressMirror();
-        if (inMirror.hasValue() &&
-            !new_->getMirrors()->getMirrorIf(inMirror.value())) {
-          throw FbossError("Mirror ", inMirror.value(), " is undefined");
-        }
-        if (egMirror.hasValue() &&
-            !new_->getMirrors()->getMirrorIf(egMirror.value())) {
-          throw FbossError("Mirror ", egMirror.value(), " is undefined");
-        }
-      }
-      entries.push_back(std::make_pair(acl->getID(), acl));
+      aclCfgs.emplace_back(aclCfg, std::move(matchAction));
     }
-    return entries;
   };
 
   // Add dataPlane traffic acls
   if (cfg_->__isset.dataPlaneTrafficPolicy) {
-    folly::gen::from(
-        addToAcls(cfg_->dataPlaneTrafficPolicy_ref().value_unchecked())) |
-        folly::gen::appendTo(newAcls);
+    addToAcls(cfg_->dataPlaneTrafficPolicy_ref().value_unchecked());
+  }
+
+  // Keep the priorities of the existing acls where we can, so that adding
+  // or removing an acl only reprograms that acl
+  std::vector<std::string> names;
+  for (const auto& aclCfg : aclCfgs) {
+    names.push_back(aclCfg.first->name);
+  }
+  auto priorities = allocateAclPriorities(
+      names, *orig_->getAcls(), std::max(FLAGS_acl_priority_gap, 1));
+
+  for (size_t i = 0; i < aclCfgs.size(); ++i) {
+    auto acl = updateAcl(*aclCfgs[i].first, priorities[i],
+      &numExistingProcessed, &changed, aclCfgs[i].second.get_pointer());
+
+    if (acl->getAclAction().hasValue()) {
+      const auto& inMirror = acl->getAclAction().value().getIngressMirror();
+      const auto& egMirror = acl->getAclAction().value().getIngressMirror();
+      if (inMirror.hasValue() &&
+          !new_->getMirrors()->getMirrorIf(inMirror.value())) {
+        throw FbossError("Mirror ", inMirror.value(), " is undefined");
+      }
+      if (egMirror.hasValue() &&
+          !new_->getMirrors()->getMirrorIf(egMirror.value())) {
+        throw FbossError("Mirror ", egMirror.value(), " is undefined");
+      }
+    }
+    newAcls.emplace(acl->getID(), acl);
   }
+
   if (numExistingProcessed != orig_->getAcls()->size()) {
     // Some existing ACLs were removed.
     changed = true;
@@ -1976,9 +2222,7 @@ shared_ptr<SwitchState> applyThriftConfig(
     const cfg::SwitchConfig* config,
     const Platform* platform,
     const cfg::SwitchConfig* prevConfig) {
-  cfg::SwitchConfig emptyConfig;
-  return ThriftConfigApplier(state, config, platform,
-      prevConfig ? prevConfig : &emptyConfig).run();
+  return ThriftConfigApplier(state, config, platform, prevConfig).run();
 }
 
 std::pair<std::shared_ptr<SwitchState>, std::string> applyThriftConfigFile(
@@ -157,13 +157,13 @@ void ArpHandler::handlePacket(
   (void)targetMac; // unused
 }
 
-static void sendArp(SwSwitch *sw,
-                    VlanID vlan,
-                    ArpOpCode op,
-                    MacAddress senderMac,
-                    IPAddressV4 senderIP,
-                    MacAddress targetMac,
-                    IPAddressV4 targetIP) {
+static std::unique_ptr<TxPacket> createArp(SwSwitch *sw,
+                                          VlanID vlan,
+                                          ArpOpCode op,
+                                          MacAddress senderMac,
+                                          IPAddressV4 senderIP,
+                                          MacAddress targetMac,
+                                          IPAddressV4 targetIP) {
   XLOG(DBG4) << "sending ARP " << ((op == ARP_OP_REQUEST) ? "request" : "reply")
              << " on vlan " << vlan << " to " << targetIP.str() << " ("
              << targetMac << "): " << senderIP.str() << " is " << senderMac;
@@ -194,11 +194,22 @@ static void sendArp(SwSwitch *sw,
   cursor.write<uint32_t>(targetIP.toLong());
   // Fill the padding with 0s
   memset(cursor.writableData(), 0, cursor.length());
+  return pkt;
+}
 
-  sw->sendPacketSwitchedAsync(std::move(pkt));
+static void sendArp(SwSwitch *sw,
+                    VlanID vlan,
+                    ArpOpCode op,
+                    MacAddress senderMac,
+                    IPAddressV4 senderIP,
+                    MacAddress targetMac,
+                    IPAddressV4 targetIP) {
+  sw->sendPacketSwitchedAsync(
+      createArp(sw, vlan, op, senderMac, senderIP, targetMac, targetIP));
 }
 
 void ArpHandler::floodGratuituousArp() {
+  std::vector<std::unique_ptr<TxPacket>> pkts;
   for (const auto& intf : *sw_->getState()->getInterfaces()) {
     for (const auto& addrEntry: intf->getAddresses()) {
       if (!addrEntry.first.isV4()) {
@@ -207,11 +218,11 @@ void ArpHandler::floodGratuituousArp() {
       auto v4Addr = addrEntry.first.asV4();
       // Gratuitous arps have both source and destination IPs set to
       // originator's address
-      sendArp(sw_, intf->getVlanID(), ARP_OP_REQUEST, intf->getMac(), v4Addr,
-          MacAddress::BROADCAST, v4Addr);
+      pkts.push_back(createArp(sw_, intf->getVlanID(), ARP_OP_REQUEST,
+          intf->getMac(), v4Addr, MacAddress::BROADCAST, v4Addr));
     }
   }
-
+  sw_->sendPacketsSwitchedAsync(std::move(pkts));
 }
 
 void ArpHandler::sendArpReply(VlanID vlan,
@@ -9,6 +9,41 @@
  */
 #include "fboss/agent/HwSwitch.h"
 
+#include "fboss/agent/TxPacket.h"
+
 namespace facebook { namespace fboss {
 
+HwSwitch::PortTxPacket::PortTxPacket(
+    std::unique_ptr<TxPacket> pkt,
+    PortID portID,
+    folly::Optional<uint8_t> cos)
+    : pkt(std::move(pkt)), portID(portID), cos(cos) {}
+
+HwSwitch::PortTxPacket::PortTxPacket(PortTxPacket&&) noexcept = default;
+HwSwitch::PortTxPacket& HwSwitch::PortTxPacket::operator=(
+    PortTxPacket&&) noexcept = default;
+HwSwitch::PortTxPacket::~PortTxPacket() {}
+
+size_t HwSwitch::sendPacketsSwitchedAsync(
+    std::vector<std::unique_ptr<TxPacket>> pkts) noexcept {
+  size_t sent = 0;
+  for (auto& pkt : pkts) {
+    if (sendPacketSwitchedAsync(std::move(pkt))) {
+      ++sent;
+    }
+  }
+  return sent;
+}
+
+size_t HwSwitch::sendPacketsOutOfPortAsync(
+    std::vector<PortTxPacket> pkts) noexcept {
+  size_t sent = 0;
+  for (auto& pkt : pkts) {
+    if (sendPacketOutOfPortAsync(std::move(pkt.pkt), pkt.portID, pkt.cos)) {
+      ++sent;
+    }
+  }
+  return sent;
+}
+
 }} // facebook::fboss
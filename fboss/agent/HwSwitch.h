@@ -18,6 +18,7 @@
 
 #include <memory>
 #include <utility>
+#include <vector>
 
 namespace folly{
 struct dynamic;
@@ -177,6 +178,42 @@ class HwSwitch {
   virtual bool sendPacketOutOfPortSync(std::unique_ptr<TxPacket> pkt,
                                    PortID portID) noexcept = 0;
 
+  /*
+   * A packet to send out of a specific port, see sendPacketsOutOfPortAsync()
+   */
+  struct PortTxPacket {
+    PortTxPacket(
+        std::unique_ptr<TxPacket> pkt,
+        PortID portID,
+        folly::Optional<uint8_t> cos = folly::none);
+    PortTxPacket(PortTxPacket&&) noexcept;
+    PortTxPacket& operator=(PortTxPacket&&) noexcept;
+    ~PortTxPacket();
+
+    std::unique_ptr<TxPacket> pkt;
+    PortID portID;
+    folly::Optional<uint8_t> cos;
+  };
+
+  /*
+   * Send a batch of packets, as sendPacketSwitchedAsync() would send each
+   * of them. Implementations may hand the whole batch to the HW at once,
+   * the default sends the packets one by one.
+   *
+   * @return The number of packets successfully sent to HW.
+   */
+  virtual size_t sendPacketsSwitchedAsync(
+      std::vector<std::unique_ptr<TxPacket>> pkts) noexcept;
+
+  /*
+   * Send a batch of packets, as sendPacketOutOfPortAsync() would send each
+   * of them.
+   *
+   * @return The number of packets successfully sent to HW.
+   */
+  virtual size_t sendPacketsOutOfPortAsync(
+      std::vector<PortTxPacket> pkts) noexcept;
+
   /*
    * Allows hardware-specific code to record switch statistics.
    */
@@ -20,6 +20,7 @@
 #include "fboss/agent/HwSwitch.h"
 #include "fboss/agent/IPHeaderV4.h"
 #include "fboss/agent/NeighborUpdater.h"
+#include "fboss/agent/ParkedPacketQueue.h"
 #include "fboss/agent/Platform.h"
 #include "fboss/agent/PortStats.h"
 #include "fboss/agent/RxPacket.h"
@@ -120,6 +121,7 @@ void IPv4Handler::handlePacket(unique_ptr<RxPacket> pkt,
 
   const uint32_t l3Len = pkt->getLength() - (cursor - Cursor(pkt->buf()));
   stats->port(port)->ipv4Rx();
+  Cursor l3Cursor(cursor);
   IPv4Hdr v4Hdr(cursor);
   XLOG(DBG4) << "Rx IPv4 packet (" << l3Len << " bytes) " << v4Hdr.srcAddr.str()
              << " --> " << v4Hdr.dstAddr.str() << " proto: 0x" << std::hex
@@ -220,13 +222,19 @@ void IPv4Handler::handlePacket(unique_ptr<RxPacket> pkt,
   // We will need to manage the rate somehow. Either from HW
   // or a SW control here
   stats->port(port)->ipv4Nexthop();
-  if (!resolveMac(state.get(), port, v4Hdr.dstAddr)) {
+  UnresolvedNextHop unresolved;
+  if (!resolveMac(state.get(), port, v4Hdr.dstAddr, &unresolved)) {
     stats->port(port)->ipv4NoArp();
     XLOG(DBG4) << "Cannot find the interface to send out ARP request for "
                << v4Hdr.dstAddr.str();
   }
-  // TODO: ideally, we need to store this packet until the ARP is done and
-  // then send this pkt out. For now, just drop it.
+  // Hold on to the packet until the ARP is done, if we can
+  auto parkedPkts = sw_->getParkedPacketQueue();
+  if (parkedPkts && unresolved &&
+      parkedPkts->park(
+          unresolved->first, unresolved->second, l3Cursor, v4Hdr.length)) {
+    return;
+  }
   stats->port(port)->pktDropped();
 }
 
@@ -234,18 +242,19 @@ void IPv4Handler::handlePacket(unique_ptr<RxPacket> pkt,
 bool IPv4Handler::resolveMac(
     SwitchState* state,
     PortID ingressPort,
-    IPAddressV4 dest) {
+    IPAddressV4 dest,
+    UnresolvedNextHop* unresolved) {
   // need to find out our own IP and MAC addresses so that we can send the
   // ARP request out. Since the request will be broadcast, there is no need to
   // worry about which port to send the packet out.
 
   // TODO: assume vrf 0 now
-  auto routeTable = state->getRouteTables()->getRouteTableIf(RouterID(0));
-  if (!routeTable) {
+  if (!state->getRouteTables()->getRouteTableIf(RouterID(0)) &&
+      !state->getFibs()->getFibContainerIf(RouterID(0))) {
     throw FbossError("No routing tables found");
   }
 
-  auto route = routeTable->getRibV4()->longestMatch(dest);
+  auto route = state->longestMatchRoute(RouterID(0), dest);
   if (!route || !route->isResolved()) {
     sw_->portStats(ingressPort)->ipv4DstLookupFailure();
     // No way to reach dest
@@ -269,6 +278,9 @@ bool IPv4Handler::resolveMac(
       auto vlan = state->getVlans()->getVlanIf(vlanID);
       if (vlan) {
         auto entry = vlan->getArpTable()->getEntryIf(target);
+        if (unresolved && !*unresolved && (!entry || entry->isPending())) {
+          *unresolved = std::make_pair(vlanID, target);
+        }
         if (entry == nullptr) {
           // No entry in ARP table, send ARP request
           auto mac = intf->getMac();
@@ -12,9 +12,11 @@
 #include "fboss/agent/types.h"
 
 #include <memory>
+#include <utility>
 
 #include <folly/IPAddressV4.h>
 #include <folly/MacAddress.h>
+#include <folly/Optional.h>
 #include "fboss/agent/packet/IPv4Hdr.h"
 
 namespace folly { namespace io {
@@ -32,6 +34,10 @@ class IPv4Handler {
  public:
   enum : uint16_t { ETHERTYPE_IPV4 = 0x0800 };
 
+  // The VLAN and IP of a next hop that has no resolved ARP entry yet
+  using UnresolvedNextHop =
+      folly::Optional<std::pair<VlanID, folly::IPAddressV4>>;
+
   explicit IPv4Handler(SwSwitch* sw);
 
   void handlePacket(std::unique_ptr<RxPacket> pkt,
@@ -45,7 +51,8 @@ class IPv4Handler {
    */
   bool resolveMac(SwitchState* state,
                   PortID ingressPort,
-                  folly::IPAddressV4 dest);
+                  folly::IPAddressV4 dest,
+                  UnresolvedNextHop* unresolved = nullptr);
 
  private:
   void sendICMPTimeExceeded(VlanID srcVlan,
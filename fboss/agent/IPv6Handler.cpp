@@ -11,10 +11,12 @@
 
 #include <folly/Format.h>
 #include <folly/MacAddress.h>
+#include <folly/Optional.h>
 #include <folly/logging/xlog.h>
 #include "fboss/agent/DHCPv6Handler.h"
 #include "fboss/agent/FbossError.h"
 #include "fboss/agent/NeighborUpdater.h"
+#include "fboss/agent/ParkedPacketQueue.h"
 #include "fboss/agent/Platform.h"
 #include "fboss/agent/RxPacket.h"
 #include "fboss/agent/SwSwitch.h"
@@ -133,6 +135,7 @@ void IPv6Handler::handlePacket(unique_ptr<RxPacket> pkt,
                                MacAddress src,
                                Cursor cursor) {
   const uint32_t l3Len = pkt->getLength() - (cursor - Cursor(pkt->buf()));
+  Cursor l3Cursor(cursor);
   IPv6Hdr ipv6(cursor);  // note: advances our cursor object
   XLOG(DBG4) << "IPv6 (" << l3Len
              << " bytes)"
@@ -238,7 +241,8 @@ void IPv6Handler::handlePacket(unique_ptr<RxPacket> pkt,
     // for this packet.
     // TODO: Add rate limiting so we don't generate too many requests for the
     // same IP.  Following the rules in RFC 4861 should be sufficient.
-    resolveDestAndHandlePacket(ipv6, std::move(pkt), dst, src, cursor);
+    resolveDestAndHandlePacket(
+        ipv6, std::move(pkt), dst, src, cursor, l3Cursor);
   }
 }
 
@@ -706,20 +710,17 @@ void IPv6Handler::resolveDestAndHandlePacket(
     unique_ptr<RxPacket> pkt,
     MacAddress dst,
     MacAddress src,
-    Cursor cursor) {
+    Cursor cursor,
+    Cursor l3Cursor) {
   // Right now this either responds with PTB or generate neighbor soliciations
+  // and parks the packet until the neighbor resolves
   auto ingressPort = pkt->getSrcPort();
   auto targetIP = hdr.dstAddr;
   auto state = sw_->getState();
 
   // resolve the destination.
   // TODO: assume vrf 0 now
-  auto routeTable = state->getRouteTables()->getRouteTableIf(RouterID(0));
-  if (!routeTable) {
-    return;
-  }
-
-  auto route = routeTable->getRibV6()->longestMatch(targetIP);
+  auto route = state->longestMatchRoute(RouterID(0), targetIP);
   if (!route || !route->isResolved()) {
     sw_->portStats(ingressPort)->ipv6DstLookupFailure();
     // No way to reach targetIP
@@ -728,6 +729,8 @@ void IPv6Handler::resolveDestAndHandlePacket(
 
   auto interfaces = state->getInterfaces();
   auto nexthops = route->getForwardInfo().getNextHopSet();
+  // The first next hop without a resolved NDP entry
+  folly::Optional<std::pair<VlanID, IPAddressV6>> unresolved;
 
   for (auto nexthop : nexthops) {
     // get interface needed to reach next hop
@@ -760,6 +763,9 @@ void IPv6Handler::resolveDestAndHandlePacket(
         auto vlan = state->getVlans()->getVlanIf(vlanID);
         if (vlan) {
           auto entry = vlan->getNdpTable()->getEntryIf(target);
+          if (!unresolved && (!entry || entry->isPending())) {
+            unresolved = std::make_pair(vlanID, target);
+          }
           if (nullptr == entry) {
             // No entry in NDP table, create a neighbor solicitation packet
             sendMulticastNeighborSolicitation(
@@ -776,6 +782,16 @@ void IPv6Handler::resolveDestAndHandlePacket(
       }
     }
   }
+
+  auto parkedPkts = sw_->getParkedPacketQueue();
+  if (parkedPkts && unresolved &&
+      parkedPkts->park(
+          unresolved->first,
+          unresolved->second,
+          l3Cursor,
+          IPv6Hdr::SIZE + hdr.payloadLength)) {
+    return;
+  }
   sw_->portStats(pkt)->pktDropped();
 } // namespace fboss
 
@@ -790,12 +806,7 @@ void IPv6Handler::sendMulticastNeighborSolicitations(
   auto state = sw_->getState();
 
   // TODO: assume vrf 0 now
-  auto routeTable = state->getRouteTables()->getRouteTableIf(RouterID(0));
-  if (!routeTable) {
-    return;
-  }
-
-  auto route = routeTable->getRibV6()->longestMatch(targetIP);
+  auto route = state->longestMatchRoute(RouterID(0), targetIP);
   if (!route || !route->isResolved()) {
     sw_->portStats(ingressPort)->ipv6DstLookupFailure();
     // No way to reach targetIP
@@ -836,15 +847,18 @@ void IPv6Handler::sendMulticastNeighborSolicitations(
 }
 
 void IPv6Handler::floodNeighborAdvertisements() {
+  std::vector<std::unique_ptr<TxPacket>> pkts;
   for (const auto& intf: *sw_->getState()->getInterfaces()) {
     for (const auto& addrEntry: intf->getAddresses()) {
       if (!addrEntry.first.isV6()) {
         continue;
       }
-      sendNeighborAdvertisement(intf->getVlanID(), intf->getMac(),
-          addrEntry.first.asV6(), MacAddress::BROADCAST, IPAddressV6());
+      pkts.push_back(createNeighborAdvertisement(intf->getVlanID(),
+          intf->getMac(), addrEntry.first.asV6(), MacAddress::BROADCAST,
+          IPAddressV6()));
     }
   }
+  sw_->sendPacketsSwitchedAsync(std::move(pkts));
 }
 
 void IPv6Handler::sendNeighborAdvertisement(VlanID vlan,
@@ -852,6 +866,16 @@ void IPv6Handler::sendNeighborAdvertisement(VlanID vlan,
                                             IPAddressV6 srcIP,
                                             MacAddress dstMac,
                                             IPAddressV6 dstIP) {
+  sw_->sendPacketSwitchedAsync(
+      createNeighborAdvertisement(vlan, srcMac, srcIP, dstMac, dstIP));
+}
+
+std::unique_ptr<TxPacket> IPv6Handler::createNeighborAdvertisement(
+    VlanID vlan,
+    MacAddress srcMac,
+    IPAddressV6 srcIP,
+    MacAddress dstMac,
+    IPAddressV6 dstIP) {
   XLOG(DBG4) << "sending neighbor advertisement to " << dstIP.str() << " ("
              << dstMac << "): for " << srcIP << " (" << srcMac << ")";
 
@@ -880,7 +904,7 @@ void IPv6Handler::sendNeighborAdvertisement(VlanID vlan,
                              ICMPv6Type::ICMPV6_TYPE_NDP_NEIGHBOR_ADVERTISEMENT,
                              ICMPv6Code::ICMPV6_CODE_NDP_MESSAGE_CODE,
                              bodyLength, serializeBody);
-  sw_->sendPacketSwitchedAsync(std::move(pkt));
+  return pkt;
 }
 
 void IPv6Handler::sendNeighborSolicitation(
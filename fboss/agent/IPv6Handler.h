@@ -30,6 +30,7 @@ class Interface;
 class RxPacket;
 class StateDelta;
 class SwitchState;
+class TxPacket;
 class Vlan;
 
 class IPv6Handler : public AutoRegisterStateObserver {
@@ -149,13 +150,25 @@ class IPv6Handler : public AutoRegisterStateObserver {
                                  folly::IPAddressV6 srcIP,
                                  folly::MacAddress dstMac,
                                  folly::IPAddressV6 dstIP);
+  std::unique_ptr<TxPacket> createNeighborAdvertisement(
+      VlanID vlan,
+      folly::MacAddress srcMac,
+      folly::IPAddressV6 srcIP,
+      folly::MacAddress dstMac,
+      folly::IPAddressV6 dstIP);
 
+  /*
+   * cursor points at the IPv6 payload, l3Cursor at the IPv6 header. The
+   * packet is parked until the next hop resolves if the SwSwitch has a
+   * ParkedPacketQueue, and dropped otherwise.
+   */
   void resolveDestAndHandlePacket(
       IPv6Hdr hdr,
       std::unique_ptr<RxPacket> pkt,
       folly::MacAddress dst,
       folly::MacAddress src,
-      folly::io::Cursor cursor);
+      folly::io::Cursor cursor,
+      folly::io::Cursor l3Cursor);
 
   static void sendNeighborSolicitation(
       SwSwitch* sw,
@@ -57,6 +57,18 @@ checkTag(facebook::fboss::PortID id,
   return false;
 }
 
+static std::string getHostname() {
+  const size_t kMaxLen = 64;
+  std::array<char, kMaxLen> hostname;
+  if (0 == gethostname(hostname.data(), kMaxLen)) {
+    // make sure it is null terminated
+    hostname[kMaxLen - 1] = '\0';
+  } else {
+    hostname[0] = '\0';
+  }
+  return std::string(hostname.data());
+}
+
 namespace facebook { namespace fboss {
 
 const MacAddress LldpManager::LLDP_DEST_MAC("01:80:c2:00:00:0e");
@@ -143,14 +155,19 @@ void LldpManager::timeoutExpired() noexcept {
 void LldpManager::sendLldpOnAllPorts() {
   // send lldp frames through all the ports here.
   std::shared_ptr<SwitchState> state = sw_->getState();
+  auto hostname = getHostname();
+  std::vector<HwSwitch::PortTxPacket> pkts;
   for (const auto& port : *state->getPorts()) {
     if (port->isPortUp()) {
-      sendLldpInfo(port);
+      // this LLDP packet HAS to exit out of the port specified here.
+      pkts.emplace_back(createLldpInfo(port, hostname), port->getID());
     } else {
       XLOG(DBG5) << "Skipping LLDP send as this port is disabled "
                  << port->getID();
     }
   }
+  // Send them all at once, there can be hundreds of ports
+  sw_->sendPacketsOutOfPortAsync(std::move(pkts));
 }
 
 uint16_t tlvHeader(uint16_t type, uint16_t length) {
@@ -288,31 +305,22 @@ LldpManager::createLldpPkt(SwSwitch* sw,
   return pkt;
 }
 
-void LldpManager::sendLldpInfo(const std::shared_ptr<Port>& port) {
+std::unique_ptr<TxPacket> LldpManager::createLldpInfo(
+    const std::shared_ptr<Port>& port,
+    const std::string& hostname) {
   MacAddress cpuMac = sw_->getPlatform()->getLocalMac();
-  PortID thisPortID = port->getID();
-
-  const size_t kMaxLen = 64;
-  std::array<char, kMaxLen> hostname;
-  if (0 == gethostname(hostname.data(), kMaxLen)) {
-    // make sure it is null terminated
-    hostname[kMaxLen - 1] = '\0';
-  } else {
-    hostname[0] = '\0';
-  }
 
   auto pkt = LldpManager::createLldpPkt(sw_, cpuMac, port->getIngressVlan(),
-                                        std::string(hostname.data()),
+                                        hostname,
                                         port->getName(), port->getDescription(),
                                         TTL_TLV_VALUE,
                                         SYSTEM_CAPABILITY_ROUTER);
 
-  // this LLDP packet HAS to exit out of the port specified here.
-  sw_->sendPacketOutOfPortAsync(std::move(pkt), thisPortID);
-  XLOG(DBG4) << "sent LLDP "
+  XLOG(DBG4) << "sending LLDP "
              << " on port " << port->getID() << " with CPU MAC "
              << cpuMac.toString() << " port id " << port->getName()
              << " and vlan " << port->getIngressVlan();
+  return pkt;
 }
 
 }} // facebook::fboss
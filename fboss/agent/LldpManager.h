@@ -104,7 +104,9 @@ class LldpManager : private folly::AsyncTimeout {
 
  private:
   void timeoutExpired() noexcept override;
-  void sendLldpInfo(const std::shared_ptr<Port>& port);
+  std::unique_ptr<TxPacket> createLldpInfo(
+      const std::shared_ptr<Port>& port,
+      const std::string& hostname);
 
   SwSwitch* sw_{nullptr};
   std::chrono::milliseconds intervalMsecs_;
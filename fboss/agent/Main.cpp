@@ -67,6 +67,9 @@ DEFINE_bool(enable_lldp, true,
             "Run LLDP protocol in agent");
 DEFINE_bool(publish_boot_type, true,
             "Publish boot type on startup");
+DEFINE_bool(enable_standalone_rib, false,
+            "Keep routes in a RIB outside of the SwitchState, and only "
+            "publish the resolved routes into it");
 DEFINE_int32(flush_warmboot_cache_secs, 60,
     "Seconds to wait before flushing warm boot cache");
 DECLARE_int32(thrift_idle_timeout);
@@ -131,6 +134,9 @@ class Initializer {
     if (FLAGS_publish_boot_type) {
       flags |= SwitchFlags::PUBLISH_STATS;
     }
+    if (FLAGS_enable_standalone_rib) {
+      flags |= SwitchFlags::ENABLE_STANDALONE_RIB;
+    }
     return flags;
   }
 
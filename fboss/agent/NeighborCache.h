@@ -39,6 +39,7 @@ namespace facebook { namespace fboss {
 template <typename NTable>
 class NeighborCache {
   friend class NeighborCacheEntry<NTable>;
+  friend class NeighborCacheImpl<NTable>;
  public:
   typedef typename NTable::Entry::AddressType AddressType;
 
@@ -67,15 +68,14 @@ class NeighborCache {
     impl_->portDown(port);
   }
 
+  // Readers do not take the cache level lock, see NeighborCacheImpl
   template <typename NeighborEntryThrift>
   std::list<NeighborEntryThrift> getCacheData() {
-    std::lock_guard<std::mutex> g(cacheLock_);
     return impl_->template getCacheData<NeighborEntryThrift>();
   }
 
   template <typename NeighborEntryThrift>
   folly::Optional<NeighborEntryThrift> getCacheData(AddressType ip) {
-    std::lock_guard<std::mutex> g(cacheLock_);
     return impl_->template getCacheData<NeighborEntryThrift>(ip);
   }
 
@@ -140,7 +140,6 @@ class NeighborCache {
 
   std::unique_ptr<typename NeighborCacheImpl<NTable>::EntryFields>
   cloneEntryFields(AddressType ip) {
-    std::lock_guard<std::mutex> g(cacheLock_);
     // this intentionally makes a copy so that callers do not have a
     // reference to memory that could be deleted.
     return impl_->cloneEntryFields(ip);
@@ -202,6 +201,22 @@ class NeighborCache {
     return impl_->processEntry(ip);
   }
 
+  // This should only be called by the NeighborCacheImpl flush timeout
+  void flushQueuedUpdates() {
+    std::lock_guard<std::mutex> g(cacheLock_);
+    impl_->flushQueuedUpdates();
+  }
+
+  // These should only be called by a NeighborCacheEntry, with the cache
+  // level lock held
+  folly::HHWheelTimer* getWheelTimer() {
+    return impl_->getWheelTimer();
+  }
+
+  bool allowProbe() {
+    return impl_->allowProbe();
+  }
+
   // Has the entry corresponding to ip has been hit in hw
   bool isHit(AddressType ip) {
     return sw_->getAndClearNeighborHit(RouterID(0), ip);
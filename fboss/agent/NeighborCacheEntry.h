@@ -16,10 +16,17 @@
 #include "fboss/agent/state/NeighborEntry.h"
 #include "fboss/agent/state/PortDescriptor.h"
 
+#include <algorithm>
 #include <chrono>
 #include <folly/MacAddress.h>
 #include <folly/IPAddress.h>
+#include <folly/Optional.h>
 #include <folly/Random.h>
+#include <folly/io/async/HHWheelTimer.h>
+#include <gflags/gflags.h>
+
+DECLARE_int32(neighbor_probe_jitter_ms);
+DECLARE_int32(neighbor_probe_rate);
 
 /**
  * This class implements much of the neighbor resolution and unreachable
@@ -52,9 +59,14 @@
  * UNINITIALIZED - Placeholder on startup.
  *
  * Once an entry is created, it is responsible for scheduling the timeout for
- * its next update. When that timeout expires, the state machine is run and the
- * next update is scheduled. If the entry ever transitions to the EXPIRED state,
- * we do not schedule another update and the cache will flush the entry.
+ * its next update on the timer wheel of its cache. When that timeout expires,
+ * the state machine is run and the next update is scheduled. If the entry ever
+ * transitions to the EXPIRED state, we do not schedule another update and the
+ * cache will flush the entry. Probes are only sent as the cache allows. A
+ * probe held back is retried once the cache may have room for it again,
+ * without counting towards MAX_PROBES, but is held back for at most a probe
+ * interval before going out regardless, so that neither does an entry expire
+ * unprobed nor linger forever.
  *
  * There is no locking in this class. Instead, the class relies on the
  * synchronization provided by NeighborCache, which should lock around all calls
@@ -78,8 +90,9 @@ enum class NeighborEntryState : uint8_t {
 template <typename NTable> class NeighborCache;
 
 template <typename NTable>
-class NeighborCacheEntry : private folly::AsyncTimeout {
+class NeighborCacheEntry : private folly::HHWheelTimer::Callback {
  public:
+
   typedef typename NTable::Entry::AddressType AddressType;
   typedef NeighborCache<NTable> Cache;
   typedef NeighborCacheEntry<NTable> Entry;
@@ -88,8 +101,7 @@ class NeighborCacheEntry : private folly::AsyncTimeout {
                      folly::EventBase* evb,
                      Cache* cache,
                      NeighborEntryState state)
-      : AsyncTimeout(evb),
-        fields_(fields),
+      : fields_(fields),
         cache_(cache),
         evb_(evb),
         probesLeft_(cache_->getMaxNeighborProbes()) {
@@ -167,7 +179,7 @@ class NeighborCacheEntry : private folly::AsyncTimeout {
     return fields_.state == NeighborState::PENDING;
   }
 
-  const EntryFields& getFields() {
+  const EntryFields& getFields() const {
     return fields_;
   }
 
@@ -204,18 +216,39 @@ class NeighborCacheEntry : private folly::AsyncTimeout {
       state_ == NeighborEntryState::INCOMPLETE;
   }
 
-  template <typename NeighborEntryThrift>
-  void populateThriftEntry(NeighborEntryThrift& entry) const {
-    entry.ip = facebook::network::toBinaryAddress(getIP());
-    entry.mac = getMac().toString();
-    entry.port = getPort().asThriftPort();
-    entry.vlanName = cache_->getVlanName();
-    entry.vlanID = cache_->getVlanID();
-    entry.state = getStateName();
-    entry.ttl = getTtl();
+  /*
+   * The lifetime of a REACHABLE entry is decided when it enters REACHABLE,
+   * so that the cache can publish it along with the state.
+   */
+  std::chrono::steady_clock::time_point getExpireTime() const {
+    return expireTime_;
+  }
+
+  static std::string getStateName(NeighborEntryState state) {
+    switch(state) {
+      case NeighborEntryState::REACHABLE:
+        return "REACHABLE";
+      case NeighborEntryState::STALE:
+        return "STALE";
+      case NeighborEntryState::PROBE:
+        return "PROBE";
+      case NeighborEntryState::INCOMPLETE:
+        return "INCOMPLETE";
+      case NeighborEntryState::EXPIRED:
+        return "EXPIRED";
+      case NeighborEntryState::DELAY:
+        return "DELAY";
+      case NeighborEntryState::UNINITIALIZED:
+        return "UNINITIALIZED";
+      default:
+        throw FbossError("Found invalid state!");
+    }
   }
 
  private:
+  // Time between probes of a PROBE or INCOMPLETE entry
+  static constexpr std::chrono::seconds kProbeInterval{1};
+
   /*
    * We tell the cache that this entry needs to be processed. The cache is
    * responsible for serializing this with other flush or rx events to prevent
@@ -225,6 +258,32 @@ class NeighborCacheEntry : private folly::AsyncTimeout {
     cache_->processEntry(getIP());
   }
 
+  // The wheel only cancels its callbacks when it is destroyed, which the
+  // cache does after destroying all of its entries
+  void callbackCanceled() noexcept override {}
+
+  void scheduleTimeout(std::chrono::milliseconds timeout) {
+    cache_->getWheelTimer()->scheduleTimeout(this, timeout);
+  }
+
+  /*
+   * Spreads out the probes of entries that went stale or started probing
+   * at the same time, so they do not all go out on the same tick.
+   */
+  static std::chrono::milliseconds probeJitter() {
+    if (FLAGS_neighbor_probe_jitter_ms <= 0) {
+      return std::chrono::milliseconds(0);
+    }
+    return std::chrono::milliseconds(
+        folly::Random::rand32(FLAGS_neighbor_probe_jitter_ms + 1));
+  }
+
+  // Time until the probe rate allows another probe
+  static std::chrono::milliseconds probeRetryInterval() {
+    return std::chrono::milliseconds(
+        1000 / std::max(FLAGS_neighbor_probe_rate, 1));
+  }
+
   /*
    * Schedules an update on the evb_. This is done synchronously so that we
    * can have a destructor guard around both running the state machine and
@@ -232,19 +291,27 @@ class NeighborCacheEntry : private folly::AsyncTimeout {
    */
   void scheduleNextUpdate() {
     CHECK(evb_->inRunningEventBaseThread());
-    std::chrono::milliseconds lifetime;
     switch (state_) {
       case NeighborEntryState::REACHABLE:
-        lifetime = calculateLifetime();
-        expireTime_ = std::chrono::steady_clock::now() + lifetime;
-        scheduleTimeout(lifetime);
+        scheduleTimeout(std::max(
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                expireTime_ - std::chrono::steady_clock::now()),
+            std::chrono::milliseconds(0)));
         break;
       case NeighborEntryState::STALE:
-        scheduleTimeout(std::chrono::seconds(cache_->getStaleEntryInterval()));
+        scheduleTimeout(
+            std::chrono::seconds(cache_->getStaleEntryInterval()) +
+            probeJitter());
         break;
       case NeighborEntryState::PROBE:
       case NeighborEntryState::INCOMPLETE:
-        scheduleTimeout(std::chrono::seconds(1));
+        if (probeDeferred_) {
+          // Retry the probe once the cache may have room for another
+          probeDeferred_ = false;
+          scheduleTimeout(probeRetryInterval() + probeJitter());
+        } else {
+          scheduleTimeout(kProbeInterval + probeJitter());
+        }
         break;
       case NeighborEntryState::EXPIRED:
         // This entry is expired and is already flushed. Don't schedule a
@@ -283,6 +350,8 @@ class NeighborCacheEntry : private folly::AsyncTimeout {
    */
   void enter(NeighborEntryState state) {
     state_ = state;
+    probeDeferred_ = false;
+    probeDeferredSince_ = folly::none;
     switch (state) {
       case NeighborEntryState::INCOMPLETE:
         // We have already sent out a solictation for this so decrement
@@ -291,6 +360,7 @@ class NeighborCacheEntry : private folly::AsyncTimeout {
         break;
       case NeighborEntryState::REACHABLE:
         probesLeft_ = cache_->getMaxNeighborProbes();
+        expireTime_ = std::chrono::steady_clock::now() + calculateLifetime();
         break;
       case NeighborEntryState::STALE:
         // For STALE entries, we might as well run the state machine right away.
@@ -312,6 +382,19 @@ class NeighborCacheEntry : private folly::AsyncTimeout {
   void probeIfProbesLeft() {
     DCHECK(isProbing());
     if (hasProbesLeft()) {
+      auto now = std::chrono::steady_clock::now();
+      bool overdue = probeDeferredSince_.hasValue() &&
+          now - *probeDeferredSince_ >= kProbeInterval;
+      if (!overdue && !cache_->allowProbe()) {
+        // Over the probe rate, keep the probe for a retry
+        probeDeferred_ = true;
+        if (!probeDeferredSince_) {
+          probeDeferredSince_ = now;
+        }
+        return;
+      }
+      probeDeferredSince_ = folly::none;
+      --probesLeft_;
       if (state_ == NeighborEntryState::INCOMPLETE) {
         /* entry is INCOMPLETE, issue multicast probe */
         cache_->probeFor(getIP());
@@ -319,7 +402,6 @@ class NeighborCacheEntry : private folly::AsyncTimeout {
         /* entry is PROBE, issue unicast probe */
         cache_->checkReachability(getIP(), getMac(), getPort());
       }
-      --probesLeft_;
     } else {
       state_ = NeighborEntryState::EXPIRED;
     }
@@ -359,41 +441,6 @@ class NeighborCacheEntry : private folly::AsyncTimeout {
     }
   }
 
-  std::string getStateName(NeighborEntryState state) const {
-    switch(state) {
-      case NeighborEntryState::REACHABLE:
-        return "REACHABLE";
-      case NeighborEntryState::STALE:
-        return "STALE";
-      case NeighborEntryState::PROBE:
-        return "PROBE";
-      case NeighborEntryState::INCOMPLETE:
-        return "INCOMPLETE";
-      case NeighborEntryState::EXPIRED:
-        return "EXPIRED";
-      case NeighborEntryState::DELAY:
-        return "DELAY";
-      case NeighborEntryState::UNINITIALIZED:
-        return "UNINITIALIZED";
-      default:
-        throw FbossError("Found invalid state!");
-    }
-  }
-
-  std::string getStateName() const {
-    return getStateName(state_);
-  }
-
-  uint32_t getTtl() const {
-    if (state_ == NeighborEntryState::REACHABLE) {
-      std::chrono::milliseconds ttl =
-          std::chrono::duration_cast<std::chrono::milliseconds>(
-              expireTime_ - std::chrono::steady_clock::now());
-      return ttl.count();
-    }
-    return 0;
-  }
-
   // Fields needed to program the SwitchState
   EntryFields fields_;
 
@@ -403,6 +450,13 @@ class NeighborCacheEntry : private folly::AsyncTimeout {
   NeighborEntryState state_{NeighborEntryState::UNINITIALIZED};
   uint8_t probesLeft_{0};
   std::chrono::time_point<std::chrono::steady_clock> expireTime_;
+  // Whether the last probe was held back by the probe rate, and since when
+  // the probe has been held back
+  bool probeDeferred_{false};
+  folly::Optional<std::chrono::steady_clock::time_point> probeDeferredSince_;
 };
 
+template <typename NTable>
+constexpr std::chrono::seconds NeighborCacheEntry<NTable>::kProbeInterval;
+
 }} // facebook::fboss
@@ -14,13 +14,19 @@
 #include <folly/futures/Future.h>
 #include <folly/io/async/EventBase.h>
 #include <folly/logging/xlog.h>
+#include <algorithm>
+#include <chrono>
 #include <list>
 #include "fboss/agent/ArpHandler.h"
 #include "fboss/agent/IPv6Handler.h"
 #include "fboss/agent/NeighborCacheImpl.h"
+#include "fboss/agent/ParkedPacketQueue.h"
+#include "fboss/agent/SwSwitch.h"
+#include "fboss/agent/SwitchStats.h"
 #include "fboss/agent/state/ArpTable.h"
 #include "fboss/agent/state/NdpTable.h"
 #include "fboss/agent/state/NeighborEntry.h"
+#include "fboss/agent/state/StateUpdateHelpers.h"
 #include "fboss/agent/state/SwitchState.h"
 #include "fboss/agent/state/Vlan.h"
 #include "fboss/agent/types.h"
@@ -99,8 +105,43 @@ void NeighborCacheImpl<NTable>::programEntry(Entry* entry) {
     return newState;
   };
 
-  sw_->updateState(folly::to<std::string>("add neighbor ", fields.ip),
-                   std::move(updateFn));
+  if (batchUpdates()) {
+    queueUpdate(fields.ip, std::move(updateFn), false);
+    return;
+  }
+
+  auto name = folly::to<std::string>("add neighbor ", fields.ip);
+  if (!sw_->getParkedPacketQueue()) {
+    sw_->updateState(name, std::move(updateFn));
+    return;
+  }
+
+  // Send on the packets that were parked waiting for this neighbor, once the
+  // entry has made it to the hardware
+  auto sw = sw_;
+  auto ip = fields.ip;
+  auto flushParkedPkts = [sw, ip, vlanID]() {
+    flushParkedPackets(sw, vlanID, ip);
+  };
+  sw_->updateState(std::make_unique<FunctionStateUpdate>(
+      name, std::move(updateFn), true, std::move(flushParkedPkts)));
+}
+
+template <typename NTable>
+void NeighborCacheImpl<NTable>::flushParkedPackets(
+    SwSwitch* sw,
+    VlanID vlanID,
+    AddressType ip) {
+  auto vlan = sw->getState()->getVlans()->getVlanIf(vlanID);
+  auto entry = vlan
+      ? vlan->template getNeighborTable<NTable>()->getEntryIf(ip)
+      : nullptr;
+  if (entry && !entry->isPending()) {
+    sw->getParkedPacketQueue()->flush(vlanID, ip);
+  } else {
+    // The entry did not make it, the packets would just get trapped again
+    sw->getParkedPacketQueue()->discard(vlanID, ip);
+  }
 }
 
 
@@ -139,14 +180,155 @@ void NeighborCacheImpl<NTable>::programPendingEntry(Entry* entry, bool force) {
     return newState;
   };
 
+  if (batchUpdates()) {
+    queueUpdate(fields.ip, std::move(updateFn), true);
+    return;
+  }
+
   sw_->updateStateNoCoalescing(
     folly::to<std::string>("add pending entry ", fields.ip),
     std::move(updateFn));
 }
 
+template <typename NTable>
+void NeighborCacheImpl<NTable>::queueUpdate(
+    AddressType ip,
+    SwSwitch::StateUpdateFn fn,
+    bool pending) {
+  queuedUpdates_.push_back(
+      {ip, std::move(fn), pending, std::chrono::steady_clock::now()});
+  if (queuedUpdates_.size() >=
+      static_cast<size_t>(std::max(FLAGS_neighbor_update_batch_size, 1))) {
+    flushQueuedUpdates();
+    return;
+  }
+  if (queuedUpdates_.size() > 1) {
+    // The flush is already scheduled
+    return;
+  }
+
+  std::chrono::milliseconds delay(FLAGS_neighbor_update_batch_ms);
+  evbTimersUsed_ = true;
+  evb_->runInEventBaseThread([this, delay]() {
+    if (!flushTimeout_) {
+      auto cache = cache_;
+      flushTimeout_ = folly::AsyncTimeout::make(
+          *evb_, [cache]() noexcept { cache->flushQueuedUpdates(); });
+    }
+    if (!flushTimeout_->isScheduled()) {
+      flushTimeout_->scheduleTimeout(delay);
+    }
+  });
+}
+
+template <typename NTable>
+void NeighborCacheImpl<NTable>::flushQueuedUpdates() {
+  if (queuedUpdates_.empty()) {
+    return;
+  }
+  std::vector<QueuedUpdate> updates;
+  updates.swap(queuedUpdates_);
+
+  sw_->stats()->neighborUpdateBatch(
+      updates.size(),
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - updates.front().queued));
+
+  // Pending entries must reach the hardware even if the entry resolves
+  // right after, as they are programmed without coalescing one at a time
+  bool allowCoalesce = true;
+  std::vector<SwSwitch::StateUpdateFn> fns;
+  std::vector<AddressType> resolved;
+  fns.reserve(updates.size());
+  for (auto& update : updates) {
+    if (update.pending) {
+      allowCoalesce = false;
+    } else {
+      resolved.push_back(update.ip);
+    }
+    fns.push_back(std::move(update.fn));
+  }
+
+  auto updateFn = [fns = std::move(fns)](
+                      const std::shared_ptr<SwitchState>& state)
+      -> std::shared_ptr<SwitchState> {
+    std::shared_ptr<SwitchState> newState{state};
+    bool changed = false;
+    for (const auto& fn : fns) {
+      auto nextState = fn(newState);
+      if (nextState) {
+        newState = std::move(nextState);
+        changed = true;
+      }
+    }
+    return changed ? newState : nullptr;
+  };
+
+  FunctionStateUpdate::SuccessFn flushParkedPkts;
+  if (sw_->getParkedPacketQueue() && !resolved.empty()) {
+    auto sw = sw_;
+    auto vlanID = vlanID_;
+    flushParkedPkts = [sw, vlanID, resolved = std::move(resolved)]() {
+      for (const auto& ip : resolved) {
+        flushParkedPackets(sw, vlanID, ip);
+      }
+    };
+  }
+  sw_->updateState(std::make_unique<FunctionStateUpdate>(
+      folly::to<std::string>(
+          "program ", updates.size(), " neighbors on vlan ", vlanID_),
+      std::move(updateFn),
+      allowCoalesce,
+      std::move(flushParkedPkts)));
+}
+
+template <typename NTable>
+void NeighborCacheImpl<NTable>::dropQueuedUpdates(AddressType ip) {
+  queuedUpdates_.erase(
+      std::remove_if(
+          queuedUpdates_.begin(),
+          queuedUpdates_.end(),
+          [&ip](const QueuedUpdate& update) { return update.ip == ip; }),
+      queuedUpdates_.end());
+}
+
 template <typename NTable>
 NeighborCacheImpl<NTable>::~NeighborCacheImpl() {
+  // Updates still queued are dropped with the cache, which only goes away
+  // with its vlan or the switch
   clearEntries();
+  if (evbTimersUsed_) {
+    // After the entries, which are destroyed from evb_ ahead of this
+    evb_->runImmediatelyOrRunInEventBaseThreadAndWait([this]() {
+      flushTimeout_.reset();
+      wheelTimer_.reset();
+    });
+  }
+}
+
+template <typename NTable>
+folly::HHWheelTimer* NeighborCacheImpl<NTable>::getWheelTimer() {
+  DCHECK(evb_->isInEventBaseThread());
+  if (!wheelTimer_) {
+    wheelTimer_ = folly::HHWheelTimer::newTimer(
+        evb_,
+        std::chrono::milliseconds(std::max(FLAGS_neighbor_timer_tick_ms, 1)));
+  }
+  return wheelTimer_.get();
+}
+
+template <typename NTable>
+bool NeighborCacheImpl<NTable>::allowProbe() {
+  if (FLAGS_neighbor_probe_rate <= 0) {
+    return true;
+  }
+  // Allow a second's worth of probes in a burst
+  if (probeBucket_.consume(
+          1, FLAGS_neighbor_probe_rate, FLAGS_neighbor_probe_rate)) {
+    return true;
+  }
+  sw_->stats()->neighborProbeRateLimited();
+  return false;
 }
 
 template <typename NTable>
@@ -170,6 +352,7 @@ void NeighborCacheImpl<NTable>::clearEntries() {
   }
   folly::collectAllSemiFuture(stopTasks).get();
   entries_.clear();
+  shards_.clear();
 }
 
 template <typename NTable>
@@ -213,6 +396,7 @@ void NeighborCacheImpl<NTable>::updateEntryState(AddressType ip,
   auto entry = getCacheEntry(ip);
   if (entry) {
     entry->updateState(state);
+    publishEntry(entry);
   }
 }
 
@@ -228,12 +412,15 @@ NeighborCacheEntry<NTable>* NeighborCacheImpl<NTable>::setEntryInternal(
       entry->updateFields(fields);
     }
     entry->updateState(state);
+    publishEntry(entry);
     return changed ? entry : nullptr;
   } else if (add) {
+    evbTimersUsed_ = true;
     auto evb = evb_;
     auto to_store = std::make_shared<Entry>(fields, evb, cache_, state);
     entry = to_store.get();
     setCacheEntry(std::move(to_store));
+    publishEntry(entry);
   }
   return entry;
 }
@@ -262,6 +449,8 @@ void NeighborCacheImpl<NTable>::processEntry(AddressType ip) {
     entry->process();
     if (entry->getState() == NeighborEntryState::EXPIRED) {
       flushEntry(ip);
+    } else {
+      publishEntry(entry);
     }
   }
 }
@@ -297,10 +486,24 @@ bool NeighborCacheImpl<NTable>::removeEntry(AddressType ip) {
   Entry::destroy(std::move(it->second), evb_);
 
   entries_.erase(it);
+  shards_.erase(ip);
 
   return true;
 }
 
+template <typename NTable>
+void NeighborCacheImpl<NTable>::publishEntry(const Entry* entry) {
+  // Most updates, e.g. an entry probing again, change nothing readers see
+  auto current = shards_.get(entry->getIP());
+  if (current && entry->fieldsMatch(current->fields) &&
+      current->state == entry->getState() &&
+      current->expireTime == entry->getExpireTime()) {
+    return;
+  }
+  shards_.set(std::make_shared<NeighborCacheRecord<NTable>>(
+      entry->getFields(), entry->getState(), entry->getExpireTime()));
+}
+
 template <typename NTable>
 bool NeighborCacheImpl<NTable>::flushEntryFromSwitchState(
     std::shared_ptr<SwitchState>* state, AddressType ip) {
@@ -325,6 +528,9 @@ bool NeighborCacheImpl<NTable>::flushEntryBlocking(AddressType ip) {
 
 template <typename NTable>
 void NeighborCacheImpl<NTable>::flushEntry(AddressType ip, bool* flushed) {
+  // The entry must not be programmed again by a batch queued before
+  dropQueuedUpdates(ip);
+
   // remove from cache
   if (!removeEntry(ip)) {
     return;
@@ -355,10 +561,10 @@ void NeighborCacheImpl<NTable>::flushEntry(AddressType ip, bool* flushed) {
 
 template <typename NTable>
 std::unique_ptr<typename NeighborCacheImpl<NTable>::EntryFields>
-NeighborCacheImpl<NTable>::cloneEntryFields(AddressType ip) {
-  auto entry = getCacheEntry(ip);
-  if (entry) {
-    return std::make_unique<EntryFields>(entry->getFields());
+NeighborCacheImpl<NTable>::cloneEntryFields(AddressType ip) const {
+  auto record = shards_.get(ip);
+  if (record) {
+    return std::make_unique<EntryFields>(record->fields);
   }
   return nullptr;
 }
@@ -386,9 +592,9 @@ template <typename NTable>
 template <typename NeighborEntryThrift>
 std::list<NeighborEntryThrift> NeighborCacheImpl<NTable>::getCacheData() const {
   std::list<NeighborEntryThrift> thriftEntries;
-  for (const auto& item : entries_) {
+  for (const auto& record : shards_.getAll()) {
     NeighborEntryThrift thriftEntry;
-    item.second->populateThriftEntry(thriftEntry);
+    record->populateThriftEntry(thriftEntry, vlanID_, vlanName_);
     thriftEntries.push_back(thriftEntry);
   }
   return thriftEntries;
@@ -399,10 +605,10 @@ template <typename NeighborEntryThrift>
 folly::Optional<NeighborEntryThrift> NeighborCacheImpl<NTable>::getCacheData(
     AddressType ip) const {
   folly::Optional<NeighborEntryThrift> cachedNeighborEntry;
-  auto entry = getCacheEntry(ip);
-  if (entry) {
+  auto record = shards_.get(ip);
+  if (record) {
     NeighborEntryThrift thriftEntry;
-    entry->populateThriftEntry(thriftEntry);
+    record->populateThriftEntry(thriftEntry, vlanID_, vlanName_);
     cachedNeighborEntry.assign(thriftEntry);
   }
   return cachedNeighborEntry;
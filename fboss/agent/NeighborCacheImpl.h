@@ -13,14 +13,26 @@
 #include "fboss/agent/FbossError.h"
 #include "fboss/agent/types.h"
 #include "fboss/agent/NeighborCacheEntry.h"
+#include "fboss/agent/NeighborCacheShards.h"
 #include "fboss/agent/state/NeighborEntry.h"
 #include "fboss/agent/state/PortDescriptor.h"
 
 #include <folly/IPAddress.h>
 #include <folly/Optional.h>
 #include <folly/Random.h>
+#include <folly/TokenBucket.h>
+#include <folly/io/async/AsyncTimeout.h>
+#include <folly/io/async/HHWheelTimer.h>
+#include <gflags/gflags.h>
+#include <chrono>
 #include <list>
 #include <string>
+#include <vector>
+
+DECLARE_int32(neighbor_update_batch_ms);
+DECLARE_int32(neighbor_update_batch_size);
+DECLARE_int32(neighbor_timer_tick_ms);
+DECLARE_int32(neighbor_probe_rate);
 
 namespace facebook { namespace fboss {
 
@@ -36,7 +48,18 @@ template <typename NTable> class NeighborCache;
  *
  * All calls into this should have acquired a cache level lock through
  * NeighborCache so only one thread should ever be operating on the
- * cache at a given time.
+ * cache at a given time. The exception are the readers, cloneEntryFields()
+ * and getCacheData(), which read the copies of the entries published to
+ * shards_ with every change and so never wait on the lock.
+ *
+ * Entries schedule their updates on a timer wheel owned by the cache, so
+ * that aging the table costs a single event base timer however many
+ * entries there are. Entries due on the same tick are processed together,
+ * and FLAGS_neighbor_probe_rate caps the probes they send per second.
+ *
+ * With FLAGS_neighbor_update_batch_ms set, entries to program are queued
+ * and programmed together in a single state update, once the oldest has
+ * waited that long or FLAGS_neighbor_update_batch_size are queued.
  */
 template <typename NTable>
 class NeighborCacheImpl {
@@ -81,7 +104,8 @@ class NeighborCacheImpl {
   void updateEntryState(AddressType ip,
                         NeighborEntryState state);
 
-  std::unique_ptr<EntryFields> cloneEntryFields(AddressType ip);
+  // Does not need the cache level lock
+  std::unique_ptr<EntryFields> cloneEntryFields(AddressType ip) const;
 
   void portDown(PortDescriptor port);
 
@@ -112,6 +136,7 @@ class NeighborCacheImpl {
   // Has the entry corresponding to ip has been hit in hw
   bool isHit(AddressType ip);
 
+  // Do not need the cache level lock
   template <typename NeighborEntryThrift>
   std::list<NeighborEntryThrift> getCacheData() const;
 
@@ -121,10 +146,40 @@ class NeighborCacheImpl {
   void clearEntries();
 
  private:
+  // An entry waiting to be programmed with the next batch
+  struct QueuedUpdate {
+    AddressType ip;
+    SwSwitch::StateUpdateFn fn;
+    bool pending;
+    std::chrono::steady_clock::time_point queued;
+  };
+
   // These are used to program entries into the SwitchState
   void programEntry(Entry* entry);
   void programPendingEntry(Entry* entry, bool force = false);
 
+  static bool batchUpdates() {
+    return FLAGS_neighbor_update_batch_ms > 0;
+  }
+
+  // Queue an entry to be programmed with the next batch
+  void queueUpdate(AddressType ip, SwSwitch::StateUpdateFn fn, bool pending);
+
+  // Program all queued entries in a single state update
+  void flushQueuedUpdates();
+
+  // Forget queued updates to ip, as the entry is being flushed
+  void dropQueuedUpdates(AddressType ip);
+
+  // Send on the packets parked waiting for ip, once the entry is programmed
+  static void flushParkedPackets(SwSwitch* sw, VlanID vlanID, AddressType ip);
+
+  // The timer wheel entries schedule their updates on, only used from evb_
+  folly::HHWheelTimer* getWheelTimer();
+
+  // Whether an entry may send a probe now
+  bool allowProbe();
+
   void processEntry(AddressType ip);
 
   // Pass in a non-null flushed if you care whether an entry
@@ -138,6 +193,9 @@ class NeighborCacheImpl {
   void setCacheEntry(std::shared_ptr<Entry> entry);
   bool removeEntry(AddressType ip);
 
+  // Make the current state of entry visible to readers, if it changed
+  void publishEntry(const Entry* entry);
+
   Entry* setEntryInternal(const EntryFields& fields,
                           NeighborEntryState state,
                           bool add = true);
@@ -155,6 +213,17 @@ class NeighborCacheImpl {
 
   // Map of all entries
   std::unordered_map<AddressType, std::shared_ptr<Entry>> entries_;
+  // What readers see of entries_
+  NeighborCacheShards<NTable> shards_;
+
+  std::vector<QueuedUpdate> queuedUpdates_;
+  // Flushes the queued updates from evb_, only used from evb_
+  std::unique_ptr<folly::AsyncTimeout> flushTimeout_;
+  folly::HHWheelTimer::UniquePtr wheelTimer_;
+  // Whether the timers above may have been created, and must be destroyed
+  // from evb_
+  bool evbTimersUsed_{false};
+  folly::DynamicTokenBucket probeBucket_;
 };
 
 }} // facebook::fboss
@@ -0,0 +1,158 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include "fboss/agent/AddressUtil.h"
+#include "fboss/agent/NeighborCacheEntry.h"
+#include "fboss/agent/types.h"
+#include "fboss/agent/state/NeighborEntry.h"
+
+#include <folly/SpinLock.h>
+#include <array>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace facebook { namespace fboss {
+
+/*
+ * An immutable copy of what readers need of a NeighborCacheEntry.
+ */
+template <typename NTable>
+struct NeighborCacheRecord {
+  typedef typename NTable::Entry::AddressType AddressType;
+  typedef NeighborEntryFields<AddressType> EntryFields;
+
+  NeighborCacheRecord(
+      const EntryFields& fields,
+      NeighborEntryState state,
+      std::chrono::steady_clock::time_point expireTime)
+      : fields(fields), state(state), expireTime(expireTime) {}
+
+  template <typename NeighborEntryThrift>
+  void populateThriftEntry(
+      NeighborEntryThrift& entry,
+      VlanID vlanID,
+      const std::string& vlanName) const {
+    entry.ip = facebook::network::toBinaryAddress(fields.ip);
+    entry.mac = fields.mac.toString();
+    entry.port = fields.port.asThriftPort();
+    entry.vlanName = vlanName;
+    entry.vlanID = vlanID;
+    entry.state = NeighborCacheEntry<NTable>::getStateName(state);
+    entry.ttl = getTtl();
+  }
+
+  uint32_t getTtl() const {
+    if (state != NeighborEntryState::REACHABLE) {
+      return 0;
+    }
+    auto ttl = std::chrono::duration_cast<std::chrono::milliseconds>(
+        expireTime - std::chrono::steady_clock::now());
+    return ttl.count() > 0 ? ttl.count() : 0;
+  }
+
+  const EntryFields fields;
+  const NeighborEntryState state;
+  const std::chrono::steady_clock::time_point expireTime;
+};
+
+/*
+ * The entries of a NeighborCache as readers see them, hash-partitioned by
+ * IP. Each shard is a map of immutable records guarded by a spin lock.
+ * Writers replace a single record under the lock of its shard, and readers
+ * only hold the lock long enough to copy out the records they want, so
+ * neither waits on the cache level lock nor on the other for long.
+ *
+ * Writes must be serialized by the caller, NeighborCacheImpl publishes
+ * every change of its entries here with the cache level lock held.
+ */
+template <typename NTable>
+class NeighborCacheShards {
+ public:
+  typedef typename NTable::Entry::AddressType AddressType;
+  typedef NeighborCacheRecord<NTable> Record;
+
+  static constexpr size_t kNumShards = 64;
+
+  std::shared_ptr<const Record> get(const AddressType& ip) const {
+    const auto& shard = shardFor(ip);
+    folly::SpinLockGuard guard(shard.lock);
+    auto it = shard.map.find(ip);
+    return it != shard.map.end() ? it->second : nullptr;
+  }
+
+  std::vector<std::shared_ptr<const Record>> getAll() const {
+    std::vector<std::shared_ptr<const Record>> records;
+    for (const auto& shard : shards_) {
+      folly::SpinLockGuard guard(shard.lock);
+      for (const auto& item : shard.map) {
+        records.push_back(item.second);
+      }
+    }
+    return records;
+  }
+
+  void set(std::shared_ptr<const Record> record) {
+    auto& shard = shardFor(record->fields.ip);
+    // Swap the new record in, so the old one is dropped outside of the lock
+    {
+      folly::SpinLockGuard guard(shard.lock);
+      shard.map[record->fields.ip].swap(record);
+    }
+  }
+
+  void erase(const AddressType& ip) {
+    auto& shard = shardFor(ip);
+    std::shared_ptr<const Record> old;
+    {
+      folly::SpinLockGuard guard(shard.lock);
+      auto it = shard.map.find(ip);
+      if (it == shard.map.end()) {
+        return;
+      }
+      old.swap(it->second);
+      shard.map.erase(it);
+    }
+  }
+
+  void clear() {
+    for (auto& shard : shards_) {
+      Map old;
+      {
+        folly::SpinLockGuard guard(shard.lock);
+        old.swap(shard.map);
+      }
+    }
+  }
+
+ private:
+  typedef std::unordered_map<AddressType, std::shared_ptr<const Record>> Map;
+
+  struct Shard {
+    mutable folly::SpinLock lock;
+    Map map;
+  };
+
+  Shard& shardFor(const AddressType& ip) {
+    return shards_[std::hash<AddressType>()(ip) % kNumShards];
+  }
+
+  const Shard& shardFor(const AddressType& ip) const {
+    return shards_[std::hash<AddressType>()(ip) % kNumShards];
+  }
+
+  std::array<Shard, kNumShards> shards_;
+};
+
+}} // facebook::fboss
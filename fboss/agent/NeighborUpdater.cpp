@@ -26,6 +26,7 @@
 
 #include <boost/container/flat_map.hpp>
 #include <folly/logging/xlog.h>
+#include <gflags/gflags.h>
 #include <list>
 #include <mutex>
 #include <string>
@@ -38,6 +39,22 @@ using folly::MacAddress;
 using folly::IPAddressV4;
 using folly::IPAddressV6;
 
+DEFINE_int32(neighbor_update_batch_ms, 0,
+    "Program resolved neighbors in batches, waiting up to this long for "
+    "more neighbors to program with an entry. Off when 0");
+DEFINE_int32(neighbor_update_batch_size, 256,
+    "Program a batch of neighbors as soon as it has this many entries");
+DEFINE_int32(neighbor_timer_tick_ms, 10,
+    "Tick of the timer wheel neighbor entries age on, entries due on the "
+    "same tick are processed together");
+DEFINE_int32(neighbor_probe_rate, 0,
+    "Most ARP requests and neighbor solicitations each vlan sends per "
+    "second to probe its entries. Probes over the limit are retried as the "
+    "limit allows, but held back for at most a second. No limit when 0");
+DEFINE_int32(neighbor_probe_jitter_ms, 0,
+    "Delay each neighbor probe by up to this long, to spread out probes "
+    "of entries that age together");
+
 namespace facebook { namespace fboss {
 
 using facebook::fboss::DeltaFunctions::forEachChanged;
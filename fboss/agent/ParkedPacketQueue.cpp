@@ -0,0 +1,155 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/ParkedPacketQueue.h"
+
+#include <folly/logging/xlog.h>
+#include "fboss/agent/SwSwitch.h"
+#include "fboss/agent/SwitchStats.h"
+#include "fboss/agent/TxPacket.h"
+
+#include <vector>
+
+using std::unique_ptr;
+
+namespace facebook { namespace fboss {
+
+ParkedPacketQueue::ParkedPacketQueue(
+    SwSwitch* sw,
+    uint32_t maxPktsPerNeighbor,
+    uint32_t maxBytes,
+    std::chrono::milliseconds maxAge)
+    : sw_(sw),
+      maxPktsPerNeighbor_(maxPktsPerNeighbor),
+      maxBytes_(maxBytes),
+      maxAge_(maxAge) {}
+
+bool ParkedPacketQueue::park(
+    VlanID vlan,
+    folly::IPAddress ip,
+    folly::io::Cursor l3,
+    uint32_t l3Len) {
+  if (maxPktsPerNeighbor_ == 0 || l3Len > maxBytes_) {
+    return false;
+  }
+  // Copy the packet out, rather than hold on to the rx buffer
+  auto pkt = sw_->allocateL3TxPacket(l3Len);
+  try {
+    l3.pull(pkt->buf()->writableData(), l3Len);
+  } catch (const std::out_of_range&) {
+    XLOG(DBG3) << "packet for " << ip << " is shorter than its L3 length "
+               << l3Len << ", not parking it";
+    return false;
+  }
+  pkt->buf()->append(l3Len);
+
+  auto now = Clock::now();
+  std::lock_guard<std::mutex> guard(mutex_);
+  if (bytes_ + l3Len > maxBytes_) {
+    expireLocked(now);
+    if (bytes_ + l3Len > maxBytes_) {
+      return false;
+    }
+  }
+  auto& pkts = parked_[std::make_pair(vlan, ip)];
+  // Make room by dropping the oldest packet
+  while (pkts.size() >= maxPktsPerNeighbor_) {
+    dropFrontLocked(&pkts);
+  }
+  pkts.emplace_back(std::move(pkt), l3Len, now);
+  bytes_ += l3Len;
+  ++packets_;
+  sw_->stats()->pktParked();
+  XLOG(DBG4) << "parked packet for " << ip << " on vlan " << vlan << ", "
+             << pkts.size() << " parked for it";
+  return true;
+}
+
+uint32_t ParkedPacketQueue::flush(VlanID vlan, folly::IPAddress ip) {
+  auto expiry = Clock::now() - maxAge_;
+  std::vector<unique_ptr<TxPacket>> toSend;
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = parked_.find(std::make_pair(vlan, ip));
+    if (it == parked_.end()) {
+      return 0;
+    }
+    auto& pkts = it->second;
+    while (!pkts.empty() && pkts.front().parkedAt < expiry) {
+      dropFrontLocked(&pkts);
+    }
+    toSend.reserve(pkts.size());
+    for (auto& parked : pkts) {
+      bytes_ -= parked.length;
+      --packets_;
+      toSend.push_back(std::move(parked.pkt));
+    }
+    parked_.erase(it);
+  }
+
+  // Send outside the lock, packets can be trapped and parked meanwhile
+  for (auto& pkt : toSend) {
+    sw_->sendL3Packet(std::move(pkt));
+    sw_->stats()->parkedPktSent();
+  }
+  if (!toSend.empty()) {
+    XLOG(DBG3) << "sent " << toSend.size() << " packets parked for " << ip
+               << " on vlan " << vlan;
+  }
+  return toSend.size();
+}
+
+void ParkedPacketQueue::discard(VlanID vlan, folly::IPAddress ip) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto it = parked_.find(std::make_pair(vlan, ip));
+  if (it == parked_.end()) {
+    return;
+  }
+  auto& pkts = it->second;
+  while (!pkts.empty()) {
+    dropFrontLocked(&pkts);
+  }
+  parked_.erase(it);
+}
+
+uint32_t ParkedPacketQueue::packets() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return packets_;
+}
+
+uint32_t ParkedPacketQueue::bytes() const {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return bytes_;
+}
+
+void ParkedPacketQueue::expireLocked(Clock::time_point now) {
+  auto expiry = now - maxAge_;
+  auto it = parked_.begin();
+  while (it != parked_.end()) {
+    auto& pkts = it->second;
+    // Packets are parked in order, so the oldest are at the front
+    while (!pkts.empty() && pkts.front().parkedAt < expiry) {
+      dropFrontLocked(&pkts);
+    }
+    if (pkts.empty()) {
+      it = parked_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void ParkedPacketQueue::dropFrontLocked(std::deque<ParkedPacket>* pkts) {
+  bytes_ -= pkts->front().length;
+  --packets_;
+  pkts->pop_front();
+  sw_->stats()->parkedPktDropped();
+}
+
+}} // facebook::fboss
@@ -0,0 +1,116 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/IPAddress.h>
+#include <folly/io/Cursor.h>
+
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "fboss/agent/types.h"
+
+namespace facebook { namespace fboss {
+
+class SwSwitch;
+class TxPacket;
+
+/*
+ * ParkedPacketQueue holds on to packets trapped to the CPU because their
+ * next hop is not resolved yet, until the next hop resolves.
+ *
+ * Packets are kept per neighbor, keyed by the VLAN and IP of the next hop,
+ * and are sent on once the neighbor entry is programmed. Without this the
+ * first packet(s) of every flow towards a new neighbor are lost, e.g. a TCP
+ * SYN, which then costs the flow a whole retransmit timeout.
+ *
+ * The queue is bounded in three ways. Each neighbor holds at most
+ * maxPktsPerNeighbor packets, the oldest one being dropped to make room for
+ * a new one, as RFC 4861 suggests. Packets older than maxAge are never sent.
+ * The L3 bytes held across all neighbors never exceed maxBytes.
+ *
+ * Packets may be parked from any thread.
+ */
+class ParkedPacketQueue {
+ public:
+  ParkedPacketQueue(
+      SwSwitch* sw,
+      uint32_t maxPktsPerNeighbor,
+      uint32_t maxBytes,
+      std::chrono::milliseconds maxAge);
+
+  /*
+   * Park a copy of the l3Len bytes long L3 packet at l3 until the neighbor
+   * ip on vlan resolves.
+   *
+   * Returns false if there is no room to park the packet, the caller then
+   * accounts for it as dropped.
+   */
+  bool park(
+      VlanID vlan,
+      folly::IPAddress ip,
+      folly::io::Cursor l3,
+      uint32_t l3Len);
+
+  /*
+   * Send out every packet parked for the neighbor ip on vlan through
+   * SwSwitch::sendL3Packet(), now that the neighbor is resolved. Returns the
+   * number of packets sent.
+   */
+  uint32_t flush(VlanID vlan, folly::IPAddress ip);
+
+  /*
+   * Drop every packet parked for the neighbor ip on vlan, e.g. because the
+   * neighbor could not be programmed.
+   */
+  void discard(VlanID vlan, folly::IPAddress ip);
+
+  uint32_t packets() const;
+  uint32_t bytes() const;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+  using Key = std::pair<VlanID, folly::IPAddress>;
+
+  struct ParkedPacket {
+    ParkedPacket(
+        std::unique_ptr<TxPacket> pkt,
+        uint32_t length,
+        Clock::time_point parkedAt)
+        : pkt(std::move(pkt)), parkedAt(parkedAt), length(length) {}
+
+    std::unique_ptr<TxPacket> pkt;
+    Clock::time_point parkedAt;
+    uint32_t length;
+  };
+
+  // Forbidden copy constructor and assignment operator
+  ParkedPacketQueue(ParkedPacketQueue const &) = delete;
+  ParkedPacketQueue& operator=(ParkedPacketQueue const &) = delete;
+
+  // Drop the packets parked longer than maxAge_, for all neighbors
+  void expireLocked(Clock::time_point now);
+  void dropFrontLocked(std::deque<ParkedPacket>* pkts);
+
+  SwSwitch* sw_{nullptr};
+  const uint32_t maxPktsPerNeighbor_;
+  const uint32_t maxBytes_;
+  const Clock::duration maxAge_;
+
+  mutable std::mutex mutex_;
+  std::map<Key, std::deque<ParkedPacket>> parked_;
+  uint32_t packets_{0};
+  uint32_t bytes_{0};
+};
+
+}} // facebook::fboss
@@ -19,12 +19,15 @@ namespace facebook { namespace fboss {
 const std::string kNameKeySeperator = ".";
 const std::string kUp = "up";
 const std::string kLinkStateFlap = "link_state.flap";
+const std::string kRxQueue = "rx_queue";
+const std::string kDrops = "drops";
 
 PortStats::PortStats(PortID portID, std::string portName,
                      SwitchStats *switchStats)
   : portID_(portID),
     portName_(portName),
     switchStats_(switchStats) {
+  setRxQueueDropKeys();
 }
 
 PortStats::~PortStats() {
@@ -36,6 +39,18 @@ void PortStats::setPortName(const std::string &portName) {
   // clear counter
   clearPortStatusCounter();
   portName_ = portName;
+  setRxQueueDropKeys();
+}
+
+void PortStats::setRxQueueDropKeys() {
+  for (auto i = 0; i < RxPacketDispatcher::NUM_QUEUES; ++i) {
+    rxQueueDropKeys_[i] = getCounterKey(folly::to<std::string>(
+        kRxQueue,
+        kNameKeySeperator,
+        RxPacketDispatcher::queueName(RxPacketDispatcher::Queue(i)),
+        kNameKeySeperator,
+        kDrops));
+  }
 }
 
 void PortStats::trappedPkt() {
@@ -53,6 +68,12 @@ void PortStats::pktError() {
 void PortStats::pktUnhandled() {
   switchStats_->pktUnhandled();
 }
+void PortStats::rxQueueDropped(RxPacketDispatcher::Queue queue) {
+  if (!portName_.empty()) {
+    tcData().addStatValue(rxQueueDropKeys_[queue], 1, SUM);
+  }
+  switchStats_->rxQueueDropped();
+}
 void PortStats::pktToHost(uint32_t bytes) {
   switchStats_->pktToHost(bytes);
 }
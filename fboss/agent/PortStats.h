@@ -9,8 +9,14 @@
  */
 #pragma once
 
+#include "fboss/agent/RxPacketDispatcher.h"
 #include "fboss/agent/types.h"
 
+#include <folly/Range.h>
+
+#include <array>
+#include <string>
+
 namespace facebook { namespace fboss {
 
 class SwitchStats;
@@ -25,6 +31,8 @@ class PortStats {
   void pktBogus();
   void pktError();
   void pktUnhandled();
+  // Dropped because the rx queue was full
+  void rxQueueDropped(RxPacketDispatcher::Queue queue);
   void pktToHost(uint32_t bytes); // number of packets forward to host
 
   void arpPkt();
@@ -78,6 +86,7 @@ class PortStats {
   PortStats& operator=(PortStats const &) = delete;
 
   std::string getCounterKey(const std::string& key);
+  void setRxQueueDropKeys();
 
   /*
    * It's useful to store this
@@ -89,6 +98,10 @@ class PortStats {
    */
   std::string portName_;
 
+  // Counter keys of rxQueueDropped(), built up front as drops come in
+  // bursts on the rx threads
+  std::array<std::string, RxPacketDispatcher::NUM_QUEUES> rxQueueDropKeys_;
+
   // Pointer to main SwitchStats object so that we can forward method calls
   // that we do not want to track ourselves.
   SwitchStats *switchStats_;
@@ -61,7 +61,12 @@ RouteUpdateLogger::RouteUpdateLogger(
     SwSwitch* sw,
     std::unique_ptr<RouteLogger<folly::IPAddressV4>> routeLoggerV4,
     std::unique_ptr<RouteLogger<folly::IPAddressV6>> routeLoggerV6)
-    : AutoRegisterStateObserver(sw, "RouteUpdateLogger"),
+    // Matching every changed route against the tracked prefixes is only
+    // for logging, so keep it off the update thread.
+    : AutoRegisterStateObserver(
+          sw,
+          "RouteUpdateLogger",
+          sw->getBackgroundEvb()),
       routeLoggerV4_(std::move(routeLoggerV4)),
       routeLoggerV6_(std::move(routeLoggerV6)) {}
 
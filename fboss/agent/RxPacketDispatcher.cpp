@@ -0,0 +1,213 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/RxPacketDispatcher.h"
+
+#include "fboss/agent/RxPacket.h"
+#include "fboss/agent/Utils.h"
+#include "fboss/agent/packet/Ethertype.h"
+#include "fboss/agent/packet/ICMPHdr.h"
+#include "fboss/agent/packet/IPProto.h"
+
+#include <folly/io/Cursor.h>
+#include <glog/logging.h>
+
+#include <vector>
+
+using folly::io::Cursor;
+using std::unique_ptr;
+
+namespace facebook { namespace fboss {
+
+namespace {
+// Size of an IPv6 header, up to the ICMPv6 type
+constexpr uint32_t kIPv6HdrSize = 40;
+// Offset of the next header field in the IPv6 header
+constexpr uint32_t kIPv6NextHdrOffset = 6;
+
+// Thread names are limited to 15 characters
+const char* const kThreadNames[RxPacketDispatcher::NUM_THREADS] = {
+    "fbossRxControl",
+    "fbossRxData",
+};
+
+bool isNdp(uint8_t icmpType) {
+  return icmpType >= static_cast<uint8_t>(
+             ICMPv6Type::ICMPV6_TYPE_NDP_ROUTER_SOLICITATION) &&
+      icmpType <= static_cast<uint8_t>(
+             ICMPv6Type::ICMPV6_TYPE_NDP_REDIRECT_MESSAGE);
+}
+} // namespace
+
+RxPacketDispatcher::RxPacketDispatcher(
+    PacketHandler handler,
+    DropHandler dropHandler,
+    const QueueDepths& queueDepths,
+    uint32_t batchSize)
+    : handler_(std::move(handler)),
+      dropHandler_(std::move(dropHandler)),
+      batchSize_(std::max(batchSize, 1u)) {
+  for (auto i = 0; i < NUM_QUEUES; ++i) {
+    CHECK_GT(queueDepths[i], 0) << "Depth of " << queueName(Queue(i))
+                                << " rx queue must be positive";
+    queues_[i] = std::make_unique<RxQueue>(queueDepths[i]);
+  }
+  for (auto i = 0; i < NUM_THREADS; ++i) {
+    threads_[i] = std::make_unique<RxThread>();
+  }
+}
+
+RxPacketDispatcher::~RxPacketDispatcher() {
+  stop();
+}
+
+void RxPacketDispatcher::start() {
+  CHECK(!started_);
+  started_ = true;
+  // A previous stop() leaves stopping_ set
+  stopping_.store(false);
+  for (auto i = 0; i < NUM_THREADS; ++i) {
+    threads_[i]->thread = std::thread([this, i] { threadLoop(Thread(i)); });
+  }
+}
+
+void RxPacketDispatcher::stop() {
+  if (!started_) {
+    return;
+  }
+  stopping_.store(true);
+  for (auto& rxThread : threads_) {
+    {
+      std::lock_guard<std::mutex> guard(rxThread->mutex);
+      rxThread->cv.notify_one();
+    }
+    rxThread->thread.join();
+  }
+  started_ = false;
+}
+
+bool RxPacketDispatcher::dispatch(unique_ptr<RxPacket> pkt) {
+  auto queue = classify(pkt.get());
+  auto& rxQueue = *queues_[queue];
+  // write() leaves pkt alone if the ring is full
+  if (!rxQueue.ring.write(std::move(pkt))) {
+    dropHandler_(pkt.get(), queue);
+    return false;
+  }
+  // Pairs with the fence in threadLoop(). Either we see the queue thread
+  // going to sleep, or it sees the packet we just queued.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  auto& rxThread = *threads_[queueThread(queue)];
+  if (rxThread.sleeping.load(std::memory_order_relaxed)) {
+    std::lock_guard<std::mutex> guard(rxThread.mutex);
+    rxThread.cv.notify_one();
+  }
+  return true;
+}
+
+bool RxPacketDispatcher::threadHasPackets(Thread thread) const {
+  for (auto i = 0; i < NUM_QUEUES; ++i) {
+    if (queueThread(Queue(i)) == thread && !queues_[i]->ring.isEmpty()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void RxPacketDispatcher::threadLoop(Thread thread) {
+  initThread(kThreadNames[thread]);
+  auto& rxThread = *threads_[thread];
+  std::vector<unique_ptr<RxPacket>> batch;
+  batch.reserve(batchSize_);
+  while (!stopping_.load()) {
+    bool morePending = false;
+    for (auto i = 0; i < NUM_QUEUES; ++i) {
+      if (queueThread(Queue(i)) != thread) {
+        continue;
+      }
+      // Take the whole batch off the ring first, to free up its slots
+      auto& ring = queues_[i]->ring;
+      unique_ptr<RxPacket> pkt;
+      while (batch.size() < batchSize_ && ring.read(pkt)) {
+        batch.push_back(std::move(pkt));
+      }
+      // There may be more waiting
+      morePending |= batch.size() == batchSize_;
+      for (auto& batchPkt : batch) {
+        handler_(std::move(batchPkt));
+      }
+      batch.clear();
+    }
+    if (morePending) {
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(rxThread.mutex);
+    rxThread.sleeping.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    rxThread.cv.wait(
+        lock, [&] { return threadHasPackets(thread) || stopping_.load(); });
+    rxThread.sleeping.store(false, std::memory_order_relaxed);
+  }
+}
+
+RxPacketDispatcher::Queue RxPacketDispatcher::classify(const RxPacket* pkt) {
+  try {
+    Cursor c(pkt->buf());
+    // Skip the destination and source MACs
+    c += 12;
+    auto ethertype = c.readBE<uint16_t>();
+    if (ethertype == static_cast<uint16_t>(ETHERTYPE::ETHERTYPE_VLAN)) {
+      c += 2;
+      ethertype = c.readBE<uint16_t>();
+    }
+    switch (static_cast<ETHERTYPE>(ethertype)) {
+      case ETHERTYPE::ETHERTYPE_SLOW_PROTOCOLS:
+      case ETHERTYPE::ETHERTYPE_LLDP:
+        return CONTROL;
+      case ETHERTYPE::ETHERTYPE_ARP:
+        return NEIGHBOR;
+      case ETHERTYPE::ETHERTYPE_IPV6: {
+        Cursor ipv6(c);
+        ipv6 += kIPv6NextHdrOffset;
+        if (ipv6.read<uint8_t>() !=
+            static_cast<uint8_t>(IP_PROTO::IP_PROTO_IPV6_ICMP)) {
+          return DEFAULT;
+        }
+        c += kIPv6HdrSize;
+        return isNdp(c.read<uint8_t>()) ? NEIGHBOR : DEFAULT;
+      }
+      default:
+        return DEFAULT;
+    }
+  } catch (const std::out_of_range&) {
+    // Too short to tell, let the handler deal with it
+    return DEFAULT;
+  }
+}
+
+RxPacketDispatcher::Thread RxPacketDispatcher::queueThread(Queue queue) {
+  return queue == CONTROL ? CONTROL_THREAD : DATA_THREAD;
+}
+
+folly::StringPiece RxPacketDispatcher::queueName(Queue queue) {
+  switch (queue) {
+    case CONTROL:
+      return "control";
+    case NEIGHBOR:
+      return "neighbor";
+    case DEFAULT:
+      return "default";
+    case NUM_QUEUES:
+      break;
+  }
+  return "unknown";
+}
+
+}} // facebook::fboss
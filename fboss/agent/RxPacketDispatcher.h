@@ -0,0 +1,132 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/ProducerConsumerQueue.h>
+#include <folly/Range.h>
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace facebook { namespace fboss {
+
+class RxPacket;
+
+/*
+ * RxPacketDispatcher takes the handling of trapped packets off the thread
+ * the HwSwitch delivers them on.
+ *
+ * Each packet is classified by protocol into a queue and pushed onto that
+ * queue's lock-free single producer, single consumer ring. Queue threads
+ * drain the rings in batches. Control protocols have a queue and thread of
+ * their own, so a storm of ARP/NDP or of packets to the host never delays
+ * LACP or LLDP.
+ *
+ * The NEIGHBOR and DEFAULT queues share a thread, taking turns a batch at a
+ * time. Their handlers share state that is not safe to use from several
+ * threads: IPv6Handler handles both NDP and other IPv6 packets, and the
+ * IPv4/IPv6 handlers park packets on the neighbors that ARP/NDP resolve.
+ * They still have separate rings, so that a storm on one fills only its
+ * own ring, and the other keeps getting a batch handled per turn. The
+ * CONTROL queue only reaches the LACP and LLDP managers, which no other rx
+ * handler touches. Handlers of every queue use the thread-safe
+ * PktCaptureManager, pcap ring and thread-local SwitchStats.
+ *
+ * dispatch() is the producer side of every ring, it must always be called
+ * from the same thread. A packet that finds its ring full is dropped and
+ * reported to the DropHandler.
+ */
+class RxPacketDispatcher {
+ public:
+  // Queues, from highest to lowest priority
+  enum Queue : uint8_t {
+    CONTROL,    // LACP, LLDP
+    NEIGHBOR,   // ARP, NDP
+    DEFAULT,    // Everything else
+    NUM_QUEUES,
+  };
+
+  // Queue threads, and the queues each drains in turn
+  enum Thread : uint8_t {
+    CONTROL_THREAD,  // CONTROL
+    DATA_THREAD,     // NEIGHBOR, DEFAULT
+    NUM_THREADS,
+  };
+
+  using PacketHandler = std::function<void(std::unique_ptr<RxPacket> pkt)>;
+  using DropHandler = std::function<void(const RxPacket* pkt, Queue queue)>;
+  using QueueDepths = std::array<uint32_t, NUM_QUEUES>;
+
+  /*
+   * handler is called on the queue threads for every packet dispatched,
+   * handling at most batchSize packets from a ring before moving on to the
+   * next ring of the thread.
+   */
+  RxPacketDispatcher(
+      PacketHandler handler,
+      DropHandler dropHandler,
+      const QueueDepths& queueDepths,
+      uint32_t batchSize);
+  ~RxPacketDispatcher();
+
+  // Start the queue threads. Packets dispatched before are queued.
+  void start();
+
+  // Stop the queue threads. Packets still queued are discarded.
+  void stop();
+
+  /*
+   * Queue a packet for its queue thread. Returns false if the packet was
+   * dropped because its queue is full.
+   */
+  bool dispatch(std::unique_ptr<RxPacket> pkt);
+
+  static Queue classify(const RxPacket* pkt);
+  static folly::StringPiece queueName(Queue queue);
+  static Thread queueThread(Queue queue);
+
+ private:
+  struct RxQueue {
+    explicit RxQueue(uint32_t depth) : ring(depth + 1) {}
+
+    // The ring holds one element less than its size
+    folly::ProducerConsumerQueue<std::unique_ptr<RxPacket>> ring;
+  };
+
+  struct RxThread {
+    std::thread thread;
+    // Only used to sleep and wake up the thread
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::atomic<bool> sleeping{false};
+  };
+
+  // Forbidden copy constructor and assignment operator
+  RxPacketDispatcher(RxPacketDispatcher const &) = delete;
+  RxPacketDispatcher& operator=(RxPacketDispatcher const &) = delete;
+
+  void threadLoop(Thread thread);
+  bool threadHasPackets(Thread thread) const;
+
+  PacketHandler handler_;
+  DropHandler dropHandler_;
+  uint32_t batchSize_;
+  std::array<std::unique_ptr<RxQueue>, NUM_QUEUES> queues_;
+  std::array<std::unique_ptr<RxThread>, NUM_THREADS> threads_;
+  std::atomic<bool> stopping_{false};
+  bool started_{false};
+};
+
+}} // facebook::fboss
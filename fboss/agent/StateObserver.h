@@ -18,15 +18,47 @@ class StateObserver : public boost::noncopyable {
  public:
   virtual ~StateObserver() {}
   virtual void stateUpdated(const StateDelta& delta) = 0;
+
+  /*
+   * The EventBase whose thread stateUpdated() should be called on.
+   *
+   * By default (nullptr) observers are notified synchronously on the update
+   * thread, one after another, before the next state update is processed.
+   * Observers doing expensive work that doesn't need to finish before the
+   * next update is applied can return their own EventBase instead.  Deltas
+   * are then queued to that EventBase, so the observer still sees every
+   * delta exactly once and in order, but notifying it no longer delays the
+   * update thread or the other observers.
+   *
+   * This is queried once, when the observer is registered.  stateUpdated()
+   * calls made on the returned EventBase must not block on the update
+   * thread (e.g. through updateStateBlocking()), since unregistering the
+   * observer waits for any in-flight notification to finish.
+   */
+  virtual folly::EventBase* getNotificationEventBase() const {
+    return nullptr;
+  }
 };
 
 class AutoRegisterStateObserver : public StateObserver {
  public:
-  AutoRegisterStateObserver(SwSwitch* sw, const std::string& name) : sw_(sw) {
+  /*
+   * The notification EventBase is passed in rather than overridden since
+   * registration happens before the subclass has been constructed.
+   */
+  AutoRegisterStateObserver(
+      SwSwitch* sw,
+      const std::string& name,
+      folly::EventBase* notificationEvb = nullptr)
+      : sw_(sw), notificationEvb_(notificationEvb) {
     sw_->registerStateObserver(this, name);
   }
   ~AutoRegisterStateObserver() override { sw_->unregisterStateObserver(this); }
 
+  folly::EventBase* getNotificationEventBase() const override {
+    return notificationEvb_;
+  }
+
   // This empty implementation should be overridden by subclasses, but it is
   // needed during destruction in the case that the derived class has been
   // destroyed, but the unregisterStateObserver call is blocked. If someone
@@ -36,6 +68,7 @@ class AutoRegisterStateObserver : public StateObserver {
 
  private:
   SwSwitch* sw_{nullptr};
+  folly::EventBase* notificationEvb_{nullptr};
 };
 
 }} // facebook::fboss
@@ -27,6 +27,7 @@
 #include <condition_variable>
 #include <exception>
 #include <tuple>
+#include <unistd.h>
 #include "common/stats/ServiceData.h"
 #include "fboss/agent/AgentConfig.h"
 #include "fboss/agent/ApplyThriftConfig.h"
@@ -41,11 +42,14 @@
 #include "fboss/agent/LldpManager.h"
 #include "fboss/agent/MirrorManager.h"
 #include "fboss/agent/NeighborUpdater.h"
+#include "fboss/agent/ParkedPacketQueue.h"
 #include "fboss/agent/Platform.h"
 #include "fboss/agent/PortStats.h"
 #include "fboss/agent/PortUpdateHandler.h"
 #include "fboss/agent/RouteUpdateLogger.h"
 #include "fboss/agent/RxPacket.h"
+#include "fboss/agent/RxPacketDispatcher.h"
+#include "fboss/agent/StateObserver.h"
 #include "fboss/agent/SwitchStats.h"
 #include "fboss/agent/ThriftHandler.h"
 #include "fboss/agent/TunManager.h"
@@ -58,10 +62,15 @@
 #include "fboss/agent/packet/IPv4Hdr.h"
 #include "fboss/agent/packet/IPv6Hdr.h"
 #include "fboss/agent/packet/PktUtil.h"
+#include "fboss/agent/rib/ForwardingInformationBaseUpdater.h"
+#include "fboss/agent/rib/RoutingInformationBase.h"
 #include "fboss/agent/state/AggregatePort.h"
+#include "fboss/agent/state/Interface.h"
+#include "fboss/agent/state/InterfaceMap.h"
 #include "fboss/agent/state/StateDelta.h"
 #include "fboss/agent/state/StateUpdateHelpers.h"
 #include "fboss/agent/state/SwitchState.h"
+#include "fboss/pcap_distribution_service/PcapRing.h"
 #include "fboss/pcap_distribution_service/if/gen-cpp2/PcapPushSubscriber.h"
 #include "fboss/pcap_distribution_service/if/gen-cpp2/pcap_pubsub_constants.h"
 
@@ -92,6 +101,49 @@ DEFINE_int32(
     distribution_timeout_ms,
     1000,
     "Timeout for sending to distribution_service (ms)");
+DEFINE_int32(
+    pcap_ring_slots,
+    0,
+    "Slots in the shared memory ring publishing packets to "
+    "distribution_service, 0 to publish them over thrift instead");
+DEFINE_int32(
+    pcap_ring_slot_bytes,
+    2048,
+    "Bytes per pcap ring slot, larger packets are published over thrift");
+DEFINE_int32(
+    max_parked_pkts_per_neighbor,
+    0,
+    "Trapped packets to hold per unresolved next hop until it resolves, "
+    "0 to drop them instead");
+DEFINE_int32(
+    max_parked_pkt_bytes,
+    1 << 20,
+    "Bytes of trapped packets to hold across all unresolved next hops");
+DEFINE_int32(
+    max_parked_pkt_age_ms,
+    1000,
+    "Drop trapped packets held for an unresolved next hop after this long");
+DEFINE_bool(
+    dispatch_rx_packets,
+    false,
+    "Handle trapped packets on per-queue rx threads rather than on the "
+    "thread the hardware delivers them on");
+DEFINE_int32(
+    rx_control_queue_depth,
+    1024,
+    "Packets queued for the control protocol rx thread before dropping");
+DEFINE_int32(
+    rx_neighbor_queue_depth,
+    4096,
+    "Packets queued for the ARP/NDP rx thread before dropping");
+DEFINE_int32(
+    rx_default_queue_depth,
+    4096,
+    "Packets queued for the default rx thread before dropping");
+DEFINE_int32(
+    rx_dispatch_batch_size,
+    64,
+    "Max packets an rx thread handles before checking its queue again");
 
 namespace {
 
@@ -174,11 +226,41 @@ SwSwitch::SwSwitch(std::unique_ptr<Platform> platform)
 
   // doesnt need to be guarded, only accessed by 1 event base
   pcapPusher_ = nullptr;
+
+  if (FLAGS_pcap_ring_slots > 0) {
+    pcapRing_ = std::make_unique<PcapRingWriter>(
+        FLAGS_pcap_ring_slots, FLAGS_pcap_ring_slot_bytes);
+  }
+
+  if (FLAGS_max_parked_pkts_per_neighbor > 0) {
+    parkedPkts_ = std::make_unique<ParkedPacketQueue>(
+        this,
+        FLAGS_max_parked_pkts_per_neighbor,
+        FLAGS_max_parked_pkt_bytes,
+        std::chrono::milliseconds(FLAGS_max_parked_pkt_age_ms));
+  }
+
+  if (FLAGS_dispatch_rx_packets) {
+    RxPacketDispatcher::QueueDepths depths;
+    depths[RxPacketDispatcher::CONTROL] = FLAGS_rx_control_queue_depth;
+    depths[RxPacketDispatcher::NEIGHBOR] = FLAGS_rx_neighbor_queue_depth;
+    depths[RxPacketDispatcher::DEFAULT] = FLAGS_rx_default_queue_depth;
+    rxDispatcher_ = std::make_unique<RxPacketDispatcher>(
+        [this](std::unique_ptr<RxPacket> pkt) {
+          handleRxPacket(std::move(pkt));
+        },
+        [this](const RxPacket* pkt, RxPacketDispatcher::Queue queue) {
+          portStats(pkt->getSrcPort())->rxQueueDropped(queue);
+        },
+        depths,
+        FLAGS_rx_dispatch_batch_size);
+  }
 }
 
 
 void SwSwitch::destroyPushClient(){
   distributionServiceReady_.store(false);
+  pcapRingAttached_.store(false);
 }
 
 void SwSwitch::constructPushClient(uint16_t port) {
@@ -192,6 +274,16 @@ void SwSwitch::constructPushClient(uint16_t port) {
     pcapPusher_ =
         std::make_unique<PcapPushSubscriberAsyncClient>(std::move(chan));
     distributionServiceReady_.store(true);
+    if (pcapRing_) {
+      // Keep publishing over thrift until the service has mapped the ring
+      pcapPusher_->future_attachRing(getpid(), pcapRing_->fd())
+          .thenValue([this](auto&&) { pcapRingAttached_.store(true); })
+          .onError([](const std::exception& ex) {
+            XLOG(ERR) << "distribution service failed to attach to the "
+                      << "pcap ring, publishing over thrift: "
+                      << folly::exceptionStr(ex);
+          });
+    }
   };
   pcapDistributionEventBase_.runInEventBaseThread(creation);
 }
@@ -215,6 +307,11 @@ void SwSwitch::stop() {
   // while we are destroying ourselves
   hw_->unregisterCallbacks();
 
+  // Handle no more of the packets already queued for the rx threads
+  if (rxDispatcher_) {
+    rxDispatcher_->stop();
+  }
+
   // Stop tunMgr so we don't get any packets to process
   // in software that were sent to the switch ip or were
   // routed from kernel to the front panel tunnel interface.
@@ -380,6 +477,17 @@ void SwSwitch::clearWarmBootCache() {
 }
 
 void SwSwitch::publishRxPacket(RxPacket* pkt, uint16_t ethertype){
+  if (pcapRingAttached_.load()) {
+    auto result = pcapRing_->write(pkt, ethertype);
+    if (result == PcapRingWriter::Result::WRITTEN) {
+      return;
+    } else if (result == PcapRingWriter::Result::FULL) {
+      stats()->pcapRingDropped();
+      return;
+    }
+    stats()->pcapRingTooBig();
+  }
+
   RxPacketData pubPkt;
   pubPkt.srcPort = pkt->getSrcPort();
   pubPkt.srcVlan = pkt->getSrcVlan();
@@ -404,6 +512,17 @@ void SwSwitch::publishRxPacket(RxPacket* pkt, uint16_t ethertype){
 }
 
 void SwSwitch::publishTxPacket(TxPacket* pkt, uint16_t ethertype){
+  if (pcapRingAttached_.load()) {
+    auto result = pcapRing_->write(pkt, ethertype);
+    if (result == PcapRingWriter::Result::WRITTEN) {
+      return;
+    } else if (result == PcapRingWriter::Result::FULL) {
+      stats()->pcapRingDropped();
+      return;
+    }
+    stats()->pcapRingTooBig();
+  }
+
   TxPacketData pubPkt;
   folly::IOBuf copy_buf;
   pkt->buf()->cloneInto(copy_buf);
@@ -485,6 +604,10 @@ void SwSwitch::init(std::unique_ptr<TunManager> tunMgr, SwitchFlags flags) {
     lagManager_ = std::make_unique<LinkAggregationManager>(this);
   }
 
+  if (flags & SwitchFlags::ENABLE_STANDALONE_RIB) {
+    rib_ = std::make_unique<rib::RoutingInformationBase>();
+  }
+
   auto bgHeartbeatStatsFunc = [this] (int delay, int backLog) {
     stats()->bgHeartbeatDelay(delay);
     stats()->bgEventBacklog(backLog);
@@ -592,6 +715,28 @@ void SwSwitch::fibSynced() {
   setSwitchRunState(SwitchRunState::FIB_SYNCED);
 }
 
+/*
+ * Book keeping for a registered StateObserver.
+ *
+ * Notifications for observers with their own EventBase are queued there and
+ * hold a reference to the registration.  They are only delivered while the
+ * observer is still registered, and the lock makes unregistering wait for a
+ * notification that is already in progress.
+ */
+struct StateObserverRegistration {
+  StateObserverRegistration(
+      StateObserver* observer,
+      std::string name,
+      folly::EventBase* evb)
+      : observer(observer), name(std::move(name)), evb(evb) {}
+
+  StateObserver* const observer;
+  const std::string name;
+  folly::EventBase* const evb;
+  std::mutex lock;
+  bool registered{true};
+};
+
 void SwSwitch::registerStateObserver(StateObserver* observer,
                                      const string name) {
   XLOG(DBG2) << "Registering state observer: " << name;
@@ -613,10 +758,17 @@ bool SwSwitch::stateObserverRegistered(StateObserver* observer) {
 
 void SwSwitch::removeStateObserver(StateObserver* observer) {
   DCHECK(updateEventBase_.isInEventBaseThread());
-  auto nErased = stateObservers_.erase(observer);
-  if (!nErased) {
+  auto it = stateObservers_.find(observer);
+  if (it == stateObservers_.end()) {
     throw FbossError("State observer remove failed: observer does not exist");
   }
+  {
+    // Wait for any in-flight notification on the observer's EventBase and
+    // drop the ones still queued there.
+    std::lock_guard<std::mutex> guard(it->second->lock);
+    it->second->registered = false;
+  }
+  stateObservers_.erase(it);
 }
 
 void SwSwitch::addStateObserver(StateObserver* observer, const string& name) {
@@ -624,7 +776,10 @@ void SwSwitch::addStateObserver(StateObserver* observer, const string& name) {
   if (stateObserverRegistered(observer)) {
     throw FbossError("State observer add failed: ", name, " already exists");
   }
-  stateObservers_.emplace(observer, name);
+  stateObservers_.emplace(
+      observer,
+      std::make_shared<StateObserverRegistration>(
+          observer, name, observer->getNotificationEventBase()));
 }
 
 void SwSwitch::notifyStateObservers(const StateDelta& delta) {
@@ -633,16 +788,45 @@ void SwSwitch::notifyStateObservers(const StateDelta& delta) {
     // Make sure the SwSwitch is not already being destroyed
     return;
   }
-  for (auto observerName : stateObservers_) {
-    try {
-      auto observer = observerName.first;
-      observer->stateUpdated(delta);
-    } catch (const std::exception& ex) {
+  // Hand the delta off to observers with their own EventBase first, so they
+  // run in parallel with the observers notified inline below.
+  for (const auto& observerReg : stateObservers_) {
+    auto registration = observerReg.second;
+    if (!registration->evb) {
+      continue;
+    }
+    auto oldState = delta.oldState();
+    auto newState = delta.newState();
+    registration->evb->runInEventBaseThread(
+        [this, registration, oldState, newState]() {
+          std::lock_guard<std::mutex> guard(registration->lock);
+          if (!registration->registered || isExiting()) {
+            return;
+          }
+          notifyStateObserver(*registration, StateDelta(oldState, newState));
+        });
+  }
+  for (const auto& observerReg : stateObservers_) {
+    if (!observerReg.second->evb) {
+      notifyStateObserver(*observerReg.second, delta);
+    }
+  }
+}
+
+void SwSwitch::notifyStateObserver(
+    const StateObserverRegistration& registration,
+    const StateDelta& delta) {
+  auto start = std::chrono::steady_clock::now();
+  try {
+    registration.observer->stateUpdated(delta);
+  } catch (const std::exception& ex) {
     // TODO: Figure out the best way to handle errors here.
-    XLOG(FATAL) << "error notifying " << observerName.second
+    XLOG(FATAL) << "error notifying " << registration.name
                 << " of update: " << folly::exceptionStr(ex);
-    }
   }
+  auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start);
+  stats()->stateObserverUpdate(registration.name, duration);
 }
 
 void SwSwitch::updateState(
@@ -962,6 +1146,14 @@ void SwSwitch::setPortStatusCounter(PortID port, bool up) {
 }
 
 void SwSwitch::packetReceived(std::unique_ptr<RxPacket> pkt) noexcept {
+  if (rxDispatcher_) {
+    rxDispatcher_->dispatch(std::move(pkt));
+    return;
+  }
+  handleRxPacket(std::move(pkt));
+}
+
+void SwSwitch::handleRxPacket(std::unique_ptr<RxPacket> pkt) noexcept {
   PortID port = pkt->getSrcPort();
   try {
     handlePacket(std::move(pkt));
@@ -1111,6 +1303,9 @@ void SwSwitch::startThreads() {
   neighborCacheThread_.reset(new std::thread([=] {
     this->threadLoop("fbossNeighborCacheThread", &neighborCacheEventBase_);
   }));
+  if (rxDispatcher_) {
+    rxDispatcher_->start();
+  }
 }
 
 void SwSwitch::stopThreads() {
@@ -1196,22 +1391,7 @@ std::unique_ptr<TxPacket> SwSwitch::allocateL3TxPacket(uint32_t l3Len) {
 void SwSwitch::sendPacketOutOfPortAsync(std::unique_ptr<TxPacket> pkt,
                                         PortID portID,
                                         folly::Optional<uint8_t> cos) noexcept {
-  pcapMgr_->packetSent(pkt.get());
-
-  Cursor c(pkt->buf());
-  // unused to parse the ethertype correctly
-  PktUtil::readMac(&c);
-  PktUtil::readMac(&c);
-  auto ethertype = c.readBE<uint16_t>();
-  if (ethertype == 0x8100) {
-    // 802.1Q
-    c += 2; // Advance over the VLAN tag.  We ignore it for now
-    ethertype = c.readBE<uint16_t>();
-  }
-
-  if (distributionServiceReady_.load()) {
-    publishTxPacket(pkt.get(), ethertype);
-  }
+  packetSentOutOfPort(pkt.get());
 
   if (!hw_->sendPacketOutOfPortAsync(std::move(pkt), portID, cos)) {
     // Just log an error for now.  There's not much the caller can do about
@@ -1263,6 +1443,52 @@ void SwSwitch::sendPacketOutOfPortAsync(
              << ": aggregate port has no enabled physical ports";
 }
 
+void SwSwitch::packetSentOutOfPort(TxPacket* pkt) {
+  pcapMgr_->packetSent(pkt);
+
+  Cursor c(pkt->buf());
+  // unused to parse the ethertype correctly
+  PktUtil::readMac(&c);
+  PktUtil::readMac(&c);
+  auto ethertype = c.readBE<uint16_t>();
+  if (ethertype == 0x8100) {
+    // 802.1Q
+    c += 2; // Advance over the VLAN tag.  We ignore it for now
+    ethertype = c.readBE<uint16_t>();
+  }
+
+  if (distributionServiceReady_.load()) {
+    publishTxPacket(pkt, ethertype);
+  }
+}
+
+void SwSwitch::sendPacketsOutOfPortAsync(
+    std::vector<HwSwitch::PortTxPacket> pkts) noexcept {
+  for (auto& pkt : pkts) {
+    packetSentOutOfPort(pkt.pkt.get());
+  }
+  auto numPkts = pkts.size();
+  auto sent = hw_->sendPacketsOutOfPortAsync(std::move(pkts));
+  if (sent < numPkts) {
+    // As for single packets, there's not much the caller can do about it
+    XLOG(ERR) << "failed to send " << numPkts - sent << " of " << numPkts
+              << " packets out of ports";
+  }
+}
+
+void SwSwitch::sendPacketsSwitchedAsync(
+    std::vector<std::unique_ptr<TxPacket>> pkts) noexcept {
+  for (auto& pkt : pkts) {
+    pcapMgr_->packetSent(pkt.get());
+  }
+  auto numPkts = pkts.size();
+  auto sent = hw_->sendPacketsSwitchedAsync(std::move(pkts));
+  if (sent < numPkts) {
+    XLOG(ERR) << "failed to send " << numPkts - sent << " of " << numPkts
+              << " L2 switched packets";
+  }
+}
+
 void SwSwitch::sendPacketSwitchedAsync(std::unique_ptr<TxPacket> pkt) noexcept {
   pcapMgr_->packetSent(pkt.get());
   if (!hw_->sendPacketSwitchedAsync(std::move(pkt))) {
@@ -1436,8 +1662,11 @@ void SwSwitch::applyConfig(const std::string& reason, bool reload) {
         auto target = reload ? platform_->reloadConfig() : platform_->config();
 
         const auto& newConfig = target->thrift.sw;
-        auto newState =
-          applyThriftConfig(state, &newConfig, platform_.get(), &curConfig_);
+        auto newState = applyThriftConfig(
+            state,
+            &newConfig,
+            platform_.get(),
+            curConfigApplied_ ? &curConfig_ : nullptr);
 
         if (!newState) {
           // if config is not updated, the new state will return null
@@ -1446,11 +1675,17 @@ void SwSwitch::applyConfig(const std::string& reason, bool reload) {
           return nullptr;
         }
 
+        if (rib_) {
+          // The RIB owns the routes, see reconfigureRib()
+          newState->resetRouteTables(state->getRouteTables());
+        }
+
         if (!isValidStateUpdate(StateDelta(state, newState))) {
           throw FbossError("Invalid config passed in, skipping");
         }
 
         curConfig_ = newConfig;
+        curConfigApplied_ = true;
         curConfigStr_ = target->swConfigRaw();
         target->dumpConfig(platform_->getRunningConfigDumpFile());
 
@@ -1464,6 +1699,65 @@ void SwSwitch::applyConfig(const std::string& reason, bool reload) {
 
         return newState;
       });
+
+  if (rib_) {
+    reconfigureRib();
+  }
+}
+
+void SwSwitch::reconfigureRib() {
+  rib::RoutingInformationBase::RouterIDToInterfaceRoutes interfaceRoutes;
+  for (const auto& intf : *getState()->getInterfaces()) {
+    for (const auto& addr : intf->getAddresses()) {
+      // Like ThriftConfigApplier, keep v6 link-local addresses out of the
+      // interface routes
+      if (addr.first.isV6() && addr.first.isLinkLocal()) {
+        continue;
+      }
+      auto network = std::make_pair(addr.first.mask(addr.second), addr.second);
+      interfaceRoutes[intf->getRouterID()][network] =
+          std::make_pair(intf->getID(), addr.first);
+    }
+  }
+
+  rib_->reconfigure(
+      interfaceRoutes,
+      curConfig_.staticRoutesWithNhops,
+      curConfig_.staticRoutesToNull,
+      curConfig_.staticRoutesToCPU,
+      [this](const rib::FibChanges& changes) {
+        publishFib("publish FIB for new config", changes);
+      });
+}
+
+void SwSwitch::publishFib(
+    folly::StringPiece reason,
+    const rib::FibChanges& changes) {
+  updateStateBlocking(reason, rib::ForwardingInformationBaseUpdater(changes));
+  if (!rib::isFibPublished(*getState(), changes)) {
+    throw FbossError(
+        "Could not program every route of VRF ", changes.vrf, " for ", reason);
+  }
+}
+
+void SwSwitch::updateRib(
+    RouterID vrf,
+    ClientID clientId,
+    const std::vector<UnicastRoute>& toAdd,
+    const std::vector<IpPrefix>& toDelete,
+    bool resetClientsRoutes,
+    folly::StringPiece reason) {
+  CHECK(rib_) << "SwSwitch was not initialized with a standalone RIB";
+  rib_->update(
+      vrf,
+      clientId,
+      clientIdToAdminDistance(static_cast<int>(clientId)),
+      toAdd,
+      toDelete,
+      resetClientsRoutes,
+      [this, reason](const rib::FibChanges& changes) {
+        publishFib(reason, changes);
+      });
 }
 
 bool SwSwitch::isValidStateUpdate(
@@ -37,28 +37,38 @@ class IPv4Handler;
 class IPv6Handler;
 class LinkAggregationManager;
 class LldpManager;
+class ParkedPacketQueue;
 class PcapPushSubscriberAsyncClient;
+class PcapRingWriter;
 class PktCaptureManager;
 class Platform;
 class Port;
 class PortStats;
 class PortUpdateHandler;
 class RxPacket;
+class RxPacketDispatcher;
 class SwitchState;
 class SwitchStats;
 class StateDelta;
 class NeighborUpdater;
 class RouteUpdateLogger;
 class StateObserver;
+struct StateObserverRegistration;
 class TunManager;
 class MirrorManager;
 
+namespace rib {
+struct FibChanges;
+class RoutingInformationBase;
+}
+
 enum SwitchFlags : int {
   DEFAULT = 0,
   ENABLE_TUN = 1,
   ENABLE_LLDP = 2,
   PUBLISH_STATS = 4,
-  ENABLE_LACP = 8
+  ENABLE_LACP = 8,
+  ENABLE_STANDALONE_RIB = 16
 };
 
 inline SwitchFlags operator|=(SwitchFlags& a, const SwitchFlags b) {
@@ -261,7 +271,9 @@ class SwSwitch : public HwSwitch::Callback {
    * should register using this api.
    *
    * The only required method for observers is stateUpdated and observers can
-   * count on this always being called from the update thread.
+   * count on this always being called from the update thread, unless they
+   * ask to be notified on their own EventBase via
+   * StateObserver::getNotificationEventBase().
    */
   void registerStateObserver(StateObserver* observer, const std::string name);
   void unregisterStateObserver(StateObserver* observer);
@@ -446,6 +458,15 @@ class SwSwitch : public HwSwitch::Callback {
    */
   void sendPacketSwitchedAsync(std::unique_ptr<TxPacket> pkt) noexcept;
 
+  /*
+   * Send a batch of packets, with one submission to the HW. Used when
+   * flooding the same kind of packet to many ports or neighbors.
+   */
+  void sendPacketsOutOfPortAsync(
+      std::vector<HwSwitch::PortTxPacket> pkts) noexcept;
+  void sendPacketsSwitchedAsync(
+      std::vector<std::unique_ptr<TxPacket>> pkts) noexcept;
+
   /**
    * Send out L3 packet through HW
    *
@@ -508,6 +529,14 @@ class SwSwitch : public HwSwitch::Callback {
     return nUpdater_.get();
   }
 
+  /*
+   * Get the ParkedPacketQueue object, or null if packets for unresolved
+   * next hops are not parked.
+   */
+  ParkedPacketQueue* getParkedPacketQueue() {
+    return parkedPkts_.get();
+  }
+
   /*
    * Get the PktCaptureManager object.
    */
@@ -533,6 +562,32 @@ class SwSwitch : public HwSwitch::Callback {
     return lagManager_.get();
   }
 
+  /*
+   * Get the RoutingInformationBase, if the SwSwitch was initialized with
+   * ENABLE_STANDALONE_RIB. In that mode routes are kept in the RIB rather
+   * than in the RouteTables of the SwitchState, and only the resolved routes
+   * are published into the SwitchState, as ForwardingInformationBases.
+   *
+   * Returns nullptr otherwise.
+   */
+  rib::RoutingInformationBase* getRib() {
+    return rib_.get();
+  }
+
+  /*
+   * Apply a route update to the RoutingInformationBase, and publish the
+   * resulting FIB. Returns once the FIB has been published.
+   *
+   * Must only be called when getRib() is not null.
+   */
+  void updateRib(
+      RouterID vrf,
+      ClientID clientId,
+      const std::vector<UnicastRoute>& toAdd,
+      const std::vector<IpPrefix>& toDelete,
+      bool resetClientsRoutes,
+      folly::StringPiece reason);
+
   /*
    * Gets the flags the SwSwitch was initialized with.
    */
@@ -619,6 +674,11 @@ class SwSwitch : public HwSwitch::Callback {
   void publishRxPacket(RxPacket* packet, uint16_t ethertype);
   void publishTxPacket(TxPacket* packet, uint16_t ethertype);
 
+  /*
+   * Capture and publish a packet about to be sent out of a port.
+   */
+  void packetSentOutOfPort(TxPacket* pkt);
+
   /*
    * Clear PortStats of the specified port.
    */
@@ -656,10 +716,17 @@ class SwSwitch : public HwSwitch::Callback {
   void publishInitTimes(std::string name, const float& time);
   void publishPortInfo();
   void publishRouteStats();
+  // Sync the interface and static routes of the RIB with the config
+  void reconfigureRib();
+  // Publish FIB changes of the RIB, throwing if the hardware could not
+  // program all of them so that the RIB undoes them
+  void publishFib(folly::StringPiece reason, const rib::FibChanges& changes);
   void publishSwitchInfo(struct HwInitResult hwInitRet);
   void setSwitchRunState(SwitchRunState desiredState);
   SwitchStats* createSwitchStats();
   void handlePacket(std::unique_ptr<RxPacket> pkt);
+  // handlePacket(), counting and logging any error
+  void handleRxPacket(std::unique_ptr<RxPacket> pkt) noexcept;
 
   static void handlePendingUpdatesHelper(SwSwitch* sw);
   void handlePendingUpdates();
@@ -689,6 +756,9 @@ class SwSwitch : public HwSwitch::Callback {
    * Notifies all the observers that a state update occured.
    */
   void notifyStateObservers(const StateDelta& delta);
+  void notifyStateObserver(
+      const StateObserverRegistration& registration,
+      const StateDelta& delta);
 
   void logLinkStateEvent(PortID port, bool up);
 
@@ -703,6 +773,8 @@ class SwSwitch : public HwSwitch::Callback {
 
   std::string curConfigStr_;
   cfg::SwitchConfig curConfig_;
+  // Whether curConfig_ has been applied, and so describes the state
+  bool curConfigApplied_{false};
 
   // The HwSwitch object.  This object is owned by the Platform.
   HwSwitch* hw_;
@@ -808,21 +880,36 @@ class SwSwitch : public HwSwitch::Callback {
    * The list of classes to notify on a state update. This container should only
    * be accessed/modified from the update thread. This removes the need for
    * locking when we access the container during a state update.
+   *
+   * Registrations are shared with any notifications queued to observers that
+   * are notified on their own EventBase, see StateObserverRegistration.
    */
-  std::map<StateObserver*, std::string> stateObservers_;
+  std::map<StateObserver*, std::shared_ptr<StateObserverRegistration>>
+      stateObservers_;
 
   std::unique_ptr<ChannelCloser> closer_; // must be before pcapPusher_
   std::unique_ptr<PcapPushSubscriberAsyncClient> pcapPusher_;
   std::atomic<bool> distributionServiceReady_{false};
+  // Published packets go through the ring once the service has attached to
+  // it, see FLAGS_pcap_ring_slots
+  std::unique_ptr<PcapRingWriter> pcapRing_;
+  std::atomic<bool> pcapRingAttached_{false};
 
 
   std::unique_ptr<ArpHandler> arp_;
   std::unique_ptr<IPv4Handler> ipv4_;
   std::unique_ptr<IPv6Handler> ipv6_;
   std::unique_ptr<NeighborUpdater> nUpdater_;
+  std::unique_ptr<ParkedPacketQueue> parkedPkts_;
   std::unique_ptr<PktCaptureManager> pcapMgr_;
+  /*
+   * Moves trapped packet handling off the HwSwitch rx thread when
+   * --dispatch_rx_packets is set. Null otherwise.
+   */
+  std::unique_ptr<RxPacketDispatcher> rxDispatcher_;
   std::unique_ptr<MirrorManager> mirrorManager_;
   std::unique_ptr<RouteUpdateLogger> routeUpdateLogger_;
+  std::unique_ptr<rib::RoutingInformationBase> rib_;
   std::unique_ptr<LinkAggregationManager> lagManager_;
 
   BootType bootType_{BootType::UNINITIALIZED};
@@ -11,6 +11,7 @@
 
 #include "fboss/agent/PortStats.h"
 #include "common/stats/ExportedStatMapImpl.h"
+#include <folly/Conv.h>
 #include <folly/Memory.h>
 
 using facebook::stats::SUM;
@@ -32,6 +33,14 @@ SwitchStats::SwitchStats(ThreadLocalStatsMap* map)
       trapPktBogus_(map, kCounterPrefix + "trapped.bogus", SUM, RATE),
       trapPktErrors_(map, kCounterPrefix + "trapped.error", SUM, RATE),
       trapPktUnhandled_(map, kCounterPrefix + "trapped.unhandled", SUM, RATE),
+      trapPktRxQueueDrops_(
+          map,
+          kCounterPrefix + "trapped.rx_queue_drops",
+          SUM,
+          RATE),
+      trapPktParked_(map, kCounterPrefix + "trapped.parked", SUM, RATE),
+      parkedPktSent_(map, kCounterPrefix + "parked.sent", SUM, RATE),
+      parkedPktDrops_(map, kCounterPrefix + "parked.drops", SUM, RATE),
       trapPktToHost_(map, kCounterPrefix + "host.rx", SUM, RATE),
       trapPktToHostBytes_(map, kCounterPrefix + "host.rx.bytes", SUM, RATE),
       pktFromHost_(map, kCounterPrefix + "host.tx", SUM, RATE),
@@ -46,6 +55,8 @@ SwitchStats::SwitchStats(ThreadLocalStatsMap* map)
       arpBadOp_(map, kCounterPrefix + "arp.bad_op", SUM, RATE),
       trapPktNdp_(map, kCounterPrefix + "trapped.ndp", SUM, RATE),
       ipv6NdpBad_(map, kCounterPrefix + "ipv6.ndp.bad", SUM, RATE),
+      neighborProbeRateLimited_(
+          map, kCounterPrefix + "neighbor.probe.rate_limited", SUM, RATE),
       ipv4Rx_(map, kCounterPrefix + "trapped.ipv4", SUM, RATE),
       ipv4TooSmall_(map, kCounterPrefix + "ipv4.too_small", SUM, RATE),
       ipv4WrongVer_(map, kCounterPrefix + "ipv4.wrong_version", SUM, RATE),
@@ -127,6 +138,24 @@ SwitchStats::SwitchStats(ThreadLocalStatsMap* map)
           AVG,
           50,
           100),
+      neighborUpdateBatchSize_(
+          map,
+          kCounterPrefix + "neighbor_update_batch_size",
+          16,
+          0,
+          4096,
+          AVG,
+          50,
+          100),
+      neighborUpdateQueueDelay_(
+          map,
+          kCounterPrefix + "neighbor_update_queue_delay.us",
+          1000,
+          0,
+          100000,
+          AVG,
+          50,
+          100),
       bgEventBacklog_(
           map,
           kCounterPrefix + "bg_event_backlog",
@@ -175,6 +204,8 @@ SwitchStats::SwitchStats(ThreadLocalStatsMap* map)
       linkStateChange_(map, kCounterPrefix + "link_state.flap", SUM),
       hwOutOfSync_(map, kCounterPrefix + "hw_out_of_sync"),
       pcapDistFailure_(map, kCounterPrefix + "pcap_dist_failure.error"),
+      pcapRingDrops_(map, kCounterPrefix + "pcap_ring.drops", SUM, RATE),
+      pcapRingTooBig_(map, kCounterPrefix + "pcap_ring.too_big", SUM, RATE),
       updateStatsExceptions_(
           map,
           kCounterPrefix + "update_stats_exceptions",
@@ -202,6 +233,16 @@ PortStats* FOLLY_NULLABLE SwitchStats::port(PortID portID) {
   return nullptr;
 }
 
+void SwitchStats::stateObserverUpdate(
+    const std::string& observerName,
+    std::chrono::microseconds us) {
+  tcData().addStatValue(
+      folly::to<std::string>(
+          kCounterPrefix, "state_observer.", observerName, ".update_us"),
+      us.count(),
+      AVG);
+}
+
 PortStats* SwitchStats::createPortStats(PortID portID, std::string portName) {
   auto rv = ports_.emplace(portID,
                            std::make_unique<PortStats>(portID, portName, this));
@@ -72,6 +72,20 @@ class SwitchStats : public boost::noncopyable {
     trapPktUnhandled_.addValue(1);
     trapPktDrops_.addValue(1);
   }
+  void rxQueueDropped() {
+    trapPktRxQueueDrops_.addValue(1);
+    trapPktDrops_.addValue(1);
+  }
+  void pktParked() {
+    trapPktParked_.addValue(1);
+  }
+  void parkedPktSent() {
+    parkedPktSent_.addValue(1);
+  }
+  void parkedPktDropped() {
+    parkedPktDrops_.addValue(1);
+    trapPktDrops_.addValue(1);
+  }
   void pktToHost(uint32_t bytes) {
     trapPktToHost_.addValue(1);
     trapPktToHostBytes_.addValue(bytes);
@@ -117,6 +131,10 @@ class SwitchStats : public boost::noncopyable {
     trapPktDrops_.addValue(1);
   }
 
+  void neighborProbeRateLimited() {
+    neighborProbeRateLimited_.addValue(1);
+  }
+
   void dhcpV4Pkt() {
     dhcpV4Pkt_.addValue(1);
   }
@@ -204,6 +222,15 @@ class SwitchStats : public boost::noncopyable {
     updateState_.addValue(us.count());
   }
 
+  /*
+   * Time spent in a single StateObserver's stateUpdated() call.  Observers
+   * come and go, so like per-port stats these are keyed by name and
+   * recorded through tcData() rather than as members.
+   */
+  void stateObserverUpdate(
+      const std::string& observerName,
+      std::chrono::microseconds us);
+
   void routeUpdate(std::chrono::microseconds us, uint64_t routes) {
     // As syncFib() could include no routes.
     if (routes == 0) {
@@ -232,6 +259,11 @@ class SwitchStats : public boost::noncopyable {
     neighborCacheHeartbeatDelay_.addValue(value);
   }
 
+  void neighborUpdateBatch(uint64_t size, std::chrono::microseconds delay) {
+    neighborUpdateBatchSize_.addValue(size);
+    neighborUpdateQueueDelay_.addValue(delay.count());
+  }
+
   void bgEventBacklog(int value) {
     bgEventBacklog_.addValue(value);
   }
@@ -268,6 +300,14 @@ class SwitchStats : public boost::noncopyable {
     pcapDistFailure_.incrementValue(1);
   }
 
+  void pcapRingDropped() {
+    pcapRingDrops_.addValue(1);
+  }
+
+  void pcapRingTooBig() {
+    pcapRingTooBig_.addValue(1);
+  }
+
   void updateStatsException(){
     updateStatsExceptions_.addValue(1);
   }
@@ -310,6 +350,14 @@ class SwitchStats : public boost::noncopyable {
   TLTimeseries trapPktErrors_;
   // Trapped packets that the controller didn't know how to handle.
   TLTimeseries trapPktUnhandled_;
+  // Trapped packets dropped because their rx queue was full
+  TLTimeseries trapPktRxQueueDrops_;
+  // Trapped packets parked until their next hop resolves
+  TLTimeseries trapPktParked_;
+  // Parked packets sent once their next hop resolved
+  TLTimeseries parkedPktSent_;
+  // Parked packets dropped, for lack of room or because they got too old
+  TLTimeseries parkedPktDrops_;
   // Trapped packets forwarded to host
   TLTimeseries trapPktToHost_;
   // Trapped packets forwarded to host in bytes
@@ -339,6 +387,8 @@ class SwitchStats : public boost::noncopyable {
   // IPv6 Neighbor Discovery Protocol packets
   TLTimeseries trapPktNdp_;
   TLTimeseries ipv6NdpBad_;
+  // ARP requests and neighbor solicitations held back by the probe rate
+  TLTimeseries neighborProbeRateLimited_;
 
   // IPv4 Packets
   TLTimeseries ipv4Rx_;
@@ -424,6 +474,13 @@ class SwitchStats : public boost::noncopyable {
    */
   TLHistogram neighborCacheHeartbeatDelay_;
 
+  /**
+   * Neighbor entries programmed per batched state update, and how long the
+   * oldest of them waited for the batch (us)
+   */
+  TLHistogram neighborUpdateBatchSize_;
+  TLHistogram neighborUpdateQueueDelay_;
+
   /**
    * Number of events queued in background thread
    */
@@ -461,6 +518,12 @@ class SwitchStats : public boost::noncopyable {
   // Number of packets dropped by the PCAP distribution service
   TLCounter pcapDistFailure_;
 
+  // Packets not published because the pcap ring was full
+  TLTimeseries pcapRingDrops_;
+
+  // Packets too big for a pcap ring slot, published over thrift instead
+  TLTimeseries pcapRingTooBig_;
+
   // Number of failed updateStats callbacks do to exceptions.
   TLTimeseries updateStatsExceptions_;
 
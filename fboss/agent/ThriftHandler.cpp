@@ -49,12 +49,14 @@
 
 #include <folly/MoveWrapper.h>
 #include <folly/Range.h>
+#include <folly/ScopeGuard.h>
 #include <folly/io/Cursor.h>
 #include <folly/io/IOBuf.h>
 #include <folly/json_pointer.h>
 #include <folly/logging/xlog.h>
 #include <thrift/lib/cpp2/async/DuplexChannel.h>
 
+#include <algorithm>
 #include <limits>
 
 using apache::thrift::ClientReceiveState;
@@ -87,6 +89,12 @@ DEFINE_bool(
     false,
     "Allow external mutations of running config");
 
+DEFINE_int32(
+    route_update_chunk_size,
+    0,
+    "Apply route updates larger than this many routes as a series of "
+    "smaller state updates, 0 applies every update at once");
+
 namespace facebook { namespace fboss {
 
 namespace util {
@@ -140,6 +148,46 @@ class RouteUpdateStats {
   std::chrono::time_point<std::chrono::steady_clock> start_;
 };
 
+namespace {
+
+template <typename AddrT>
+UnicastRoute toUnicastRoute(const Route<AddrT>& route) {
+  UnicastRoute unicastRoute;
+  const auto& fwdInfo = route.getForwardInfo();
+  unicastRoute.dest.ip = toBinaryAddress(route.prefix().network);
+  unicastRoute.dest.prefixLength = route.prefix().mask;
+  unicastRoute.nextHopAddrs = util::fromFwdNextHops(fwdInfo.getNextHopSet());
+  unicastRoute.nextHops = util::fromRouteNextHopSet(fwdInfo.getNextHopSet());
+  return unicastRoute;
+}
+
+void ensureVrfExists(const shared_ptr<SwitchState>& state, RouterID vrf) {
+  if (!state->getRouteTables()->getRouteTableIf(vrf) &&
+      !state->getFibs()->getFibContainerIf(vrf)) {
+    throw FbossError("No Such VRF ", vrf);
+  }
+}
+
+folly::CIDRNetwork toNormalizedPrefix(const IpPrefix& prefix) {
+  auto network = toIPAddress(prefix.ip);
+  auto mask = static_cast<uint8_t>(prefix.prefixLength);
+  return std::make_pair(network.mask(mask), mask);
+}
+
+shared_ptr<SwitchState> applyRouteUpdater(
+    const shared_ptr<SwitchState>& state,
+    RouteUpdater* updater) {
+  auto newRt = updater->updateDone();
+  if (!newRt) {
+    return shared_ptr<SwitchState>();
+  }
+  auto newState = state->clone();
+  newState->resetRouteTables(std::move(newRt));
+  return newState;
+}
+
+} // unnamed namespace
+
 ThriftHandler::ThriftHandler(SwSwitch* sw) : FacebookBase2("FBOSS"), sw_(sw) {
   sw->registerNeighborListener(
     [=](const std::vector<std::string>& added,
@@ -196,6 +244,10 @@ void ThriftHandler::addUnicastRoutes(
     int16_t client, std::unique_ptr<std::vector<UnicastRoute>> routes) {
   ensureConfigured("addUnicastRoutes");
   ensureFibSynced("addUnicastRoutes");
+  if (sw_->getRib()) {
+    updateUnicastRoutesInRib(client, *routes, {}, "addUnicastRoutes", false);
+    return;
+  }
   updateUnicastRoutesImpl(client, routes, "addUnicastRoutes", false);
 }
 
@@ -207,6 +259,10 @@ void ThriftHandler::deleteUnicastRoutes(
     int16_t client, std::unique_ptr<std::vector<IpPrefix>> prefixes) {
   ensureConfigured("deleteUnicastRoutes");
   ensureFibSynced("deleteUnicastRoutes");
+  if (sw_->getRib()) {
+    updateUnicastRoutesInRib(client, {}, *prefixes, "Delete", false);
+    return;
+  }
   RouteUpdateStats stats(sw_, "Delete", prefixes->size());
   // Perform the update
   auto updateFn = [&](const shared_ptr<SwitchState>& state) {
@@ -222,21 +278,25 @@ void ThriftHandler::deleteUnicastRoutes(
       }
       updater.delRoute(routerId, network, mask, ClientID(client));
     }
-    auto newRt = updater.updateDone();
-    if (!newRt) {
-      return shared_ptr<SwitchState>();
-    }
-    auto newState = state->clone();
-    newState->resetRouteTables(std::move(newRt));
-    return newState;
+    return applyRouteUpdater(state, &updater);
   };
+  std::vector<folly::CIDRNetwork> deleted;
+  deleted.reserve(prefixes->size());
+  for (const auto& prefix : *prefixes) {
+    deleted.push_back(toNormalizedPrefix(prefix));
+  }
+  recordLateRouteUpdates(client, deleted, false);
   sw_->updateStateBlocking("delete unicast route", updateFn);
 }
 
 void ThriftHandler::syncFib(
     int16_t client, std::unique_ptr<std::vector<UnicastRoute>> routes) {
   ensureConfigured("syncFib");
-  updateUnicastRoutesImpl(client, routes, "syncFib", true);
+  if (sw_->getRib()) {
+    updateUnicastRoutesInRib(client, *routes, {}, "syncFib", true);
+  } else {
+    updateUnicastRoutesImpl(client, routes, "syncFib", true);
+  }
   if (!sw_->isFibSynced()) {
     sw_->fibSynced();
   }
@@ -247,6 +307,27 @@ void ThriftHandler::updateUnicastRoutesImpl(
   const std::string& updType, bool sync) {
   RouteUpdateStats stats(sw_, updType, routes->size());
 
+  if (!sync) {
+    std::vector<folly::CIDRNetwork> added;
+    added.reserve(routes->size());
+    for (const auto& route : *routes) {
+      added.push_back(toNormalizedPrefix(route.dest));
+    }
+    recordLateRouteUpdates(client, added, true);
+  }
+
+  if (FLAGS_route_update_chunk_size > 0 &&
+      routes->size() > static_cast<size_t>(FLAGS_route_update_chunk_size)) {
+    updateUnicastRoutesChunked(
+        client, *routes, updType, sync, FLAGS_route_update_chunk_size);
+    return;
+  }
+
+  if (sync) {
+    // Any chunked sync still in flight for this client is superseded
+    startFibSync(client, false);
+  }
+
   // Note that we capture routes by reference here, since it is a unique_ptr.
   // This is safe since we use updateStateBlocking(), so routes will still
   // be valid in our scope when updateFn() is called.
@@ -255,48 +336,181 @@ void ThriftHandler::updateUnicastRoutesImpl(
     // create an update object starting from empty
     RouteUpdater updater(state->getRouteTables());
     RouterID routerId = RouterID(0); // TODO, default vrf for now
-    auto clientIdToAdmin = sw_->clientIdToAdminDistance(client);
     if (sync) {
       updater.removeAllRoutesForClient(routerId, ClientID(client));
     }
-    for (const auto& route : *routes) {
-      folly::IPAddress network = toIPAddress(route.dest.ip);
-      uint8_t mask = static_cast<uint8_t>(route.dest.prefixLength);
-      auto adminDistance = route.__isset.adminDistance
-          ? route.adminDistance_ref().value_unchecked()
-          : clientIdToAdmin;
-      std::vector<NextHopThrift> nhts;
-      if (route.nextHops.empty() && !route.nextHopAddrs.empty()) {
-        nhts = util::thriftNextHopsFromAddresses(route.nextHopAddrs);
-      } else {
-        nhts = route.nextHops;
-      }
-      RouteNextHopSet nexthops = util::toRouteNextHopSet(nhts);
-      if (nexthops.size()) {
-        updater.addRoute(routerId, network, mask, ClientID(client),
-                         RouteNextHopEntry(std::move(nexthops), adminDistance));
-      } else {
-        XLOG(DBG3) << "Blackhole route:" << network << "/"
-                   << static_cast<int>(mask);
-        updater.addRoute(routerId, network, mask, ClientID(client),
-                         RouteNextHopEntry(RouteForwardAction::DROP,
-                           adminDistance));
-      }
-      if (network.isV4()) {
-        sw_->stats()->addRouteV4();
-      } else {
-        sw_->stats()->addRouteV6();
+    addUnicastRoutesToUpdater(&updater, client, routes->begin(), routes->end());
+    return applyRouteUpdater(state, &updater);
+  };
+  sw_->updateStateBlocking(updType, updateFn);
+}
+
+void ThriftHandler::updateUnicastRoutesChunked(
+    int16_t client, const std::vector<UnicastRoute>& routes,
+    const std::string& updType, bool sync, size_t chunkSize) {
+  uint64_t generation = sync ? startFibSync(client, true) : 0;
+  SCOPE_EXIT {
+    if (sync) {
+      finishFibSync(client, generation);
+    }
+  };
+
+  auto chunkBegin = routes.begin();
+  while (chunkBegin != routes.end()) {
+    auto chunkEnd = chunkBegin +
+        std::min<size_t>(chunkSize, std::distance(chunkBegin, routes.end()));
+    auto updateFn = [&](const shared_ptr<SwitchState>& state) {
+      // Routes the client changed since the sync started are newer than
+      // what the sync has for them, leave them alone
+      LateRouteUpdates lateUpdates;
+      if (sync) {
+        lateUpdates = getLateRouteUpdates(client, generation);
       }
+      RouteUpdater updater(state->getRouteTables());
+      addUnicastRoutesToUpdater(
+          &updater, client, chunkBegin, chunkEnd, &lateUpdates);
+      return applyRouteUpdater(state, &updater);
+    };
+    sw_->updateStateBlocking(updType, updateFn);
+    chunkBegin = chunkEnd;
+  }
+  if (!sync) {
+    return;
+  }
+
+  // All chunks are in, sweep away the routes of this client that were
+  // neither in the sync nor added by the client since it started.
+  std::vector<folly::CIDRNetwork> synced;
+  synced.reserve(routes.size());
+  for (const auto& route : routes) {
+    synced.push_back(toNormalizedPrefix(route.dest));
+  }
+  std::sort(synced.begin(), synced.end());
+  auto sweepFn = [&](const shared_ptr<SwitchState>& state) {
+    auto lateUpdates = getLateRouteUpdates(client, generation);
+    RouteUpdater updater(state->getRouteTables());
+    updater.removeRoutesForClientIf(
+        RouterID(0),
+        ClientID(client),
+        [&](const folly::IPAddress& network, uint8_t mask) {
+          auto prefix = std::make_pair(network, mask);
+          auto late = lateUpdates.find(prefix);
+          if (late != lateUpdates.end()) {
+            return !late->second;
+          }
+          return !std::binary_search(synced.begin(), synced.end(), prefix);
+        });
+    return applyRouteUpdater(state, &updater);
+  };
+  sw_->updateStateBlocking(updType, sweepFn);
+}
+
+void ThriftHandler::addUnicastRoutesToUpdater(
+    RouteUpdater* updater, int16_t client,
+    std::vector<UnicastRoute>::const_iterator begin,
+    std::vector<UnicastRoute>::const_iterator end,
+    const LateRouteUpdates* skip) {
+  RouterID routerId = RouterID(0); // TODO, default vrf for now
+  auto clientIdToAdmin = sw_->clientIdToAdminDistance(client);
+  for (auto it = begin; it != end; ++it) {
+    const auto& route = *it;
+    if (skip && !skip->empty() &&
+        skip->find(toNormalizedPrefix(route.dest)) != skip->end()) {
+      continue;
     }
-    auto newRt = updater.updateDone();
-    if (!newRt) {
-      return shared_ptr<SwitchState>();
+    folly::IPAddress network = toIPAddress(route.dest.ip);
+    uint8_t mask = static_cast<uint8_t>(route.dest.prefixLength);
+    auto adminDistance = route.__isset.adminDistance
+        ? route.adminDistance_ref().value_unchecked()
+        : clientIdToAdmin;
+    std::vector<NextHopThrift> nhts;
+    if (route.nextHops.empty() && !route.nextHopAddrs.empty()) {
+      nhts = util::thriftNextHopsFromAddresses(route.nextHopAddrs);
+    } else {
+      nhts = route.nextHops;
     }
-    auto newState = state->clone();
-    newState->resetRouteTables(std::move(newRt));
-    return newState;
-  };
-  sw_->updateStateBlocking(updType, updateFn);
+    RouteNextHopSet nexthops = util::toRouteNextHopSet(nhts);
+    if (nexthops.size()) {
+      updater->addRoute(routerId, network, mask, ClientID(client),
+                        RouteNextHopEntry(std::move(nexthops), adminDistance));
+    } else {
+      XLOG(DBG3) << "Blackhole route:" << network << "/"
+                 << static_cast<int>(mask);
+      updater->addRoute(routerId, network, mask, ClientID(client),
+                        RouteNextHopEntry(RouteForwardAction::DROP,
+                          adminDistance));
+    }
+    if (network.isV4()) {
+      sw_->stats()->addRouteV4();
+    } else {
+      sw_->stats()->addRouteV6();
+    }
+  }
+}
+
+void ThriftHandler::updateUnicastRoutesInRib(
+    int16_t client, const std::vector<UnicastRoute>& toAdd,
+    const std::vector<IpPrefix>& toDelete, const std::string& updType,
+    bool sync) {
+  RouteUpdateStats stats(sw_, updType, toAdd.size() + toDelete.size());
+  for (const auto& route : toAdd) {
+    if (toIPAddress(route.dest.ip).isV4()) {
+      sw_->stats()->addRouteV4();
+    } else {
+      sw_->stats()->addRouteV6();
+    }
+  }
+  for (const auto& prefix : toDelete) {
+    if (toIPAddress(prefix.ip).isV4()) {
+      sw_->stats()->delRouteV4();
+    } else {
+      sw_->stats()->delRouteV6();
+    }
+  }
+  RouterID routerId = RouterID(0); // TODO, default vrf for now
+  sw_->updateRib(routerId, ClientID(client), toAdd, toDelete, sync, updType);
+}
+
+uint64_t ThriftHandler::startFibSync(int16_t client, bool chunked) {
+  auto syncs = fibSyncs_.wlock();
+  auto& sync = (*syncs)[client];
+  sync.inProgress = chunked;
+  sync.lateUpdates.clear();
+  return ++sync.generation;
+}
+
+void ThriftHandler::finishFibSync(int16_t client, uint64_t generation) {
+  auto syncs = fibSyncs_.wlock();
+  auto& sync = (*syncs)[client];
+  if (sync.generation == generation) {
+    sync.inProgress = false;
+    sync.lateUpdates.clear();
+  }
+}
+
+ThriftHandler::LateRouteUpdates ThriftHandler::getLateRouteUpdates(
+    int16_t client, uint64_t generation) {
+  auto syncs = fibSyncs_.rlock();
+  auto it = syncs->find(client);
+  if (it == syncs->end() || it->second.generation != generation) {
+    throw FbossError(
+        "syncFib for client ", client, " superseded by a newer syncFib");
+  }
+  return it->second.lateUpdates;
+}
+
+void ThriftHandler::recordLateRouteUpdates(
+    int16_t client,
+    const std::vector<folly::CIDRNetwork>& prefixes,
+    bool added) {
+  auto syncs = fibSyncs_.wlock();
+  auto it = syncs->find(client);
+  if (it == syncs->end() || !it->second.inProgress) {
+    return;
+  }
+  for (const auto& prefix : prefixes) {
+    it->second.lateUpdates[prefix] = added;
+  }
 }
 
 static void populateInterfaceDetail(InterfaceDetail& interfaceDetail,
@@ -708,6 +922,15 @@ void ThriftHandler::getRouteTable(std::vector<UnicastRoute>& routes) {
       routes.emplace_back(std::move(tempRoute));
     }
   }
+  // With a standalone RIB, the resolved routes are in the FIBs instead
+  for (const auto& fibContainer : (*appliedState->getFibs())) {
+    for (const auto& ipv4 : *(fibContainer->getFibV4())) {
+      routes.emplace_back(toUnicastRoute(*ipv4));
+    }
+    for (const auto& ipv6 : *(fibContainer->getFibV6())) {
+      routes.emplace_back(toUnicastRoute(*ipv6));
+    }
+  }
 }
 
 void ThriftHandler::getRouteTableByClient(
@@ -760,21 +983,25 @@ void ThriftHandler::getRouteTableDetails(std::vector<RouteDetails>& routes) {
       routes.emplace_back(std::move(rd));
     }
   }
+  for (const auto& fibContainer : (*sw_->getState()->getFibs())) {
+    for (const auto& ipv4 : *(fibContainer->getFibV4())) {
+      routes.emplace_back(ipv4->toRouteDetails());
+    }
+    for (const auto& ipv6 : *(fibContainer->getFibV6())) {
+      routes.emplace_back(ipv6->toRouteDetails());
+    }
+  }
 }
 
 void ThriftHandler::getIpRoute(UnicastRoute& route,
                                 std::unique_ptr<Address> addr, int32_t vrfId) {
   ensureConfigured();
   folly::IPAddress ipAddr = toIPAddress(*addr);
-  auto routeTable = sw_->getState()->getRouteTables()->getRouteTableIf(
-      RouterID(vrfId));
-  if (!routeTable) {
-    throw FbossError("No Such VRF ", vrfId);
-  }
+  auto state = sw_->getState();
+  ensureVrfExists(state, RouterID(vrfId));
 
   if (ipAddr.isV4()) {
-    auto ripV4Rib = routeTable->getRibV4();
-    auto match = ripV4Rib->longestMatch(ipAddr.asV4());
+    auto match = state->longestMatchRoute(RouterID(vrfId), ipAddr.asV4());
     if (!match || !match->isResolved()) {
       route.dest.ip = toBinaryAddress(IPAddressV4("0.0.0.0"));
       route.dest.prefixLength = 0;
@@ -785,8 +1012,7 @@ void ThriftHandler::getIpRoute(UnicastRoute& route,
     route.dest.prefixLength = match->prefix().mask;
     route.nextHopAddrs = util::fromFwdNextHops(fwdInfo.getNextHopSet());
   } else {
-    auto ripV6Rib = routeTable->getRibV6();
-    auto match = ripV6Rib->longestMatch(ipAddr.asV6());
+    auto match = state->longestMatchRoute(RouterID(vrfId), ipAddr.asV6());
     if (!match || !match->isResolved()) {
       route.dest.ip = toBinaryAddress(IPAddressV6("::0"));
       route.dest.prefixLength = 0;
@@ -803,21 +1029,16 @@ void ThriftHandler::getIpRouteDetails(
   RouteDetails& route, std::unique_ptr<Address> addr, int32_t vrfId) {
   ensureConfigured();
   folly::IPAddress ipAddr = toIPAddress(*addr);
-  auto routeTable = sw_->getState()->getRouteTables()->getRouteTableIf(
-      RouterID(vrfId));
-  if (!routeTable) {
-    throw FbossError("No Such VRF ", vrfId);
-  }
+  auto state = sw_->getState();
+  ensureVrfExists(state, RouterID(vrfId));
 
   if (ipAddr.isV4()) {
-    auto ripV4Rib = routeTable->getRibV4();
-    auto match = ripV4Rib->longestMatch(ipAddr.asV4());
+    auto match = state->longestMatchRoute(RouterID(vrfId), ipAddr.asV4());
     if (match && match->isResolved()) {
       route = match->toRouteDetails();
     }
   } else {
-    auto ripV6Rib = routeTable->getRibV6();
-    auto match = ripV6Rib->longestMatch(ipAddr.asV6());
+    auto match = state->longestMatchRoute(RouterID(vrfId), ipAddr.asV6());
     if (match && match->isResolved()) {
       route = match->toRouteDetails();
     }
@@ -912,8 +1133,20 @@ void ThriftHandler::async_eb_registerForNeighborChanged(
 void ThriftHandler::startPktCapture(unique_ptr<CaptureInfo> info) {
   ensureConfigured();
   auto* mgr = sw_->getCaptureMgr();
+  if (info->snaplen < 0 || info->rotateBytes < 0 || info->rotateSeconds < 0 ||
+      info->maxFiles < 0) {
+    throw FbossError("invalid snaplen or rotation limits for capture ",
+                     info->name);
+  }
   auto capture = make_unique<PktCapture>(
-       info->name, info->maxPackets, info->direction, info->filter);
+       info->name, info->maxPackets, info->direction, info->filter,
+       info->snaplen);
+  PcapWriter::FileOptions fileOptions;
+  fileOptions.rotateBytes = info->rotateBytes;
+  fileOptions.rotateInterval = std::chrono::seconds(info->rotateSeconds);
+  fileOptions.compress = info->compress;
+  fileOptions.maxFiles = info->maxFiles;
+  capture->setFileOptions(fileOptions);
   mgr->startCapture(std::move(capture));
 }
 
@@ -986,7 +1219,7 @@ void ThriftHandler::sendPkt(int32_t port, int32_t vlan,
   auto pkt = make_unique<MockRxPacket>(std::move(buf));
   pkt->setSrcPort(PortID(port));
   pkt->setSrcVlan(VlanID(vlan));
-  sw_->packetReceived(std::move(pkt));
+  sw_->packetReceivedThrowExceptionOnError(std::move(pkt));
 }
 
 void ThriftHandler::sendPktHex(int32_t port, int32_t vlan,
@@ -995,7 +1228,7 @@ void ThriftHandler::sendPktHex(int32_t port, int32_t vlan,
   auto pkt = MockRxPacket::fromHex(StringPiece(*hex));
   pkt->setSrcPort(PortID(port));
   pkt->setSrcVlan(VlanID(vlan));
-  sw_->packetReceived(std::move(pkt));
+  sw_->packetReceivedThrowExceptionOnError(std::move(pkt));
 }
 
 void ThriftHandler::txPkt(int32_t port, unique_ptr<fbstring> data) {
@@ -31,6 +31,7 @@ namespace facebook { namespace fboss {
 
 class AggregatePort;
 class Port;
+class RouteUpdater;
 class SwSwitch;
 class Vlan;
 
@@ -268,6 +269,61 @@ class ThriftHandler : virtual public FbossCtrlSvIf,
   void updateUnicastRoutesImpl(
     int16_t client, const std::unique_ptr<std::vector<UnicastRoute>>& routes,
     const std::string& updType, bool sync);
+  /*
+   * Apply a large route update as a series of state updates of at most
+   * chunkSize routes each, so that other state updates get to run in
+   * between instead of waiting for the whole request.
+   *
+   * For a sync, the stale routes of the client are removed by a final sweep
+   * once all chunks are in: every prefix in the request is marked, and the
+   * sweep deletes the routes of the client that are not marked. Prefixes
+   * the client updates while the sync is in flight are skipped by the
+   * chunks that follow, so a late chunk never undoes a newer update.
+   */
+  void updateUnicastRoutesChunked(
+    int16_t client, const std::vector<UnicastRoute>& routes,
+    const std::string& updType, bool sync, size_t chunkSize);
+  typedef std::map<folly::CIDRNetwork, bool> LateRouteUpdates;
+  void addUnicastRoutesToUpdater(
+    RouteUpdater* updater, int16_t client,
+    std::vector<UnicastRoute>::const_iterator begin,
+    std::vector<UnicastRoute>::const_iterator end,
+    const LateRouteUpdates* skip = nullptr);
+  /*
+   * Route updates when the SwSwitch keeps its routes in a standalone RIB.
+   * The RIB is updated in place, so a sync is applied as a single update
+   * without chunking.
+   */
+  void updateUnicastRoutesInRib(
+    int16_t client, const std::vector<UnicastRoute>& toAdd,
+    const std::vector<IpPrefix>& toDelete, const std::string& updType,
+    bool sync);
+
+  /*
+   * syncFib() bookkeeping for each client. Every sync bumps the generation,
+   * which makes a chunked sync still in flight for the same client give up.
+   * Routes the client adds or deletes while a chunked sync is in flight are
+   * recorded in lateUpdates (true for added), and both the remaining chunks
+   * and the final sweep honor them over the content of the sync, as if the
+   * sync had been applied as one atomic update before them.
+   *
+   * The state update functions of a sync only hold fibSyncs_ long enough to
+   * copy out lateUpdates, see getLateRouteUpdates().
+   */
+  struct FibSyncState {
+    uint64_t generation{0};
+    bool inProgress{false};
+    LateRouteUpdates lateUpdates;
+  };
+  uint64_t startFibSync(int16_t client, bool chunked);
+  void finishFibSync(int16_t client, uint64_t generation);
+  // Throws if a newer sync superseded the given generation
+  LateRouteUpdates getLateRouteUpdates(int16_t client, uint64_t generation);
+  void recordLateRouteUpdates(
+    int16_t client,
+    const std::vector<folly::CIDRNetwork>& prefixes,
+    bool added);
+  folly::Synchronized<std::map<int16_t, FibSyncState>> fibSyncs_;
 
   void getPortInfoHelper(
       PortInfoThrift& portInfo,
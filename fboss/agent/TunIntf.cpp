@@ -64,20 +64,20 @@ struct iplink_req {
 
 TunIntf::TunIntf(
     SwSwitch *sw,
-    folly::EventBase *evb,
+    const std::vector<folly::EventBase*>& evbs,
     InterfaceID ifID,
     int ifIndex,
     int mtu)
-    : folly::EventHandler(evb),
-      sw_(sw),
+    : sw_(sw),
       name_(util::createTunIntfName(ifID)),
       ifID_(ifID),
       ifIndex_(ifIndex),
+      evbs_(evbs),
       mtu_(mtu) {
   DCHECK(sw) << "NULL pointer to SwSwitch.";
-  DCHECK(evb) << "NULL pointer to EventBase";
+  DCHECK(!evbs.empty()) << "No EventBase";
 
-  openFD();
+  openFD(evbs_.size());
   SCOPE_FAIL {
     closeFD();
   };
@@ -87,37 +87,37 @@ TunIntf::TunIntf(
   // next release onwards we will not need it
   disableIPv6AddrGenMode(ifIndex_);
 
-  XLOG(INFO) << "Added interface " << name_ << " with fd " << fd_ << " @ index "
-             << ifIndex_ << ", "
+  XLOG(INFO) << "Added interface " << name_ << " with " << fds_.size()
+             << " queues @ index " << ifIndex_ << ", "
              << "DOWN";
 }
 
 TunIntf::TunIntf(
     SwSwitch *sw,
-    folly::EventBase *evb,
+    const std::vector<folly::EventBase*>& evbs,
     InterfaceID ifID,
     bool status,
     const Interface::Addresses& addr,
     int mtu)
-    : folly::EventHandler(evb),
-      sw_(sw),
+    : sw_(sw),
       name_(util::createTunIntfName(ifID)),
       ifID_(ifID),
       status_(status),
       addrs_(addr),
+      evbs_(evbs),
       mtu_(mtu) {
   DCHECK(sw) << "NULL pointer to SwSwitch.";
-  DCHECK(evb) << "NULL pointer to EventBase";
+  DCHECK(!evbs.empty()) << "No EventBase";
 
-  // Open Tun interface FD for socket-IO
-  openFD();
+  // Open Tun interface FDs for socket-IO
+  openFD(evbs_.size());
   SCOPE_FAIL {
     closeFD();
   };
 
   // Make the Tun interface persistent, so that the network sessions from the
   // application (i.e. BGP)  will not be reset if controller restarts
-  auto ret = ioctl(fd_, TUNSETPERSIST, 1);
+  auto ret = ioctl(fds_[0], TUNSETPERSIST, 1);
   sysCheckError(ret, "Failed to set persist interface ", name_);
 
   // TODO: if needed, we can adjust send buffer size, TUNSETSNDBUF
@@ -147,83 +147,132 @@ TunIntf::TunIntf(
   // Disable v6 link-local address assignment on Tun interface
   disableIPv6AddrGenMode(ifIndex_);
 
-  XLOG(INFO) << "Created interface " << name_ << " with fd " << fd_
-             << " @ index " << ifIndex_ << ", " << (status ? "UP" : "DOWN");
+  XLOG(INFO) << "Created interface " << name_ << " with " << fds_.size()
+             << " queues @ index " << ifIndex_ << ", "
+             << (status ? "UP" : "DOWN");
 }
 
 TunIntf::~TunIntf() {
   stop();
 
   // We must have a valid fd to TunIntf
-  CHECK_NE(fd_, -1);
+  CHECK(!fds_.empty());
 
   // Delete interface if need be
   if (toDelete_) {
-    auto ret = ioctl(fd_, TUNSETPERSIST, 0);
+    auto ret = ioctl(fds_[0], TUNSETPERSIST, 0);
     sysLogError(ret, "Failed to unset persist interface ", name_);
   }
 
-  // Close FD. This will delete the interface if TUNSETPERSIST is not on
+  // Close FDs. This will delete the interface if TUNSETPERSIST is not on
   closeFD();
   XLOG(INFO) << (toDelete_ ? "Delete" : "Detach") << " interface " << name_;
 }
 
 void TunIntf::stop() {
-  unregisterHandler();
+  for (auto& queue : queues_) {
+    queue->stop();
+  }
 }
 
 void TunIntf::start() {
-  if (fd_ != -1 && !isHandlerRegistered()) {
-    changeHandlerFD(folly::NetworkSocket::fromFd(fd_));
-    registerHandler(folly::EventHandler::READ | folly::EventHandler::PERSIST);
+  for (auto& queue : queues_) {
+    queue->start();
   }
 }
 
-void TunIntf::openFD() {
-  fd_ = open(kTunDev.c_str(), O_RDWR);
-  sysCheckError(fd_, "Cannot open ", kTunDev.c_str());
+void TunIntf::openFD(size_t numQueues) {
   SCOPE_FAIL {
     closeFD();
   };
 
+  bool multiQueue = numQueues > 1;
+  auto fd = openQueue(multiQueue);
+  if (fd == -1) {
+    // The interface persisted from a run with a different number of queues,
+    // and keeps its queue mode until deleted. Attach to it as it is.
+    XLOG(WARNING) << "Interface " << name_ << " is "
+                  << (multiQueue ? "single" : "multi") << " queue, "
+                  << "attaching with a single queue";
+    multiQueue = !multiQueue;
+    numQueues = 1;
+    fd = openQueue(multiQueue);
+    if (fd == -1) {
+      throw SysError(EINVAL, "Failed to create/attach interface ", name_);
+    }
+  }
+  fds_.push_back(fd);
+  while (fds_.size() < numQueues) {
+    fd = openQueue(multiQueue);
+    if (fd == -1) {
+      throw SysError(
+          EINVAL, "Failed to attach queue ", fds_.size(), " of ", name_);
+    }
+    fds_.push_back(fd);
+  }
+
+  // Set configured MTU
+  setMtu(mtu_);
+
+  for (size_t i = 0; i < fds_.size(); ++i) {
+    queues_.push_back(std::make_unique<Queue>(this, evbs_[i], fds_[i]));
+  }
+}
+
+int TunIntf::openQueue(bool multiQueue) {
+  auto fd = open(kTunDev.c_str(), O_RDWR);
+  sysCheckError(fd, "Cannot open ", kTunDev.c_str());
+  SCOPE_FAIL {
+    close(fd);
+  };
+
   struct ifreq ifr;
   memset(&ifr, 0, sizeof(ifr));
-  // Flags: IFF_TUN   - TUN device (no Ethernet headers)
-  //        IFF_NO_PI - Do not provide packet information
+  // Flags: IFF_TUN         - TUN device (no Ethernet headers)
+  //        IFF_NO_PI       - Do not provide packet information
+  //        IFF_MULTI_QUEUE - One of several queues of the device
   ifr.ifr_flags = IFF_TUN | IFF_NO_PI;
+  if (multiQueue) {
+    ifr.ifr_flags |= IFF_MULTI_QUEUE;
+  }
   bzero(ifr.ifr_name, sizeof(ifr.ifr_name));
   size_t len = std::min(name_.size(), sizeof(ifr.ifr_name));
   memmove(ifr.ifr_name, name_.c_str(), len);
-  auto ret = ioctl(fd_, TUNSETIFF, (void *) &ifr);
+  auto ret = ioctl(fd, TUNSETIFF, (void *) &ifr);
+  if (ret < 0 && errno == EINVAL) {
+    close(fd);
+    return -1;
+  }
   sysCheckError(ret, "Failed to create/attach interface ", name_);
 
-  // Set configured MTU
-  setMtu(mtu_);
-
   // make fd non-blocking
-  auto flags = fcntl(fd_, F_GETFL);
-  sysCheckError(flags, "Failed to get flags from fd ", fd_);
+  auto flags = fcntl(fd, F_GETFL);
+  sysCheckError(flags, "Failed to get flags from fd ", fd);
   flags |= O_NONBLOCK;
-  ret = fcntl(fd_, F_SETFL, flags);
+  ret = fcntl(fd, F_SETFL, flags);
   sysCheckError(ret, "Failed to set non-blocking flags ", flags,
-                " to fd ", fd_);
-  flags = fcntl(fd_, F_GETFD);
-  sysCheckError(flags, "Failed to get flags from fd ", fd_);
+                " to fd ", fd);
+  flags = fcntl(fd, F_GETFD);
+  sysCheckError(flags, "Failed to get flags from fd ", fd);
   flags |= FD_CLOEXEC;
-  ret = fcntl(fd_, F_SETFD, flags);
+  ret = fcntl(fd, F_SETFD, flags);
   sysCheckError(ret, "Failed to set close-on-exec flags ", flags,
-                " to fd ", fd_);
+                " to fd ", fd);
 
-  XLOG(INFO) << "Create/attach to tun interface " << name_ << " @ fd " << fd_;
+  XLOG(INFO) << "Create/attach to tun interface " << name_ << " @ fd " << fd;
+  return fd;
 }
 
 void TunIntf::closeFD() noexcept {
-  auto ret = close(fd_);
-  sysLogError(ret, "Failed to close fd ", fd_, " for interface ", name_);
-  if (ret == 0) {
-    XLOG(INFO) << "Closed fd " << fd_ << " for interface " << name_;
-    fd_ = -1;
+  queues_.clear();
+  for (auto fd : fds_) {
+    auto ret = close(fd);
+    sysLogError(ret, "Failed to close fd ", fd, " for interface ", name_);
+    if (ret == 0) {
+      XLOG(INFO) << "Closed fd " << fd << " for interface " << name_;
+    }
   }
+  fds_.clear();
 }
 
 void TunIntf::addAddress(const folly::IPAddress& addr, uint8_t mask) {
@@ -252,7 +301,7 @@ void TunIntf::setMtu(int mtu) {
   ifr.ifr_mtu = mtu_;
   auto ret = ioctl(sock, SIOCSIFMTU, (void*)&ifr);
   sysCheckError(ret, "Failed to set MTU ", ifr.ifr_mtu,
-                " to fd ", fd_, " errno = ", errno);
+                " on interface ", name_, " errno = ", errno);
   XLOG(DBG3) << "Set tun " << name_ << " MTU to " << mtu;
 }
 
@@ -293,11 +342,31 @@ void TunIntf::disableIPv6AddrGenMode(int ifIndex) {
   return;
 }
 
-void TunIntf::handlerReady(uint16_t /*events*/) noexcept {
+TunIntf::Queue::Queue(TunIntf* intf, folly::EventBase* evb, int fd)
+    : folly::EventHandler(evb), intf_(intf), evb_(evb), fd_(fd) {
+  DCHECK(evb) << "NULL pointer to EventBase";
+}
+
+void TunIntf::Queue::start() {
+  evb_->runImmediatelyOrRunInEventBaseThreadAndWait([this]() {
+    if (!isHandlerRegistered()) {
+      changeHandlerFD(folly::NetworkSocket::fromFd(fd_));
+      registerHandler(folly::EventHandler::READ | folly::EventHandler::PERSIST);
+    }
+  });
+}
+
+void TunIntf::Queue::stop() {
+  evb_->runImmediatelyOrRunInEventBaseThreadAndWait(
+      [this]() { unregisterHandler(); });
+}
+
+void TunIntf::Queue::handlerReady(uint16_t /*events*/) noexcept {
   CHECK(fd_ != -1);
 
   // Since this is L3 packet size, we should also reserve some space for L2
   // header, which is 18 bytes (including one vlan tag)
+  auto mtu = intf_->mtu_.load(std::memory_order_relaxed);
   int sent = 0;
   int dropped = 0;
   uint64_t bytes = 0;
@@ -305,7 +374,12 @@ void TunIntf::handlerReady(uint16_t /*events*/) noexcept {
   try {
     while (sent + dropped < kMaxSentOneTime) {
       std::unique_ptr<TxPacket> pkt;
-      pkt = sw_->allocateL3TxPacket(mtu_);
+      if (spare_ && spare_->buf()->tailroom() >= mtu) {
+        pkt = std::move(spare_);
+      } else {
+        spare_.reset();
+        pkt = intf_->sw_->allocateL3TxPacket(mtu);
+      }
       auto buf = pkt->buf();
       int ret = 0;
       do {
@@ -317,12 +391,14 @@ void TunIntf::handlerReady(uint16_t /*events*/) noexcept {
           // Cannot continue read on this fd
           fdFail = true;
         }
+        spare_ = std::move(pkt);
         break;
       } else if (ret == 0) {
         // Nothing to read. It shall not happen as the fd is non-blocking.
         // Just add this case to be safe. Adding DCHECK for sanity checking
         // in debug mode.
         DCHECK(false) << "Unexpected event. Nothing to read.";
+        spare_ = std::move(pkt);
         break;
       } else if (ret > buf->tailroom()) {
         // The pkt is larger than the buffer. We don't have complete packet.
@@ -330,10 +406,11 @@ void TunIntf::handlerReady(uint16_t /*events*/) noexcept {
         XLOG(ERR) << "Too large packet (" << ret << " > " << buf->tailroom()
                   << ") received from host. Drop the packet.";
         ++dropped;
+        spare_ = std::move(pkt);
       } else {
         bytes += ret;
         buf->append(ret);
-        sw_->sendL3Packet(std::move(pkt), ifID_);
+        intf_->sw_->sendL3Packet(std::move(pkt), intf_->ifID_);
         ++sent;
       }
     } // while
@@ -347,12 +424,12 @@ void TunIntf::handlerReady(uint16_t /*events*/) noexcept {
   }
 
   XLOG(DBG4) << "Forwarded " << sent << " packets (" << bytes
-             << " bytes) from host @ fd " << fd_ << " for interface " << name_
-             << " dropped:" << dropped;
+             << " bytes) from host @ fd " << fd_ << " for interface "
+             << intf_->name_ << " dropped:" << dropped;
 }
 
 bool TunIntf::sendPacketToHost(std::unique_ptr<RxPacket> pkt) {
-  CHECK(fd_ != -1);
+  CHECK(!fds_.empty());
   const int l2Len = EthHdr::SIZE;
 
   auto buf = pkt->buf();
@@ -364,9 +441,13 @@ bool TunIntf::sendPacketToHost(std::unique_ptr<RxPacket> pkt) {
   // skip L2 header
   buf->trimStart(l2Len);
 
+  // Spread the packets over the queues, a queue is as good as any other to
+  // write to, but writes to the same queue contend in the kernel
+  auto fd = fds_[nextTxQueue_.fetch_add(1, std::memory_order_relaxed) %
+                 fds_.size()];
   int ret = 0;
   do {
-    ret = write(fd_, buf->data(), buf->length());
+    ret = write(fd, buf->data(), buf->length());
   } while (ret == -1 && errno == EINTR);
   if (ret < 0) {
     sysLogError(ret, "Failed to send packet to host from Interface ", ifID_);
@@ -15,12 +15,23 @@
 #include <folly/io/async/EventBase.h>
 #include <folly/io/async/EventHandler.h>
 
+#include <atomic>
+#include <memory>
+#include <vector>
+
 namespace facebook { namespace fboss {
 
 class SwSwitch;
 class RxPacket;
+class TxPacket;
 
-class TunIntf : private folly::EventHandler {
+/**
+ * A Tun interface on the host. With more than one event base the interface
+ * is created with IFF_MULTI_QUEUE and one queue per event base, so that
+ * packets from the host are read by as many threads. Packets to the host
+ * are written to the queues in turn.
+ */
+class TunIntf {
  public:
   /**
    * Creates a TunIntf object of already existing linux interface. Initial
@@ -30,7 +41,7 @@ class TunIntf : private folly::EventHandler {
    */
   TunIntf(
       SwSwitch *sw,
-      folly::EventBase *evb,
+      const std::vector<folly::EventBase*>& evbs,
       InterfaceID ifID,
       int ifIndex /* linux */,
       int mtu);
@@ -40,7 +51,7 @@ class TunIntf : private folly::EventHandler {
    */
   TunIntf(
       SwSwitch *sw,
-      folly::EventBase *evb,
+      const std::vector<folly::EventBase*>& evbs,
       InterfaceID ifID,   // Switch interface ID
       bool status,
       const Interface::Addresses& addrs,
@@ -119,24 +130,61 @@ class TunIntf : private folly::EventHandler {
     return mtu_;
   }
 
+  size_t getNumQueues() const {
+    return fds_.size();
+  }
+
   bool getStatus() const {
     return status_;
   }
 
  private:
   /**
-   * Callback for event on Tun interface's read socket-fd
-   * Override's folly::EventHandler handlerReady callback.
+   * One queue of the Tun interface, which reads packets from the host on
+   * the thread serving its evb.
    */
-  void handlerReady(uint16_t events) noexcept override;
+  class Queue : private folly::EventHandler {
+   public:
+    Queue(TunIntf* intf, folly::EventBase* evb, int fd);
+
+    /**
+     * Start/Stop reading from the queue. Can be called from any thread.
+     */
+    void start();
+    void stop();
+
+   private:
+    /**
+     * Callback for event on the queue's fd
+     * Override's folly::EventHandler handlerReady callback.
+     */
+    void handlerReady(uint16_t events) noexcept override;
+
+    TunIntf* intf_{nullptr};
+    folly::EventBase* evb_{nullptr};
+    int fd_{-1};
+
+    /**
+     * The packet allocated for a read which found nothing to read. It is
+     * kept for the next read instead of being freed, so that draining the
+     * queue does not cost an allocation every time.
+     */
+    std::unique_ptr<TxPacket> spare_;
+  };
 
   /**
-   * Open/Close a new socket-fd to read/write data from Tun interface.
-   * fd_ is mutated.
+   * Open/Close the socket-fds to read/write data from Tun interface, one
+   * per queue. fds_ is mutated.
    */
-  void openFD();
+  void openFD(size_t numQueues);
   void closeFD() noexcept;
 
+  /**
+   * Open one queue of the Tun interface. Returns -1 if the interface exists
+   * in the other queue mode, and throws on any other error.
+   */
+  int openQueue(bool multiQueue);
+
   /**
    * In newer kernel an interface is automatically gets link-local IPv6 address
    * because of IPv6 autoconf and FBOSS (we) assign one more.
@@ -158,11 +206,18 @@ class TunIntf : private folly::EventHandler {
   Interface::Addresses addrs_;  // The IP addresses assigned to this intf
 
   /**
-   * File descriptor for this interface through which packets can
-   * be received from or sent to.
+   * File descriptors for this interface through which packets can
+   * be received from or sent to, one per queue.
    */
-  int fd_{-1};
-  int mtu_{-1};
+  std::vector<int> fds_;
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<folly::EventBase*> evbs_;
+
+  // The queue the next packet to the host is written to
+  std::atomic<uint32_t> nextTxQueue_{0};
+
+  // Read by the queues on their own threads
+  std::atomic<int> mtu_{-1};
 };
 
 }}  // nanesoace facebook::fboss
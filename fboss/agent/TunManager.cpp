@@ -18,10 +18,13 @@ extern "C" {
 #include <sys/ioctl.h>
 }
 
+#include <folly/Conv.h>
 #include <folly/Demangle.h>
 #include <folly/MapUtil.h>
 #include <folly/io/async/EventBase.h>
+#include <folly/io/async/ScopedEventBaseThread.h>
 #include <folly/logging/xlog.h>
+#include <gflags/gflags.h>
 #include "fboss/agent/NlError.h"
 #include "fboss/agent/RxPacket.h"
 #include "fboss/agent/SysError.h"
@@ -37,6 +40,10 @@ namespace {
   const int kDefaultMtu = 1500;
 }
 
+DEFINE_int32(tun_queues, 1,
+             "Number of queues of each TUN interface. Each queue beyond the "
+             "first is read from its own thread.");
+
 namespace facebook { namespace fboss {
 
 using folly::IPAddress;
@@ -52,6 +59,14 @@ TunManager::TunManager(SwSwitch *sw, EventBase *evb) : sw_(sw), evb_(evb) {
   }
   auto error = nl_connect(sock_, NETLINK_ROUTE);
   nlCheckError(error, "failed to connect netlink socket to NETLINK_ROUTE");
+
+  // The first queue is served by evb, along with everything else
+  queueEvbs_.push_back(evb_);
+  for (int i = 1; i < FLAGS_tun_queues; ++i) {
+    queueThreads_.push_back(std::make_unique<folly::ScopedEventBaseThread>(
+        folly::to<std::string>("TunQueue", i)));
+    queueEvbs_.push_back(queueThreads_.back()->getEventBase());
+  }
 }
 
 TunManager::~TunManager() {
@@ -113,7 +128,7 @@ void TunManager::addExistingIntf(
     intfs_.erase(ret.first);
   };
   ret.first->second.reset(
-      new TunIntf(sw_, evb_, ifID, ifIndex, getInterfaceMtu(ifID)));
+      new TunIntf(sw_, queueEvbs_, ifID, ifIndex, getInterfaceMtu(ifID)));
 }
 
 void TunManager::addNewIntf(
@@ -129,7 +144,7 @@ void TunManager::addNewIntf(
     intfs_.erase(ret.first);
   };
   auto intf = std::make_unique<TunIntf>(
-      sw_, evb_, ifID, isUp, addrs, getInterfaceMtu(ifID));
+      sw_, queueEvbs_, ifID, isUp, addrs, getInterfaceMtu(ifID));
 
   SCOPE_FAIL {
     intf->setDelete();
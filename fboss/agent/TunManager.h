@@ -16,11 +16,18 @@
 
 #include <boost/container/flat_map.hpp>
 
+#include <memory>
+#include <vector>
+
 extern "C" {
 #include <netlink/socket.h>
 #include <netlink/object.h>
 }
 
+namespace folly {
+class ScopedEventBaseThread;
+}
+
 namespace facebook { namespace fboss {
 
 class InterfaceMap;
@@ -208,6 +215,14 @@ class TunManager : public StateObserver {
   // Netlink socket for managing interface/addresses in Host/Linux
   nl_sock *sock_{nullptr};
 
+  /**
+   * The threads reading the queues of the TUN interfaces beyond the first,
+   * see FLAGS_tun_queues, and the evbs serving each queue, evb_ first.
+   * Declared before intfs_ so that they outlive the interfaces.
+   */
+  std::vector<std::unique_ptr<folly::ScopedEventBaseThread>> queueThreads_;
+  std::vector<folly::EventBase*> queueEvbs_;
+
   /**
    * The mutex used to protect `intfs_` which can be used by
    * sync() could manipulate intfs_. Called on the thread that serves evb_.
@@ -20,8 +20,10 @@
 
 #include <folly/FileUtil.h>
 #include <folly/dynamic.h>
+#include <folly/experimental/bser/Bser.h>
 #include <folly/json.h>
 #include <folly/logging/xlog.h>
+#include <folly/system/MemoryMapping.h>
 
 #include <boost/filesystem/operations.hpp>
 
@@ -93,6 +95,18 @@ bool dumpStateToFile(const std::string& filename,
   return folly::writeFile(folly::toPrettyJson(json), filename.c_str());
 }
 
+bool dumpBinaryStateToFile(
+    const std::string& filename,
+    const folly::dynamic& state) {
+  folly::bser::serialization_opts opts;
+  return folly::writeFile(folly::bser::toBser(state, opts), filename.c_str());
+}
+
+folly::dynamic readBinaryStateFromFile(const std::string& filename) {
+  folly::MemoryMapping mapping(filename.c_str());
+  return folly::bser::parseBser(mapping.range());
+}
+
 std::string getLocalHostname() {
   const size_t kHostnameMaxLen = 256;  // from gethostname man page
   char hostname[kHostnameMaxLen];
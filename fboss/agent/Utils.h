@@ -78,6 +78,20 @@ void incNiceValue(const uint32_t increment);
  */
 bool dumpStateToFile(const std::string& filename, const folly::dynamic& json);
 
+/*
+ * Serialize folly dynamic to binary (BSER) and write to file. This is much
+ * more compact and faster to both write and read back than JSON.
+ */
+bool dumpBinaryStateToFile(
+    const std::string& filename,
+    const folly::dynamic& state);
+
+/*
+ * Read back a file written by dumpBinaryStateToFile(). The file is mmap'ed
+ * and parsed in place rather than being copied into memory first.
+ */
+folly::dynamic readBinaryStateFromFile(const std::string& filename);
+
 /*
  * StdClientIds to ClientID
  */
@@ -0,0 +1,61 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/capture/BpfFilter.h"
+
+#include "fboss/agent/FbossError.h"
+
+#include <folly/ScopeGuard.h>
+#include <folly/io/IOBuf.h>
+
+namespace {
+// Only used to compile, packets longer than this still match in full
+constexpr int kCompileSnaplen = 0xffff;
+}
+
+namespace facebook { namespace fboss {
+
+BpfFilter::BpfFilter(folly::StringPiece expression)
+    : expression_(expression.str()) {
+  auto pcap = pcap_open_dead(DLT_EN10MB, kCompileSnaplen);
+  if (!pcap) {
+    throw FbossError("unable to compile packet filter \"", expression, "\"");
+  }
+  SCOPE_EXIT {
+    pcap_close(pcap);
+  };
+  if (pcap_compile(
+          pcap,
+          &program_,
+          expression_.c_str(),
+          1 /* optimize */,
+          PCAP_NETMASK_UNKNOWN) != 0) {
+    throw FbossError(
+        "invalid packet filter \"", expression, "\": ", pcap_geterr(pcap));
+  }
+}
+
+BpfFilter::~BpfFilter() {
+  pcap_freecode(&program_);
+}
+
+bool BpfFilter::matches(const folly::IOBuf* buf) const {
+  struct pcap_pkthdr hdr{};
+  hdr.len = buf->computeChainDataLength();
+  hdr.caplen = hdr.len;
+  if (!buf->isChained()) {
+    return pcap_offline_filter(&program_, &hdr, buf->data()) != 0;
+  }
+  // The program needs the packet contiguous, only chains need a copy
+  auto copy = buf->clone();
+  copy->coalesce();
+  return pcap_offline_filter(&program_, &hdr, copy->data()) != 0;
+}
+
+}} // facebook::fboss
@@ -0,0 +1,55 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/Range.h>
+#include <pcap/pcap.h>
+
+#include <string>
+
+namespace folly {
+class IOBuf;
+}
+
+namespace facebook { namespace fboss {
+
+/*
+ * BpfFilter matches packets against a pcap-filter expression, as taken by
+ * tcpdump, e.g. "vlan and arp".
+ *
+ * The expression is compiled to a classic BPF program once, on
+ * construction, and throws an FbossError if it does not compile. Packets
+ * start at the ethernet header, including any 802.1q tag, so expressions
+ * need "vlan" to look past the tag of a tagged packet.
+ *
+ * matches() only reads the compiled program, it is safe to call from any
+ * thread.
+ */
+class BpfFilter {
+ public:
+  explicit BpfFilter(folly::StringPiece expression);
+  ~BpfFilter();
+
+  bool matches(const folly::IOBuf* buf) const;
+
+  const std::string& expression() const {
+    return expression_;
+  }
+
+ private:
+  // Forbidden copy constructor and assignment operator
+  BpfFilter(BpfFilter const &) = delete;
+  BpfFilter& operator=(BpfFilter const &) = delete;
+
+  const std::string expression_;
+  struct bpf_program program_;
+};
+
+}} // facebook::fboss
@@ -9,12 +9,23 @@
  */
 #include "fboss/agent/capture/PcapFile.h"
 
+#include "fboss/agent/FbossError.h"
 #include "fboss/agent/capture/PcapPkt.h"
 
 #include <folly/Exception.h>
 #include <folly/FileUtil.h>
+#include <folly/compression/Compression.h>
+#include <folly/io/IOBuf.h>
 
+#include <gflags/gflags.h>
+
+#include <algorithm>
 #include <chrono>
+#include <cstring>
+
+DEFINE_int32(pcap_write_buffer_bytes, 1 << 20,
+             "Bytes of pcap records assembled before writing them to the "
+             "capture file");
 
 using folly::IOBuf;
 using folly::writeFull;
@@ -22,36 +33,62 @@ using folly::writevFull;
 using std::chrono::microseconds;
 using std::chrono::seconds;
 
+namespace {
+// Buffers are aligned so they could be written with O_DIRECT
+constexpr size_t kBufferAlign = 4096;
+// Room for the largest record without a snaplen
+constexpr size_t kMinBufferBytes = 128 * 1024;
+}
+
 namespace facebook { namespace fboss {
 
 PcapFile::PktHeader::PktHeader(const PcapPkt& pkt) {
   auto ts = pkt.timestamp().time_since_epoch();
   seconds tsSec = std::chrono::duration_cast<seconds>(ts);
   microseconds tsUsec = std::chrono::duration_cast<microseconds>(ts);
-  auto len = pkt.buf()->computeChainDataLength();
 
   timeSec = tsSec.count();
   timeUsec = (tsUsec - tsSec).count();
-  includedLen = len;
-  origLen = len;
+  includedLen = pkt.buf()->computeChainDataLength();
+  origLen = pkt.origLen();
 }
 
 PcapFile::PcapFile() {
 }
 
 PcapFile::PcapFile(folly::StringPiece path,
-                   bool overwriteExisting)
+                   bool overwriteExisting,
+                   bool compress)
   : file_(path.str().c_str(), openFlags(overwriteExisting), 0644) {
+  if (compress) {
+    if (!folly::io::hasCodec(folly::io::CodecType::ZSTD)) {
+      throw FbossError("zstd compression of ", path, " is not supported");
+    }
+    codec_ = folly::io::getCodec(folly::io::CodecType::ZSTD);
+  }
+  capacity_ =
+      std::max<size_t>(FLAGS_pcap_write_buffer_bytes, kMinBufferBytes);
+  capacity_ = (capacity_ + kBufferAlign - 1) & ~(kBufferAlign - 1);
+  void* buf{nullptr};
+  int err = posix_memalign(&buf, kBufferAlign, capacity_);
+  if (err) {
+    folly::throwSystemErrorExplicit(err, "error allocating pcap buffer");
+  }
+  buf_.reset(static_cast<uint8_t*>(buf));
 }
 
 PcapFile::~PcapFile() {
 }
 
+PcapFile::PcapFile(PcapFile&&) noexcept = default;
+PcapFile& PcapFile::operator=(PcapFile&&) noexcept = default;
+
 void PcapFile::close() {
+  flush();
   file_.close();
 }
 
-void PcapFile::writeGlobalHeader() {
+void PcapFile::writeGlobalHeader(uint32_t snaplen) {
   struct GlobalHeader {
     uint32_t magic;
     uint16_t versionMajor;
@@ -66,34 +103,78 @@ void PcapFile::writeGlobalHeader() {
   hdr.versionMinor = 4;
   hdr.tzOffset = 0;
   hdr.sigfigs = 0;
-  hdr.snaplen = 0xffff;
+  hdr.snaplen = snaplen ? snaplen : 0xffff;
   // Link type 1 is ethernet.  Other possible types we might want to use
   // include 113 for linux "cooked" capture format.
   hdr.linkType = 1;
 
-  int ret = writeFull(file_.fd(), &hdr, sizeof(hdr));
-  folly::checkUnixError(ret, "error writing pcap global header");
+  bytesCaptured_ += sizeof(hdr);
+  auto out = reserve(sizeof(hdr));
+  if (!out) {
+    writeBuffer(reinterpret_cast<const uint8_t*>(&hdr), sizeof(hdr));
+    return;
+  }
+  memcpy(out, &hdr, sizeof(hdr));
+  used_ += sizeof(hdr);
 }
 
 void PcapFile::writePackets(const std::vector<PcapPkt>& pkts) {
-  folly::fbvector<PktHeader> hdrs;
-  hdrs.reserve(pkts.size());
-  folly::fbvector<struct iovec> iov;
-  // Reserve enough space, assuming each packet is in a single IOBuf.
-  // If some packets are split across IOBuf chains then we will end up
-  // allocating more space as needed in the loop below.
-  iov.reserve(pkts.size() * 2);
-
-  // Build iovecs for all of the packet headers and data
   for (const auto& pkt : pkts) {
-    hdrs.emplace_back(pkt);
-    PktHeader* curHdr = &hdrs.back();
-    iov.push_back({(void*)curHdr, sizeof(PktHeader)});
-    pkt.buf()->appendToIov(&iov);
+    PktHeader hdr(pkt);
+    auto len = sizeof(hdr) + hdr.includedLen;
+    bytesCaptured_ += len;
+    auto out = reserve(len);
+    if (!out) {
+      // Too big for the buffer, write it out on its own
+      std::vector<struct iovec> iov;
+      iov.push_back({&hdr, sizeof(hdr)});
+      pkt.buf()->appendToIov(&iov);
+      int ret = writevFull(file_.fd(), iov.data(), iov.size());
+      folly::checkUnixError(ret, "error writing pcap data");
+      bytesWritten_ += len;
+      continue;
+    }
+    memcpy(out, &hdr, sizeof(hdr));
+    out += sizeof(hdr);
+    for (auto range : *pkt.buf()) {
+      memcpy(out, range.data(), range.size());
+      out += range.size();
+    }
+    used_ += len;
   }
+}
 
+void PcapFile::flush() {
+  if (used_ == 0) {
+    return;
+  }
+  writeBuffer(buf_.get(), used_);
+  used_ = 0;
+}
+
+uint8_t* PcapFile::reserve(size_t len) {
+  if (used_ + len > capacity_) {
+    flush();
+  }
+  if (len > capacity_) {
+    return nullptr;
+  }
+  return buf_.get() + used_;
+}
+
+void PcapFile::writeBuffer(const uint8_t* data, size_t len) {
+  if (!codec_) {
+    int ret = writeFull(file_.fd(), data, len);
+    folly::checkUnixError(ret, "error writing pcap data");
+    bytesWritten_ += len;
+    return;
+  }
+  auto in = IOBuf::wrapBuffer(data, len);
+  auto out = codec_->compress(in.get());
+  auto iov = out->getIov();
   int ret = writevFull(file_.fd(), iov.data(), iov.size());
-  folly::checkUnixError(ret, "error writing pcap data");
+  folly::checkUnixError(ret, "error writing compressed pcap data");
+  bytesWritten_ += out->computeChainDataLength();
 }
 
 int PcapFile::openFlags(bool overwriteExisting) {
@@ -11,8 +11,13 @@
 
 #include <folly/File.h>
 #include <folly/Range.h>
+#include <memory>
 #include <vector>
 
+namespace folly { namespace io {
+class Codec;
+}}
+
 namespace facebook { namespace fboss {
 
 class PcapPkt;
@@ -20,6 +25,11 @@ class PcapPkt;
 /*
  * PcapFile supports writing packets to a file in pcap format.
  *
+ * Records are assembled into a large buffer, which is written out with a
+ * single write once full, or on flush(). With compress set, each buffer is
+ * written out as a zstd frame, which concatenated make up a valid zstd
+ * stream of the pcap file.
+ *
  * PcapFile uses blocking I/O.  If you are recording packets from a
  * non-blocking thread, you should use PcapWriter instead of using PcapFile
  * directly.
@@ -27,17 +37,45 @@ class PcapPkt;
 class PcapFile {
  public:
   PcapFile();
-  explicit PcapFile(folly::StringPiece path, bool overwriteExisting = false);
+  explicit PcapFile(
+      folly::StringPiece path,
+      bool overwriteExisting = false,
+      bool compress = false);
   ~PcapFile();
 
+  /*
+   * Flush any buffered records and close the file.
+   */
   void close();
 
-  void writeGlobalHeader();
+  /*
+   * Write the file header. snaplen is the most bytes captured of any packet,
+   * 0 if packets are captured whole.
+   */
+  void writeGlobalHeader(uint32_t snaplen = 0);
   void writePackets(const std::vector<PcapPkt>& pkt);
 
+  /*
+   * Write out the records buffered so far.
+   */
+  void flush();
+
+  // Bytes written to the file so far, after compression
+  uint64_t bytesWritten() const {
+    return bytesWritten_;
+  }
+  // Bytes of records buffered and not written yet, before compression
+  uint64_t bytesBuffered() const {
+    return used_;
+  }
+  // Bytes of pcap data written or buffered so far, before compression
+  uint64_t bytesCaptured() const {
+    return bytesCaptured_;
+  }
+
   // Move constructor and assignment operator
-  PcapFile(PcapFile&&) = default;
-  PcapFile& operator=(PcapFile&&) = default;
+  PcapFile(PcapFile&&) noexcept;
+  PcapFile& operator=(PcapFile&&) noexcept;
 
  private:
   struct PktHeader {
@@ -49,13 +87,29 @@ class PcapFile {
     uint32_t origLen{0};
   };
 
+  struct FreeDeleter {
+    void operator()(uint8_t* p) const {
+      free(p);
+    }
+  };
+
   // Forbidden copy constructor and assignment operator
   PcapFile(PcapFile const &) = delete;
   PcapFile& operator=(PcapFile const &) = delete;
 
   static int openFlags(bool overwriteExisting);
 
+  // Make room for len more bytes in the buffer, flushing it if need be
+  uint8_t* reserve(size_t len);
+  void writeBuffer(const uint8_t* data, size_t len);
+
   folly::File file_;
+  std::unique_ptr<uint8_t, FreeDeleter> buf_;
+  size_t capacity_{0};
+  size_t used_{0};
+  uint64_t bytesWritten_{0};
+  uint64_t bytesCaptured_{0};
+  std::unique_ptr<folly::io::Codec> codec_;
 };
 
 }} // facebook::fboss
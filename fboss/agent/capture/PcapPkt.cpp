@@ -82,4 +82,16 @@ PcapPkt::PcapPkt(const TxPacketData* pkt, TimePoint timestamp)
                                              pkt->packetData.size()));
 }
 
+void PcapPkt::truncate(uint32_t snaplen) {
+  auto len = buf_.computeChainDataLength();
+  if (len <= snaplen) {
+    return;
+  }
+  if (buf_.isChained()) {
+    buf_.coalesce();
+  }
+  origLen_ = origLen();
+  buf_.trimEnd(len - snaplen);
+}
+
 }} // facebook::fboss
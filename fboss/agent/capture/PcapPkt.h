@@ -79,6 +79,15 @@ class PcapPkt {
   const folly::IOBuf* buf() const {
     return &buf_;
   }
+  // The length of the packet on the wire, buf() may hold less of it
+  uint32_t origLen() const {
+    return origLen_ ? origLen_ : buf_.computeChainDataLength();
+  }
+
+  /*
+   * Keep only the first snaplen bytes of the packet.
+   */
+  void truncate(uint32_t snaplen);
   std::vector<RxReason> getReasons(){
     return reasons_;
   }
@@ -96,6 +105,7 @@ class PcapPkt {
     vlan_ = other.vlan_;
     timestamp_ = other.timestamp_;
     buf_ = std::move(other.buf_);
+    origLen_ = other.origLen_;
     reasons_ = std::move(other.reasons_);
     return *this;
   }
@@ -120,6 +130,8 @@ class PcapPkt {
   TimePoint timestamp_;
   // The packet contents, starting from the ethernet header.
   folly::IOBuf buf_;
+  // The length of the packet before it was truncated, 0 if it was not
+  uint32_t origLen_{0};
   // Reasons for sending packet to CPU
   std::vector<RxReason> reasons_;
 };
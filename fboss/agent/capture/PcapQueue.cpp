@@ -13,6 +13,8 @@
 #include "fboss/agent/TxPacket.h"
 #include "fboss/agent/capture/PcapPkt.h"
 
+#include <algorithm>
+
 DEFINE_int32(fboss_pcap_queue_depth, 10240,
              "When taking packet captures, the maximum number of packets "
              "to buffer in memory while waiting them to be written to the "
@@ -20,10 +22,13 @@ DEFINE_int32(fboss_pcap_queue_depth, 10240,
 
 namespace facebook { namespace fboss {
 
-PcapQueue::PcapQueue(uint32_t pktCapacity, uint64_t bytesCapacity)
+PcapQueue::PcapQueue(uint32_t pktCapacity,
+                     uint64_t bytesCapacity,
+                     uint32_t snaplen)
   : pktCapacity_(pktCapacity == 0 ?
                  FLAGS_fboss_pcap_queue_depth : pktCapacity),
-    bytesCapacity_(bytesCapacity) {
+    bytesCapacity_(bytesCapacity),
+    snaplen_(snaplen) {
   queue_.reserve(pktCapacity_);
 }
 
@@ -37,13 +42,20 @@ void PcapQueue::addPktInternal(const PktType* pkt) {
     pktsDropped_ += 1;
     return;
   }
-  auto newBytes = bytesInQueue_ + pkt->buf()->computeChainDataLength();
+  uint64_t pktBytes = pkt->buf()->computeChainDataLength();
+  if (snaplen_ > 0) {
+    pktBytes = std::min<uint64_t>(pktBytes, snaplen_);
+  }
+  auto newBytes = bytesInQueue_ + pktBytes;
   if (bytesCapacity_ > 0 && newBytes >= bytesCapacity_) {
     pktsDropped_ += 1;
     return;
   }
 
   queue_.emplace_back(pkt);
+  if (snaplen_ > 0) {
+    queue_.back().truncate(snaplen_);
+  }
 }
 
 void PcapQueue::addPkt(const RxPacket* pkt) {
@@ -115,4 +127,30 @@ bool PcapQueue::wait(std::vector<PcapPkt>* swapQueue) {
   return true;
 }
 
+bool PcapQueue::wait(std::vector<PcapPkt>* swapQueue,
+                     std::chrono::milliseconds timeout) {
+  swapQueue->clear();
+  swapQueue->reserve(pktCapacity_);
+
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  std::unique_lock<std::mutex> guard(mutex_);
+  while (queue_.empty() && !finished_) {
+    if (cv_.wait_until(guard, deadline) == std::cv_status::timeout) {
+      break;
+    }
+  }
+  if (queue_.empty()) {
+    if (!finished_) {
+      // Timed out
+      return true;
+    }
+    queue_.shrink_to_fit();
+    return false;
+  }
+
+  swapQueue->swap(queue_);
+  bytesInQueue_ = 0;
+  return true;
+}
+
 }} // facebook::fboss
@@ -9,6 +9,7 @@
  */
 #pragma once
 
+#include <chrono>
 #include <condition_variable>
 #include <mutex>
 #include <vector>
@@ -28,7 +29,13 @@ class PcapPkt;
  */
 class PcapQueue {
  public:
-  explicit PcapQueue(uint32_t pktCapacity, uint64_t bytesCapacity = 0);
+  /*
+   * Packets added are truncated to snaplen bytes, unless snaplen is 0.
+   */
+  explicit PcapQueue(
+      uint32_t pktCapacity,
+      uint64_t bytesCapacity = 0,
+      uint32_t snaplen = 0);
   virtual ~PcapQueue();
 
   uint32_t getPktCapacity() const {
@@ -36,6 +43,11 @@ class PcapQueue {
     return pktCapacity_;
   }
 
+  uint32_t getSnaplen() const {
+    // snaplen_ is const, so no need for locking
+    return snaplen_;
+  }
+
   /*
    * Get the mutex protecting this PcapQueue.
    *
@@ -79,6 +91,14 @@ class PcapQueue {
    */
   bool wait(std::vector<PcapPkt>* swapQueue);
 
+  /*
+   * Like wait(), but gives up waiting for new packets after timeout, in which
+   * case it returns true with swapQueue empty.
+   */
+  bool wait(
+      std::vector<PcapPkt>* swapQueue,
+      std::chrono::milliseconds timeout);
+
  private:
   // Forbidden copy constructor and assignment operator
   PcapQueue(PcapQueue const &) = delete;
@@ -93,6 +113,7 @@ class PcapQueue {
   bool finished_{false};
   const uint32_t pktCapacity_{0};
   uint64_t bytesCapacity_{0};
+  const uint32_t snaplen_{0};
   uint64_t bytesInQueue_{0};
   uint64_t pktsDropped_{0};
   std::vector<PcapPkt> queue_;
@@ -11,23 +11,34 @@
 
 #include "fboss/agent/capture/PcapPkt.h"
 
+#include "common/stats/ThreadCachedServiceData.h"
+
+#include <folly/Conv.h>
 #include <folly/String.h>
 #include <folly/logging/xlog.h>
+#include <gflags/gflags.h>
+
+#include <unistd.h>
+
+DEFINE_int32(pcap_flush_interval_ms, 1000,
+             "Longest time captured packets are buffered before being "
+             "written to the capture file");
 
 using folly::StringPiece;
+using std::chrono::steady_clock;
 
 namespace facebook { namespace fboss {
 
-PcapWriter::PcapWriter(uint32_t maxBufferedPkts)
-  : queue_(maxBufferedPkts) {
+PcapWriter::PcapWriter(uint32_t maxBufferedPkts, uint32_t snaplen)
+  : queue_(maxBufferedPkts, 0, snaplen) {
 }
 
 PcapWriter::PcapWriter(StringPiece path,
                        bool overwriteExisting,
-                       uint32_t maxBufferedPkts)
-  : file_(path, overwriteExisting),
-    queue_(maxBufferedPkts),
-    thread_(&PcapWriter::threadMain, this) {
+                       uint32_t maxBufferedPkts,
+                       uint32_t snaplen)
+  : queue_(maxBufferedPkts, 0, snaplen) {
+  start(path, overwriteExisting);
 }
 
 PcapWriter::~PcapWriter() {
@@ -42,8 +53,14 @@ PcapWriter::~PcapWriter() {
   }
 }
 
-void PcapWriter::start(folly::StringPiece path, bool overwriteExisting) {
-  file_ = PcapFile(path, overwriteExisting);
+void PcapWriter::start(folly::StringPiece path,
+                       bool overwriteExisting,
+                       const FileOptions& options) {
+  path_ = path.str();
+  overwriteExisting_ = overwriteExisting;
+  options_ = options;
+  // Open the first file here, so that errors opening it reach the caller
+  openFile();
   thread_ = std::thread(&PcapWriter::threadMain, this);
 }
 
@@ -55,6 +72,11 @@ void PcapWriter::finish() {
 
   queue_.finish();
   thread_.join();
+  if (!counterPrefix_.empty()) {
+    for (auto name : {"packets_written", "bytes_written", "files", "drops"}) {
+      tcData().clearCounter(folly::to<std::string>(counterPrefix_, ".", name));
+    }
+  }
   if (ex_) {
     std::rethrow_exception(ex_);
   }
@@ -62,9 +84,9 @@ void PcapWriter::finish() {
 
 void PcapWriter::threadMain() {
   try {
-    file_.writeGlobalHeader();
     writeLoop();
     file_.close();
+    bytesWritten_.store(closedFileBytes_ + file_.bytesWritten());
   } catch (const std::exception& ex) {
     XLOG(ERR) << "error writing to pcap file: " << folly::exceptionStr(ex);
     ex_ = std::current_exception();
@@ -72,17 +94,81 @@ void PcapWriter::threadMain() {
 }
 
 void PcapWriter::writeLoop() {
+  std::chrono::milliseconds flushInterval(FLAGS_pcap_flush_interval_ms);
+  auto lastFlush = steady_clock::now();
   std::vector<PcapPkt> pkts;
-  while (true) {
-    pkts.clear();
-    if (!queue_.wait(&pkts)) {
-      DCHECK(pkts.empty());
-      return;
+  while (queue_.wait(&pkts, flushInterval)) {
+    if (!pkts.empty()) {
+      maybeRotate();
+      file_.writePackets(pkts);
+      filePkts_ += pkts.size();
+      pktsWritten_ += pkts.size();
+    }
+    // Write out what is buffered once idle, or every flushInterval when busy
+    auto now = steady_clock::now();
+    if (pkts.empty() || now - lastFlush >= flushInterval) {
+      file_.flush();
+      lastFlush = now;
+    }
+    bytesWritten_.store(closedFileBytes_ + file_.bytesWritten());
+    updateCounters();
+  }
+  DCHECK(pkts.empty());
+}
+
+void PcapWriter::openFile() {
+  file_ = PcapFile(filePath(fileIndex_), overwriteExisting_, options_.compress);
+  file_.writeGlobalHeader(queue_.getSnaplen());
+  fileOpened_ = steady_clock::now();
+  filePkts_ = 0;
+  ++numFiles_;
+  if (options_.maxFiles > 0 && fileIndex_ >= options_.maxFiles) {
+    auto oldest = filePath(fileIndex_ - options_.maxFiles);
+    if (unlink(oldest.c_str()) != 0) {
+      XLOG(WARNING) << "could not delete old packet capture " << oldest << ": "
+                    << folly::errnoStr(errno);
     }
+  }
+}
 
-    DCHECK(!pkts.empty());
-    file_.writePackets(pkts);
+void PcapWriter::maybeRotate() {
+  // Never leave a file with no packets
+  if (filePkts_ == 0) {
+    return;
   }
+  bool full = options_.rotateBytes > 0 &&
+      file_.bytesCaptured() >= options_.rotateBytes;
+  bool old = options_.rotateInterval.count() > 0 &&
+      steady_clock::now() - fileOpened_ >= options_.rotateInterval;
+  if (!full && !old) {
+    return;
+  }
+  file_.close();
+  closedFileBytes_ += file_.bytesWritten();
+  ++fileIndex_;
+  openFile();
+  XLOG(DBG2) << "rotated packet capture to " << filePath(fileIndex_);
+}
+
+void PcapWriter::updateCounters() {
+  if (counterPrefix_.empty()) {
+    return;
+  }
+  auto counter = [this](StringPiece name, int64_t value) {
+    tcData().setCounter(folly::to<std::string>(counterPrefix_, ".", name),
+                        value);
+  };
+  counter("packets_written", numPktsWritten());
+  counter("bytes_written", numBytesWritten());
+  counter("files", numFiles());
+  counter("drops", numDropped());
+}
+
+std::string PcapWriter::filePath(uint32_t fileIndex) const {
+  return folly::to<std::string>(
+      path_,
+      fileIndex ? folly::to<std::string>(fileIndex) : "",
+      options_.compress ? ".zst" : "");
 }
 
 }} // facebook::fboss
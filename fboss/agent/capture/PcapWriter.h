@@ -12,6 +12,9 @@
 #include "fboss/agent/capture/PcapFile.h"
 #include "fboss/agent/capture/PcapQueue.h"
 
+#include <atomic>
+#include <chrono>
+#include <string>
 #include <thread>
 
 namespace facebook { namespace fboss {
@@ -21,16 +24,52 @@ namespace facebook { namespace fboss {
  * to a pcap file.
  *
  * It performs blocking disk I/O, so it performs the writes in its own thread.
+ * Records are buffered by PcapFile and written out a buffer at a time, at
+ * least every --pcap_flush_interval_ms.
+ *
+ * For long running captures the output can be rotated, the first file being
+ * at the given path and the following ones at the path with 1, 2, etc.
+ * appended, as tcpdump -C does. The number of files kept can be capped, the
+ * oldest being deleted as new ones are started, as tcpdump -W does.
  */
 class PcapWriter {
  public:
-  explicit PcapWriter(uint32_t maxBufferedPkts = 0);
+  struct FileOptions {
+    // Start a new file once the current one holds this many bytes of pcap
+    // data, before compression, 0 for no limit. Checked before writing each
+    // batch of packets.
+    uint64_t rotateBytes{0};
+    // Start a new file once the current one is this old, 0 for no limit
+    std::chrono::seconds rotateInterval{0};
+    // Compress files with zstd, adding a .zst suffix
+    bool compress{false};
+    // Delete the oldest file when starting a new one would leave more than
+    // this many, 0 for no limit
+    uint32_t maxFiles{0};
+  };
+
+  /*
+   * Packets are truncated to snaplen bytes, unless snaplen is 0.
+   */
+  explicit PcapWriter(uint32_t maxBufferedPkts = 0, uint32_t snaplen = 0);
   explicit PcapWriter(folly::StringPiece path,
                       bool overwriteExisting = false,
-                      uint32_t maxBufferedPkts = 0);
+                      uint32_t maxBufferedPkts = 0,
+                      uint32_t snaplen = 0);
   virtual ~PcapWriter();
 
-  void start(folly::StringPiece path, bool overwriteExisting = false);
+  void start(folly::StringPiece path,
+             bool overwriteExisting = false,
+             const FileOptions& options = FileOptions());
+
+  /*
+   * Export the number of packets and bytes written, files written and
+   * packets dropped as fb303 counters starting with prefix, while running.
+   * Must be called before start().
+   */
+  void exportCounters(folly::StringPiece prefix) {
+    counterPrefix_ = prefix.str();
+  }
 
   /*
    * Get the mutex protecting this PcapWriter.
@@ -67,6 +106,18 @@ class PcapWriter {
     return queue_.numDropped();
   }
 
+  uint64_t numPktsWritten() const {
+    return pktsWritten_.load(std::memory_order_relaxed);
+  }
+  // Bytes written across all files, after compression
+  uint64_t numBytesWritten() const {
+    return bytesWritten_.load(std::memory_order_relaxed);
+  }
+  // Files started, including any deleted since to honor maxFiles
+  uint32_t numFiles() const {
+    return numFiles_.load(std::memory_order_relaxed);
+  }
+
  private:
   // Forbidden copy constructor and assignment operator
   PcapWriter(PcapWriter const &) = delete;
@@ -75,11 +126,29 @@ class PcapWriter {
   void threadMain();
   void writeHeader();
   void writeLoop();
+  void openFile();
+  void maybeRotate();
+  void updateCounters();
+  std::string filePath(uint32_t fileIndex) const;
 
   PcapFile file_;
   PcapQueue queue_;
   std::exception_ptr ex_;
   std::thread thread_;
+
+  // Only accessed by the writer thread once started
+  std::string path_;
+  bool overwriteExisting_{false};
+  FileOptions options_;
+  uint32_t fileIndex_{0};
+  std::chrono::steady_clock::time_point fileOpened_;
+  uint64_t filePkts_{0};
+  uint64_t closedFileBytes_{0};
+  std::string counterPrefix_;
+
+  std::atomic<uint64_t> pktsWritten_{0};
+  std::atomic<uint64_t> bytesWritten_{0};
+  std::atomic<uint32_t> numFiles_{0};
 };
 
 }} // facebook::fboss
@@ -24,8 +24,10 @@ PktCapture::PktCapture(folly::StringPiece name, uint64_t maxPackets,
 
 PktCapture::PktCapture(folly::StringPiece name, uint64_t maxPackets,
                        CaptureDirection direction,
-                       const CaptureFilter& captureFilter)
+                       const CaptureFilter& captureFilter,
+                       uint32_t snaplen)
   : name_(name.str()),
+    writer_(0, snaplen),
     maxPackets_(maxPackets),
     direction_(direction),
     packetFilter_(captureFilter) {
@@ -34,7 +36,8 @@ PktCapture::PktCapture(folly::StringPiece name, uint64_t maxPackets,
 
 void PktCapture::start(StringPiece path) {
   XLOG(INFO) << "starting packet capture " << toString();
-  writer_.start(path, true);
+  writer_.exportCounters(folly::to<std::string>("capture.", name_));
+  writer_.start(path, true, fileOptions_);
 }
 
 void PktCapture::stop() {
@@ -43,21 +46,27 @@ void PktCapture::stop() {
 }
 
 bool PktCapture::packetReceived(const RxPacket* pkt) {
-  std::lock_guard<std::mutex> guard(writer_.mutex());
-  if (direction_ != CaptureDirection::CAPTURE_ONLY_TX &&
-      true == packetFilter_.passes(pkt)) {
-    ++numPacketsReceived_;
-    writer_.addPktLocked(pkt);
+  // Filter before taking the lock, most packets don't make it past here in
+  // a targeted capture. A capture is stopped once it returns false for its
+  // last packet, so there is no need to check the count for the others.
+  if (direction_ == CaptureDirection::CAPTURE_ONLY_TX ||
+      !packetFilter_.passes(pkt)) {
+    return true;
   }
+  std::lock_guard<std::mutex> guard(writer_.mutex());
+  ++numPacketsReceived_;
+  writer_.addPktLocked(pkt);
   return (numPacketsSent_ + numPacketsReceived_) < maxPackets_;
 }
 
 bool PktCapture::packetSent(const TxPacket* pkt) {
-  std::lock_guard<std::mutex> guard(writer_.mutex());
-  if (direction_ != CaptureDirection::CAPTURE_ONLY_RX) {
-    ++numPacketsSent_;
-    writer_.addPktLocked(pkt);
+  if (direction_ == CaptureDirection::CAPTURE_ONLY_RX ||
+      !packetFilter_.passes(pkt)) {
+    return true;
   }
+  std::lock_guard<std::mutex> guard(writer_.mutex());
+  ++numPacketsSent_;
+  writer_.addPktLocked(pkt);
   return (numPacketsSent_ + numPacketsReceived_) < maxPackets_;
 }
 
@@ -72,7 +81,11 @@ std::string PktCapture::toString(bool withStats) const {
             : "TX only"));
   if (withStats) {
     ss << ", Packet received:" << numPacketsReceived_
-       << ", Packet sent:" << numPacketsSent_;
+       << ", Packet sent:" << numPacketsSent_
+       << ", Packets written:" << writer_.numPktsWritten()
+       << ", Bytes written:" << writer_.numBytesWritten()
+       << ", Files:" << writer_.numFiles()
+       << ", Packets dropped:" << writer_.numDropped();
   }
   return ss.str();
 }
@@ -9,10 +9,12 @@
  */
 #pragma once
 
+#include "fboss/agent/capture/BpfFilter.h"
 #include "fboss/agent/capture/PcapWriter.h"
 #include "fboss/agent/if/gen-cpp2/ctrl_types.h"
 
 #include <folly/Range.h>
+#include <memory>
 #include <string>
 #include "fboss/agent/RxPacket.h"
 #include "fboss/agent/TxPacket.h"
@@ -38,13 +40,22 @@ class RxPacketFilter {
 class PacketFilter {
  public:
    explicit PacketFilter(const CaptureFilter & captureFilter) :
-   rxPacketFilter_(captureFilter.get_rxCaptureFilter()) {}
+   rxPacketFilter_(captureFilter.get_rxCaptureFilter()) {
+     if (!captureFilter.bpfFilter.empty()) {
+       bpfFilter_ = std::make_unique<BpfFilter>(captureFilter.bpfFilter);
+     }
+   }
 
-   bool passes(const RxPacket* pkt) {
-     return rxPacketFilter_.passes(pkt);
+   bool passes(const RxPacket* pkt) const {
+     return rxPacketFilter_.passes(pkt) &&
+         (!bpfFilter_ || bpfFilter_->matches(pkt->buf()));
+   }
+   bool passes(const TxPacket* pkt) const {
+     return !bpfFilter_ || bpfFilter_->matches(pkt->buf());
    }
  private:
    RxPacketFilter rxPacketFilter_;
+   std::unique_ptr<BpfFilter> bpfFilter_;
 };
 
 /*
@@ -54,13 +65,25 @@ class PktCapture {
  public:
   PktCapture(folly::StringPiece name, uint64_t maxPackets,
              CaptureDirection direction);
+  /*
+   * Only packets passing captureFilter are captured, truncated to snaplen
+   * bytes unless snaplen is 0.
+   */
   PktCapture(folly::StringPiece name, uint64_t maxPackets,
-             CaptureDirection direction, const CaptureFilter& captureFilter);
+             CaptureDirection direction, const CaptureFilter& captureFilter,
+             uint32_t snaplen = 0);
 
   const std::string& name() const {
     return name_;
   }
 
+  /*
+   * Set how the capture file is rotated and compressed, before start().
+   */
+  void setFileOptions(const PcapWriter::FileOptions& options) {
+    fileOptions_ = options;
+  }
+
   void start(folly::StringPiece path);
   void stop();
 
@@ -77,12 +100,14 @@ class PktCapture {
   const std::string name_;
 
   // Note: the rest of the state in this class is protcted by
-  // the PcapWriter's mutex.
+  // the PcapWriter's mutex, except for the filter and direction which are
+  // const, so that packets can be filtered before taking the mutex.
   PcapWriter writer_;
+  PcapWriter::FileOptions fileOptions_;
   uint64_t maxPackets_{0};
   uint64_t numPacketsReceived_{0};
   uint64_t numPacketsSent_{0};
-  CaptureDirection direction_{CaptureDirection::CAPTURE_TX_RX};
-  PacketFilter packetFilter_;
+  const CaptureDirection direction_{CaptureDirection::CAPTURE_TX_RX};
+  const PacketFilter packetFilter_;
 };
 }} // facebook::fboss
@@ -9,6 +9,7 @@
  */
 #include "fboss/agent/gen-cpp2/switch_config_types.h"
 #include "fboss/agent/ApplyThriftConfig.h"
+#include "fboss/agent/FbossError.h"
 #include "fboss/agent/SwSwitch.h"
 #include "fboss/agent/capture/PktCapture.h"
 #include "fboss/agent/capture/PktCaptureManager.h"
@@ -270,3 +271,77 @@ TEST(CaptureTest, FullCapture) {
   //
   // EXPECT_BUF_EQ(updatedIpPktData, pcapPkts.at(4).data);
 }
+
+TEST(CaptureTest, FilteredCapture) {
+  auto handle = setupTestHandle();
+  auto sw = handle->getSw();
+  auto* mgr = sw->getCaptureMgr();
+
+  CaptureFilter filter;
+  filter.bpfFilter = "vlan and arp";
+  mgr->startCapture(make_unique<PktCapture>(
+      "arp", 100, CaptureDirection::CAPTURE_ONLY_RX, filter, 20));
+
+  auto ipPktData = PktUtil::parseHexData(
+    // dst mac, src mac
+    "02 00 01 00 00 01  02 00 02 01 02 03"
+    // 802.1q, VLAN 1
+    "81 00 00 01"
+    // IPv4
+    "08 00"
+    // Version(4), IHL(5), DSCP(0), ECN(0), Total Length(20)
+    "45  00  00 14"
+    // Identification(0), Flags(0), Fragment offset(0)
+    "00 00  00 00"
+    // TTL(31), Protocol(6), Checksum (0, fake)
+    "1F  06  00 00"
+    // Source IP (1.2.3.4)
+    "01 02 03 04"
+    // Destination IP (10.0.0.10)
+    "0a 00 00 0a"
+  );
+  MockRxPacket ipPkt(ipPktData.clone());
+  ipPkt.setSrcPort(PortID(1));
+  ipPkt.setSrcVlan(VlanID(1));
+
+  auto arpPktData = PktUtil::parseHexData(
+    // dst mac, src mac
+    "02 01 02 03 04 05  02 05 00 00 01 02"
+    // 802.1q, VLAN 1
+    "81 00  00 01"
+    // ARP, htype: ethernet, ptype: IPv4, hlen: 6, plen: 4
+    "08 06  00 01  08 00  06  04"
+    // ARP Reply
+    "00 02"
+    // Sender MAC, sender IP: 10.0.0.10
+    "02 05 00 00 01 02  0a 00 00 0a"
+    // Target MAC, target IP: 10.0.0.1
+    "02 01 02 03 04 05  0a 00 00 01"
+  );
+  MockRxPacket arpPkt(arpPktData.clone());
+  arpPkt.setSrcPort(PortID(3));
+  arpPkt.setSrcVlan(VlanID(1));
+
+  mgr->packetReceived(&ipPkt);
+  mgr->packetReceived(&arpPkt);
+  mgr->packetReceived(&ipPkt);
+  mgr->stopCapture("arp");
+
+  string pcapPath = folly::to<string>(mgr->getCaptureDir(), "/arp.pcap");
+  auto pcapPkts = readPcapFile(pcapPath.c_str());
+
+  // Only the ARP packet is captured, truncated to 20 bytes
+  ASSERT_EQ(1, pcapPkts.size());
+  EXPECT_EQ(20, pcapPkts.at(0).hdr.caplen);
+  EXPECT_EQ(arpPktData.computeChainDataLength(), pcapPkts.at(0).hdr.len);
+  arpPktData.trimEnd(arpPktData.length() - 20);
+  EXPECT_BUF_EQ(arpPktData, pcapPkts.at(0).data);
+}
+
+TEST(CaptureTest, InvalidFilter) {
+  CaptureFilter filter;
+  filter.bpfFilter = "vlan and not";
+  EXPECT_THROW(
+      PktCapture("bad", 100, CaptureDirection::CAPTURE_TX_RX, filter),
+      FbossError);
+}
@@ -11,14 +11,20 @@
 #include "fboss/agent/capture/test/PcapUtil.h"
 #include "fboss/agent/hw/mock/MockRxPacket.h"
 
+#include <folly/Conv.h>
 #include <folly/Exception.h>
 #include <folly/ScopeGuard.h>
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
 using namespace facebook::fboss;
 
-void addPackets(PcapWriter* writer, uint32_t count) {
-  // Create a packet to add to the queue
+std::unique_ptr<MockRxPacket> makePacket() {
   auto pkt = MockRxPacket::fromHex(
     // dst mac, src mac
     "02 00 01 00 00 01  02 00 02 01 02 03"
@@ -40,6 +46,12 @@ void addPackets(PcapWriter* writer, uint32_t count) {
   pkt->padToLength(68);
   pkt->setSrcPort(PortID(1));
   pkt->setSrcVlan(VlanID(1));
+  return pkt;
+}
+
+void addPackets(PcapWriter* writer, uint32_t count) {
+  // Create a packet to add to the queue
+  auto pkt = makePacket();
 
   // For now, just add the same packet N times
   for (uint32_t n = 0; n < count; ++n) {
@@ -47,6 +59,35 @@ void addPackets(PcapWriter* writer, uint32_t count) {
   }
 }
 
+/*
+ * Add count packets at once, so that the writer takes them as a single
+ * batch, and wait for it to write them.
+ */
+void addBatch(PcapWriter* writer, uint32_t count) {
+  auto pkt = makePacket();
+  auto expected = writer->numPktsWritten() + count;
+  {
+    std::lock_guard<std::mutex> guard(writer->mutex());
+    for (uint32_t n = 0; n < count; ++n) {
+      writer->addPktLocked(pkt.get());
+    }
+  }
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (writer->numPktsWritten() < expected) {
+    ASSERT_LT(std::chrono::steady_clock::now(), deadline);
+    std::this_thread::yield();
+  }
+}
+
+std::vector<std::string> rotatedPaths(const char* path, uint32_t numFiles) {
+  std::vector<std::string> paths;
+  for (uint32_t i = 0; i < numFiles; ++i) {
+    paths.push_back(
+        i == 0 ? std::string(path) : folly::to<std::string>(path, i));
+  }
+  return paths;
+}
+
 TEST(PcapWriterTest, Write) {
   char tmpPath[] = "fbossPcapTest.XXXXXX";
   int tmpFD = mkstemp(tmpPath);
@@ -102,3 +143,92 @@ TEST(PcapWriterTest, Drop) {
     EXPECT_EQ(68, pktInfo.hdr.caplen);
   }
 }
+
+TEST(PcapWriterTest, Rotate) {
+  char tmpPath[] = "fbossPcapTest.XXXXXX";
+  int tmpFD = mkstemp(tmpPath);
+  folly::checkUnixError(tmpFD, "failed to create temporary file");
+  close(tmpFD);
+  auto paths = rotatedPaths(tmpPath, 3);
+  SCOPE_EXIT {
+    for (const auto& path : paths) {
+      unlink(path.c_str());
+    }
+  };
+
+  // Rotate before every batch of packets after the first
+  PcapWriter::FileOptions options;
+  options.rotateBytes = 1;
+  PcapWriter writer;
+  writer.start(tmpPath, true, options);
+  for (auto i = 0; i < 3; ++i) {
+    addBatch(&writer, 100);
+  }
+  writer.finish();
+
+  EXPECT_EQ(3, writer.numFiles());
+  EXPECT_EQ(0, writer.numDropped());
+  for (const auto& path : paths) {
+    EXPECT_EQ(100, readPcapFile(path.c_str()).size());
+  }
+}
+
+TEST(PcapWriterTest, RotateBytes) {
+  char tmpPath[] = "fbossPcapTest.XXXXXX";
+  int tmpFD = mkstemp(tmpPath);
+  folly::checkUnixError(tmpFD, "failed to create temporary file");
+  close(tmpFD);
+  auto paths = rotatedPaths(tmpPath, 2);
+  SCOPE_EXIT {
+    for (const auto& path : paths) {
+      unlink(path.c_str());
+    }
+  };
+
+  // The limit is on the pcap data, buffered or not: 24 bytes of file header
+  // and 10 records of 16 bytes of header and 68 of packet reach it, 9 don't
+  PcapWriter::FileOptions options;
+  options.rotateBytes = 24 + 10 * (16 + 68);
+  PcapWriter writer;
+  writer.start(tmpPath, true, options);
+  addBatch(&writer, 9);
+  addBatch(&writer, 1);
+  addBatch(&writer, 5);
+  writer.finish();
+
+  EXPECT_EQ(2, writer.numFiles());
+  EXPECT_EQ(10, readPcapFile(paths[0].c_str()).size());
+  EXPECT_EQ(5, readPcapFile(paths[1].c_str()).size());
+}
+
+TEST(PcapWriterTest, MaxFiles) {
+  char tmpPath[] = "fbossPcapTest.XXXXXX";
+  int tmpFD = mkstemp(tmpPath);
+  folly::checkUnixError(tmpFD, "failed to create temporary file");
+  close(tmpFD);
+  auto paths = rotatedPaths(tmpPath, 5);
+  SCOPE_EXIT {
+    for (const auto& path : paths) {
+      unlink(path.c_str());
+    }
+  };
+
+  PcapWriter::FileOptions options;
+  options.rotateBytes = 1;
+  options.maxFiles = 2;
+  PcapWriter writer;
+  writer.start(tmpPath, true, options);
+  for (auto i = 0; i < 5; ++i) {
+    addBatch(&writer, 10);
+  }
+  writer.finish();
+
+  // Only the last 2 files are left
+  EXPECT_EQ(5, writer.numFiles());
+  for (auto i = 0; i < 3; ++i) {
+    EXPECT_NE(0, access(paths[i].c_str(), F_OK)) << paths[i];
+  }
+  for (auto i = 3; i < 5; ++i) {
+    EXPECT_EQ(10, readPcapFile(paths[i].c_str()).size());
+  }
+}
@@ -16,6 +16,7 @@ extern "C" {
 #include <folly/IPAddress.h>
 #include <folly/IPAddressV4.h>
 #include <folly/IPAddressV6.h>
+#include <folly/ScopeGuard.h>
 #include <folly/logging/xlog.h>
 #include "fboss/agent/Constants.h"
 #include "fboss/agent/hw/bcm/BcmError.h"
@@ -29,7 +30,10 @@ extern "C" {
 #include "fboss/agent/state/RouteTypes.h"
 
 #include <gflags/gflags.h>
+#include <algorithm>
+#include <map>
 #include <numeric>
+#include <tuple>
 
 namespace {
 
@@ -150,6 +154,16 @@ RouteNextHopEntry::NextHopSet normalizeNextHops(
   }
   return normalizedNextHops;
 }
+
+// Orders prefixes the way a pre-order walk of the prefix trie would visit
+// them: a covering prefix sorts right before the more specific prefixes it
+// contains.
+template <typename RouteT>
+bool prefixOrderLess(const RouteT* r1, const RouteT* r2) {
+  const auto& p1 = r1->prefix();
+  const auto& p2 = r2->prefix();
+  return std::tie(p1.network, p1.mask) < std::tie(p2.network, p2.mask);
+}
 }
 
 BcmRoute::BcmRoute(const BcmSwitch* hw, opennsl_vrf_t vrf,
@@ -442,6 +456,18 @@ BcmRoute* BcmRouteTable::getBcmRoute(
 
 template<typename RouteT>
 void BcmRouteTable::addRoute(opennsl_vrf_t vrf, const RouteT *route) {
+  CHECK(route->isResolved());
+  RouteNextHopEntry fwd(route->getForwardInfo());
+  if (fwd.getAction() == RouteForwardAction::NEXTHOPS) {
+    RouteNextHopSet nhops = normalizeNextHops(fwd.getNextHopSet());
+    fwd = RouteNextHopEntry(nhops, fwd.getAdminDistance());
+  }
+  programRoute(vrf, route, fwd);
+}
+
+template<typename RouteT>
+void BcmRouteTable::programRoute(
+    opennsl_vrf_t vrf, const RouteT* route, const RouteNextHopEntry& fwd) {
   const auto& prefix = route->prefix();
 
   Key key{folly::IPAddress(prefix.network), prefix.mask, vrf};
@@ -454,12 +480,6 @@ void BcmRouteTable::addRoute(opennsl_vrf_t vrf, const RouteT *route) {
                                         folly::IPAddress(prefix.network),
                                         prefix.mask));
   }
-  CHECK(route->isResolved());
-  RouteNextHopEntry fwd(route->getForwardInfo());
-  if (fwd.getAction() == RouteForwardAction::NEXTHOPS) {
-    RouteNextHopSet nhops = normalizeNextHops(fwd.getNextHopSet());
-    fwd = RouteNextHopEntry(nhops, fwd.getAdminDistance());
-  }
   ret.first->second->program(fwd);
 }
 
@@ -474,6 +494,72 @@ void BcmRouteTable::deleteRoute(opennsl_vrf_t vrf, const RouteT *route) {
   fib_.erase(iter);
 }
 
+template<typename RouteT>
+void BcmRouteTable::programRoutes(
+    opennsl_vrf_t vrf,
+    std::vector<const RouteT*> toDelete,
+    const std::vector<const RouteT*>& toAdd,
+    const RouteErrorCallback& onAddError) {
+  // Work out the forward info of every route being added, normalizing each
+  // distinct next hop set only once and taking a reference on its egress
+  // object for the lifetime of the batch.
+  std::map<RouteNextHopSet, RouteNextHopSet> normalizedNextHops;
+  std::vector<BcmEcmpHostKey> heldEcmpHosts;
+  SCOPE_EXIT {
+    for (const auto& key : heldEcmpHosts) {
+      hw_->writableHostTable()->derefBcmEcmpHost(key);
+    }
+  };
+  std::vector<RouteNextHopEntry> fwds;
+  fwds.reserve(toAdd.size());
+  for (const auto route : toAdd) {
+    CHECK(route->isResolved());
+    RouteNextHopEntry fwd(route->getForwardInfo());
+    if (fwd.getAction() == RouteForwardAction::NEXTHOPS) {
+      auto ret = normalizedNextHops.emplace(
+          fwd.getNextHopSet(), RouteNextHopSet());
+      if (ret.second) {
+        ret.first->second = normalizeNextHops(fwd.getNextHopSet());
+        BcmEcmpHostKey key(vrf, ret.first->second);
+        try {
+          hw_->writableHostTable()->incRefOrCreateBcmEcmpHost(key);
+          heldEcmpHosts.push_back(std::move(key));
+        } catch (const BcmError& ex) {
+          // Programming the routes using this next hop set will hit the same
+          // error below and report it against each of them.
+          XLOG(DBG2) << "Failed to create egress for " << ret.first->second
+                     << " ahead of programming routes: " << ex.what();
+        }
+      }
+      fwd = RouteNextHopEntry(ret.first->second, fwd.getAdminDistance());
+    }
+    fwds.push_back(std::move(fwd));
+  }
+
+  std::sort(
+      toDelete.begin(),
+      toDelete.end(),
+      [](const RouteT* r1, const RouteT* r2) {
+        return prefixOrderLess(r2, r1);
+      });
+  for (const auto route : toDelete) {
+    deleteRoute(vrf, route);
+  }
+
+  std::vector<size_t> addOrder(toAdd.size());
+  std::iota(addOrder.begin(), addOrder.end(), 0);
+  std::sort(addOrder.begin(), addOrder.end(), [&](size_t i1, size_t i2) {
+    return prefixOrderLess(toAdd[i1], toAdd[i2]);
+  });
+  for (auto idx : addOrder) {
+    try {
+      programRoute(vrf, toAdd[idx], fwds[idx]);
+    } catch (const BcmError& error) {
+      onAddError(idx, error);
+    }
+  }
+}
+
 folly::dynamic BcmRouteTable::toFollyDynamic() const {
   folly::dynamic routesJson = folly::dynamic::array;
   for (const auto& route : fib_) {
@@ -488,4 +574,14 @@ template void BcmRouteTable::addRoute(opennsl_vrf_t, const RouteV4 *);
 template void BcmRouteTable::addRoute(opennsl_vrf_t, const RouteV6 *);
 template void BcmRouteTable::deleteRoute(opennsl_vrf_t, const RouteV4 *);
 template void BcmRouteTable::deleteRoute(opennsl_vrf_t, const RouteV6 *);
+template void BcmRouteTable::programRoutes(
+    opennsl_vrf_t,
+    std::vector<const RouteV4*>,
+    const std::vector<const RouteV4*>&,
+    const RouteErrorCallback&);
+template void BcmRouteTable::programRoutes(
+    opennsl_vrf_t,
+    std::vector<const RouteV6*>,
+    const std::vector<const RouteV6*>&,
+    const RouteErrorCallback&);
 }}
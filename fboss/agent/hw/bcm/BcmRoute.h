@@ -22,8 +22,12 @@ extern "C" {
 
 #include <boost/container/flat_map.hpp>
 
+#include <functional>
+#include <vector>
+
 namespace facebook { namespace fboss {
 
+class BcmError;
 class BcmSwitch;
 class BcmHost;
 
@@ -94,6 +98,32 @@ class BcmRouteTable {
   void addRoute(opennsl_vrf_t vrf, const RouteT *route);
   template<typename RouteT>
   void deleteRoute(opennsl_vrf_t vrf, const RouteT *route);
+
+  /*
+   * Program a batch of route deletes and adds coming from one StateDelta.
+   *
+   * Rather than programming the routes in whatever order the delta yields
+   * them, the batch is ordered to keep ALPM bucket churn down: all deletes go
+   * first, most specific prefix first, followed by the adds in prefix order
+   * so that a covering route is in place before the more specific routes
+   * that land in its bucket. Next hop normalization and the egress objects
+   * are resolved once per distinct next hop set in the batch, and those
+   * egress objects are held until the batch is done so that a group losing
+   * its last route to a delete is not torn down only to be recreated by an
+   * add further on.
+   *
+   * If an add fails with a BcmError, onAddError is called with the index of
+   * the route in toAdd and the rest of the batch is still programmed, unless
+   * onAddError throws.
+   */
+  using RouteErrorCallback = std::function<void(size_t, const BcmError&)>;
+  template<typename RouteT>
+  void programRoutes(
+      opennsl_vrf_t vrf,
+      std::vector<const RouteT*> toDelete,
+      const std::vector<const RouteT*>& toAdd,
+      const RouteErrorCallback& onAddError);
+
   folly::dynamic toFollyDynamic() const;
  private:
   struct Key {
@@ -103,6 +133,10 @@ class BcmRouteTable {
     bool operator<(const Key& k2) const;
   };
 
+  template<typename RouteT>
+  void programRoute(
+      opennsl_vrf_t vrf, const RouteT* route, const RouteNextHopEntry& fwd);
+
   const BcmSwitch *hw_;
 
   boost::container::flat_map<Key, std::unique_ptr<BcmRoute>> fib_;
@@ -36,6 +36,8 @@ BcmStats::BcmStats(ThreadLocalStatsMap *map)
                   SUM, RATE),
       txPktAllocErrors_(map, SwitchStats::kCounterPrefix +
           "bcm.tx.pkt.allocation.errors", SUM, RATE),
+      txPktPoolExhausted_(map, SwitchStats::kCounterPrefix +
+          "bcm.tx.pkt.pool.exhausted", SUM, RATE),
       txQueued_(map, SwitchStats::kCounterPrefix + "bcm.tx.pkt.queued_us",
                 100, 0, 1000),
       parityErrors_(map, SwitchStats::kCounterPrefix + "bcm.parity.errors",
@@ -52,6 +52,9 @@ class BcmStats {
     txErrors_.addValue(1);
     txPktAllocErrors_.addValue(1);
   }
+  void txPktPoolExhausted() {
+    txPktPoolExhausted_.addValue(1);
+  }
 
   void corrParityError() {
     parityErrors_.addValue(1);
@@ -91,6 +94,8 @@ class BcmStats {
   // Errors in sending packets
   TLTimeseries txErrors_;
   TLTimeseries txPktAllocErrors_;
+  // Packets allocated from the SDK because the tx packet pool was empty
+  TLTimeseries txPktPoolExhausted_;
 
   // Time spent for each Tx packet queued in HW
   TLHistogram txQueued_;
@@ -49,6 +49,7 @@
 #include "fboss/agent/hw/bcm/BcmTableStats.h"
 #include "fboss/agent/hw/bcm/BcmTrunkTable.h"
 #include "fboss/agent/hw/bcm/BcmTxPacket.h"
+#include "fboss/agent/hw/bcm/BcmTxPacketPool.h"
 #include "fboss/agent/hw/bcm/BcmUnit.h"
 #include "fboss/agent/hw/bcm/BcmWarmBootCache.h"
 #include "fboss/agent/hw/bcm/BcmWarmBootHelper.h"
@@ -115,6 +116,9 @@ DEFINE_int32(
     60,
     "Update BST stats for ODS interval in seconds");
 DEFINE_bool(force_init_fp, true, "Force full field processor initialization");
+DEFINE_int32(bcm_tx_pool_pkts, 0,
+             "Number of tx packet buffers of each size class to allocate "
+             "up front and recycle, 0 to allocate every packet");
 
 enum : uint8_t {
   kRxCallbackPriority = 1,
@@ -233,6 +237,7 @@ unique_ptr<BcmUnit> BcmSwitch::releaseUnit() {
   // vlans need to be destroyed explicity
   auto rv = opennsl_vlan_destroy_all(unit_);
   bcmCheckError(rv, "failed to destroy all VLANs");
+  BcmTxPacketPool::get()->release();
   unit_ = -1;
   unitObject_->setCookie(nullptr);
   return std::move(unitObject_);
@@ -317,6 +322,7 @@ void BcmSwitch::gracefulExit(folly::dynamic& switchState) {
   dumpState(platform_->getWarmBootHelper()->shutdownSdkDumpFile());
 
   switchState[kHwSwitch] = toFollyDynamic();
+  BcmTxPacketPool::get()->release();
   unitObject_->detachAndSetupWarmBoot(switchState);
   unitObject_.reset();
   XLOG(INFO)
@@ -440,6 +446,7 @@ HwInitResult BcmSwitch::init(Callback* callback) {
   }
   unit_ = unitObject_->getNumber();
   unitObject_->setCookie(this);
+  BcmTxPacketPool::get()->init(unit_, std::max(FLAGS_bcm_tx_pool_pkts, 0));
 
   bootType_ = platform_->getWarmBootHelper()->canWarmBoot()
       ? BootType::WARM_BOOT
@@ -1372,68 +1379,90 @@ void BcmSwitch::processNeighborChanges(
   }
 }
 
-template <typename RouteT>
-void BcmSwitch::processChangedRoute(
+template <typename RouteT, typename DeltaT>
+void BcmSwitch::processRemovedRoutes(
     const RouterID& id,
-    std::shared_ptr<SwitchState>* appliedState,
-    const shared_ptr<RouteT>& oldRoute,
-    const shared_ptr<RouteT>& newRoute) {
-  std::string routeMessage;
-  folly::toAppend(
-      "changing route entry @ vrf ",
-      id,
-      " from old: ",
-      oldRoute->str(),
-      "to new: ",
-      newRoute->str(),
-      &routeMessage);
-  XLOG(DBG3) << routeMessage;
-  // if the new route is not resolved, delete it instead of changing it
-  if (!newRoute->isResolved()) {
-    XLOG(DBG1) << "Non-resolved route HW programming is skipped";
-    processRemovedRoute(id, oldRoute);
-  } else {
-    try {
-      routeTable_->addRoute(getBcmVrfId(id), newRoute.get());
-    } catch (const BcmError& error) {
-      rethrowIfHwNotFull(error);
-      SwitchState::revertNewRouteEntry(id, newRoute, oldRoute, appliedState);
+    const DeltaT& routesDelta) {
+  std::vector<const RouteT*> toDelete;
+  forEachRemoved(routesDelta, [&](const shared_ptr<RouteT>& route) {
+    XLOG(DBG3) << "removing route entry @ vrf " << id << " " << route->str();
+    if (!route->isResolved()) {
+      XLOG(DBG1) << "Non-resolved route HW programming is skipped";
+      return;
     }
-  }
+    toDelete.push_back(route.get());
+  });
+  routeTable_->programRoutes(
+      getBcmVrfId(id), std::move(toDelete), {}, nullptr);
 }
 
-template <typename RouteT>
-void BcmSwitch::processAddedRoute(
+template <typename RouteT, typename DeltaT>
+void BcmSwitch::processAddedChangedRoutes(
     const RouterID& id,
-    std::shared_ptr<SwitchState>* appliedState,
-    const shared_ptr<RouteT>& route) {
-  std::string routeMessage;
-  folly::toAppend(
-      "adding route entry @ vrf ", id, " ", route->str(), &routeMessage);
-  XLOG(DBG3) << routeMessage;
-  // if the new route is not resolved, ignore it
-  if (!route->isResolved()) {
-    XLOG(DBG1) << "Non-resolved route HW programming is skipped";
-    return;
-  }
-  try {
-    routeTable_->addRoute(getBcmVrfId(id), route.get());
-  } catch (const BcmError& error) {
-    rethrowIfHwNotFull(error);
-    using AddrT = typename RouteT::Addr;
-    SwitchState::revertNewRouteEntry<AddrT>(id, route, nullptr, appliedState);
-  }
-}
-
-template <typename RouteT>
-void BcmSwitch::processRemovedRoute(const RouterID id,
-                                    const shared_ptr<RouteT>& route) {
-  XLOG(DBG3) << "removing route entry @ vrf " << id << " " << route->str();
-  if (!route->isResolved()) {
-    XLOG(DBG1) << "Non-resolved route HW programming is skipped";
-    return;
-  }
-  routeTable_->deleteRoute(getBcmVrfId(id), route.get());
+    const DeltaT& routesDelta,
+    bool inFib,
+    std::shared_ptr<SwitchState>* appliedState) {
+  std::vector<const RouteT*> toDelete;
+  std::vector<const RouteT*> toAdd;
+  // old and new route for each entry in toAdd, for reverting failed adds
+  std::vector<std::pair<shared_ptr<RouteT>, shared_ptr<RouteT>>> addedRoutes;
+  forEachChanged(
+      routesDelta,
+      [&](const shared_ptr<RouteT>& oldRoute,
+          const shared_ptr<RouteT>& newRoute) {
+        std::string routeMessage;
+        folly::toAppend(
+            "changing route entry @ vrf ",
+            id,
+            " from old: ",
+            oldRoute->str(),
+            "to new: ",
+            newRoute->str(),
+            &routeMessage);
+        XLOG(DBG3) << routeMessage;
+        // if the new route is not resolved, delete it instead of changing it
+        if (!newRoute->isResolved()) {
+          XLOG(DBG1) << "Non-resolved route HW programming is skipped";
+          if (oldRoute->isResolved()) {
+            toDelete.push_back(oldRoute.get());
+          }
+          return;
+        }
+        toAdd.push_back(newRoute.get());
+        addedRoutes.emplace_back(oldRoute, newRoute);
+      },
+      [&](const shared_ptr<RouteT>& route) {
+        std::string routeMessage;
+        folly::toAppend(
+            "adding route entry @ vrf ", id, " ", route->str(), &routeMessage);
+        XLOG(DBG3) << routeMessage;
+        // if the new route is not resolved, ignore it
+        if (!route->isResolved()) {
+          XLOG(DBG1) << "Non-resolved route HW programming is skipped";
+          return;
+        }
+        toAdd.push_back(route.get());
+        addedRoutes.emplace_back(nullptr, route);
+      },
+      [&](const shared_ptr<RouteT>& /*route*/) {});
+
+  routeTable_->programRoutes(
+      getBcmVrfId(id),
+      std::move(toDelete),
+      toAdd,
+      [&](size_t idx, const BcmError& error) {
+        rethrowIfHwNotFull(error);
+        using AddrT = typename RouteT::Addr;
+        const auto& newRoute = addedRoutes[idx].second;
+        const auto& oldRoute = addedRoutes[idx].first;
+        if (inFib) {
+          SwitchState::revertNewFibEntry<AddrT>(
+              id, newRoute, oldRoute, appliedState);
+        } else {
+          SwitchState::revertNewRouteEntry<AddrT>(
+              id, newRoute, oldRoute, appliedState);
+        }
+      });
 }
 
 void BcmSwitch::processRemovedRoutes(const StateDelta& delta) {
@@ -1443,16 +1472,16 @@ void BcmSwitch::processRemovedRoutes(const StateDelta& delta) {
       continue;
     }
     RouterID id = rtDelta.getOld()->getID();
-    forEachRemoved(
-        rtDelta.getRoutesV4Delta(),
-        &BcmSwitch::processRemovedRoute<RouteV4>,
-        this,
-        id);
-    forEachRemoved(
-        rtDelta.getRoutesV6Delta(),
-        &BcmSwitch::processRemovedRoute<RouteV6>,
-        this,
-        id);
+    processRemovedRoutes<RouteV4>(id, rtDelta.getRoutesV4Delta());
+    processRemovedRoutes<RouteV6>(id, rtDelta.getRoutesV6Delta());
+  }
+  for (auto const& fibDelta : delta.getFibsDelta()) {
+    if (!fibDelta.getOld()) {
+      continue;
+    }
+    RouterID id = fibDelta.getOld()->getID();
+    processRemovedRoutes<RouteV4>(id, fibDelta.getV4FibDelta());
+    processRemovedRoutes<RouteV6>(id, fibDelta.getV6FibDelta());
   }
 }
 
@@ -1465,28 +1494,20 @@ void BcmSwitch::processAddedChangedRoutes(
       continue;
     }
     RouterID id = rtDelta.getNew()->getID();
-    forEachChanged(
-        rtDelta.getRoutesV4Delta(),
-        &BcmSwitch::processChangedRoute<RouteV4>,
-        &BcmSwitch::processAddedRoute<RouteV4>,
-        [&](BcmSwitch*,
-            const RouterID&,
-            std::shared_ptr<SwitchState>*,
-            const shared_ptr<RouteV4>&) {},
-        this,
-        id,
-        appliedState);
-    forEachChanged(
-        rtDelta.getRoutesV6Delta(),
-        &BcmSwitch::processChangedRoute<RouteV6>,
-        &BcmSwitch::processAddedRoute<RouteV6>,
-        [&](BcmSwitch*,
-            const RouterID&,
-            std::shared_ptr<SwitchState>*,
-            const shared_ptr<RouteV6>&) {},
-        this,
-        id,
-        appliedState);
+    processAddedChangedRoutes<RouteV4>(
+        id, rtDelta.getRoutesV4Delta(), false, appliedState);
+    processAddedChangedRoutes<RouteV6>(
+        id, rtDelta.getRoutesV6Delta(), false, appliedState);
+  }
+  for (auto const& fibDelta : delta.getFibsDelta()) {
+    if (!fibDelta.getNew()) {
+      continue;
+    }
+    RouterID id = fibDelta.getNew()->getID();
+    processAddedChangedRoutes<RouteV4>(
+        id, fibDelta.getV4FibDelta(), true, appliedState);
+    processAddedChangedRoutes<RouteV6>(
+        id, fibDelta.getV6FibDelta(), true, appliedState);
   }
 }
 
@@ -1605,6 +1626,34 @@ bool BcmSwitch::sendPacketOutOfPortSync(unique_ptr<TxPacket> pkt,
   return sendPacketOutOfPortSync(std::move(bcmPkt), portID);
 }
 
+size_t BcmSwitch::sendPacketsSwitchedAsync(
+    std::vector<unique_ptr<TxPacket>> pkts) noexcept {
+  std::vector<unique_ptr<BcmTxPacket>> bcmPkts;
+  bcmPkts.reserve(pkts.size());
+  for (auto& pkt : pkts) {
+    bcmPkts.emplace_back(
+        boost::polymorphic_downcast<BcmTxPacket*>(pkt.release()));
+  }
+  return BcmTxPacket::sendAsync(std::move(bcmPkts));
+}
+
+size_t BcmSwitch::sendPacketsOutOfPortAsync(
+    std::vector<PortTxPacket> pkts) noexcept {
+  std::vector<unique_ptr<BcmTxPacket>> bcmPkts;
+  bcmPkts.reserve(pkts.size());
+  for (auto& pkt : pkts) {
+    bcmPkts.emplace_back(
+        boost::polymorphic_downcast<BcmTxPacket*>(pkt.pkt.release()));
+    bcmPkts.back()->setDestModPort(getPortTable()->getBcmPortId(pkt.portID));
+    if (pkt.cos) {
+      bcmPkts.back()->setCos(*pkt.cos);
+    }
+  }
+  XLOG(DBG4) << "sendPacketsOutOfPortAsync for " << bcmPkts.size()
+             << " packets";
+  return BcmTxPacket::sendAsync(std::move(bcmPkts));
+}
+
 void BcmSwitch::updateStats(SwitchStats *switchStats) {
   // Update thread-local switch statistics.
   updateThreadLocalSwitchStats(switchStats);
@@ -227,6 +227,10 @@ class BcmSwitch : public BcmSwitchIf {
       std::unique_ptr<TxPacket> pkt,
       PortID portID,
       uint8_t cos) noexcept;
+  size_t sendPacketsSwitchedAsync(
+      std::vector<std::unique_ptr<TxPacket>> pkts) noexcept override;
+  size_t sendPacketsOutOfPortAsync(
+      std::vector<PortTxPacket> pkts) noexcept override;
   std::unique_ptr<PacketTraceInfo> getPacketTrace(
       std::unique_ptr<MockRxPacket> pkt) override;
 
@@ -459,20 +463,22 @@ class BcmSwitch : public BcmSwitchIf {
   void pickupLinkStatusChanges(const StateDelta& delta);
   void reconfigurePortGroups(const StateDelta& delta);
 
-  template <typename RouteT>
-  void processChangedRoute(
-      const RouterID& id,
-      std::shared_ptr<SwitchState>* appliedState,
-      const std::shared_ptr<RouteT>& oldRoute,
-      const std::shared_ptr<RouteT>& newRoute);
-  template <typename RouteT>
-  void processAddedRoute(
+  /*
+   * Route changes for one route table and address family are collected and
+   * handed to BcmRouteTable::programRoutes() as a single batch.
+   *
+   * Routes come either from the RouteTables of the SwitchState, or from its
+   * ForwardingInformationBases when the agent runs with a standalone RIB.
+   * inFib says which, so that failed routes are reverted in the right place.
+   */
+  template <typename RouteT, typename DeltaT>
+  void processRemovedRoutes(const RouterID& id, const DeltaT& routesDelta);
+  template <typename RouteT, typename DeltaT>
+  void processAddedChangedRoutes(
       const RouterID& id,
-      std::shared_ptr<SwitchState>* appliedState,
-      const std::shared_ptr<RouteT>& route);
-  template <typename RouteT>
-  void processRemovedRoute(
-      const RouterID id, const std::shared_ptr<RouteT>& route);
+      const DeltaT& routesDelta,
+      bool inFib,
+      std::shared_ptr<SwitchState>* appliedState);
   void processRemovedRoutes(const StateDelta& delta);
   void processAddedChangedRoutes(
       const StateDelta& delta,
@@ -11,6 +11,7 @@
 
 #include "fboss/agent/hw/bcm/BcmError.h"
 #include "fboss/agent/hw/bcm/BcmStats.h"
+#include "fboss/agent/hw/bcm/BcmTxPacketPool.h"
 
 
 extern "C" {
@@ -30,6 +31,11 @@ void freeTxBuf(void* /*ptr*/, void* arg) {
   BcmStats::get()->txPktFree();
 }
 
+void freePooledTxBuf(void* /*ptr*/, void* arg) {
+  BcmTxPacketPool::get()->free(reinterpret_cast<BcmTxPacketPool::Entry*>(arg));
+  BcmStats::get()->txPktFree();
+}
+
 inline void txCallbackImpl(int /*unit*/, opennsl_pkt_t* pkt, void* cookie) {
   // Put the BcmTxPacket back into a unique_ptr.
   // This will delete it when we return.
@@ -66,6 +72,15 @@ bool& BcmTxPacket::syncPacketSent() {
 
 BcmTxPacket::BcmTxPacket(int unit, uint32_t size)
     : queued_(std::chrono::time_point<std::chrono::steady_clock>::min()) {
+  auto entry = BcmTxPacketPool::get()->alloc(size);
+  if (entry) {
+    pkt_ = entry->pkt;
+    buf_ = IOBuf::takeOwnership(pkt_->pkt_data->data, size,
+                                freePooledTxBuf, reinterpret_cast<void*>(entry));
+    BcmStats::get()->txPktAlloc();
+    return;
+  }
+
   int rv = opennsl_pkt_alloc(unit, size,
                              OPENNSL_TX_CRC_APPEND | OPENNSL_TX_ETHER, &pkt_);
   bcmCheckError(rv, "Failed to allocate packet.");
@@ -81,7 +96,9 @@ void BcmTxPacket::enableHiGigHeader() {
   pkt_->flags &= ~OPENNSL_TX_ETHER;
 }
 
-inline int BcmTxPacket::sendImpl(unique_ptr<BcmTxPacket> pkt) noexcept {
+inline int BcmTxPacket::sendImpl(
+    unique_ptr<BcmTxPacket> pkt,
+    TimePoint now) noexcept {
   opennsl_pkt_t* bcmPkt = pkt->pkt_;
   const auto buf = pkt->buf();
 
@@ -94,7 +111,7 @@ inline int BcmTxPacket::sendImpl(unique_ptr<BcmTxPacket> pkt) noexcept {
   // buf->writableBuffer in case there is unused header space in the IOBuf
   bcmPkt->pkt_data->data = buf->writableData();
 
-  pkt->queued_ = std::chrono::steady_clock::now();
+  pkt->queued_ = now;
   auto rv = opennsl_tx(bcmPkt->unit, bcmPkt, pkt.get());
   if (OPENNSL_SUCCESS(rv)) {
     pkt.release();
@@ -128,6 +145,22 @@ int BcmTxPacket::sendAsync(unique_ptr<BcmTxPacket> pkt) noexcept {
   return sendImpl(std::move(pkt));
 }
 
+size_t BcmTxPacket::sendAsync(
+    std::vector<unique_ptr<BcmTxPacket>> pkts) noexcept {
+  // The packets are queued at once, read the clock once for all of them
+  auto now = std::chrono::steady_clock::now();
+  size_t sent = 0;
+  for (auto& pkt : pkts) {
+    opennsl_pkt_t* bcmPkt = pkt->pkt_;
+    DCHECK(bcmPkt->call_back == nullptr);
+    bcmPkt->call_back = BcmTxPacket::txCallbackAsync;
+    if (OPENNSL_SUCCESS(sendImpl(std::move(pkt), now))) {
+      ++sent;
+    }
+  }
+  return sent;
+}
+
 int BcmTxPacket::sendSync(unique_ptr<BcmTxPacket> pkt) noexcept {
   opennsl_pkt_t* bcmPkt = pkt->pkt_;
   DCHECK(bcmPkt->call_back == nullptr);
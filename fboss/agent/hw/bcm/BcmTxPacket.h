@@ -12,6 +12,7 @@
 #include <chrono>
 #include <mutex>
 #include <condition_variable>
+#include <vector>
 
 #include "fboss/agent/TxPacket.h"
 
@@ -61,6 +62,13 @@ class BcmTxPacket : public TxPacket {
    * Returns an OpenNSL error code.
    */
   static int sendAsync(std::unique_ptr<BcmTxPacket> pkt) noexcept;
+  /*
+   * Send a batch of BcmTxPackets asynchronously, back to back.
+   *
+   * Returns the number of packets queued to HW.
+   */
+  static size_t sendAsync(
+      std::vector<std::unique_ptr<BcmTxPacket>> pkts) noexcept;
   /*
    * Send a BcmTxPacket synchronously.
    *
@@ -74,7 +82,9 @@ class BcmTxPacket : public TxPacket {
   static int sendSync(std::unique_ptr<BcmTxPacket> pkt) noexcept;
 
  private:
-  inline static int sendImpl(std::unique_ptr<BcmTxPacket> pkt) noexcept;
+  inline static int sendImpl(
+      std::unique_ptr<BcmTxPacket> pkt,
+      TimePoint now = std::chrono::steady_clock::now()) noexcept;
   static void txCallbackAsync(int unit, opennsl_pkt_t* pkt, void* cookie);
   static void txCallbackSync(int unit, opennsl_pkt_t* pkt, void* cookie);
 
@@ -0,0 +1,136 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/hw/bcm/BcmTxPacketPool.h"
+
+#include "fboss/agent/hw/bcm/BcmError.h"
+#include "fboss/agent/hw/bcm/BcmStats.h"
+
+#include <folly/logging/xlog.h>
+
+#include <algorithm>
+
+extern "C" {
+#include <opennsl/tx.h>
+}
+
+namespace facebook { namespace fboss {
+
+constexpr std::array<uint32_t, 4> BcmTxPacketPool::kSizeClasses;
+
+BcmTxPacketPool* BcmTxPacketPool::get() {
+  // Never destroyed, the unit may be gone by the time statics are
+  static BcmTxPacketPool* pool = new BcmTxPacketPool();
+  return pool;
+}
+
+void BcmTxPacketPool::init(int unit, uint32_t pktsPerClass) {
+  release();
+  if (pktsPerClass == 0) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> g(entriesMutex_);
+  auto generation = ++generation_;
+  for (uint8_t c = 0; c < kSizeClasses.size(); ++c) {
+    std::vector<Entry*> entries;
+    for (uint32_t i = 0; i < pktsPerClass; ++i) {
+      opennsl_pkt_t* pkt;
+      int rv = opennsl_pkt_alloc(
+          unit,
+          kSizeClasses[c],
+          OPENNSL_TX_CRC_APPEND | OPENNSL_TX_ETHER,
+          &pkt);
+      if (OPENNSL_FAILURE(rv)) {
+        // Make do with what we have, packets will be allocated as needed
+        bcmLogError(rv, "Failed to preallocate tx packet of ",
+                    kSizeClasses[c], " bytes");
+        break;
+      }
+      entries_.push_back(std::make_unique<Entry>());
+      auto entry = entries_.back().get();
+      entry->pkt = pkt;
+      entry->data = pkt->pkt_data->data;
+      entry->sizeClass = c;
+      entry->generation = generation;
+      entries.push_back(entry);
+    }
+    std::lock_guard<std::mutex> g2(classes_[c].mutex);
+    classes_[c].free = std::move(entries);
+  }
+  enabled_ = true;
+  XLOG(INFO) << "Preallocated " << pktsPerClass
+             << " tx packets of each size class on unit " << unit;
+}
+
+void BcmTxPacketPool::release() {
+  // Buffers returned from now on are freed rather than pooled
+  enabled_ = false;
+  ++generation_;
+  for (auto& sizeClass : classes_) {
+    std::lock_guard<std::mutex> g(sizeClass.mutex);
+    for (auto entry : sizeClass.free) {
+      freePkt(entry);
+    }
+    sizeClass.free.clear();
+  }
+}
+
+BcmTxPacketPool::Entry* BcmTxPacketPool::alloc(uint32_t size) {
+  auto it = std::lower_bound(kSizeClasses.begin(), kSizeClasses.end(), size);
+  if (it == kSizeClasses.end()) {
+    return nullptr;
+  }
+  auto& sizeClass = classes_[it - kSizeClasses.begin()];
+  Entry* entry;
+  {
+    std::lock_guard<std::mutex> g(sizeClass.mutex);
+    if (sizeClass.free.empty()) {
+      if (enabled_.load()) {
+        BcmStats::get()->txPktPoolExhausted();
+      }
+      return nullptr;
+    }
+    entry = sizeClass.free.back();
+    sizeClass.free.pop_back();
+  }
+
+  // Undo whatever the last packet sent with the buffer changed
+  auto pkt = entry->pkt;
+  pkt->flags = OPENNSL_TX_CRC_APPEND | OPENNSL_TX_ETHER;
+  OPENNSL_PBMP_CLEAR(pkt->tx_pbmp);
+  OPENNSL_PBMP_CLEAR(pkt->tx_upbmp);
+  pkt->cos = 0;
+  pkt->call_back = nullptr;
+  pkt->pkt_data->data = entry->data;
+  pkt->pkt_data->len = kSizeClasses[entry->sizeClass];
+  return entry;
+}
+
+void BcmTxPacketPool::free(Entry* entry) {
+  auto& sizeClass = classes_[entry->sizeClass];
+  std::lock_guard<std::mutex> g(sizeClass.mutex);
+  if (entry->generation != generation_.load()) {
+    freePkt(entry);
+    return;
+  }
+  sizeClass.free.push_back(entry);
+}
+
+void BcmTxPacketPool::freePkt(Entry* entry) {
+  if (!entry->pkt) {
+    return;
+  }
+  entry->pkt->pkt_data->data = entry->data;
+  int rv = opennsl_pkt_free(entry->pkt->unit, entry->pkt);
+  bcmLogError(rv, "Failed to free pooled packet");
+  entry->pkt = nullptr;
+}
+
+}} // facebook::fboss
@@ -0,0 +1,102 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+extern "C" {
+#include <opennsl/pkt.h>
+#include <opennsl/types.h>
+}
+
+namespace facebook { namespace fboss {
+
+/*
+ * Packet buffers allocated from the SDK DMA pool up front, and recycled
+ * when the transmission of a packet completes, so that sending a packet
+ * does not pay for an opennsl_pkt_alloc() and opennsl_pkt_free().
+ *
+ * Buffers come in a few size classes, a packet gets a buffer from the
+ * smallest class it fits in. Packets larger than the largest class, or
+ * sent while their class is exhausted, are allocated from the SDK as
+ * before.
+ *
+ * There is a single pool for the process, as there is a single DMA pool
+ * for all units. It is empty until init(), and must be release()d before
+ * the unit is detached.
+ */
+class BcmTxPacketPool {
+ public:
+  static constexpr std::array<uint32_t, 4> kSizeClasses{
+      {256, 1024, 2048, 10240}};
+
+  struct Entry {
+    opennsl_pkt_t* pkt{nullptr};
+    // The DMA buffer, pkt_data->data is moved while the packet is sent
+    uint8_t* data{nullptr};
+    uint8_t sizeClass{0};
+    // The init() that allocated the buffer
+    uint32_t generation{0};
+  };
+
+  static BcmTxPacketPool* get();
+
+  /*
+   * Allocate pktsPerClass buffers of each size class on unit.
+   */
+  void init(int unit, uint32_t pktsPerClass);
+
+  /*
+   * Free the buffers in the pool. Buffers of packets still being sent are
+   * freed when the packets complete.
+   */
+  void release();
+
+  /*
+   * Returns a buffer of at least size bytes, reset for a new packet, or
+   * nullptr if there is none to spare.
+   */
+  Entry* alloc(uint32_t size);
+
+  /*
+   * Return a buffer to the pool.
+   */
+  void free(Entry* entry);
+
+ private:
+  struct SizeClass {
+    std::mutex mutex;
+    std::vector<Entry*> free;
+  };
+
+  BcmTxPacketPool() {}
+  // Forbidden copy constructor and assignment operator
+  BcmTxPacketPool(BcmTxPacketPool const &) = delete;
+  BcmTxPacketPool& operator=(BcmTxPacketPool const &) = delete;
+
+  static void freePkt(Entry* entry);
+
+  std::array<SizeClass, kSizeClasses.size()> classes_;
+
+  // Entries are never deleted, packets in flight keep pointing to them
+  // across release() and init()
+  std::mutex entriesMutex_;
+  std::vector<std::unique_ptr<Entry>> entries_;
+  std::atomic<uint32_t> generation_{0};
+  // Between init() and release()
+  std::atomic<bool> enabled_{false};
+};
+
+}} // facebook::fboss
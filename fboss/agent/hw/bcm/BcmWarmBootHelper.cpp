@@ -5,6 +5,7 @@
 #include "fboss/agent/Utils.h"
 
 #include <sys/stat.h>
+#include <unistd.h>
 #include <fcntl.h>
 
 #include <folly/FileUtil.h>
@@ -12,12 +13,20 @@
 #include <folly/logging/xlog.h>
 #include <glog/logging.h>
 
+#include <tuple>
+
 using std::string;
 
 DEFINE_bool(can_warm_boot, true,
             "Enable/disable warm boot functionality");
 DEFINE_string(switch_state_file, "switch_state",
     "File for dumping switch state JSON in on exit");
+DEFINE_bool(binary_switch_state, false,
+    "Store the warm boot switch state in binary (BSER) form rather than "
+    "JSON. Binary state is much faster to write on exit and to load on "
+    "warm boot. Either form is read back on warm boot, but agents older "
+    "than this one only read JSON, so leave this off until rolling back to "
+    "one is no longer possible.");
 
 namespace {
 constexpr auto wbFlagPrefix = "can_warm_boot_";
@@ -25,6 +34,7 @@ constexpr auto wbDataPrefix = "bcm_sdk_state_";
 constexpr auto forceColdBootPrefix = "cold_boot_once_";
 constexpr auto shutdownDumpPrefix = "sdk_shutdown_dump_";
 constexpr auto startupDumpPrefix = "sdk_startup_dump_";
+constexpr auto binarySwitchStateSuffix = ".bser";
 
 /*
  * Remove the given file. Return true if file exists and
@@ -45,6 +55,14 @@ bool removeFile(const string& filename) {
       errno, "error while trying to remove warm boot file ", filename);
 }
 
+/*
+ * Return true if the file a was modified after the file b
+ */
+bool isNewer(const struct stat& a, const struct stat& b) {
+  return std::tie(a.st_mtim.tv_sec, a.st_mtim.tv_nsec) >
+      std::tie(b.st_mtim.tv_sec, b.st_mtim.tv_nsec);
+}
+
 }
 
 namespace facebook { namespace fboss {
@@ -88,6 +106,11 @@ std::string DiscBackedBcmWarmBootHelper::warmBootSwitchStateFile() const {
   return folly::to<string>(warmBootDir_, "/", FLAGS_switch_state_file);
 }
 
+std::string DiscBackedBcmWarmBootHelper::warmBootBinarySwitchStateFile()
+    const {
+  return folly::to<string>(warmBootSwitchStateFile(), binarySwitchStateSuffix);
+}
+
 std::string DiscBackedBcmWarmBootHelper::warmBootFlag() const {
   return folly::to<string>(warmBootDir_, "/", wbFlagPrefix, unit_);
 }
@@ -130,10 +153,28 @@ bool DiscBackedBcmWarmBootHelper::checkAndClearWarmBootFlags() {
 
 bool DiscBackedBcmWarmBootHelper::storeWarmBootState(
     const folly::dynamic& switchState) {
-  return dumpStateToFile(warmBootSwitchStateFile(), switchState);
+  // Only ever leave one form of the state behind, so that we never warm boot
+  // from a stale file written by a previous run in the other format.
+  if (!FLAGS_binary_switch_state) {
+    removeFile(warmBootBinarySwitchStateFile());
+    return dumpStateToFile(warmBootSwitchStateFile(), switchState);
+  }
+  removeFile(warmBootSwitchStateFile());
+  return dumpBinaryStateToFile(warmBootBinarySwitchStateFile(), switchState);
 }
 
 folly::dynamic DiscBackedBcmWarmBootHelper::getWarmBootState() const {
+  // An agent rolled back to one that predates the binary state writes JSON
+  // and leaves the binary state of the run before it behind, so when both
+  // files are there the newer one is the current state.
+  auto binaryStateFile = warmBootBinarySwitchStateFile();
+  struct stat binaryStat;
+  struct stat jsonStat;
+  if (stat(binaryStateFile.c_str(), &binaryStat) == 0 &&
+      (stat(warmBootSwitchStateFile().c_str(), &jsonStat) != 0 ||
+       !isNewer(jsonStat, binaryStat))) {
+    return readBinaryStateFromFile(binaryStateFile);
+  }
   std::string warmBootJson;
   auto ret = folly::readFile(warmBootSwitchStateFile().c_str(), warmBootJson);
   sysCheckError(
@@ -337,6 +337,12 @@ struct RxCaptureFilter {
 
 struct CaptureFilter {
   1: RxCaptureFilter rxCaptureFilter;
+  /*
+   * A pcap-filter expression, as taken by tcpdump, that both rx and tx
+   * packets must match, e.g. "vlan and arp". Empty to match all packets.
+   * Packets start at the ethernet header, including any 802.1q tag.
+   */
+  2: string bpfFilter
 }
 
 struct CaptureInfo {
@@ -356,6 +362,24 @@ struct CaptureInfo {
    * set of criteria that packet must meet to be captured
    */
   4: CaptureFilter  filter
+  /*
+   * Bytes captured of each packet, longer packets are truncated.
+   * 0 to capture whole packets.
+   */
+  5: i32 snaplen = 0
+  /*
+   * Start a new capture file once the current one reaches rotateBytes, or
+   * is rotateSeconds old. 0 for no limit.
+   */
+  6: i64 rotateBytes = 0
+  7: i32 rotateSeconds = 0
+  // Compress the capture files with zstd
+  8: bool compress = false
+  /*
+   * Keep at most maxFiles capture files, deleting the oldest on rotation,
+   * as tcpdump -W does. 0 for no limit.
+   */
+  9: i32 maxFiles = 0
 }
 
 struct RouteUpdateLoggingInfo {
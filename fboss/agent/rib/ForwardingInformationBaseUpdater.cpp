@@ -0,0 +1,283 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/rib/ForwardingInformationBaseUpdater.h"
+
+#include "fboss/agent/state/ForwardingInformationBaseContainer.h"
+#include "fboss/agent/state/ForwardingInformationBaseMap.h"
+#include "fboss/agent/state/Route.h"
+#include "fboss/agent/state/RouteNextHopEntry.h"
+#include "fboss/agent/state/SwitchState.h"
+
+#include <folly/lang/Assume.h>
+
+#include <type_traits>
+
+namespace facebook {
+namespace fboss {
+namespace rib {
+
+namespace {
+
+// The rib and the SwitchState each have their own route types
+using FibRouteNextHopEntry = facebook::fboss::RouteNextHopEntry;
+template <typename AddressT>
+using FibRoute = facebook::fboss::Route<AddressT>;
+template <typename AddressT>
+using FibRoutePrefix = facebook::fboss::RoutePrefix<AddressT>;
+
+FibRouteNextHopEntry toFibNextHopEntry(const RouteNextHopEntry& entry) {
+  switch (entry.getAction()) {
+    case RouteForwardAction::DROP:
+      return FibRouteNextHopEntry(
+          facebook::fboss::RouteForwardAction::DROP, entry.getAdminDistance());
+    case RouteForwardAction::TO_CPU:
+      return FibRouteNextHopEntry(
+          facebook::fboss::RouteForwardAction::TO_CPU,
+          entry.getAdminDistance());
+    case RouteForwardAction::NEXTHOPS: {
+      facebook::fboss::RouteNextHopSet nhops;
+      for (const auto& nhop : entry.getNextHopSet()) {
+        auto intfID = nhop.intfID();
+        if (intfID) {
+          nhops.emplace(facebook::fboss::ResolvedNextHop(
+              nhop.addr(), *intfID, nhop.weight()));
+        } else {
+          nhops.emplace(
+              facebook::fboss::UnresolvedNextHop(nhop.addr(), nhop.weight()));
+        }
+      }
+      return FibRouteNextHopEntry(std::move(nhops), entry.getAdminDistance());
+    }
+  }
+  folly::assume_unreachable();
+}
+
+template <typename AddressT>
+std::shared_ptr<FibRoute<AddressT>> toFibRoute(const Route<AddressT>& route) {
+  FibRoutePrefix<AddressT> prefix{route.prefix().network, route.prefix().mask};
+  auto bestEntry = route.getBestEntry();
+  CHECK(bestEntry.second) << "Resolved route " << route.str()
+                          << " has no next hop entry";
+  auto fibRoute = std::make_shared<FibRoute<AddressT>>(
+      prefix, bestEntry.first, toFibNextHopEntry(*bestEntry.second));
+  fibRoute->setResolved(toFibNextHopEntry(route.getForwardInfo()));
+  if (route.isConnected()) {
+    fibRoute->setConnected();
+  }
+  return fibRoute;
+}
+
+template <typename AddressT>
+bool sameForwarding(
+    const FibRoute<AddressT>& existing,
+    const FibRoute<AddressT>& route) {
+  if (existing.isConnected() != route.isConnected() ||
+      !(existing.getForwardInfo() == route.getForwardInfo())) {
+    return false;
+  }
+  auto existingBestEntry = existing.getBestEntry();
+  auto bestEntry = route.getBestEntry();
+  return existingBestEntry.first == bestEntry.first &&
+      existingBestEntry.second && bestEntry.second &&
+      *existingBestEntry.second == *bestEntry.second;
+}
+
+template <typename AddressT>
+AddressT asAddress(const folly::IPAddress& addr);
+
+template <>
+folly::IPAddressV4 asAddress(const folly::IPAddress& addr) {
+  return addr.asV4();
+}
+
+template <>
+folly::IPAddressV6 asAddress(const folly::IPAddress& addr) {
+  return addr.asV6();
+}
+
+template <typename AddressT>
+void getFibRouteChanges(
+    const NetworkToRouteMap<AddressT>& routes,
+    const folly::Optional<std::set<folly::CIDRNetwork>>& prefixes,
+    FibRouteChanges<AddressT>* changes) {
+  if (!prefixes) {
+    changes->replaceAll = true;
+    for (const auto& entry : routes) {
+      const auto& route = entry.value();
+      if (route.isResolved()) {
+        changes->routes.emplace_back(
+            FibRoutePrefix<AddressT>{route.prefix().network,
+                                     route.prefix().mask},
+            toFibRoute(route));
+      }
+    }
+    return;
+  }
+
+  for (const auto& cidr : *prefixes) {
+    if (cidr.first.isV4() !=
+        std::is_same<AddressT, folly::IPAddressV4>::value) {
+      continue;
+    }
+    FibRoutePrefix<AddressT> prefix{asAddress<AddressT>(cidr.first),
+                                    cidr.second};
+    auto it = routes.exactMatch(prefix.network, prefix.mask);
+    if (it == routes.end() || !it->value().isResolved()) {
+      changes->routes.emplace_back(prefix, nullptr);
+    } else {
+      changes->routes.emplace_back(prefix, toFibRoute(it->value()));
+    }
+  }
+}
+
+} // namespace
+
+FibChanges getFibChanges(
+    RouterID vrf,
+    const IPv4NetworkToRouteMap& v4NetworkToRoute,
+    const IPv6NetworkToRouteMap& v6NetworkToRoute,
+    const folly::Optional<std::set<folly::CIDRNetwork>>& prefixes) {
+  FibChanges changes(vrf);
+  getFibRouteChanges(v4NetworkToRoute, prefixes, &changes.v4);
+  getFibRouteChanges(v6NetworkToRoute, prefixes, &changes.v6);
+  return changes;
+}
+
+ForwardingInformationBaseUpdater::ForwardingInformationBaseUpdater(
+    const FibChanges& changes)
+    : changes_(changes) {}
+
+std::shared_ptr<SwitchState> ForwardingInformationBaseUpdater::operator()(
+    const std::shared_ptr<SwitchState>& state) {
+  auto vrf = changes_.vrf;
+  auto container = state->getFibs()->getFibContainerIf(vrf);
+  bool newVrf = !container;
+  if (newVrf) {
+    container = std::make_shared<ForwardingInformationBaseContainer>(vrf);
+  }
+
+  auto updatedFibV4 = createUpdatedFib(changes_.v4, container->getFibV4());
+  auto updatedFibV6 = createUpdatedFib(changes_.v6, container->getFibV6());
+  if (!updatedFibV4 && !updatedFibV6 && !newVrf) {
+    return nullptr;
+  }
+
+  auto updatedContainer = newVrf ? container : container->clone();
+  if (updatedFibV4) {
+    updatedContainer->setFib(std::move(updatedFibV4));
+  }
+  if (updatedFibV6) {
+    updatedContainer->setFib(std::move(updatedFibV6));
+  }
+
+  auto updatedFibs = state->getFibs()->clone();
+  if (newVrf) {
+    updatedFibs->addNode(updatedContainer);
+  } else {
+    updatedFibs->updateNode(updatedContainer);
+  }
+
+  auto newState = state->clone();
+  newState->resetForwardingInformationBases(std::move(updatedFibs));
+  return newState;
+}
+
+template <typename AddressT>
+std::shared_ptr<facebook::fboss::ForwardingInformationBase<AddressT>>
+ForwardingInformationBaseUpdater::createUpdatedFib(
+    const FibRouteChanges<AddressT>& changes,
+    const std::shared_ptr<facebook::fboss::ForwardingInformationBase<
+        AddressT>>& fib) const {
+  using Fib = facebook::fboss::ForwardingInformationBase<AddressT>;
+
+  if (changes.replaceAll) {
+    auto updatedFib = std::make_shared<Fib>();
+    bool changed = false;
+    for (const auto& prefixAndRoute : changes.routes) {
+      auto route = prefixAndRoute.second;
+      auto existing = fib->exactMatch(prefixAndRoute.first);
+      if (existing && sameForwarding(*existing, *route)) {
+        route = std::move(existing);
+      } else {
+        changed = true;
+      }
+      updatedFib->addNode(route);
+    }
+    // Every route we kept is an existing one, so unless some were dropped
+    // too the FIB is unchanged
+    if (!changed && updatedFib->size() == fib->size()) {
+      return nullptr;
+    }
+    return updatedFib;
+  }
+
+  // Cloning the FIB is O(1), and each change below only copies the path to
+  // its route
+  std::shared_ptr<Fib> updatedFib;
+  auto writableFib = [&]() {
+    if (!updatedFib) {
+      updatedFib = fib->clone();
+    }
+    return updatedFib.get();
+  };
+  for (const auto& prefixAndRoute : changes.routes) {
+    const auto& prefix = prefixAndRoute.first;
+    const auto& route = prefixAndRoute.second;
+    auto existing = fib->exactMatch(prefix);
+    if (!route) {
+      if (existing) {
+        writableFib()->removeNode(prefix);
+      }
+    } else if (!existing) {
+      writableFib()->addNode(route);
+    } else if (!sameForwarding(*existing, *route)) {
+      writableFib()->updateNode(route);
+    }
+  }
+  return updatedFib;
+}
+
+namespace {
+
+template <typename AddressT>
+bool fibHasChanges(
+    const FibRouteChanges<AddressT>& changes,
+    const facebook::fboss::ForwardingInformationBase<AddressT>& fib) {
+  if (changes.replaceAll && changes.routes.size() != fib.size()) {
+    return false;
+  }
+  for (const auto& prefixAndRoute : changes.routes) {
+    const auto& route = prefixAndRoute.second;
+    auto existing = fib.exactMatch(prefixAndRoute.first);
+    if (!route) {
+      if (existing) {
+        return false;
+      }
+    } else if (!existing || !sameForwarding(*existing, *route)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+bool isFibPublished(const SwitchState& state, const FibChanges& changes) {
+  auto container = state.getFibs()->getFibContainerIf(changes.vrf);
+  if (!container) {
+    return changes.v4.routes.empty() && changes.v6.routes.empty();
+  }
+  return fibHasChanges(changes.v4, *container->getFibV4()) &&
+      fibHasChanges(changes.v6, *container->getFibV6());
+}
+
+} // namespace rib
+} // namespace fboss
+} // namespace facebook
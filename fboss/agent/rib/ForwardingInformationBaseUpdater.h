@@ -0,0 +1,116 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include "fboss/agent/rib/NetworkToRouteMap.h"
+#include "fboss/agent/state/ForwardingInformationBase.h"
+#include "fboss/agent/types.h"
+
+#include <folly/IPAddress.h>
+#include <folly/Optional.h>
+
+#include <memory>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace facebook {
+namespace fboss {
+
+class SwitchState;
+
+namespace rib {
+
+/*
+ * The FIB routes of one address family that a RIB update changed. A null
+ * route removes its prefix from the FIB. If replaceAll is set, routes holds
+ * every route of the FIB rather than only the changed ones.
+ */
+template <typename AddressT>
+struct FibRouteChanges {
+  using FibRoute = facebook::fboss::Route<AddressT>;
+  using FibRoutePrefix = facebook::fboss::RoutePrefix<AddressT>;
+
+  std::vector<std::pair<FibRoutePrefix, std::shared_ptr<FibRoute>>> routes;
+  bool replaceAll{false};
+};
+
+/*
+ * The FIB routes of one VRF that a RIB update changed. They are built from
+ * the route tables while the RIB is locked, and hold no reference to them,
+ * so they can be published once the lock is released.
+ */
+struct FibChanges {
+  explicit FibChanges(RouterID vrf) : vrf(vrf) {}
+
+  RouterID vrf;
+  FibRouteChanges<folly::IPAddressV4> v4;
+  FibRouteChanges<folly::IPAddressV6> v6;
+};
+
+/*
+ * Gather the FIB routes of the given prefixes, as RouteUpdater::
+ * getResolvedPrefixes() returns them. If prefixes is folly::none, every
+ * resolved route of the VRF is gathered instead.
+ */
+FibChanges getFibChanges(
+    RouterID vrf,
+    const IPv4NetworkToRouteMap& v4NetworkToRoute,
+    const IPv6NetworkToRouteMap& v6NetworkToRoute,
+    const folly::Optional<std::set<folly::CIDRNetwork>>& prefixes);
+
+/*
+ * ForwardingInformationBaseUpdater publishes the FibChanges of one VRF into
+ * SwitchState, as that VRF's ForwardingInformationBaseContainer. It is a
+ * StateUpdateFn.
+ *
+ * Only the prefixes in the changes are looked at. Routes whose forwarding
+ * information did not change keep their existing node, so the resulting
+ * StateDelta only holds the routes that actually need reprogramming, and the
+ * update is a no-op if there are none. The FIBs keep their routes in a
+ * PersistentNodeContainer, so patching them costs O(log n) per changed route
+ * rather than a copy of the whole FIB.
+ *
+ * The updater refers to the changes it is given rather than copying them,
+ * so they have to outlive it, as they do when it is invoked through
+ * SwSwitch::updateStateBlocking().
+ *
+ * The FIB is not serialized for warm boot. The RIB is rebuilt from config
+ * and from the syncFib of each client after a restart, and republishes the
+ * whole FIB of a VRF the first time it updates it.
+ */
+class ForwardingInformationBaseUpdater {
+ public:
+  explicit ForwardingInformationBaseUpdater(const FibChanges& changes);
+
+  std::shared_ptr<SwitchState> operator()(
+      const std::shared_ptr<SwitchState>& state);
+
+ private:
+  // Returns nullptr if fib already matches the changes
+  template <typename AddressT>
+  std::shared_ptr<facebook::fboss::ForwardingInformationBase<AddressT>>
+  createUpdatedFib(
+      const FibRouteChanges<AddressT>& changes,
+      const std::shared_ptr<facebook::fboss::ForwardingInformationBase<
+          AddressT>>& fib) const;
+
+  const FibChanges& changes_;
+};
+
+/*
+ * Whether the FIB of state holds the changes as given. It does not when the
+ * hardware could not program some of the routes and they were reverted.
+ */
+bool isFibPublished(const SwitchState& state, const FibChanges& changes);
+
+} // namespace rib
+} // namespace fboss
+} // namespace facebook
@@ -25,10 +25,21 @@ namespace facebook {
 namespace fboss {
 namespace rib {
 
-template <typename AddressT>
-class NetworkToRouteMap
-    : public facebook::network::RadixTree<AddressT, Route<AddressT>> {
+/*
+ * TreeT is the tree used for longest prefix matching, either a RadixTree or
+ * a MultibitTrie, which is smaller and faster to search for large tables.
+ * RouteUpdater and RoutingInformationBase use the default tree.
+ */
+template <
+    typename AddressT,
+    typename TreeT = facebook::network::RadixTree<AddressT, Route<AddressT>>>
+class NetworkToRouteMap : public TreeT {
  public:
+  // Routes live in the tree nodes, so this pools the routes too
+  NetworkToRouteMap() {
+    this->enableNodePool();
+  }
+
   folly::dynamic toFollyDynamic() const {
     folly::dynamic routesJson = folly::dynamic::array;
     for (const auto& route : *this) {
@@ -39,9 +50,9 @@ class NetworkToRouteMap
     return routesObject;
   }
 
-  static std::unique_ptr<NetworkToRouteMap<AddressT>> fromFollyDynamic(
+  static std::unique_ptr<NetworkToRouteMap> fromFollyDynamic(
       const folly::dynamic& routes) {
-    auto networkToRouteMap = std::make_unique<NetworkToRouteMap<AddressT>>();
+    auto networkToRouteMap = std::make_unique<NetworkToRouteMap>();
 
     auto routesJson = routes[kRoutes];
     for (const auto& routeJson : routesJson) {
@@ -0,0 +1,110 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/rib/NextHopDependencyIndex.h"
+
+namespace facebook {
+namespace fboss {
+namespace rib {
+
+void NextHopDependencyIndex::clear() {
+  dependents_.clear();
+  for (auto& unresolved : unresolvedDependents_) {
+    unresolved.clear();
+  }
+  dependencies_.clear();
+  valid_ = false;
+}
+
+const NextHopDependencyIndex::Dependents*
+NextHopDependencyIndex::getDependents(
+    const folly::Optional<folly::CIDRNetwork>& prefix,
+    const folly::IPAddress& addrOfFamily) const {
+  if (!prefix) {
+    return &unresolvedDependents_[addrOfFamily.isV4() ? 0 : 1];
+  }
+  auto it = dependents_.find(*prefix);
+  return it == dependents_.end() ? nullptr : &it->second;
+}
+
+NextHopDependencyIndex::Dependents&
+NextHopDependencyIndex::getWritableDependents(
+    const folly::Optional<folly::CIDRNetwork>& prefix,
+    const folly::IPAddress& addrOfFamily) {
+  if (!prefix) {
+    return unresolvedDependents_[addrOfFamily.isV4() ? 0 : 1];
+  }
+  return dependents_[*prefix];
+}
+
+void NextHopDependencyIndex::addDependency(
+    const folly::CIDRNetwork& dependent,
+    const folly::IPAddress& nexthop,
+    const folly::Optional<folly::CIDRNetwork>& resolvedVia) {
+  getWritableDependents(resolvedVia, nexthop).emplace(nexthop, dependent);
+  dependencies_[dependent].emplace_back(nexthop, resolvedVia);
+}
+
+void NextHopDependencyIndex::removeDependencies(
+    const folly::CIDRNetwork& dependent) {
+  auto it = dependencies_.find(dependent);
+  if (it == dependencies_.end()) {
+    return;
+  }
+  for (const auto& dependency : it->second) {
+    const auto& nexthop = dependency.first;
+    const auto& resolvedVia = dependency.second;
+    auto& dependents = getWritableDependents(resolvedVia, nexthop);
+    auto range = dependents.equal_range(nexthop);
+    for (auto entry = range.first; entry != range.second; ++entry) {
+      if (entry->second == dependent) {
+        dependents.erase(entry);
+        break;
+      }
+    }
+    if (resolvedVia && dependents.empty()) {
+      dependents_.erase(*resolvedVia);
+    }
+  }
+  dependencies_.erase(it);
+}
+
+void NextHopDependencyIndex::forEachDependent(
+    const folly::CIDRNetwork& prefix,
+    const DependentFn& fn) const {
+  auto it = dependents_.find(prefix);
+  if (it == dependents_.end()) {
+    return;
+  }
+  for (const auto& entry : it->second) {
+    fn(entry.second);
+  }
+}
+
+void NextHopDependencyIndex::forEachDependentWithin(
+    const folly::Optional<folly::CIDRNetwork>& prefix,
+    const folly::CIDRNetwork& subnet,
+    const DependentFn& fn) const {
+  auto dependents = getDependents(prefix, subnet.first);
+  if (!dependents) {
+    return;
+  }
+  // Dependents are ordered by next hop, so the ones inside the subnet are
+  // contiguous, starting at the subnet address.
+  for (auto it = dependents->lower_bound(subnet.first);
+       it != dependents->end() &&
+       it->first.inSubnet(subnet.first, subnet.second);
+       ++it) {
+    fn(it->second);
+  }
+}
+
+} // namespace rib
+} // namespace fboss
+} // namespace facebook
@@ -0,0 +1,102 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/IPAddress.h>
+#include <folly/Optional.h>
+
+#include <array>
+#include <functional>
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace facebook {
+namespace fboss {
+namespace rib {
+
+/*
+ * NextHopDependencyIndex records, for every route in a route table, which
+ * route each of its next hops was resolved through. It is the reverse index
+ * RouteUpdater uses to find the routes whose resolution could be affected by
+ * a change, so that an update only re-resolves those instead of the whole
+ * table.
+ *
+ * Routes are identified by prefix rather than by pointer, since routes of
+ * either address family may depend on routes of the other.
+ *
+ * The index is only meaningful as long as every update of the route table
+ * goes through a RouteUpdater that is given the index. It starts out
+ * invalid, which makes the next RouteUpdater resolve the whole table and
+ * build the index from scratch.
+ */
+class NextHopDependencyIndex {
+ public:
+  using DependentFn = std::function<void(const folly::CIDRNetwork&)>;
+
+  bool isValid() const {
+    return valid_;
+  }
+  void setValid() {
+    valid_ = true;
+  }
+  void clear();
+
+  /*
+   * Record that the route for dependent resolved nexthop through the route
+   * for resolvedVia, or could not find a route for it if resolvedVia is
+   * folly::none.
+   */
+  void addDependency(
+      const folly::CIDRNetwork& dependent,
+      const folly::IPAddress& nexthop,
+      const folly::Optional<folly::CIDRNetwork>& resolvedVia);
+  // Forget all the dependencies recorded for dependent
+  void removeDependencies(const folly::CIDRNetwork& dependent);
+
+  // Invoke fn for every route that resolved a next hop through prefix
+  void forEachDependent(const folly::CIDRNetwork& prefix, const DependentFn& fn)
+      const;
+  /*
+   * Invoke fn for every route with a next hop inside subnet that resolved it
+   * through the route for prefix, or through no route if prefix is
+   * folly::none.
+   */
+  void forEachDependentWithin(
+      const folly::Optional<folly::CIDRNetwork>& prefix,
+      const folly::CIDRNetwork& subnet,
+      const DependentFn& fn) const;
+
+ private:
+  // next hop -> route that resolved the next hop
+  using Dependents = std::multimap<folly::IPAddress, folly::CIDRNetwork>;
+
+  const Dependents* getDependents(
+      const folly::Optional<folly::CIDRNetwork>& prefix,
+      const folly::IPAddress& addrOfFamily) const;
+  Dependents& getWritableDependents(
+      const folly::Optional<folly::CIDRNetwork>& prefix,
+      const folly::IPAddress& addrOfFamily);
+
+  std::map<folly::CIDRNetwork, Dependents> dependents_;
+  // Next hops no route was found for, one set per address family so that
+  // each stays ordered by address
+  std::array<Dependents, 2> unresolvedDependents_;
+  std::map<
+      folly::CIDRNetwork,
+      std::vector<
+          std::pair<folly::IPAddress, folly::Optional<folly::CIDRNetwork>>>>
+      dependencies_;
+  bool valid_{false};
+};
+
+} // namespace rib
+} // namespace fboss
+} // namespace facebook
@@ -38,10 +38,44 @@ static const PrefixV6 kIPv6LinkLocalPrefix{folly::IPAddressV6("fe80::"), 64};
 static const auto kInterfaceRouteClientId =
     StdClientIds2ClientID(StdClientIds::INTERFACE_ROUTE);
 
+template <typename AddressT>
+static CIDRNetwork toCIDRNetwork(const RoutePrefix<AddressT>& prefix) {
+  return CIDRNetwork(IPAddress(prefix.network), prefix.mask);
+}
+
 RouteUpdater::RouteUpdater(
     IPv4NetworkToRouteMap* v4Routes,
-    IPv6NetworkToRouteMap* v6Routes)
-    : v4Routes_(v4Routes), v6Routes_(v6Routes) {}
+    IPv6NetworkToRouteMap* v6Routes,
+    NextHopDependencyIndex* nextHopDependencies)
+    : v4Routes_(v4Routes),
+      v6Routes_(v6Routes),
+      nextHopDependencies_(nextHopDependencies) {}
+
+template <typename AddressT>
+void RouteUpdater::recordChange(const Prefix<AddressT>& prefix, bool added) {
+  if (!nextHopDependencies_) {
+    return;
+  }
+  auto cidr = toCIDRNetwork(prefix);
+  changedPrefixes_.push_back(cidr);
+  if (added) {
+    addedPrefixes_.insert(cidr);
+  }
+}
+
+template <typename AddressT>
+void RouteUpdater::recordPreviousEntry(
+    const Prefix<AddressT>& prefix,
+    ClientID clientID,
+    const RouteNextHopEntry* entry) {
+  auto key = std::make_pair(toCIDRNetwork(prefix), clientID);
+  if (previousEntries_.find(key) != previousEntries_.end()) {
+    return;
+  }
+  previousEntries_.emplace(
+      std::move(key),
+      entry ? folly::Optional<RouteNextHopEntry>(*entry) : folly::none);
+}
 
 template <typename AddressT>
 void RouteUpdater::addRouteImpl(
@@ -57,13 +91,17 @@ void RouteUpdater::addRouteImpl(
       return;
     }
 
+    recordPreviousEntry(prefix, clientID, route->getEntryForClient(clientID));
     route->update(clientID, entry);
+    recordChange(prefix, false);
     return;
   }
 
   CHECK(it == routes->end());
+  recordPreviousEntry(prefix, clientID, nullptr);
   routes->insert(
       prefix.network, prefix.mask, Route<AddressT>(prefix, clientID, entry));
+  recordChange(prefix, true);
 }
 
 void RouteUpdater::addRoute(
@@ -130,7 +168,9 @@ void RouteUpdater::delRouteImpl(
   }
 
   Route<AddressT>& route = it->value();
+  recordPreviousEntry(prefix, clientID, route.getEntryForClient(clientID));
   route.delEntryForClient(clientID);
+  recordChange(prefix, false);
 
   XLOG(DBG3) << "Deleted next-hops for prefix " << prefix.str()
              << "from client " << clientID;
@@ -158,11 +198,20 @@ void RouteUpdater::delRoute(
 template <typename AddressT>
 void RouteUpdater::removeAllRoutesFromClientImpl(
     NetworkToRouteMap<AddressT>* routes,
-    ClientID clientID) {
+    ClientID clientID,
+    const std::set<CIDRNetwork>* keep) {
   std::vector<typename NetworkToRouteMap<AddressT>::Iterator> toDelete;
 
   for (auto it : *routes) {
     Route<AddressT>& route = it->value();
+    if (keep && keep->count(toCIDRNetwork(route.prefix()))) {
+      continue;
+    }
+    auto entry = route.getEntryForClient(clientID);
+    if (entry) {
+      recordPreviousEntry(route.prefix(), clientID, entry);
+      recordChange(route.prefix(), false);
+    }
     route.delEntryForClient(clientID);
     if (route.hasNoEntry()) {
       // The nexthops we removed was the only one.  Delete the route.
@@ -181,6 +230,13 @@ void RouteUpdater::removeAllRoutesForClient(ClientID clientID) {
   removeAllRoutesFromClientImpl<IPAddressV6>(v6Routes_, clientID);
 }
 
+void RouteUpdater::removeRoutesForClientExcept(
+    ClientID clientID,
+    const std::set<CIDRNetwork>& keep) {
+  removeAllRoutesFromClientImpl<IPAddressV4>(v4Routes_, clientID, &keep);
+  removeAllRoutesFromClientImpl<IPAddressV6>(v6Routes_, clientID, &keep);
+}
+
 // Some helper functions for recursive weight resolution
 // These aren't really usefully reusable, but structuring them
 // this way helps with clarifying their meaning.
@@ -369,21 +425,30 @@ RouteNextHopSet mergeForwardInfos(
 }
 } // anonymous namespace
 
-template <typename AddressT>
+template <typename AddressT, typename NextHopAddressT>
 void RouteUpdater::getFwdInfoFromNhop(
-    NetworkToRouteMap<AddressT>* routes,
-    const AddressT& nh,
+    const Route<AddressT>& dependent,
+    NetworkToRouteMap<NextHopAddressT>* routes,
+    const NextHopAddressT& nh,
     bool* hasToCpu,
     bool* hasDrop,
     RouteNextHopSet& fwd) {
   auto it = routes->longestMatch(nh, nh.bitCount());
+  if (nextHopDependencies_) {
+    folly::Optional<CIDRNetwork> resolvedVia;
+    if (it != routes->end()) {
+      resolvedVia = toCIDRNetwork(it->value().prefix());
+    }
+    nextHopDependencies_->addDependency(
+        toCIDRNetwork(dependent.prefix()), IPAddress(nh), resolvedVia);
+  }
   if (it == routes->end()) {
     XLOG(DBG3) << "Could not find subnet for next-hop:  " << nh;
     // Unresolvable next hop
     return;
   }
 
-  Route<AddressT>* route = &(it->value());
+  Route<NextHopAddressT>* route = &(it->value());
   CHECK(route);
 
   if (route->needResolve()) {
@@ -450,11 +515,21 @@ void RouteUpdater::resolveOne(Route<AddressT>* route) {
 
       if (addr.isV4()) {
         getFwdInfoFromNhop(
-            v4Routes_, nh.addr().asV4(), &hasToCpu, &hasDrop, nhToFwds[nh]);
+            *route,
+            v4Routes_,
+            nh.addr().asV4(),
+            &hasToCpu,
+            &hasDrop,
+            nhToFwds[nh]);
       } else {
         CHECK(addr.isV6());
         getFwdInfoFromNhop(
-            v6Routes_, nh.addr().asV6(), &hasToCpu, &hasDrop, nhToFwds[nh]);
+            *route,
+            v6Routes_,
+            nh.addr().asV6(),
+            &hasToCpu,
+            &hasDrop,
+            nhToFwds[nh]);
       }
     }
 
@@ -500,9 +575,186 @@ void RouteUpdater::updateDoneImpl(NetworkToRouteMap<AddressT>* routes) {
   resolve(routes);
 }
 
+template <typename AddressT>
+Route<AddressT>* RouteUpdater::getRouteIf(
+    NetworkToRouteMap<AddressT>* routes,
+    const AddressT& network,
+    uint8_t mask) const {
+  auto it = routes->exactMatch(network, mask);
+  return it == routes->end() ? nullptr : &(it->value());
+}
+
+template <typename AddressT>
+folly::Optional<CIDRNetwork> RouteUpdater::getPreexistingParent(
+    NetworkToRouteMap<AddressT>* routes,
+    const Prefix<AddressT>& prefix) const {
+  auto mask = prefix.mask;
+  while (mask > 0) {
+    auto it = routes->longestMatch(prefix.network.mask(mask - 1), mask - 1);
+    if (it == routes->end()) {
+      break;
+    }
+    const auto& parent = it->value().prefix();
+    auto cidr = toCIDRNetwork(parent);
+    if (addedPrefixes_.find(cidr) == addedPrefixes_.end()) {
+      return cidr;
+    }
+    mask = parent.mask;
+  }
+  return folly::none;
+}
+
+std::set<CIDRNetwork> RouteUpdater::getAffectedPrefixes() const {
+  std::set<CIDRNetwork> affected;
+  std::vector<CIDRNetwork> toVisit;
+  auto markAffected = [&](const CIDRNetwork& prefix) {
+    if (affected.insert(prefix).second) {
+      toVisit.push_back(prefix);
+    }
+  };
+
+  for (const auto& prefix : changedPrefixes_) {
+    markAffected(prefix);
+    if (addedPrefixes_.find(prefix) == addedPrefixes_.end()) {
+      continue;
+    }
+    // Next hops inside a new prefix, that were resolved through a less
+    // specific route or could not be resolved at all, now resolve through
+    // the new route instead.
+    folly::Optional<CIDRNetwork> parent;
+    if (prefix.first.isV4()) {
+      PrefixV4 added{prefix.first.asV4(), prefix.second};
+      if (!getRouteIf(v4Routes_, added.network, added.mask)) {
+        continue;
+      }
+      parent = getPreexistingParent(v4Routes_, added);
+    } else {
+      PrefixV6 added{prefix.first.asV6(), prefix.second};
+      if (!getRouteIf(v6Routes_, added.network, added.mask)) {
+        continue;
+      }
+      parent = getPreexistingParent(v6Routes_, added);
+    }
+    nextHopDependencies_->forEachDependentWithin(parent, prefix, markAffected);
+  }
+
+  // Routes resolved through an affected route are affected in turn
+  while (!toVisit.empty()) {
+    auto prefix = toVisit.back();
+    toVisit.pop_back();
+    nextHopDependencies_->forEachDependent(prefix, markAffected);
+  }
+  return affected;
+}
+
+void RouteUpdater::updateDoneIncremental() {
+  auto affected = getAffectedPrefixes();
+  XLOG(DBG3) << "Re-resolving " << affected.size() << " affected routes";
+
+  // Clear all affected routes before resolving any of them, since resolving
+  // one may recursively resolve others.
+  for (const auto& prefix : affected) {
+    nextHopDependencies_->removeDependencies(prefix);
+    if (prefix.first.isV4()) {
+      auto route = getRouteIf(v4Routes_, prefix.first.asV4(), prefix.second);
+      if (route) {
+        route->clearForward();
+      }
+    } else {
+      auto route = getRouteIf(v6Routes_, prefix.first.asV6(), prefix.second);
+      if (route) {
+        route->clearForward();
+      }
+    }
+  }
+  for (const auto& prefix : affected) {
+    if (prefix.first.isV4()) {
+      auto route = getRouteIf(v4Routes_, prefix.first.asV4(), prefix.second);
+      if (route && route->needResolve()) {
+        resolveOne(route);
+      }
+    } else {
+      auto route = getRouteIf(v6Routes_, prefix.first.asV6(), prefix.second);
+      if (route && route->needResolve()) {
+        resolveOne(route);
+      }
+    }
+  }
+  resolvedPrefixes_ = std::move(affected);
+}
+
+RouteUpdater::UndoLog RouteUpdater::getUndoLog() const {
+  UndoLog undoLog;
+  undoLog.reserve(previousEntries_.size());
+  for (const auto& previous : previousEntries_) {
+    const auto& prefix = previous.first.first;
+    auto clientID = previous.first.second;
+    const RouteNextHopEntry* after = nullptr;
+    if (prefix.first.isV4()) {
+      auto route = getRouteIf(v4Routes_, prefix.first.asV4(), prefix.second);
+      after = route ? route->getEntryForClient(clientID) : nullptr;
+    } else {
+      auto route = getRouteIf(v6Routes_, prefix.first.asV6(), prefix.second);
+      after = route ? route->getEntryForClient(clientID) : nullptr;
+    }
+    undoLog.push_back(UndoEntry{
+        prefix,
+        clientID,
+        previous.second,
+        after ? folly::Optional<RouteNextHopEntry>(*after) : folly::none});
+  }
+  return undoLog;
+}
+
+template <typename AddressT>
+void RouteUpdater::undoImpl(
+    const Prefix<AddressT>& prefix,
+    NetworkToRouteMap<AddressT>* routes,
+    const UndoEntry& undoEntry) {
+  auto route = getRouteIf(routes, prefix.network, prefix.mask);
+  auto current = route ? route->getEntryForClient(undoEntry.clientID) : nullptr;
+  bool unchanged = current ? undoEntry.after && *current == *undoEntry.after
+                           : !undoEntry.after;
+  if (!unchanged) {
+    XLOG(DBG2) << "Not undoing the entry of client " << undoEntry.clientID
+               << " for " << prefix.str() << ", it changed again since";
+    return;
+  }
+  if (undoEntry.before) {
+    addRouteImpl(prefix, routes, undoEntry.clientID, *undoEntry.before);
+  } else if (current) {
+    delRouteImpl(prefix, routes, undoEntry.clientID);
+  }
+}
+
+void RouteUpdater::undo(const UndoLog& undoLog) {
+  for (const auto& undoEntry : undoLog) {
+    const auto& prefix = undoEntry.prefix;
+    if (prefix.first.isV4()) {
+      undoImpl(
+          PrefixV4{prefix.first.asV4(), prefix.second}, v4Routes_, undoEntry);
+    } else {
+      undoImpl(
+          PrefixV6{prefix.first.asV6(), prefix.second}, v6Routes_, undoEntry);
+    }
+  }
+}
+
 void RouteUpdater::updateDone() {
+  resolvedPrefixes_ = folly::none;
+  if (nextHopDependencies_ && nextHopDependencies_->isValid()) {
+    updateDoneIncremental();
+    return;
+  }
+  if (nextHopDependencies_) {
+    // Rebuilt from scratch while resolving the whole table below
+    nextHopDependencies_->clear();
+  }
   updateDoneImpl(v4Routes_);
   updateDoneImpl(v6Routes_);
+  if (nextHopDependencies_) {
+    nextHopDependencies_->setValid();
+  }
 }
 
 } // namespace rib
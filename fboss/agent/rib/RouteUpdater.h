@@ -13,12 +13,19 @@
 #include "fboss/agent/types.h"
 
 #include "fboss/agent/rib/NetworkToRouteMap.h"
+#include "fboss/agent/rib/NextHopDependencyIndex.h"
 #include "fboss/agent/rib/Route.h"
 #include "fboss/agent/rib/RouteNextHopEntry.h"
 #include "fboss/agent/rib/RouteNextHopsMulti.h"
 #include "fboss/agent/rib/RouteTypes.h"
 
 #include <folly/IPAddress.h>
+#include <folly/Optional.h>
+
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
 
 namespace facebook {
 namespace fboss {
@@ -47,12 +54,18 @@ namespace rib {
  *    only IP nexthops will be in the final ECMP group.
  * 5. If and only if TO_CPU is the only nexthop (directly or indirectly) of
  *    a route, TO_CPU action will be only path in the resolved ECMP group.
+ *
+ * Without a NextHopDependencyIndex, updateDone() re-resolves every route in
+ * the table. Given one, it only re-resolves the routes that were changed
+ * and the routes whose next hops could resolve differently because of those
+ * changes, transitively, and keeps the index up to date for the next update.
  */
 class RouteUpdater {
  public:
   RouteUpdater(
       IPv4NetworkToRouteMap* v4Routes,
-      IPv6NetworkToRouteMap* v6Routes);
+      IPv6NetworkToRouteMap* v6Routes,
+      NextHopDependencyIndex* nextHopDependencies = nullptr);
 
   void addRoute(
       const folly::IPAddress& network,
@@ -71,12 +84,66 @@ class RouteUpdater {
   delRoute(const folly::IPAddress& network, uint8_t mask, ClientID clientID);
   void delLinkLocalRoutes();
   void removeAllRoutesForClient(ClientID clientID);
+  /*
+   * Remove the routes of the client except those of the given prefixes.
+   * Adding the kept routes back afterwards only changes the ones whose
+   * next hops differ, so a client's routes can be replaced without
+   * touching the ones that stay the same.
+   */
+  void removeRoutesForClientExcept(
+      ClientID clientID,
+      const std::set<folly::CIDRNetwork>& keep);
 
   void updateDone();
 
+  /*
+   * The prefixes whose routes updateDone() added, removed, modified or
+   * re-resolved, or folly::none if it re-resolved the whole table.
+   */
+  const folly::Optional<std::set<folly::CIDRNetwork>>& getResolvedPrefixes()
+      const {
+    return resolvedPrefixes_;
+  }
+
+  /*
+   * For each prefix and client whose entry an update changed, the entry the
+   * client had before the update and the one it has after, if any.
+   */
+  struct UndoEntry {
+    folly::CIDRNetwork prefix;
+    ClientID clientID;
+    folly::Optional<RouteNextHopEntry> before;
+    folly::Optional<RouteNextHopEntry> after;
+  };
+  using UndoLog = std::vector<UndoEntry>;
+
+  /*
+   * What it takes to undo the changes made so far, e.g. when they could not
+   * be programmed.
+   */
+  UndoLog getUndoLog() const;
+
+  /*
+   * Give back every client the entry it had before the update undoLog was
+   * taken from, except where the entry has changed again since. Like any
+   * other change, this takes effect on updateDone().
+   */
+  void undo(const UndoLog& undoLog);
+
  private:
   IPv4NetworkToRouteMap* v4Routes_{nullptr};
   IPv6NetworkToRouteMap* v6Routes_{nullptr};
+  NextHopDependencyIndex* nextHopDependencies_{nullptr};
+
+  // Prefixes changed by this update, and the subset that were newly added
+  std::vector<folly::CIDRNetwork> changedPrefixes_;
+  std::set<folly::CIDRNetwork> addedPrefixes_;
+  folly::Optional<std::set<folly::CIDRNetwork>> resolvedPrefixes_;
+  // The entry each client had before its first change in this update
+  std::map<
+      std::pair<folly::CIDRNetwork, ClientID>,
+      folly::Optional<RouteNextHopEntry>>
+      previousEntries_;
 
   // TODO(samank): rename in original file
   template <typename AddressT>
@@ -97,19 +164,46 @@ class RouteUpdater {
   template <typename AddressT>
   void removeAllRoutesFromClientImpl(
       NetworkToRouteMap<AddressT>* routes,
-      ClientID clientID);
+      ClientID clientID,
+      const std::set<folly::CIDRNetwork>* keep = nullptr);
   template <typename AddressT>
   void updateDoneImpl(NetworkToRouteMap<AddressT>* routes);
+  template <typename AddressT>
+  void recordChange(const Prefix<AddressT>& prefix, bool added);
+  template <typename AddressT>
+  void recordPreviousEntry(
+      const Prefix<AddressT>& prefix,
+      ClientID clientID,
+      const RouteNextHopEntry* entry);
+  template <typename AddressT>
+  void undoImpl(
+      const Prefix<AddressT>& prefix,
+      NetworkToRouteMap<AddressT>* routes,
+      const UndoEntry& undoEntry);
+
+  // Incremental counterpart of updateDoneImpl(), using nextHopDependencies_
+  void updateDoneIncremental();
+  std::set<folly::CIDRNetwork> getAffectedPrefixes() const;
+  template <typename AddressT>
+  folly::Optional<folly::CIDRNetwork> getPreexistingParent(
+      NetworkToRouteMap<AddressT>* routes,
+      const Prefix<AddressT>& prefix) const;
+  template <typename AddressT>
+  Route<AddressT>* getRouteIf(
+      NetworkToRouteMap<AddressT>* routes,
+      const AddressT& network,
+      uint8_t mask) const;
 
   template <typename AddressT>
   void resolve(NetworkToRouteMap<AddressT>* routes);
   template <typename AddressT>
   void resolveOne(Route<AddressT>* route);
 
-  template <typename AddressT>
+  template <typename AddressT, typename NextHopAddressT>
   void getFwdInfoFromNhop(
-      NetworkToRouteMap<AddressT>* routes,
-      const AddressT& nh,
+      const Route<AddressT>& dependent,
+      NetworkToRouteMap<NextHopAddressT>* routes,
+      const NextHopAddressT& nh,
       bool* hasToCpu,
       bool* hasDrop,
       RouteNextHopSet& fwd);
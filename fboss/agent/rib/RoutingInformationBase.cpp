@@ -11,59 +11,306 @@
 #include "fboss/agent/rib/RouteNextHopEntry.h"
 #include "fboss/agent/rib/RouteUpdater.h"
 
+#include <folly/ExceptionString.h>
+#include <folly/ScopeGuard.h>
+#include <folly/logging/xlog.h>
+
+#include <exception>
+#include <set>
+#include <tuple>
 #include <utility>
+#include <vector>
 
 #include "fboss/agent/AddressUtil.h"
+#include "fboss/agent/Utils.h"
 
 namespace facebook {
 namespace fboss {
 namespace rib {
 
+RoutingInformationBase::RouteTable&
+RoutingInformationBase::getOrCreateRouteTable(
+    RouterIDToRouteTable* routeTables,
+    RouterID routerID) {
+  auto it = routeTables->find(routerID);
+  if (it == routeTables->end()) {
+    // We can be more strict about admitting VRFs by taking the set of valid
+    // VRFs on construction, and checking routerID belongs to that set here.
+    bool inserted = false;
+    std::tie(it, inserted) = routeTables->emplace(routerID, RouteTable());
+    CHECK(inserted);
+  }
+  return it->second;
+}
+
 void RoutingInformationBase::update(
     RouterID routerID,
     ClientID clientID,
     AdminDistance adminDistanceFromClientID,
     const std::vector<UnicastRoute>& toAdd,
     const std::vector<IpPrefix>& toDelete,
-    bool resetClientsRoutes) {
-  auto lockedRouteTables = synchronizedRouteTables_.wlock();
+    bool resetClientsRoutes,
+    const FibUpdateFunction& fibUpdateCallback) {
+  std::vector<FibChanges> changes;
+  UndoLogs undoLogs;
+  uint64_t ticket;
+  {
+    auto lockedRouteTables = synchronizedRouteTables_.wlock();
+    auto& routeTable = getOrCreateRouteTable(&(*lockedRouteTables), routerID);
 
-  auto it = lockedRouteTables->find(routerID);
-  if (it == lockedRouteTables->end()) {
-    // We can be more strict about admitting VRFs by taking the set of valid
-    // VRFs on construction, and checking routerID belongs to that set here.
-    bool inserted = false;
-    std::tie(it, inserted) = lockedRouteTables->emplace(routerID, RouteTable());
-    CHECK(inserted);
+    RouteUpdater updater(
+        &routeTable.v4NetworkToRoute,
+        &routeTable.v6NetworkToRoute,
+        &routeTable.nextHopDependencies);
+
+    if (resetClientsRoutes) {
+      updater.removeAllRoutesForClient(clientID);
+    }
+
+    for (const auto& route : toAdd) {
+      auto network = facebook::network::toIPAddress(route.dest.ip);
+      auto mask = static_cast<uint8_t>(route.dest.prefixLength);
+
+      updater.addRoute(
+          network,
+          mask,
+          clientID,
+          RouteNextHopEntry::from(route, adminDistanceFromClientID));
+    }
+
+    for (const auto& prefix : toDelete) {
+      auto network = facebook::network::toIPAddress(prefix.ip);
+      auto mask = static_cast<uint8_t>(prefix.prefixLength);
+
+      updater.delRoute(network, mask, clientID);
+    }
+
+    updater.updateDone();
+
+    changes.push_back(getFibChanges(
+        routerID,
+        routeTable.v4NetworkToRoute,
+        routeTable.v6NetworkToRoute,
+        updater.getResolvedPrefixes()));
+    undoLogs.emplace_back(routerID, updater.getUndoLog());
+    ticket = nextTicket_++;
   }
+  publishOrUndo(ticket, changes, undoLogs, fibUpdateCallback);
+}
 
-  RouteUpdater updater(
-      &(it->second.v4NetworkToRoute),
-      &(it->second.v6NetworkToRoute));
+void RoutingInformationBase::reconfigure(
+    const RouterIDToInterfaceRoutes& interfaceRoutes,
+    const std::vector<cfg::StaticRouteWithNextHops>& staticRoutesWithNhops,
+    const std::vector<cfg::StaticRouteNoNextHops>& staticRoutesToNull,
+    const std::vector<cfg::StaticRouteNoNextHops>& staticRoutesToCPU,
+    const FibUpdateFunction& fibUpdateCallback) {
+  std::vector<FibChanges> changes;
+  UndoLogs undoLogs;
+  uint64_t ticket;
+  {
+    auto lockedRouteTables = synchronizedRouteTables_.wlock();
+    reconfigureLocked(
+        &(*lockedRouteTables),
+        interfaceRoutes,
+        staticRoutesWithNhops,
+        staticRoutesToNull,
+        staticRoutesToCPU,
+        &changes,
+        &undoLogs);
+    ticket = nextTicket_++;
+  }
+  publishOrUndo(ticket, changes, undoLogs, fibUpdateCallback);
+}
 
-  if (resetClientsRoutes) {
-    updater.removeAllRoutesForClient(clientID);
+void RoutingInformationBase::reconfigureLocked(
+    RouterIDToRouteTable* routeTables,
+    const RouterIDToInterfaceRoutes& interfaceRoutes,
+    const std::vector<cfg::StaticRouteWithNextHops>& staticRoutesWithNhops,
+    const std::vector<cfg::StaticRouteNoNextHops>& staticRoutesToNull,
+    const std::vector<cfg::StaticRouteNoNextHops>& staticRoutesToCPU,
+    std::vector<FibChanges>* changes,
+    UndoLogs* undoLogs) {
+  for (const auto& vrfAndRoutes : interfaceRoutes) {
+    getOrCreateRouteTable(routeTables, vrfAndRoutes.first);
+  }
+  auto addVrf = [&](int32_t routerID) {
+    getOrCreateRouteTable(routeTables, RouterID(routerID));
+  };
+  for (const auto& route : staticRoutesWithNhops) {
+    addVrf(route.routerID);
   }
+  for (const auto& route : staticRoutesToNull) {
+    addVrf(route.routerID);
+  }
+  for (const auto& route : staticRoutesToCPU) {
+    addVrf(route.routerID);
+  }
+
+  auto interfaceClientID = StdClientIds2ClientID(StdClientIds::INTERFACE_ROUTE);
+  auto staticClientID = StdClientIds2ClientID(StdClientIds::STATIC_ROUTE);
+  auto staticAdminDistance = AdminDistance::STATIC_ROUTE;
+
+  for (auto& vrfAndRouteTable : *routeTables) {
+    auto routerID = vrfAndRouteTable.first;
+    auto& routeTable = vrfAndRouteTable.second;
 
-  for (const auto& route : toAdd) {
-    auto network = facebook::network::toIPAddress(route.dest.ip);
-    auto mask = static_cast<uint8_t>(route.dest.prefixLength);
+    RouteUpdater updater(
+        &routeTable.v4NetworkToRoute,
+        &routeTable.v6NetworkToRoute,
+        &routeTable.nextHopDependencies);
 
-    updater.addRoute(
-        network,
-        mask,
-        clientID,
-        RouteNextHopEntry::from(route, adminDistanceFromClientID));
+    // Only the interface and static routes the config dropped are removed.
+    // The others are added back, which is a no-op for those whose next hops
+    // did not change, so reapplying an unchanged config changes nothing.
+    std::set<folly::CIDRNetwork> interfaceNetworks;
+    auto vrfInterfaceRoutes = interfaceRoutes.find(routerID);
+    if (vrfInterfaceRoutes != interfaceRoutes.end()) {
+      for (const auto& entry : vrfInterfaceRoutes->second) {
+        const auto& network = entry.first;
+        interfaceNetworks.emplace(
+            network.first.mask(network.second), network.second);
+      }
+    }
+    updater.removeRoutesForClientExcept(interfaceClientID, interfaceNetworks);
+    if (vrfInterfaceRoutes != interfaceRoutes.end()) {
+      for (const auto& entry : vrfInterfaceRoutes->second) {
+        const auto& network = entry.first;
+        const auto& interfaceAndAddress = entry.second;
+        updater.addInterfaceRoute(
+            network.first,
+            network.second,
+            interfaceAndAddress.second,
+            interfaceAndAddress.first);
+      }
+      updater.addLinkLocalRoutes();
+    } else {
+      updater.delLinkLocalRoutes();
+    }
+
+    std::vector<std::pair<folly::CIDRNetwork, RouteNextHopEntry>> staticRoutes;
+    for (const auto& route : staticRoutesToNull) {
+      if (RouterID(route.routerID) != routerID) {
+        continue;
+      }
+      staticRoutes.emplace_back(
+          folly::IPAddress::createNetwork(route.prefix),
+          RouteNextHopEntry(RouteForwardAction::DROP, staticAdminDistance));
+    }
+    for (const auto& route : staticRoutesToCPU) {
+      if (RouterID(route.routerID) != routerID) {
+        continue;
+      }
+      staticRoutes.emplace_back(
+          folly::IPAddress::createNetwork(route.prefix),
+          RouteNextHopEntry(RouteForwardAction::TO_CPU, staticAdminDistance));
+    }
+    for (const auto& route : staticRoutesWithNhops) {
+      if (RouterID(route.routerID) != routerID) {
+        continue;
+      }
+      RouteNextHopSet nhops;
+      // Static routes use the default UCMP weight, see syncStaticRoutes() in
+      // ApplyThriftConfig.cpp
+      for (const auto& nhopStr : route.nexthops) {
+        nhops.emplace(
+            UnresolvedNextHop(folly::IPAddress(nhopStr), UCMP_DEFAULT_WEIGHT));
+      }
+      staticRoutes.emplace_back(
+          folly::IPAddress::createNetwork(route.prefix),
+          RouteNextHopEntry(std::move(nhops), staticAdminDistance));
+    }
+    std::set<folly::CIDRNetwork> staticNetworks;
+    for (const auto& route : staticRoutes) {
+      staticNetworks.insert(route.first);
+    }
+    updater.removeRoutesForClientExcept(staticClientID, staticNetworks);
+    for (auto& route : staticRoutes) {
+      updater.addRoute(
+          route.first.first,
+          route.first.second,
+          staticClientID,
+          std::move(route.second));
+    }
+
+    updater.updateDone();
+
+    changes->push_back(getFibChanges(
+        routerID,
+        routeTable.v4NetworkToRoute,
+        routeTable.v6NetworkToRoute,
+        updater.getResolvedPrefixes()));
+    undoLogs->emplace_back(routerID, updater.getUndoLog());
   }
+}
 
-  for (const auto& prefix : toDelete) {
-    auto network = facebook::network::toIPAddress(prefix.ip);
-    auto mask = static_cast<uint8_t>(prefix.prefixLength);
+void RoutingInformationBase::publishFibChanges(
+    uint64_t ticket,
+    const std::vector<FibChanges>& changes,
+    const FibUpdateFunction& fibUpdateCallback) {
+  {
+    std::unique_lock<std::mutex> guard(publishMutex_);
+    publishCondition_.wait(
+        guard, [&]() { return nextPublishTicket_ == ticket; });
+  }
+  // Let the next update publish even if this one throws
+  SCOPE_EXIT {
+    {
+      std::lock_guard<std::mutex> guard(publishMutex_);
+      ++nextPublishTicket_;
+    }
+    publishCondition_.notify_all();
+  };
+  for (const auto& vrfChanges : changes) {
+    fibUpdateCallback(vrfChanges);
+  }
+}
 
-    updater.delRoute(network, mask, clientID);
+void RoutingInformationBase::publishOrUndo(
+    uint64_t ticket,
+    const std::vector<FibChanges>& changes,
+    const UndoLogs& undoLogs,
+    const FibUpdateFunction& fibUpdateCallback) {
+  std::exception_ptr error;
+  try {
+    publishFibChanges(ticket, changes, fibUpdateCallback);
+    return;
+  } catch (const std::exception& ex) {
+    XLOG(ERR) << "Failed to publish route changes, undoing them: "
+              << folly::exceptionStr(ex);
+    error = std::current_exception();
   }
 
-  updater.updateDone();
+  // The undo goes through the RIB like any other update, so it is published
+  // after every update applied before it
+  std::vector<FibChanges> undoChanges;
+  uint64_t undoTicket;
+  {
+    auto lockedRouteTables = synchronizedRouteTables_.wlock();
+    for (const auto& vrfAndUndoLog : undoLogs) {
+      auto routerID = vrfAndUndoLog.first;
+      auto& routeTable = getOrCreateRouteTable(&(*lockedRouteTables), routerID);
+      RouteUpdater updater(
+          &routeTable.v4NetworkToRoute,
+          &routeTable.v6NetworkToRoute,
+          &routeTable.nextHopDependencies);
+      updater.undo(vrfAndUndoLog.second);
+      updater.updateDone();
+      undoChanges.push_back(getFibChanges(
+          routerID,
+          routeTable.v4NetworkToRoute,
+          routeTable.v6NetworkToRoute,
+          updater.getResolvedPrefixes()));
+    }
+    undoTicket = nextTicket_++;
+  }
+  try {
+    publishFibChanges(undoTicket, undoChanges, fibUpdateCallback);
+  } catch (const std::exception& ex) {
+    XLOG(ERR) << "Failed to publish the undoing of route changes, the RIB "
+              << "and the FIB disagree until the routes are updated again: "
+              << folly::exceptionStr(ex);
+  }
+  std::rethrow_exception(error);
 }
 
 } // namespace rib
@@ -11,20 +11,56 @@
 
 #include "fboss/agent/types.h"
 
+#include <boost/container/flat_map.hpp>
+#include <folly/IPAddress.h>
 #include <folly/Synchronized.h>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
 #include <thread>
+#include <utility>
 #include <vector>
 
+#include "fboss/agent/rib/ForwardingInformationBaseUpdater.h"
 #include "fboss/agent/rib/NetworkToRouteMap.h"
+#include "fboss/agent/rib/NextHopDependencyIndex.h"
+#include "fboss/agent/rib/RouteUpdater.h"
 
+#include "fboss/agent/gen-cpp2/switch_config_types.h"
 #include "fboss/agent/if/gen-cpp2/FbossCtrl.h"
 
 namespace facebook {
 namespace fboss {
 namespace rib {
 
+/*
+ * RoutingInformationBase holds the routes of every VRF outside of the
+ * copy-on-write SwitchState, so that route updates modify the route tables in
+ * place rather than cloning them.
+ *
+ * After each update of a VRF, the FibUpdateFunction passed to the update is
+ * invoked with the FibChanges of that VRF, for the caller to publish them
+ * (see ForwardingInformationBaseUpdater). The changes are gathered with the
+ * RIB lock held, but the function is called once it is released, so
+ * publishing does not hold up other RIB updates. Calls are still made in the
+ * order the updates were applied to the RIB, one at a time.
+ *
+ * The function throws if it could not publish the changes in full, e.g.
+ * because the hardware ran out of room for some routes. The update is then
+ * undone, its undoing published in turn so that the RIB and the FIB agree,
+ * and the exception passed on to the caller.
+ */
 class RoutingInformationBase {
  public:
+  using FibUpdateFunction = std::function<void(const FibChanges& changes)>;
+
+  // network -> (interface, interface address), per VRF
+  using InterfaceRoutes = boost::container::flat_map<
+      folly::CIDRNetwork,
+      std::pair<InterfaceID, folly::IPAddress>>;
+  using RouterIDToInterfaceRoutes =
+      boost::container::flat_map<RouterID, InterfaceRoutes>;
+
   // If a UnicastRoute does not specify its admin distance, then we derive its
   // admin distance via its clientID.  This is accomplished by a mapping from
   // client IDs to admin distances provided in configuration. Unfortunately,
@@ -37,7 +73,20 @@ class RoutingInformationBase {
       AdminDistance adminDistanceFromClientID,
       const std::vector<UnicastRoute>& toAdd,
       const std::vector<IpPrefix>& toDelete,
-      bool resetClientsRoutes = false);
+      bool resetClientsRoutes,
+      const FibUpdateFunction& fibUpdateCallback);
+
+  /*
+   * Replace the interface and static routes of every VRF with the ones given,
+   * which come from configuration. VRFs without interface routes lose their
+   * link-local route.
+   */
+  void reconfigure(
+      const RouterIDToInterfaceRoutes& interfaceRoutes,
+      const std::vector<cfg::StaticRouteWithNextHops>& staticRoutesWithNhops,
+      const std::vector<cfg::StaticRouteNoNextHops>& staticRoutesToNull,
+      const std::vector<cfg::StaticRouteNoNextHops>& staticRoutesToCPU,
+      const FibUpdateFunction& fibUpdateCallback);
 
  private:
   struct RouteTable {
@@ -45,6 +94,8 @@ class RoutingInformationBase {
 
     IPv4NetworkToRouteMap v4NetworkToRoute;
     IPv6NetworkToRouteMap v6NetworkToRoute;
+    // Lets updates re-resolve only the routes they can affect
+    NextHopDependencyIndex nextHopDependencies;
   };
 
   // Currently, route updates to separate VRFs are made to be sequential. In the
@@ -56,7 +107,45 @@ class RoutingInformationBase {
   using RouterIDToRouteTable = boost::container::flat_map<RouterID, RouteTable>;
   using SynchronizedRouteTables = folly::Synchronized<RouterIDToRouteTable>;
 
+  // The undo logs of an update, per VRF it changed
+  using UndoLogs = std::vector<std::pair<RouterID, RouteUpdater::UndoLog>>;
+
+  static RouteTable& getOrCreateRouteTable(
+      RouterIDToRouteTable* routeTables,
+      RouterID routerID);
+
+  void reconfigureLocked(
+      RouterIDToRouteTable* routeTables,
+      const RouterIDToInterfaceRoutes& interfaceRoutes,
+      const std::vector<cfg::StaticRouteWithNextHops>& staticRoutesWithNhops,
+      const std::vector<cfg::StaticRouteNoNextHops>& staticRoutesToNull,
+      const std::vector<cfg::StaticRouteNoNextHops>& staticRoutesToCPU,
+      std::vector<FibChanges>* changes,
+      UndoLogs* undoLogs);
+
+  // Waits for the changes of every earlier update to be published, so must
+  // be called without the RIB lock held
+  void publishFibChanges(
+      uint64_t ticket,
+      const std::vector<FibChanges>& changes,
+      const FibUpdateFunction& fibUpdateCallback);
+
+  // Publishes changes, and if that fails undoes the update they came from
+  // before rethrowing. Must be called without the RIB lock held.
+  void publishOrUndo(
+      uint64_t ticket,
+      const std::vector<FibChanges>& changes,
+      const UndoLogs& undoLogs,
+      const FibUpdateFunction& fibUpdateCallback);
+
   SynchronizedRouteTables synchronizedRouteTables_;
+
+  // Each update takes a ticket with the RIB lock held, and publishes its
+  // FibChanges when nextPublishTicket_ reaches it
+  uint64_t nextTicket_{0};
+  std::mutex publishMutex_;
+  std::condition_variable publishCondition_;
+  uint64_t nextPublishTicket_{0};
 };
 
 } // namespace rib
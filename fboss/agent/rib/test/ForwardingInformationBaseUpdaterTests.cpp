@@ -0,0 +1,288 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#include "fboss/agent/rib/ForwardingInformationBaseUpdater.h"
+#include "fboss/agent/rib/NetworkToRouteMap.h"
+#include "fboss/agent/rib/RouteNextHopEntry.h"
+#include "fboss/agent/rib/RouteUpdater.h"
+#include "fboss/agent/state/ForwardingInformationBaseContainer.h"
+#include "fboss/agent/state/ForwardingInformationBaseMap.h"
+#include "fboss/agent/state/Route.h"
+#include "fboss/agent/state/SwitchState.h"
+
+#include <folly/IPAddress.h>
+#include <folly/Optional.h>
+
+#include <gtest/gtest.h>
+
+using namespace facebook::fboss;
+using folly::IPAddress;
+using folly::IPAddressV4;
+using folly::IPAddressV6;
+
+namespace {
+
+const RouterID kVrf = RouterID(0);
+const ClientID kClient = ClientID(1001);
+
+struct RibTables {
+  rib::IPv4NetworkToRouteMap v4Routes;
+  rib::IPv6NetworkToRouteMap v6Routes;
+  rib::NextHopDependencyIndex nextHopDependencies;
+};
+
+void addBaseRoutes(RibTables* tables) {
+  rib::RouteUpdater updater(&tables->v4Routes, &tables->v6Routes);
+  updater.addInterfaceRoute(
+      IPAddress("10.0.0.0"), 24, IPAddress("10.0.0.1"), InterfaceID(1));
+  updater.addInterfaceRoute(
+      IPAddress("2001::"), 64, IPAddress("2001::1"), InterfaceID(1));
+
+  rib::RouteNextHopSet nexthops;
+  nexthops.emplace(
+      rib::UnresolvedNextHop(IPAddress("10.0.0.10"), rib::ECMP_WEIGHT));
+  updater.addRoute(
+      IPAddress("20.0.0.0"),
+      16,
+      kClient,
+      rib::RouteNextHopEntry(std::move(nexthops), AdminDistance::EBGP));
+
+  // Unresolvable, must not make it into the FIB
+  rib::RouteNextHopSet unresolvable;
+  unresolvable.emplace(
+      rib::UnresolvedNextHop(IPAddress("30.0.0.1"), rib::ECMP_WEIGHT));
+  updater.addRoute(
+      IPAddress("40.0.0.0"),
+      16,
+      kClient,
+      rib::RouteNextHopEntry(std::move(unresolvable), AdminDistance::EBGP));
+  updater.updateDone();
+}
+
+std::shared_ptr<SwitchState> publish(
+    const std::shared_ptr<SwitchState>& state,
+    const RibTables& tables,
+    const folly::Optional<std::set<folly::CIDRNetwork>>& prefixes =
+        folly::none) {
+  auto changes =
+      rib::getFibChanges(kVrf, tables.v4Routes, tables.v6Routes, prefixes);
+  rib::ForwardingInformationBaseUpdater updater(changes);
+  return updater(state);
+}
+
+void addRoute(
+    rib::RouteUpdater* updater,
+    const std::string& network,
+    uint8_t mask,
+    const std::string& nexthop) {
+  rib::RouteNextHopSet nexthops;
+  nexthops.emplace(
+      rib::UnresolvedNextHop(IPAddress(nexthop), rib::ECMP_WEIGHT));
+  updater->addRoute(
+      IPAddress(network),
+      mask,
+      kClient,
+      rib::RouteNextHopEntry(std::move(nexthops), AdminDistance::EBGP));
+}
+
+} // namespace
+
+TEST(ForwardingInformationBaseUpdater, PublishResolvedRoutes) {
+  RibTables tables;
+  addBaseRoutes(&tables);
+
+  auto state = publish(std::make_shared<SwitchState>(), tables);
+  ASSERT_NE(nullptr, state);
+
+  auto container = state->getFibs()->getFibContainerIf(kVrf);
+  ASSERT_NE(nullptr, container);
+  auto fibV4 = container->getFibV4();
+  auto fibV6 = container->getFibV6();
+
+  auto connected = fibV4->exactMatch({IPAddressV4("10.0.0.0"), 24});
+  ASSERT_NE(nullptr, connected);
+  EXPECT_TRUE(connected->isResolved());
+  EXPECT_TRUE(connected->isConnected());
+
+  auto bgp = fibV4->exactMatch({IPAddressV4("20.0.0.0"), 16});
+  ASSERT_NE(nullptr, bgp);
+  EXPECT_TRUE(bgp->isResolved());
+  EXPECT_FALSE(bgp->isConnected());
+  const auto& fwd = bgp->getForwardInfo();
+  EXPECT_EQ(RouteForwardAction::NEXTHOPS, fwd.getAction());
+  ASSERT_EQ(1, fwd.getNextHopSet().size());
+  EXPECT_EQ(InterfaceID(1), fwd.getNextHopSet().begin()->intf());
+
+  EXPECT_EQ(nullptr, fibV4->exactMatch({IPAddressV4("40.0.0.0"), 16}));
+
+  EXPECT_NE(nullptr, fibV6->exactMatch({IPAddressV6("2001::"), 64}));
+
+  // Lookups go through the FIB once there is one for the VRF
+  auto match = state->longestMatchRoute(kVrf, IPAddressV4("20.0.1.1"));
+  EXPECT_EQ(bgp, match);
+  EXPECT_EQ(nullptr, state->longestMatchRoute(kVrf, IPAddressV4("40.0.1.1")));
+}
+
+TEST(ForwardingInformationBaseUpdater, UnchangedRoutesKeepTheirNode) {
+  RibTables tables;
+  addBaseRoutes(&tables);
+
+  auto state = publish(std::make_shared<SwitchState>(), tables);
+  ASSERT_NE(nullptr, state);
+  state->publish();
+
+  // Publishing the same routes again is a no-op
+  EXPECT_EQ(nullptr, publish(state, tables));
+
+  auto oldFibV4 = state->getFibs()->getFibContainerIf(kVrf)->getFibV4();
+  auto oldFibV6 = state->getFibs()->getFibContainerIf(kVrf)->getFibV6();
+
+  rib::RouteUpdater updater(&tables.v4Routes, &tables.v6Routes);
+  updater.delRoute(IPAddress("20.0.0.0"), 16, kClient);
+  updater.updateDone();
+
+  auto newState = publish(state, tables);
+  ASSERT_NE(nullptr, newState);
+  auto newContainer = newState->getFibs()->getFibContainerIf(kVrf);
+
+  // The v6 FIB did not change at all
+  EXPECT_EQ(oldFibV6, newContainer->getFibV6());
+
+  auto newFibV4 = newContainer->getFibV4();
+  EXPECT_EQ(nullptr, newFibV4->exactMatch({IPAddressV4("20.0.0.0"), 16}));
+  EXPECT_EQ(
+      oldFibV4->exactMatch({IPAddressV4("10.0.0.0"), 24}),
+      newFibV4->exactMatch({IPAddressV4("10.0.0.0"), 24}));
+}
+
+TEST(ForwardingInformationBaseUpdater, PublishOnlyResolvedPrefixes) {
+  RibTables tables;
+  {
+    rib::RouteUpdater updater(
+        &tables.v4Routes, &tables.v6Routes, &tables.nextHopDependencies);
+    updater.addInterfaceRoute(
+        IPAddress("10.0.0.0"), 24, IPAddress("10.0.0.1"), InterfaceID(1));
+    updater.addInterfaceRoute(
+        IPAddress("2001::"), 64, IPAddress("2001::1"), InterfaceID(1));
+    addRoute(&updater, "20.0.0.0", 16, "10.0.0.10");
+    // Resolves recursively through 20.0.0.0/16
+    addRoute(&updater, "30.0.0.0", 16, "20.0.0.1");
+    addRoute(&updater, "50.0.0.0", 16, "10.0.0.11");
+    updater.updateDone();
+    // The first update of the index resolves the whole table
+    EXPECT_FALSE(updater.getResolvedPrefixes().hasValue());
+  }
+  auto state = publish(std::make_shared<SwitchState>(), tables);
+  ASSERT_NE(nullptr, state);
+  state->publish();
+  auto oldFibV4 = state->getFibs()->getFibContainerIf(kVrf)->getFibV4();
+  auto oldFibV6 = state->getFibs()->getFibContainerIf(kVrf)->getFibV6();
+
+  // Move 20.0.0.0/16 to another next hop, which re-resolves 30.0.0.0/16 too
+  rib::RouteUpdater updater(
+      &tables.v4Routes, &tables.v6Routes, &tables.nextHopDependencies);
+  addRoute(&updater, "20.0.0.0", 16, "10.0.0.12");
+  updater.updateDone();
+  const auto& prefixes = updater.getResolvedPrefixes();
+  ASSERT_TRUE(prefixes.hasValue());
+  EXPECT_EQ(1, prefixes->count({IPAddress("20.0.0.0"), 16}));
+  EXPECT_EQ(1, prefixes->count({IPAddress("30.0.0.0"), 16}));
+  EXPECT_EQ(0, prefixes->count({IPAddress("50.0.0.0"), 16}));
+
+  auto changes =
+      rib::getFibChanges(kVrf, tables.v4Routes, tables.v6Routes, prefixes);
+  EXPECT_FALSE(changes.v4.replaceAll);
+  EXPECT_EQ(prefixes->size(), changes.v4.routes.size());
+  EXPECT_TRUE(changes.v6.routes.empty());
+
+  auto newState = publish(state, tables, prefixes);
+  ASSERT_NE(nullptr, newState);
+  auto newContainer = newState->getFibs()->getFibContainerIf(kVrf);
+  EXPECT_EQ(oldFibV6, newContainer->getFibV6());
+  auto newFibV4 = newContainer->getFibV4();
+  EXPECT_EQ(oldFibV4->size(), newFibV4->size());
+
+  for (auto prefix : {"20.0.0.0", "30.0.0.0"}) {
+    RoutePrefixV4 fibPrefix{IPAddressV4(prefix), 16};
+    auto route = newFibV4->exactMatch(fibPrefix);
+    ASSERT_NE(nullptr, route);
+    EXPECT_NE(oldFibV4->exactMatch(fibPrefix), route);
+    const auto& nhops = route->getForwardInfo().getNextHopSet();
+    ASSERT_EQ(1, nhops.size());
+    EXPECT_EQ(IPAddress("10.0.0.12"), nhops.begin()->addr());
+  }
+  for (auto fibPrefix : {RoutePrefixV4{IPAddressV4("10.0.0.0"), 24},
+                         RoutePrefixV4{IPAddressV4("50.0.0.0"), 16}}) {
+    EXPECT_EQ(
+        oldFibV4->exactMatch(fibPrefix), newFibV4->exactMatch(fibPrefix));
+  }
+
+  // Deleting a route removes it from the FIB
+  newState->publish();
+  rib::RouteUpdater delUpdater(
+      &tables.v4Routes, &tables.v6Routes, &tables.nextHopDependencies);
+  delUpdater.delRoute(IPAddress("50.0.0.0"), 16, kClient);
+  delUpdater.updateDone();
+  auto delState = publish(newState, tables, delUpdater.getResolvedPrefixes());
+  ASSERT_NE(nullptr, delState);
+  auto delFibV4 = delState->getFibs()->getFibContainerIf(kVrf)->getFibV4();
+  EXPECT_EQ(nullptr, delFibV4->exactMatch({IPAddressV4("50.0.0.0"), 16}));
+  EXPECT_EQ(newFibV4->size() - 1, delFibV4->size());
+}
+
+TEST(ForwardingInformationBaseUpdater, LongestMatchFollowsPrefixLengths) {
+  RibTables tables;
+  {
+    rib::RouteUpdater updater(&tables.v4Routes, &tables.v6Routes);
+    updater.addInterfaceRoute(
+        IPAddress("10.0.0.0"), 24, IPAddress("10.0.0.1"), InterfaceID(1));
+    addRoute(&updater, "20.0.0.0", 8, "10.0.0.10");
+    addRoute(&updater, "20.1.0.0", 16, "10.0.0.11");
+    addRoute(&updater, "20.1.1.0", 24, "10.0.0.12");
+    updater.updateDone();
+  }
+  auto state = publish(std::make_shared<SwitchState>(), tables);
+  ASSERT_NE(nullptr, state);
+  state->publish();
+  auto fibV4 = state->getFibs()->getFibContainerIf(kVrf)->getFibV4();
+  const auto& numRoutes = fibV4->getExtraFields().numRoutes;
+  EXPECT_EQ(1, numRoutes[8]);
+  EXPECT_EQ(1, numRoutes[16]);
+  EXPECT_EQ(2, numRoutes[24]);
+  EXPECT_EQ(0, numRoutes[32]);
+
+  auto expectMatch = [&](const std::shared_ptr<SwitchState>& s,
+                         const std::string& address,
+                         const std::string& network,
+                         uint8_t mask) {
+    auto match = s->longestMatchRoute(kVrf, IPAddressV4(address));
+    ASSERT_NE(nullptr, match) << address;
+    EXPECT_EQ((RoutePrefixV4{IPAddressV4(network), mask}), match->prefix())
+        << address;
+  };
+  expectMatch(state, "20.1.1.1", "20.1.1.0", 24);
+  expectMatch(state, "20.1.2.1", "20.1.0.0", 16);
+  expectMatch(state, "20.2.0.1", "20.0.0.0", 8);
+  EXPECT_EQ(nullptr, state->longestMatchRoute(kVrf, IPAddressV4("30.0.0.1")));
+
+  // Removing the only /16 leaves its addresses to the /8
+  rib::RouteUpdater updater(&tables.v4Routes, &tables.v6Routes);
+  updater.delRoute(IPAddress("20.1.0.0"), 16, kClient);
+  updater.updateDone();
+  auto newState = publish(state, tables);
+  ASSERT_NE(nullptr, newState);
+  auto newFibV4 = newState->getFibs()->getFibContainerIf(kVrf)->getFibV4();
+  EXPECT_EQ(0, newFibV4->getExtraFields().numRoutes[16]);
+  EXPECT_EQ(2, newFibV4->getExtraFields().numRoutes[24]);
+  expectMatch(newState, "20.1.2.1", "20.0.0.0", 8);
+  expectMatch(newState, "20.1.1.1", "20.1.1.0", 24);
+  // The published FIB keeps its own counts
+  EXPECT_EQ(1, fibV4->getExtraFields().numRoutes[16]);
+}
@@ -0,0 +1,139 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/Utils.h"
+#include "fboss/agent/rib/NetworkToRouteMap.h"
+#include "fboss/agent/rib/NextHopDependencyIndex.h"
+#include "fboss/agent/rib/RouteNextHopEntry.h"
+#include "fboss/agent/rib/RouteUpdater.h"
+
+#include <folly/Benchmark.h>
+#include <folly/IPAddress.h>
+
+#include <memory>
+
+/*
+ * Compares the cost of adding a single route to a table of 10k, 100k and 1M
+ * routes, when the update re-resolves the whole table and when it only
+ * re-resolves the routes the new route can affect.
+ *
+ * The table looks like what BGP gives us: every route resolves recursively
+ * through two of a small set of loopback routes, which in turn resolve
+ * through the interface routes.
+ */
+
+using namespace facebook::fboss;
+using namespace facebook::fboss::rib;
+using folly::IPAddress;
+using folly::IPAddressV4;
+
+namespace {
+
+constexpr auto kNumInterfaces = 4;
+constexpr auto kNumLoopbacks = 64;
+const auto kBgpClient = StdClientIds2ClientID(StdClientIds::BGPD);
+
+struct RouteTable {
+  IPv4NetworkToRouteMap v4Routes;
+  IPv6NetworkToRouteMap v6Routes;
+  NextHopDependencyIndex nextHopDependencies;
+};
+
+IPAddressV4 nthAddress(const char* base, uint32_t n) {
+  return IPAddressV4::fromLongHBO(IPAddressV4(base).toLongHBO() + n);
+}
+
+IPAddressV4 loopback(uint32_t n) {
+  return nthAddress("100.0.0.0", n % kNumLoopbacks);
+}
+
+// A /24 per route, from 20.0.0.0 onwards
+IPAddressV4 bgpNetwork(uint32_t n) {
+  return nthAddress("20.0.0.0", n << 8);
+}
+
+void addBgpRoute(RouteUpdater* updater, uint32_t n) {
+  RouteNextHopSet nexthops;
+  nexthops.emplace(UnresolvedNextHop(loopback(n), ECMP_WEIGHT));
+  nexthops.emplace(UnresolvedNextHop(loopback(n + 1), ECMP_WEIGHT));
+  updater->addRoute(
+      bgpNetwork(n),
+      24,
+      kBgpClient,
+      RouteNextHopEntry(std::move(nexthops), AdminDistance::EBGP));
+}
+
+std::unique_ptr<RouteTable> buildRouteTable(uint32_t numRoutes) {
+  auto table = std::make_unique<RouteTable>();
+  RouteUpdater updater(
+      &table->v4Routes, &table->v6Routes, &table->nextHopDependencies);
+  for (uint32_t intf = 0; intf < kNumInterfaces; ++intf) {
+    auto address = nthAddress("10.0.0.1", intf << 8);
+    updater.addInterfaceRoute(
+        address, 24, address, InterfaceID(intf + 1));
+  }
+  for (uint32_t n = 0; n < kNumLoopbacks; ++n) {
+    auto neighbor = nthAddress("10.0.0.10", (n % kNumInterfaces) << 8);
+    RouteNextHopSet nexthops;
+    nexthops.emplace(UnresolvedNextHop(neighbor, ECMP_WEIGHT));
+    updater.addRoute(
+        loopback(n),
+        32,
+        kBgpClient,
+        RouteNextHopEntry(std::move(nexthops), AdminDistance::EBGP));
+  }
+  for (uint32_t n = 0; n < numRoutes; ++n) {
+    addBgpRoute(&updater, n);
+  }
+  updater.updateDone();
+  return table;
+}
+
+void singleRouteAdd(unsigned iters, uint32_t numRoutes, bool incremental) {
+  std::unique_ptr<RouteTable> table;
+  BENCHMARK_SUSPEND {
+    table = buildRouteTable(numRoutes);
+  }
+  for (unsigned i = 0; i < iters; ++i) {
+    RouteUpdater updater(
+        &table->v4Routes,
+        &table->v6Routes,
+        incremental ? &table->nextHopDependencies : nullptr);
+    addBgpRoute(&updater, numRoutes + i);
+    updater.updateDone();
+  }
+  BENCHMARK_SUSPEND {
+    table.reset();
+  }
+}
+
+void fullResolve(unsigned iters, uint32_t numRoutes) {
+  singleRouteAdd(iters, numRoutes, false);
+}
+
+void incrementalResolve(unsigned iters, uint32_t numRoutes) {
+  singleRouteAdd(iters, numRoutes, true);
+}
+
+} // unnamed namespace
+
+BENCHMARK_PARAM(fullResolve, 10000)
+BENCHMARK_RELATIVE_PARAM(incrementalResolve, 10000)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_PARAM(fullResolve, 100000)
+BENCHMARK_RELATIVE_PARAM(incrementalResolve, 100000)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_PARAM(fullResolve, 1000000)
+BENCHMARK_RELATIVE_PARAM(incrementalResolve, 1000000)
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -11,6 +11,7 @@
 #include "fboss/agent/FbossError.h"
 #include "fboss/agent/Utils.h"
 #include "fboss/agent/rib/NetworkToRouteMap.h"
+#include "fboss/agent/rib/NextHopDependencyIndex.h"
 #include "fboss/agent/rib/RouteNextHop.h"
 #include "fboss/agent/rib/RouteNextHopEntry.h"
 #include "fboss/agent/rib/RouteTypes.h"
@@ -21,6 +22,7 @@
 #include <folly/logging/xlog.h>
 
 #include <gtest/gtest.h>
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -1461,6 +1463,86 @@ TEST(Route, nextHopTest) {
   EXPECT_TRUE(unh < rnh && rnh > unh);
 }
 
+// Incremental resolution has to end up with exactly what re-resolving the
+// whole table does
+TEST(Route, incrementalResolve) {
+  IPv4NetworkToRouteMap fullV4Routes;
+  IPv6NetworkToRouteMap fullV6Routes;
+  IPv4NetworkToRouteMap v4Routes;
+  IPv6NetworkToRouteMap v6Routes;
+  NextHopDependencyIndex nextHopDependencies;
+
+  configRoutes(&fullV4Routes, &fullV6Routes);
+  configRoutes(&v4Routes, &v6Routes);
+
+  auto update = [&](std::function<void(RouteUpdater*)> updateFn) {
+    RouteUpdater full(&fullV4Routes, &fullV6Routes);
+    updateFn(&full);
+    full.updateDone();
+    RouteUpdater incremental(&v4Routes, &v6Routes, &nextHopDependencies);
+    updateFn(&incremental);
+    incremental.updateDone();
+    EXPECT_TRUE(nextHopDependencies.isValid());
+    EXPECT_ROUTES_MATCH(&fullV4Routes, &v4Routes);
+    EXPECT_ROUTES_MATCH(&fullV6Routes, &v6Routes);
+  };
+  auto addRoute = [](RouteUpdater* updater,
+                     std::string network,
+                     uint8_t mask,
+                     ClientID client,
+                     std::vector<std::string> nexthops) {
+    updater->addRoute(
+        IPAddress(network),
+        mask,
+        client,
+        RouteNextHopEntry(makeNextHops(nexthops), kDistance));
+  };
+
+  // A chain of recursively resolved routes, and one that can't be resolved
+  update([&](RouteUpdater* u) {
+    addRoute(u, "1.1.3.0", 24, kClientA, {"1.1.1.10"});
+    addRoute(u, "8.8.8.0", 24, kClientA, {"1.1.3.10"});
+    addRoute(u, "9.9.0.0", 16, kClientA, {"8.8.8.5"});
+    addRoute(u, "10.0.0.0", 8, kClientA, {"7.7.7.7"});
+  });
+  EXPECT_FWD_INFO(getRoute(v4Routes, "9.9.0.0/16"), InterfaceID(1), "1.1.1.10");
+  EXPECT_FALSE(getRoute(v4Routes, "10.0.0.0/8")->isResolved());
+
+  // A route for a next hop that could not be resolved before
+  update([&](RouteUpdater* u) {
+    addRoute(u, "7.7.0.0", 16, kClientB, {"2.2.2.10"});
+  });
+  EXPECT_FWD_INFO(
+      getRoute(v4Routes, "10.0.0.0/8"), InterfaceID(2), "2.2.2.10");
+
+  // A more specific route in the middle of the chain, and then without it
+  update([&](RouteUpdater* u) {
+    addRoute(u, "1.1.3.0", 25, kClientB, {"3.3.3.10"});
+  });
+  EXPECT_FWD_INFO(getRoute(v4Routes, "9.9.0.0/16"), InterfaceID(3), "3.3.3.10");
+  update([&](RouteUpdater* u) {
+    u->delRoute(IPAddress("1.1.3.0"), 25, kClientB);
+  });
+  EXPECT_FWD_INFO(getRoute(v4Routes, "9.9.0.0/16"), InterfaceID(1), "1.1.1.10");
+
+  // v4 routes resolved through v6 routes, then a change of the v6 route
+  update([&](RouteUpdater* u) {
+    addRoute(u, "5::", 64, kClientA, {"1::10"});
+    addRoute(u, "12.0.0.0", 8, kClientA, {"5::5"});
+  });
+  EXPECT_FWD_INFO(getRoute(v4Routes, "12.0.0.0/8"), InterfaceID(1), "1::10");
+  update([&](RouteUpdater* u) { addRoute(u, "5::", 64, kClientA, {"2::10"}); });
+  EXPECT_FWD_INFO(getRoute(v4Routes, "12.0.0.0/8"), InterfaceID(2), "2::10");
+
+  // Routes going away from under the routes resolved through them
+  update([&](RouteUpdater* u) { u->removeAllRoutesForClient(kClientB); });
+  EXPECT_FALSE(getRoute(v4Routes, "10.0.0.0/8")->isResolved());
+  update([&](RouteUpdater* u) {
+    u->delRoute(IPAddress("1.1.3.0"), 24, kClientA);
+  });
+  EXPECT_FALSE(getRoute(v4Routes, "9.9.0.0/16")->isResolved());
+}
+
 /*
  * Class that makes it easy to run tests with the following
  * configurable entities:
@@ -0,0 +1,233 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#include "fboss/agent/AddressUtil.h"
+#include "fboss/agent/FbossError.h"
+#include "fboss/agent/rib/ForwardingInformationBaseUpdater.h"
+#include "fboss/agent/rib/NetworkToRouteMap.h"
+#include "fboss/agent/rib/RouteNextHopEntry.h"
+#include "fboss/agent/rib/RouteUpdater.h"
+#include "fboss/agent/rib/RoutingInformationBase.h"
+#include "fboss/agent/state/Route.h"
+
+#include <folly/IPAddress.h>
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+using namespace facebook::fboss;
+using facebook::network::toBinaryAddress;
+using folly::IPAddress;
+using folly::IPAddressV4;
+
+namespace {
+
+const RouterID kVrf = RouterID(0);
+const ClientID kClient = ClientID(1001);
+
+UnicastRoute makeRoute(
+    const std::string& network,
+    uint8_t mask,
+    const std::string& nexthop) {
+  UnicastRoute route;
+  route.dest.ip = toBinaryAddress(IPAddress(network));
+  route.dest.prefixLength = mask;
+  route.nextHopAddrs.push_back(toBinaryAddress(IPAddress(nexthop)));
+  return route;
+}
+
+IpPrefix makePrefix(const std::string& network, uint8_t mask) {
+  IpPrefix prefix;
+  prefix.ip = toBinaryAddress(IPAddress(network));
+  prefix.prefixLength = mask;
+  return prefix;
+}
+
+// The v4 FIB route the changes have for prefix, nullptr if they remove it
+std::shared_ptr<RouteV4> getChange(
+    const rib::FibChanges& changes,
+    const std::string& network,
+    uint8_t mask) {
+  RoutePrefixV4 prefix{IPAddressV4(network), mask};
+  for (const auto& change : changes.v4.routes) {
+    if (change.first == prefix) {
+      return change.second;
+    }
+  }
+  ADD_FAILURE() << "No change for " << prefix.str();
+  return nullptr;
+}
+
+IPAddress getNextHop(const std::shared_ptr<RouteV4>& route) {
+  const auto& nhops = route->getForwardInfo().getNextHopSet();
+  EXPECT_EQ(1, nhops.size());
+  return nhops.begin()->addr();
+}
+
+class RoutingInformationBaseTest : public ::testing::Test {
+ public:
+  void SetUp() override {
+    interfaceRoutes_[kVrf][{IPAddress("10.0.0.0"), 24}] =
+        std::make_pair(InterfaceID(1), IPAddress("10.0.0.1"));
+    reconfigure({});
+    update({makeRoute("20.0.0.0", 16, "10.0.0.10")}, {}, record());
+    published_.clear();
+  }
+
+ protected:
+  rib::RoutingInformationBase::FibUpdateFunction record() {
+    return [this](const rib::FibChanges& changes) {
+      published_.push_back(changes);
+    };
+  }
+
+  // Fails to publish the first changes it is given, like SwSwitch does when
+  // the hardware could not program them, and records the others
+  rib::RoutingInformationBase::FibUpdateFunction failFirst() {
+    return [this](const rib::FibChanges& changes) {
+      if (!failed_) {
+        failed_ = true;
+        throw FbossError("out of room");
+      }
+      published_.push_back(changes);
+    };
+  }
+
+  void reconfigure(
+      const std::vector<cfg::StaticRouteNoNextHops>& staticRoutesToNull) {
+    rib_.reconfigure(interfaceRoutes_, {}, staticRoutesToNull, {}, record());
+  }
+
+  void update(
+      const std::vector<UnicastRoute>& toAdd,
+      const std::vector<IpPrefix>& toDelete,
+      const rib::RoutingInformationBase::FibUpdateFunction& publish) {
+    rib_.update(
+        kVrf, kClient, AdminDistance::EBGP, toAdd, toDelete, false, publish);
+  }
+
+  rib::RoutingInformationBase::RouterIDToInterfaceRoutes interfaceRoutes_;
+  rib::RoutingInformationBase rib_;
+  std::vector<rib::FibChanges> published_;
+  bool failed_{false};
+};
+
+} // namespace
+
+TEST_F(RoutingInformationBaseTest, ReconfigureChangesOnlyWhatDiffers) {
+  cfg::StaticRouteNoNextHops nullRoute;
+  nullRoute.routerID = 0;
+  nullRoute.prefix = "40.0.0.0/16";
+  reconfigure({nullRoute});
+  ASSERT_EQ(1, published_.size());
+  EXPECT_EQ(1, published_[0].v4.routes.size());
+  EXPECT_NE(nullptr, getChange(published_[0], "40.0.0.0", 16));
+
+  // Applying the same config again changes nothing
+  published_.clear();
+  reconfigure({nullRoute});
+  ASSERT_EQ(1, published_.size());
+  EXPECT_FALSE(published_[0].v4.replaceAll);
+  EXPECT_TRUE(published_[0].v4.routes.empty());
+  EXPECT_TRUE(published_[0].v6.routes.empty());
+
+  // And dropping the static route only removes it
+  published_.clear();
+  reconfigure({});
+  ASSERT_EQ(1, published_.size());
+  EXPECT_EQ(1, published_[0].v4.routes.size());
+  EXPECT_EQ(nullptr, getChange(published_[0], "40.0.0.0", 16));
+}
+
+TEST_F(RoutingInformationBaseTest, UndoAddedRoute) {
+  EXPECT_THROW(
+      update({makeRoute("30.0.0.0", 16, "10.0.0.11")}, {}, failFirst()),
+      FbossError);
+
+  // The undo removes the route that could not be programmed
+  ASSERT_EQ(1, published_.size());
+  EXPECT_EQ(nullptr, getChange(published_[0], "30.0.0.0", 16));
+
+  // And the RIB no longer has it, so deleting it changes nothing
+  published_.clear();
+  update({}, {makePrefix("30.0.0.0", 16)}, record());
+  ASSERT_EQ(1, published_.size());
+  EXPECT_TRUE(published_[0].v4.routes.empty());
+}
+
+TEST_F(RoutingInformationBaseTest, UndoChangedAndDeletedRoutes) {
+  update({makeRoute("30.0.0.0", 16, "20.0.0.1")}, {}, record());
+  published_.clear();
+
+  // Moving 20.0.0.0/16 re-resolves 30.0.0.0/16 through it, and both go
+  // back to the old next hop when the update is undone
+  EXPECT_THROW(
+      update({makeRoute("20.0.0.0", 16, "10.0.0.12")}, {}, failFirst()),
+      FbossError);
+  ASSERT_EQ(1, published_.size());
+  for (auto network : {"20.0.0.0", "30.0.0.0"}) {
+    auto route = getChange(published_[0], network, 16);
+    ASSERT_NE(nullptr, route);
+    EXPECT_EQ(IPAddress("10.0.0.10"), getNextHop(route));
+  }
+
+  // A failed delete puts the route back
+  published_.clear();
+  failed_ = false;
+  EXPECT_THROW(
+      update({}, {makePrefix("30.0.0.0", 16)}, failFirst()), FbossError);
+  ASSERT_EQ(1, published_.size());
+  auto route = getChange(published_[0], "30.0.0.0", 16);
+  ASSERT_NE(nullptr, route);
+  EXPECT_EQ(IPAddress("10.0.0.10"), getNextHop(route));
+}
+
+TEST(RouteUpdater, UndoLeavesLaterChangesAlone) {
+  // Undo entries whose prefix changed again since are skipped
+  rib::RouteUpdater::UndoLog undoLog;
+  rib::IPv4NetworkToRouteMap v4Routes;
+  rib::IPv6NetworkToRouteMap v6Routes;
+  rib::RouteNextHopSet nhops;
+  nhops.emplace(rib::UnresolvedNextHop(IPAddress("1.1.1.1"), rib::ECMP_WEIGHT));
+  rib::RouteNextHopEntry first(nhops, AdminDistance::EBGP);
+  nhops.clear();
+  nhops.emplace(rib::UnresolvedNextHop(IPAddress("2.2.2.2"), rib::ECMP_WEIGHT));
+  rib::RouteNextHopEntry second(nhops, AdminDistance::EBGP);
+
+  {
+    rib::RouteUpdater updater(&v4Routes, &v6Routes);
+    updater.addRoute(IPAddress("30.0.0.0"), 16, kClient, first);
+    updater.addRoute(IPAddress("40.0.0.0"), 16, kClient, first);
+    updater.updateDone();
+    undoLog = updater.getUndoLog();
+  }
+  ASSERT_EQ(2, undoLog.size());
+  for (const auto& undoEntry : undoLog) {
+    EXPECT_FALSE(undoEntry.before.hasValue());
+    ASSERT_TRUE(undoEntry.after.hasValue());
+    EXPECT_EQ(first, *undoEntry.after);
+  }
+  {
+    rib::RouteUpdater updater(&v4Routes, &v6Routes);
+    updater.addRoute(IPAddress("40.0.0.0"), 16, kClient, second);
+    updater.updateDone();
+  }
+  {
+    rib::RouteUpdater updater(&v4Routes, &v6Routes);
+    updater.undo(undoLog);
+    updater.updateDone();
+  }
+  EXPECT_EQ(
+      v4Routes.end(), v4Routes.exactMatch(IPAddressV4("30.0.0.0"), 16));
+  auto it = v4Routes.exactMatch(IPAddressV4("40.0.0.0"), 16);
+  ASSERT_NE(v4Routes.end(), it);
+  EXPECT_EQ(second, *it->value().getEntryForClient(kClient));
+}
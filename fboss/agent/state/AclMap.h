@@ -74,6 +74,7 @@ struct PrioAclMapTraits {
   using KeyType = int;
   using Node = AclEntry;
   using ExtraFields = NodeMapNoExtraFields;
+  using NodeContainer = NodeMapFlatContainer<KeyType, Node>;
 
   static KeyType getKey(const std::shared_ptr<Node>& entry) {
     return entry->getPriority();
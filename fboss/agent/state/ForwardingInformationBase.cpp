@@ -9,11 +9,44 @@
  */
 #include "ForwardingInformationBase.h"
 
+#include "fboss/agent/state/ForwardingInformationBaseMap.h"
 #include "fboss/agent/state/NodeMap-defs.h"
+#include "fboss/agent/state/SwitchState.h"
 
 namespace facebook {
 namespace fboss {
 
+namespace {
+constexpr auto kPrefixLength = "prefixLength";
+constexpr auto kNumRoutes = "numRoutes";
+} // namespace
+
+constexpr size_t ForwardingInformationBasePrefixLengths::kNumPrefixLengths;
+
+folly::dynamic ForwardingInformationBasePrefixLengths::toFollyDynamic() const {
+  folly::dynamic json = folly::dynamic::array;
+  for (size_t mask = 0; mask < kNumPrefixLengths; ++mask) {
+    if (numRoutes[mask]) {
+      folly::dynamic entry = folly::dynamic::object;
+      entry[kPrefixLength] = mask;
+      entry[kNumRoutes] = numRoutes[mask];
+      json.push_back(std::move(entry));
+    }
+  }
+  return json;
+}
+
+ForwardingInformationBasePrefixLengths
+ForwardingInformationBasePrefixLengths::fromFollyDynamic(
+    const folly::dynamic& json) {
+  ForwardingInformationBasePrefixLengths prefixLengths;
+  for (const auto& entry : json) {
+    prefixLengths.numRoutes.at(entry[kPrefixLength].asInt()) =
+        entry[kNumRoutes].asInt();
+  }
+  return prefixLengths;
+}
+
 template <typename AddressT>
 ForwardingInformationBase<AddressT>::ForwardingInformationBase() {}
 
@@ -27,6 +60,73 @@ ForwardingInformationBase<AddressT>::exactMatch(
   return ForwardingInformationBase::Base::getNodeIf(prefix);
 }
 
+template <typename AddressT>
+std::shared_ptr<Route<AddressT>>
+ForwardingInformationBase<AddressT>::longestMatch(
+    const AddressT& address) const {
+  const auto& numRoutes = this->getExtraFields().numRoutes;
+  for (int mask = address.bitCount(); mask >= 0; --mask) {
+    if (!numRoutes[mask]) {
+      continue;
+    }
+    auto route = exactMatch(
+        RoutePrefix<AddressT>{address.mask(mask), static_cast<uint8_t>(mask)});
+    if (route) {
+      return route;
+    }
+  }
+  return nullptr;
+}
+
+template <typename AddressT>
+void ForwardingInformationBase<AddressT>::addNode(
+    const std::shared_ptr<Route<AddressT>>& route) {
+  Base::addNode(route);
+  ++this->writableExtraFields().numRoutes[route->prefix().mask];
+}
+
+template <typename AddressT>
+void ForwardingInformationBase<AddressT>::removeNode(
+    const std::shared_ptr<Route<AddressT>>& route) {
+  Base::removeNode(route);
+  --this->writableExtraFields().numRoutes[route->prefix().mask];
+}
+
+template <typename AddressT>
+std::shared_ptr<Route<AddressT>>
+ForwardingInformationBase<AddressT>::removeNode(
+    const RoutePrefix<AddressT>& prefix) {
+  auto route = Base::removeNode(prefix);
+  --this->writableExtraFields().numRoutes[prefix.mask];
+  return route;
+}
+
+template <typename AddressT>
+std::shared_ptr<Route<AddressT>>
+ForwardingInformationBase<AddressT>::removeNodeIf(
+    const RoutePrefix<AddressT>& prefix) {
+  auto route = Base::removeNodeIf(prefix);
+  if (route) {
+    --this->writableExtraFields().numRoutes[prefix.mask];
+  }
+  return route;
+}
+
+template <typename AddressT>
+ForwardingInformationBase<AddressT>*
+ForwardingInformationBase<AddressT>::modify(
+    RouterID vrf,
+    std::shared_ptr<SwitchState>* state) {
+  if (!this->isPublished()) {
+    return this;
+  }
+  auto clonedContainer = (*state)->getFibs()->getNode(vrf)->modify(state);
+  auto clonedFib = this->clone();
+  auto clonedFibPtr = clonedFib.get();
+  clonedContainer->setFib(std::move(clonedFib));
+  return clonedFibPtr;
+}
+
 FBOSS_INSTANTIATE_NODE_MAP(
     ForwardingInformationBase<folly::IPAddressV4>,
     ForwardingInformationBaseTraits<folly::IPAddressV4>);
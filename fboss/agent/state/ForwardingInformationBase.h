@@ -12,16 +12,49 @@
 #include "fboss/agent/state/NodeMap.h"
 #include "fboss/agent/state/Route.h"
 #include "fboss/agent/state/RouteTypes.h"
+#include "fboss/agent/types.h"
 
 #include <folly/IPAddressV4.h>
 #include <folly/IPAddressV6.h>
+#include <folly/dynamic.h>
+
+#include <array>
 
 namespace facebook {
 namespace fboss {
 
+class SwitchState;
+
+/*
+ * The number of routes of each prefix length in a FIB, so that longestMatch()
+ * only looks up the prefix lengths that are in use. Route tables use a
+ * handful of them, rather than the 33 or 129 an address has.
+ */
+struct ForwardingInformationBasePrefixLengths {
+  // Enough for IPv6, IPv4 FIBs only use the first 33
+  static constexpr size_t kNumPrefixLengths = 129;
+
+  template <typename Fn>
+  void forEachChild(Fn /*fn*/) {}
+
+  folly::dynamic toFollyDynamic() const;
+  static ForwardingInformationBasePrefixLengths fromFollyDynamic(
+      const folly::dynamic& json);
+
+  std::array<uint32_t, kNumPrefixLengths> numRoutes{};
+};
+
+/*
+ * FIBs are as large as the route tables and are patched on every route
+ * update, so like RouteTableRib they keep their routes in a
+ * PersistentNodeContainer.
+ */
 template <typename AddressT>
-using ForwardingInformationBaseTraits =
-    NodeMapTraits<RoutePrefix<AddressT>, Route<AddressT>>;
+using ForwardingInformationBaseTraits = NodeMapTraits<
+    RoutePrefix<AddressT>,
+    Route<AddressT>,
+    ForwardingInformationBasePrefixLengths,
+    NodeMapPersistentContainer<RoutePrefix<AddressT>, Route<AddressT>>>;
 
 template <typename AddressT>
 class ForwardingInformationBase
@@ -34,6 +67,28 @@ class ForwardingInformationBase
 
   std::shared_ptr<Route<AddressT>> exactMatch(
       const RoutePrefix<AddressT>& prefix) const;
+  /*
+   * The FIB is not a radix tree, so this looks up the address under each
+   * prefix length the FIB has routes of, longest first. It is only meant for
+   * the slow path.
+   */
+  std::shared_ptr<Route<AddressT>> longestMatch(const AddressT& address) const;
+
+  /*
+   * These hide the NodeMapT methods of the same name, to keep count of the
+   * prefix lengths in use. updateNode() never changes a prefix, so is left
+   * as is.
+   */
+  void addNode(const std::shared_ptr<Route<AddressT>>& route);
+  void removeNode(const std::shared_ptr<Route<AddressT>>& route);
+  std::shared_ptr<Route<AddressT>> removeNode(
+      const RoutePrefix<AddressT>& prefix);
+  std::shared_ptr<Route<AddressT>> removeNodeIf(
+      const RoutePrefix<AddressT>& prefix);
+
+  ForwardingInformationBase* modify(
+      RouterID vrf,
+      std::shared_ptr<SwitchState>* state);
 
  private:
   using Base = NodeMapT<
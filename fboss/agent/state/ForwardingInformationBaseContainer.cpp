@@ -8,14 +8,18 @@
  *
  */
 #include "fboss/agent/state/ForwardingInformationBaseContainer.h"
+#include "fboss/agent/state/ForwardingInformationBaseMap.h"
 #include "fboss/agent/state/NodeBase-defs.h"
+#include "fboss/agent/state/SwitchState.h"
 
 namespace facebook {
 namespace fboss {
 
 ForwardingInformationBaseContainerFields::
     ForwardingInformationBaseContainerFields(RouterID vrf)
-    : vrf(vrf) {}
+    : vrf(vrf),
+      fibV4(std::make_shared<ForwardingInformationBaseV4>()),
+      fibV6(std::make_shared<ForwardingInformationBaseV6>()) {}
 
 ForwardingInformationBaseContainer::ForwardingInformationBaseContainer(
     RouterID vrf)
@@ -36,6 +40,26 @@ ForwardingInformationBaseContainer::getFibV6() const {
   return getFields()->fibV6;
 }
 
+void ForwardingInformationBaseContainer::setFib(
+    std::shared_ptr<ForwardingInformationBaseV4> fib) {
+  writableFields()->fibV4.swap(fib);
+}
+void ForwardingInformationBaseContainer::setFib(
+    std::shared_ptr<ForwardingInformationBaseV6> fib) {
+  writableFields()->fibV6.swap(fib);
+}
+
+ForwardingInformationBaseContainer* ForwardingInformationBaseContainer::modify(
+    std::shared_ptr<SwitchState>* state) {
+  if (!isPublished()) {
+    return this;
+  }
+  auto clonedFibMap = (*state)->getFibs()->modify(state);
+  auto clonedContainer = this->clone();
+  clonedFibMap->updateNode(clonedContainer);
+  return clonedContainer.get();
+}
+
 std::shared_ptr<ForwardingInformationBaseContainer>
 ForwardingInformationBaseContainer::fromFollyDynamic(
     const folly::dynamic& /* json */) {
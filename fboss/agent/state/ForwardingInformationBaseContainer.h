@@ -19,6 +19,8 @@
 namespace facebook {
 namespace fboss {
 
+class SwitchState;
+
 struct ForwardingInformationBaseContainerFields {
   explicit ForwardingInformationBaseContainerFields(RouterID vrf);
 
@@ -44,6 +46,14 @@ class ForwardingInformationBaseContainer
   RouterID getID() const;
   const std::shared_ptr<ForwardingInformationBaseV4>& getFibV4() const;
   const std::shared_ptr<ForwardingInformationBaseV6>& getFibV6() const;
+  template <typename AddressT>
+  const std::shared_ptr<ForwardingInformationBase<AddressT>>& getFib() const;
+
+  void setFib(std::shared_ptr<ForwardingInformationBaseV4> fib);
+  void setFib(std::shared_ptr<ForwardingInformationBaseV6> fib);
+
+  ForwardingInformationBaseContainer* modify(
+      std::shared_ptr<SwitchState>* state);
 
   static std::shared_ptr<ForwardingInformationBaseContainer> fromFollyDynamic(
       const folly::dynamic& json);
@@ -55,5 +65,17 @@ class ForwardingInformationBaseContainer
   friend class CloneAllocator;
 };
 
+template <>
+inline const std::shared_ptr<ForwardingInformationBaseV4>&
+ForwardingInformationBaseContainer::getFib() const {
+  return getFibV4();
+}
+
+template <>
+inline const std::shared_ptr<ForwardingInformationBaseV6>&
+ForwardingInformationBaseContainer::getFib() const {
+  return getFibV6();
+}
+
 } // namespace fboss
 } // namespace facebook
@@ -9,6 +9,7 @@
  */
 #include "fboss/agent/state/ForwardingInformationBaseMap.h"
 #include "fboss/agent/state/NodeMap-defs.h"
+#include "fboss/agent/state/SwitchState.h"
 
 namespace facebook {
 namespace fboss {
@@ -17,6 +18,18 @@ ForwardingInformationBaseMap::ForwardingInformationBaseMap() {}
 
 ForwardingInformationBaseMap::~ForwardingInformationBaseMap() {}
 
+ForwardingInformationBaseMap* ForwardingInformationBaseMap::modify(
+    std::shared_ptr<SwitchState>* state) {
+  if (!isPublished()) {
+    return this;
+  }
+  SwitchState::modify(state);
+  auto clonedFibMap = this->clone();
+  auto clonedFibMapPtr = clonedFibMap.get();
+  (*state)->resetForwardingInformationBases(std::move(clonedFibMap));
+  return clonedFibMapPtr;
+}
+
 FBOSS_INSTANTIATE_NODE_MAP(
     ForwardingInformationBaseMap,
     ForwardingInformationBaseMapTraits);
@@ -16,6 +16,8 @@
 namespace facebook {
 namespace fboss {
 
+class SwitchState;
+
 using ForwardingInformationBaseMapTraits =
     NodeMapTraits<RouterID, ForwardingInformationBaseContainer>;
 
@@ -26,6 +28,13 @@ class ForwardingInformationBaseMap : public NodeMapT<
   ForwardingInformationBaseMap();
   ~ForwardingInformationBaseMap() override;
 
+  std::shared_ptr<ForwardingInformationBaseContainer> getFibContainerIf(
+      RouterID vrf) const {
+    return getNodeIf(vrf);
+  }
+
+  ForwardingInformationBaseMap* modify(std::shared_ptr<SwitchState>* state);
+
  private:
   // Inherit the constructors required for clone()
   using NodeMapT::NodeMapT;
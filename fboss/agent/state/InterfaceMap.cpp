@@ -9,15 +9,32 @@
  */
 #include "fboss/agent/state/InterfaceMap.h"
 #include <string>
+#include <unordered_map>
 #include <folly/Conv.h>
 #include "fboss/agent/state/Interface.h"
 #include "fboss/agent/state/NodeMap-defs.h"
+#include "fboss/lib/RadixTree.h"
 
 using std::string;
 using folly::IPAddress;
 
 namespace facebook { namespace fboss {
 
+struct InterfaceMap::Indices {
+  // Interface by address, per router. The first interface wins.
+  std::unordered_map<
+      RouterID,
+      std::unordered_map<IPAddress, std::shared_ptr<Interface>>>
+      byAddr;
+  // Interface by VLAN. The first interface wins.
+  std::unordered_map<VlanID, std::shared_ptr<Interface>> byVlan;
+  // Interface subnets, per router
+  std::unordered_map<
+      RouterID,
+      facebook::network::RadixTree<IPAddress, IntfAddrToReach>>
+      subnets;
+};
+
 InterfaceMap::InterfaceMap() {
 }
 
@@ -26,6 +43,14 @@ InterfaceMap::~InterfaceMap() {
 
 std::shared_ptr<Interface>
 InterfaceMap::getInterfaceIf(RouterID router, const IPAddress& ip) const {
+  if (indices_) {
+    auto routerAddrs = indices_->byAddr.find(router);
+    if (routerAddrs == indices_->byAddr.end()) {
+      return nullptr;
+    }
+    auto intf = routerAddrs->second.find(ip);
+    return intf != routerAddrs->second.end() ? intf->second : nullptr;
+  }
   for (auto itr = begin(); itr != end(); ++itr) {
     if ((*itr)->getRouterID() == router && (*itr)->hasAddress(ip)) {
       return *itr;
@@ -36,6 +61,16 @@ InterfaceMap::getInterfaceIf(RouterID router, const IPAddress& ip) const {
 
 const std::shared_ptr<Interface>&
 InterfaceMap::getInterface(RouterID router, const IPAddress& ip) const {
+  if (indices_) {
+    auto routerAddrs = indices_->byAddr.find(router);
+    if (routerAddrs != indices_->byAddr.end()) {
+      auto intf = routerAddrs->second.find(ip);
+      if (intf != routerAddrs->second.end()) {
+        return intf->second;
+      }
+    }
+    throw FbossError("No interface with ip : ", ip);
+  }
   for (auto itr = begin(); itr != end(); ++itr) {
     if ((*itr)->getRouterID() == router && (*itr)->hasAddress(ip)) {
       return *itr;
@@ -46,6 +81,10 @@ InterfaceMap::getInterface(RouterID router, const IPAddress& ip) const {
 
 std::shared_ptr<Interface>
 InterfaceMap::getInterfaceInVlanIf(VlanID vlan) const {
+  if (indices_) {
+    auto intf = indices_->byVlan.find(vlan);
+    return intf != indices_->byVlan.end() ? intf->second : nullptr;
+  }
   for (auto itr = begin(); itr != end(); ++itr) {
     if ((*itr)->getVlanID() == vlan ) {
       return *itr;
@@ -65,22 +104,63 @@ InterfaceMap::getInterfaceInVlan(VlanID vlan) const {
 
 InterfaceMap::IntfAddrToReach InterfaceMap::getIntfAddrToReach(
     RouterID router, const folly::IPAddress& dest) const {
+  if (indices_) {
+    auto routerSubnets = indices_->subnets.find(router);
+    if (routerSubnets != indices_->subnets.end()) {
+      const auto& tree = routerSubnets->second;
+      auto match = tree.longestMatch(dest, dest.bitCount());
+      if (match != tree.end()) {
+        return match.value();
+      }
+    }
+    return IntfAddrToReach(nullptr, nullptr, 0);
+  }
+  // Keep to the same answer as the index, the longest subnet wins
+  IntfAddrToReach best(nullptr, nullptr, 0);
   for (auto iter = begin(); iter != end(); iter++) {
     const auto& intf = *iter;
-    if (intf->getRouterID() == router) {
-      auto addrIter = intf->getAddressToReach(dest);
-      if (addrIter != intf->getAddresses().end()) {
-        return IntfAddrToReach(intf.get(), &addrIter->first, addrIter->second);
+    if (intf->getRouterID() != router) {
+      continue;
+    }
+    for (const auto& addr : intf->getAddresses()) {
+      if ((!best.intf || addr.second > best.mask) &&
+          dest.inSubnet(addr.first, addr.second)) {
+        best = IntfAddrToReach(intf.get(), &addr.first, addr.second);
       }
     }
   }
-  return IntfAddrToReach(nullptr, nullptr, 0);
+  return best;
 }
 
 void InterfaceMap::addInterface(const std::shared_ptr<Interface>& interface) {
   addNode(interface);
 }
 
+void InterfaceMap::publish() {
+  if (isPublished()) {
+    return;
+  }
+  NodeMapT::publish();
+
+  // Nothing can change from now on, index the interfaces. The index holds
+  // pointers into the interfaces, which this map keeps alive.
+  auto indices = std::make_shared<Indices>();
+  for (const auto& intf : *this) {
+    auto router = intf->getRouterID();
+    indices->byVlan.emplace(intf->getVlanID(), intf);
+    auto& addrs = indices->byAddr[router];
+    auto& subnets = indices->subnets[router];
+    for (const auto& addr : intf->getAddresses()) {
+      addrs.emplace(addr.first, intf);
+      subnets.insert(
+          addr.first.mask(addr.second),
+          addr.second,
+          IntfAddrToReach(intf.get(), &addr.first, addr.second));
+    }
+  }
+  indices_ = std::move(indices);
+}
+
 folly::dynamic InterfaceMap::toFollyDynamic() const {
   folly::dynamic intfs = folly::dynamic::array;
   for (const auto& intf: *this) {
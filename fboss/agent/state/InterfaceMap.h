@@ -19,6 +19,11 @@ typedef NodeMapTraits<InterfaceID, Interface> InterfaceMapTraits;
 
 /*
  * A container for the set of INTERFACEs.
+ *
+ * The lookups by IP, VLAN and destination are done per trapped packet. Once
+ * the map is published, and so can no longer change, they are served from
+ * indices built at publish time instead of scanning every interface.
+ * Unpublished maps are still scanned.
  */
 class InterfaceMap : public NodeMapT<InterfaceMap, InterfaceMapTraits> {
  public:
@@ -83,7 +88,8 @@ class InterfaceMap : public NodeMapT<InterfaceMap, InterfaceMapTraits> {
   };
 
   /*
-   * Find an interface with its address to reach the given destination
+   * Find an interface with its address to reach the given destination. If
+   * several subnets contain it, the longest one wins.
    */
   IntfAddrToReach getIntfAddrToReach(
       RouterID router, const folly::IPAddress& dest) const;
@@ -97,6 +103,8 @@ class InterfaceMap : public NodeMapT<InterfaceMap, InterfaceMapTraits> {
 
   void addInterface(const std::shared_ptr<Interface>& interface);
 
+  void publish() override;
+
   /*
    * Serialize to a folly::dynamic object
    */
@@ -113,9 +121,14 @@ class InterfaceMap : public NodeMapT<InterfaceMap, InterfaceMapTraits> {
   }
 
  private:
+  struct Indices;
+
   // Inherit the constructors required for clone()
   using NodeMapT::NodeMapT;
   friend class CloneAllocator;
+
+  // Built by publish(), so a clone starts without any
+  std::shared_ptr<const Indices> indices_;
 };
 
 }} // facebook::fboss
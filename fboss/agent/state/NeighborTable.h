@@ -30,6 +30,7 @@ struct NeighborTableTraits {
   typedef IPADDR KeyType;
   typedef ENTRY Node;
   typedef NodeMapNoExtraFields ExtraFields;
+  typedef NodeMapPersistentContainer<KeyType, Node> NodeContainer;
 
   static KeyType getKey(const std::shared_ptr<Node>& entry) {
     return entry->getIP();
@@ -39,12 +40,9 @@ struct NeighborTableTraits {
 /*
  * A map of IP --> MAC for the IP addresses of other nodes on a VLAN.
  *
- * TODO: We should switch from NodeMap to PrefixMap when the new PrefixMap
- * implementation is ready.
- *
- * Any change to a NodeMap is O(N), so it is really only suitable for small
- * maps that do not change frequently.  Our new PrefixMap implementation will
- * allow us to perform cheaper copy-on-write updates.
+ * Neighbor tables can hold a very large number of entries and change
+ * constantly, so entries are stored in a PersistentNodeContainer: cloning the
+ * table to add or update one neighbor is O(log N) rather than O(N).
  */
 template<typename IPADDR, typename ENTRY, typename SUBCLASS>
 class NeighborTable
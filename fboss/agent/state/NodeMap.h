@@ -13,6 +13,7 @@
 
 #include "fboss/agent/state/NodeBase.h"
 #include "fboss/agent/state/NodeMapIterator.h"
+#include "fboss/agent/state/PersistentNodeContainer.h"
 
 namespace facebook { namespace fboss {
 
@@ -24,8 +25,7 @@ struct NodeMapFields {
   using KeyType = typename TraitsT::KeyType;
   using Node = typename TraitsT::Node;
   using ExtraFields = typename TraitsT::ExtraFields;
-  using NodeContainer =
-      boost::container::flat_map<KeyType, std::shared_ptr<Node>>;
+  using NodeContainer = typename TraitsT::NodeContainer;
 
   NodeMapFields() {}
   NodeMapFields(const NodeMapFields& other, NodeContainer nodes)
@@ -57,11 +57,34 @@ struct NodeMapNoExtraFields {
   }
 };
 
-template<typename KeyT, typename NodeT, typename ExtraT = NodeMapNoExtraFields>
+/*
+ * The default NodeContainer for NodeMaps.
+ *
+ * A flat_map is compact and fast to iterate, but copying it on clone() and
+ * inserting into it are both O(n).  This is fine for most maps, which are
+ * small and rarely modified.
+ */
+template<typename KeyT, typename NodeT>
+using NodeMapFlatContainer =
+    boost::container::flat_map<KeyT, std::shared_ptr<NodeT>>;
+
+/*
+ * A NodeContainer for maps that can grow very large and are modified often
+ * (e.g. neighbor tables and routes).  Tree nodes are shared between the
+ * published map and its clones, so clone() is O(1) and each modification only
+ * copies the O(log n) tree nodes on its path.  See PersistentNodeContainer.
+ */
+template<typename KeyT, typename NodeT>
+using NodeMapPersistentContainer =
+    PersistentNodeContainer<KeyT, std::shared_ptr<NodeT>>;
+
+template<typename KeyT, typename NodeT, typename ExtraT = NodeMapNoExtraFields,
+         typename ContainerT = NodeMapFlatContainer<KeyT, NodeT>>
 struct NodeMapTraits {
   using KeyType = KeyT;
   using Node = NodeT;
   using ExtraFields = ExtraT;
+  using NodeContainer = ContainerT;
 
   static KeyType getKey(const std::shared_ptr<Node>& node) {
     return node->getID();
@@ -72,9 +95,10 @@ struct NodeMapTraits {
  * A helper class for implementing state nodes that store a set of Node
  * children.
  *
- * The TraitsT class specifies the Node type, and how to get the map key from a
- * Node object.  The default Traits implementation calls the getID() method on
- * the Node.
+ * The TraitsT class specifies the Node type, the container used to store
+ * the nodes, and how to get the map key from a Node object.  The default
+ * Traits implementation stores nodes in a flat_map and calls the getID()
+ * method on the Node.
  */
 template <typename MapTypeT, typename TraitsT>
 class NodeMapT : public NodeBaseT<MapTypeT,
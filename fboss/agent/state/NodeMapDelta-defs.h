@@ -30,12 +30,7 @@ NodeMapDelta<MAP, VALUE, MAPPOINTERTRAITS>::Iterator::Iterator(
     newMap_(newMap),
     value_(nullNode_, nullNode_) {
   // Advance to the first difference
-  while (oldIt_ != oldMap_->end() &&
-         newIt_ != newMap_->end() &&
-         *oldIt_ == *newIt_) {
-    ++oldIt_;
-    ++newIt_;
-  }
+  skipUnchanged();
   updateValue();
 }
 
@@ -103,13 +98,22 @@ void NodeMapDelta<MAP, VALUE, MAPPOINTERTRAITS>::Iterator::advance() {
   }
 
   // Advance past any unchanged nodes.
+  skipUnchanged();
+  updateValue();
+}
+
+template<typename MAP, typename VALUE, typename MAPPOINTERTRAITS>
+void NodeMapDelta<MAP, VALUE, MAPPOINTERTRAITS>::Iterator::skipUnchanged() {
   while (oldIt_ != oldMap_->end() &&
          newIt_ != newMap_->end() &&
          *oldIt_ == *newIt_) {
-    ++oldIt_;
-    ++newIt_;
+    // If both maps still share the storage holding this node, every other
+    // node in that storage is unchanged too and can be skipped in one go.
+    if (!oldIt_.skipShared(newIt_)) {
+      ++oldIt_;
+      ++newIt_;
+    }
   }
-  updateValue();
 }
 
 }} // facebook::fboss
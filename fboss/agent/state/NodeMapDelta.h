@@ -55,6 +55,10 @@ class MapUniquePointerTraits {
  *
  * The main function of this class is the Iterator that it provides.  This
  * allows caller to walk over the changed, added, and removed nodes.
+ *
+ * For NodeMaps stored in a PersistentNodeContainer the Iterator skips over
+ * whole subtrees that the old and new maps still share, so walking the delta
+ * costs O(changes * log(size)) rather than O(size).
  */
 template<typename MAP,
   typename VALUE = DeltaValue<typename MAP::Node>,
@@ -186,6 +190,7 @@ class NodeMapDelta<MAP, VALUE, MAPPOINTERTRAITS>::Iterator {
   using Traits = typename MapType::Traits;
 
   void advance();
+  void skipUnchanged();
   void updateValue();
 
   InnerIter oldIt_{nullptr};
@@ -12,7 +12,21 @@
 #include <boost/container/flat_map.hpp>
 
 /*
- * NodeMapIterator is a very small wrapper around flat_map::const_iterator.
+ * Advance a and b past any entries that are shared by the containers they
+ * iterate over, returning true if anything was skipped.
+ *
+ * NodeContainers that share storage between copies (PersistentNodeContainer)
+ * provide an overload of this found via ADL.  Other containers can't tell
+ * which entries are shared, so never skip anything.
+ */
+template <typename _Iter>
+bool skipSharedSubtree(_Iter& /*a*/, _Iter& /*b*/) {
+  return false;
+}
+
+/*
+ * NodeMapIterator is a very small wrapper around the const_iterator of the
+ * NodeMap's NodeContainer (a flat_map or a PersistentNodeContainer).
  *
  * The main difference is that dereferencing it returns only the Node,
  * and not a pair of (_Id, _Node)
@@ -46,6 +60,14 @@ class NodeMapIterator : public std::iterator<std::forward_iterator_tag,
     return tmp;
   }
 
+  /*
+   * If this iterator and other point at the same node in storage shared by
+   * both NodeMaps, advance both past the shared nodes and return true.
+   */
+  bool skipShared(NodeMapIterator& other) {
+    return skipSharedSubtree(it_, other.it_);
+  }
+
   bool operator==(const NodeMapIterator& other) const {
     return it_ == other.it_;
   }
@@ -58,8 +80,8 @@ class NodeMapIterator : public std::iterator<std::forward_iterator_tag,
 };
 
 /*
- * ReverseNodeMapIterator is a very small wrapper around
- * flat_map::const_reverse_iterator.
+ * ReverseNodeMapIterator is a very small wrapper around the
+ * const_reverse_iterator of the NodeMap's NodeContainer.
  *
  * The main difference is that dereferencing it returns only the Node,
  * and not a pair of (_Id, _Node)
@@ -0,0 +1,675 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace facebook { namespace fboss {
+
+/*
+ * PersistentNodeContainer is an ordered map implemented as a B+tree whose
+ * tree nodes are shared between copies of the container.
+ *
+ * It exposes the subset of the boost::container::flat_map API that NodeMapT
+ * and its users rely on, so it can be used as the NodeContainer of a NodeMap
+ * (see NodeMapTraits).  The difference is in the cost model:
+ *
+ *  - Copying the container is O(1): only the root pointer is copied.
+ *  - insert()/erase()/find() on a non-const container are O(log n).  Any tree
+ *    node on the path that is still shared with another copy of the container
+ *    is cloned first (path copying), so earlier copies are never modified.
+ *
+ * This is what makes it attractive for NodeMaps with very large numbers of
+ * entries (ARP/NDP tables, routes): cloning the NodeMap to modify a single
+ * entry copies O(log n) tree nodes rather than the entire flat vector.
+ *
+ * Tree nodes that are only referenced by this container are modified in place,
+ * so a sequence of modifications on an unpublished NodeMap only pays the path
+ * copying cost the first time a path is touched.
+ *
+ * Iterators obtained from a non-const container are mutable and unshare tree
+ * nodes lazily as they visit them; iterators obtained from a const container
+ * never modify the tree.  As with flat_map, any insert or erase invalidates
+ * all iterators.
+ */
+template <
+    typename KeyT,
+    typename ValueT,
+    typename CompareT = std::less<KeyT>,
+    size_t kMaxNodeSize = 32>
+class PersistentNodeContainer {
+  static_assert(kMaxNodeSize >= 4, "B+tree nodes must hold at least 4 items");
+
+ public:
+  using key_type = KeyT;
+  using mapped_type = ValueT;
+  using value_type = std::pair<KeyT, ValueT>;
+  using key_compare = CompareT;
+  using size_type = size_t;
+  using difference_type = ptrdiff_t;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+
+ private:
+  struct TreeNode;
+  using TreeNodePtr = std::shared_ptr<TreeNode>;
+
+  template <bool kConst>
+  class IteratorImpl;
+
+ public:
+  using iterator = IteratorImpl<false>;
+  using const_iterator = IteratorImpl<true>;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  PersistentNodeContainer() {}
+  PersistentNodeContainer(const PersistentNodeContainer& other) = default;
+  PersistentNodeContainer& operator=(const PersistentNodeContainer& other) =
+      default;
+  PersistentNodeContainer(PersistentNodeContainer&& other) noexcept
+      : root_(std::move(other.root_)), size_(other.size_) {
+    other.size_ = 0;
+  }
+  PersistentNodeContainer& operator=(PersistentNodeContainer&& other) noexcept {
+    root_ = std::move(other.root_);
+    size_ = other.size_;
+    other.size_ = 0;
+    return *this;
+  }
+
+  size_type size() const {
+    return size_;
+  }
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  const_iterator begin() const {
+    return cbegin();
+  }
+  const_iterator end() const {
+    return cend();
+  }
+  const_iterator cbegin() const {
+    const_iterator it(this);
+    if (size_ != 0) {
+      it.descendFirst(root_.get());
+    }
+    return it;
+  }
+  const_iterator cend() const {
+    return const_iterator(this);
+  }
+  const_reverse_iterator rbegin() const {
+    return const_reverse_iterator(end());
+  }
+  const_reverse_iterator rend() const {
+    return const_reverse_iterator(begin());
+  }
+  const_reverse_iterator crbegin() const {
+    return rbegin();
+  }
+  const_reverse_iterator crend() const {
+    return rend();
+  }
+
+  /*
+   * Mutable iteration unshares every tree node it visits, so walking the
+   * whole container through these iterators is O(n) just like copying a
+   * flat_map.  Prefer the const overloads when only reading.
+   */
+  iterator begin() {
+    iterator it(this);
+    if (size_ != 0) {
+      it.descendFirst(mutableRoot());
+    }
+    return it;
+  }
+  iterator end() {
+    return iterator(this);
+  }
+  reverse_iterator rbegin() {
+    return reverse_iterator(end());
+  }
+  reverse_iterator rend() {
+    return reverse_iterator(begin());
+  }
+
+  const_iterator find(const KeyT& key) const {
+    auto it = lower_bound(key);
+    if (it != end() && !comp_(key, it->first)) {
+      return it;
+    }
+    return end();
+  }
+  iterator find(const KeyT& key) {
+    if (static_cast<const PersistentNodeContainer*>(this)->find(key) ==
+        cend()) {
+      // Avoid unsharing the path when the key isn't present
+      return end();
+    }
+    return lower_bound(key);
+  }
+
+  size_type count(const KeyT& key) const {
+    return find(key) == end() ? 0 : 1;
+  }
+
+  const_iterator lower_bound(const KeyT& key) const {
+    const_iterator it(this);
+    if (size_ != 0) {
+      it.seek(root_.get(), key, false);
+    }
+    return it;
+  }
+  iterator lower_bound(const KeyT& key) {
+    iterator it(this);
+    if (size_ != 0) {
+      it.seek(mutableRoot(), key, false);
+    }
+    return it;
+  }
+  const_iterator upper_bound(const KeyT& key) const {
+    const_iterator it(this);
+    if (size_ != 0) {
+      it.seek(root_.get(), key, true);
+    }
+    return it;
+  }
+
+  const ValueT& at(const KeyT& key) const {
+    auto it = find(key);
+    if (it == end()) {
+      throw std::out_of_range("PersistentNodeContainer::at");
+    }
+    return it->second;
+  }
+
+  ValueT& operator[](const KeyT& key) {
+    auto it = find(key);
+    if (it == end()) {
+      it = insert(value_type(key, ValueT())).first;
+    }
+    return it->second;
+  }
+
+  std::pair<iterator, bool> insert(value_type value) {
+    if (static_cast<const PersistentNodeContainer*>(this)->find(value.first) !=
+        cend()) {
+      return std::make_pair(find(value.first), false);
+    }
+    KeyT key = value.first;
+    auto sibling = insertImpl(mutableRoot(), std::move(value));
+    if (sibling) {
+      auto newRoot = std::make_shared<TreeNode>(false);
+      newRoot->keys.push_back(minKey(root_.get()));
+      newRoot->keys.push_back(minKey(sibling.get()));
+      newRoot->children.push_back(std::move(root_));
+      newRoot->children.push_back(std::move(sibling));
+      root_ = std::move(newRoot);
+    }
+    ++size_;
+    return std::make_pair(lower_bound(key), true);
+  }
+
+  // flat_map compatibility: the hint is ignored, since finding the insert
+  // position is O(log n) regardless.
+  iterator insert(const_iterator /*hint*/, value_type value) {
+    return insert(std::move(value)).first;
+  }
+
+  template <typename... Args>
+  std::pair<iterator, bool> emplace(Args&&... args) {
+    return insert(value_type(std::forward<Args>(args)...));
+  }
+
+  template <typename... Args>
+  iterator emplace_hint(const_iterator /*hint*/, Args&&... args) {
+    return insert(value_type(std::forward<Args>(args)...)).first;
+  }
+
+  size_type erase(const KeyT& key) {
+    if (static_cast<const PersistentNodeContainer*>(this)->find(key) ==
+        cend()) {
+      return 0;
+    }
+    auto* root = mutableRoot();
+    eraseImpl(root, key);
+    --size_;
+    if (!root->isLeaf && root->children.size() == 1) {
+      // Collapse the root once it only has a single child.
+      TreeNodePtr child = std::move(root->children.front());
+      root_ = std::move(child);
+    }
+    return 1;
+  }
+
+  iterator erase(const_iterator pos) {
+    KeyT key = pos->first;
+    erase(key);
+    return lower_bound(key);
+  }
+  iterator erase(iterator pos) {
+    return erase(const_iterator(pos));
+  }
+
+  void clear() {
+    root_.reset();
+    size_ = 0;
+  }
+
+  void swap(PersistentNodeContainer& other) noexcept {
+    std::swap(root_, other.root_);
+    std::swap(size_, other.size_);
+  }
+
+  bool operator==(const PersistentNodeContainer& other) const {
+    return size_ == other.size_ && std::equal(begin(), end(), other.begin());
+  }
+  bool operator!=(const PersistentNodeContainer& other) const {
+    return !(*this == other);
+  }
+
+ private:
+  static constexpr size_t kMinNodeSize = kMaxNodeSize / 2;
+
+  struct TreeNode {
+    explicit TreeNode(bool leaf) : isLeaf(leaf) {}
+
+    size_t nodeSize() const {
+      return isLeaf ? entries.size() : children.size();
+    }
+
+    bool isLeaf;
+    // Populated for leaf nodes only.
+    std::vector<value_type> entries;
+    // Populated for internal nodes only.  keys[i] is the smallest key stored
+    // anywhere underneath children[i].
+    std::vector<KeyT> keys;
+    std::vector<TreeNodePtr> children;
+  };
+
+  /*
+   * Return a pointer to the tree node held in slot, cloning it first if it is
+   * still shared with another container.  The caller must own the node that
+   * holds slot exclusively.
+   */
+  static TreeNode* unshare(TreeNodePtr& slot) {
+    if (slot.use_count() > 1) {
+      slot = std::make_shared<TreeNode>(*slot);
+    }
+    return slot.get();
+  }
+
+  TreeNode* mutableRoot() {
+    if (!root_) {
+      root_ = std::make_shared<TreeNode>(true);
+    }
+    return unshare(root_);
+  }
+
+  static const KeyT& minKey(const TreeNode* node) {
+    return node->isLeaf ? node->entries.front().first : node->keys.front();
+  }
+
+  size_t childIndex(const TreeNode* node, const KeyT& key) const {
+    auto it = std::upper_bound(
+        node->keys.begin(), node->keys.end(), key, comp_);
+    return it == node->keys.begin() ? 0 : (it - node->keys.begin()) - 1;
+  }
+
+  size_t entryIndex(const TreeNode* node, const KeyT& key, bool upper) const {
+    auto& entries = node->entries;
+    if (upper) {
+      return std::upper_bound(
+                 entries.begin(),
+                 entries.end(),
+                 key,
+                 [this](const KeyT& k, const value_type& v) {
+                   return comp_(k, v.first);
+                 }) -
+          entries.begin();
+    }
+    return std::lower_bound(
+               entries.begin(),
+               entries.end(),
+               key,
+               [this](const value_type& v, const KeyT& k) {
+                 return comp_(v.first, k);
+               }) -
+        entries.begin();
+  }
+
+  /*
+   * Split an overfull node in half, returning the new right hand sibling.
+   */
+  static TreeNodePtr split(TreeNode* node) {
+    auto sibling = std::make_shared<TreeNode>(node->isLeaf);
+    auto half = node->nodeSize() / 2;
+    if (node->isLeaf) {
+      sibling->entries.assign(
+          std::make_move_iterator(node->entries.begin() + half),
+          std::make_move_iterator(node->entries.end()));
+      node->entries.resize(half);
+    } else {
+      sibling->keys.assign(node->keys.begin() + half, node->keys.end());
+      sibling->children.assign(
+          std::make_move_iterator(node->children.begin() + half),
+          std::make_move_iterator(node->children.end()));
+      node->keys.resize(half);
+      node->children.resize(half);
+    }
+    return sibling;
+  }
+
+  /*
+   * Insert value into the subtree rooted at node, which must not already
+   * contain the key.  Returns the new right hand sibling if node had to be
+   * split.
+   */
+  TreeNodePtr insertImpl(TreeNode* node, value_type&& value) {
+    if (node->isLeaf) {
+      auto idx = entryIndex(node, value.first, false);
+      node->entries.insert(node->entries.begin() + idx, std::move(value));
+    } else {
+      auto idx = childIndex(node, value.first);
+      auto* child = unshare(node->children[idx]);
+      auto sibling = insertImpl(child, std::move(value));
+      node->keys[idx] = minKey(child);
+      if (sibling) {
+        node->keys.insert(node->keys.begin() + idx + 1, minKey(sibling.get()));
+        node->children.insert(
+            node->children.begin() + idx + 1, std::move(sibling));
+      }
+    }
+    if (node->nodeSize() > kMaxNodeSize) {
+      return split(node);
+    }
+    return nullptr;
+  }
+
+  /*
+   * Remove key, which must be present, from the subtree rooted at node.
+   * Children left with fewer than kMinNodeSize items are merged with or
+   * refilled from a sibling.
+   */
+  void eraseImpl(TreeNode* node, const KeyT& key) {
+    if (node->isLeaf) {
+      auto idx = entryIndex(node, key, false);
+      node->entries.erase(node->entries.begin() + idx);
+      return;
+    }
+    auto idx = childIndex(node, key);
+    auto* child = unshare(node->children[idx]);
+    eraseImpl(child, key);
+    if (child->nodeSize() >= kMinNodeSize) {
+      node->keys[idx] = minKey(child);
+      return;
+    }
+    rebalance(node, idx == 0 ? 0 : idx - 1);
+  }
+
+  /*
+   * Redistribute the items of node->children[idx] and node->children[idx + 1]
+   * so that both are at least half full, merging them if they fit in one.
+   */
+  void rebalance(TreeNode* node, size_t idx) {
+    if (idx + 1 >= node->children.size()) {
+      // Only the root may have a single child, and erase() collapses it.
+      if (node->children[idx]->nodeSize() != 0) {
+        node->keys[idx] = minKey(node->children[idx].get());
+      }
+      return;
+    }
+    auto* left = unshare(node->children[idx]);
+    auto* right = unshare(node->children[idx + 1]);
+    if (left->isLeaf) {
+      left->entries.insert(
+          left->entries.end(),
+          std::make_move_iterator(right->entries.begin()),
+          std::make_move_iterator(right->entries.end()));
+      right->entries.clear();
+    } else {
+      left->keys.insert(
+          left->keys.end(), right->keys.begin(), right->keys.end());
+      left->children.insert(
+          left->children.end(),
+          std::make_move_iterator(right->children.begin()),
+          std::make_move_iterator(right->children.end()));
+      right->keys.clear();
+      right->children.clear();
+    }
+    if (left->nodeSize() <= kMaxNodeSize) {
+      node->keys.erase(node->keys.begin() + idx + 1);
+      node->children.erase(node->children.begin() + idx + 1);
+    } else {
+      node->children[idx + 1] = split(left);
+      node->keys[idx + 1] = minKey(node->children[idx + 1].get());
+    }
+    if (left->nodeSize() != 0) {
+      node->keys[idx] = minKey(left);
+    }
+  }
+
+  template <bool kConst>
+  class IteratorImpl {
+   public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = typename PersistentNodeContainer::value_type;
+    using difference_type = ptrdiff_t;
+    using pointer =
+        typename std::conditional<kConst, const value_type*, value_type*>::type;
+    using reference =
+        typename std::conditional<kConst, const value_type&, value_type&>::type;
+
+    IteratorImpl() {}
+    // Allow conversion from a mutable iterator to a const one.
+    template <bool kOtherConst, typename = typename std::enable_if<
+        kConst && !kOtherConst>::type>
+    /* implicit */ IteratorImpl(const IteratorImpl<kOtherConst>& other)
+        : container_(other.container_) {
+      path_.reserve(other.path_.size());
+      for (const auto& step : other.path_) {
+        path_.emplace_back(step.first, step.second);
+      }
+    }
+
+    reference operator*() const {
+      const auto& step = path_.back();
+      return step.first->entries[step.second];
+    }
+    pointer operator->() const {
+      return &operator*();
+    }
+
+    IteratorImpl& operator++() {
+      auto& leaf = path_.back();
+      if (++leaf.second < leaf.first->entries.size()) {
+        return *this;
+      }
+      path_.pop_back();
+      while (!path_.empty()) {
+        auto& step = path_.back();
+        if (++step.second < step.first->children.size()) {
+          descendFirst(child(step.first, step.second));
+          return *this;
+        }
+        path_.pop_back();
+      }
+      return *this;
+    }
+    IteratorImpl operator++(int) {
+      IteratorImpl tmp(*this);
+      ++(*this);
+      return tmp;
+    }
+
+    IteratorImpl& operator--() {
+      if (path_.empty()) {
+        descendLast(root());
+        return *this;
+      }
+      auto& leaf = path_.back();
+      if (leaf.second > 0) {
+        --leaf.second;
+        return *this;
+      }
+      path_.pop_back();
+      while (!path_.empty()) {
+        auto& step = path_.back();
+        if (step.second > 0) {
+          --step.second;
+          descendLast(child(step.first, step.second));
+          return *this;
+        }
+        path_.pop_back();
+      }
+      return *this;
+    }
+    IteratorImpl operator--(int) {
+      IteratorImpl tmp(*this);
+      --(*this);
+      return tmp;
+    }
+
+    /*
+     * Used when diffing two containers (see NodeMapDelta): if a and b point
+     * at the same entry in a leaf shared by both containers, advance both past
+     * the largest subtree containing that entry that is shared by both and
+     * return true.  Otherwise leave them untouched and return false.
+     *
+     * Since copies of a container share every tree node that hasn't been
+     * modified since, this lets a diff skip all unchanged entries in
+     * O(log n) steps per changed entry.
+     */
+    friend bool skipSharedSubtree(IteratorImpl& a, IteratorImpl& b) {
+      if (a.path_.empty() || b.path_.empty() ||
+          a.path_.back() != b.path_.back()) {
+        return false;
+      }
+      size_t depth = 1;
+      while (depth < a.path_.size() && depth < b.path_.size() &&
+             a.path_[a.path_.size() - 1 - depth] ==
+                 b.path_[b.path_.size() - 1 - depth]) {
+        ++depth;
+      }
+      a.skipSubtree(depth);
+      b.skipSubtree(depth);
+      return true;
+    }
+
+    bool operator==(const IteratorImpl& other) const {
+      if (path_.empty() || other.path_.empty()) {
+        return path_.empty() && other.path_.empty();
+      }
+      return path_.back() == other.path_.back();
+    }
+    bool operator!=(const IteratorImpl& other) const {
+      return !operator==(other);
+    }
+
+   private:
+    using ContainerPtr = typename std::conditional<
+        kConst,
+        const PersistentNodeContainer*,
+        PersistentNodeContainer*>::type;
+    using NodePtr =
+        typename std::conditional<kConst, const TreeNode*, TreeNode*>::type;
+
+    explicit IteratorImpl(ContainerPtr container) : container_(container) {}
+
+    NodePtr root() const {
+      return rootOf(container_);
+    }
+
+    static const TreeNode* rootOf(const PersistentNodeContainer* container) {
+      return container->root_.get();
+    }
+    static TreeNode* rootOf(PersistentNodeContainer* container) {
+      return container->mutableRoot();
+    }
+
+    static const TreeNode* child(const TreeNode* node, size_t idx) {
+      return node->children[idx].get();
+    }
+    static TreeNode* child(TreeNode* node, size_t idx) {
+      return unshare(node->children[idx]);
+    }
+
+    void descendFirst(NodePtr node) {
+      while (!node->isLeaf) {
+        path_.emplace_back(node, 0);
+        node = child(node, 0);
+      }
+      path_.emplace_back(node, 0);
+    }
+
+    void descendLast(NodePtr node) {
+      while (!node->isLeaf) {
+        path_.emplace_back(node, node->children.size() - 1);
+        node = child(node, node->children.size() - 1);
+      }
+      path_.emplace_back(node, node->entries.size() - 1);
+    }
+
+    /*
+     * Advance to the first entry after the subtree rooted at the tree node
+     * depth levels up the current path (1 being the current leaf).
+     */
+    void skipSubtree(size_t depth) {
+      auto subtree = path_[path_.size() - depth].first;
+      path_.resize(path_.size() - depth);
+      descendLast(subtree);
+      ++(*this);
+    }
+
+    /*
+     * Position the iterator at the first entry whose key is not less than
+     * (or, if upper is set, greater than) key.
+     */
+    void seek(NodePtr node, const KeyT& key, bool upper) {
+      while (!node->isLeaf) {
+        auto idx = container_->childIndex(node, key);
+        path_.emplace_back(node, idx);
+        node = child(node, idx);
+      }
+      auto idx = container_->entryIndex(node, key, upper);
+      path_.emplace_back(node, idx);
+      if (idx == node->entries.size()) {
+        // The next entry, if any, lives in the following leaf.
+        --path_.back().second;
+        ++(*this);
+      }
+    }
+
+    ContainerPtr container_{nullptr};
+    std::vector<std::pair<NodePtr, size_t>> path_;
+
+    friend class PersistentNodeContainer;
+    template <bool kOtherConst>
+    friend class IteratorImpl;
+  };
+
+  TreeNodePtr root_;
+  size_type size_{0};
+  CompareT comp_;
+};
+
+}} // facebook::fboss
@@ -45,8 +45,8 @@ FBOSS_INSTANTIATE_NODE_MAP(
     RouteTableRibNodeMap<folly::IPAddressV6>,
     RouteTableRibNodeMapTraits<folly::IPAddressV6>);
 
-template <typename AddrT>
-folly::dynamic RouteTableRib<AddrT>::toFollyDynamic() const {
+template <typename AddrT, typename RoutesTreeT>
+folly::dynamic RouteTableRib<AddrT, RoutesTreeT>::toFollyDynamic() const {
   folly::dynamic routesJson = folly::dynamic::array;
   for (const auto& route: *nodeMap_) {
     routesJson.push_back(route->toFollyDynamic());
@@ -56,10 +56,11 @@ folly::dynamic RouteTableRib<AddrT>::toFollyDynamic() const {
   return routes;
 }
 
-template <typename AddrT>
-std::shared_ptr<RouteTableRib<AddrT>>
-RouteTableRib<AddrT>::fromFollyDynamic(const folly::dynamic& routes) {
-  auto rib = std::make_shared<RouteTableRib<AddrT>>();
+template <typename AddrT, typename RoutesTreeT>
+std::shared_ptr<RouteTableRib<AddrT, RoutesTreeT>>
+RouteTableRib<AddrT, RoutesTreeT>::fromFollyDynamic(
+    const folly::dynamic& routes) {
+  auto rib = std::make_shared<RouteTableRib<AddrT, RoutesTreeT>>();
   auto routesJson = routes[kRoutes];
   for (const auto& routeJson: routesJson) {
     auto route = Route<AddrT>::fromFollyDynamic(routeJson);
@@ -69,8 +70,8 @@ RouteTableRib<AddrT>::fromFollyDynamic(const folly::dynamic& routes) {
   return rib;
 }
 
-template <typename AddrT>
-RouteTableRib<AddrT>* RouteTableRib<AddrT>::modify(
+template <typename AddrT, typename RoutesTreeT>
+RouteTableRib<AddrT, RoutesTreeT>* RouteTableRib<AddrT, RoutesTreeT>::modify(
     RouterID id,
     std::shared_ptr<SwitchState>* state) {
   if (!isPublished()) {
@@ -100,20 +101,20 @@ RouteTableRib<AddrT>* RouteTableRib<AddrT>::modify(
   return clonedRibPtr;
 }
 
-template <typename AddrT>
-void RouteTableRib<AddrT>::addRoute(
+template <typename AddrT, typename RoutesTreeT>
+void RouteTableRib<AddrT, RoutesTreeT>::addRoute(
     const std::shared_ptr<Route<AddrT>>& route) {
   nodeMap_->addRoute(route);
 }
 
-template <typename AddrT>
-void RouteTableRib<AddrT>::updateRoute(
+template <typename AddrT, typename RoutesTreeT>
+void RouteTableRib<AddrT, RoutesTreeT>::updateRoute(
     const std::shared_ptr<Route<AddrT>>& route) {
   nodeMap_->updateRoute(route);
 }
 
-template <typename AddrT>
-void RouteTableRib<AddrT>::removeRoute(
+template <typename AddrT, typename RoutesTreeT>
+void RouteTableRib<AddrT, RoutesTreeT>::removeRoute(
     const std::shared_ptr<Route<AddrT>>& route) {
   nodeMap_->removeRoute(route);
 }
@@ -22,11 +22,9 @@ template<typename AddrT>
 class Route;
 class SwitchState;
 
-template <typename AddrT>
-class RouteTableRib;
-
 template<typename AddrT> using RouteTableRibNodeMapTraits
-  = NodeMapTraits<RoutePrefix<AddrT>, Route<AddrT>>;
+  = NodeMapTraits<RoutePrefix<AddrT>, Route<AddrT>, NodeMapNoExtraFields,
+                  NodeMapPersistentContainer<RoutePrefix<AddrT>, Route<AddrT>>>;
 
 template<typename AddrT>
 class RouteTableRibNodeMap
@@ -66,7 +64,13 @@ class RouteTableRibNodeMap
   friend class CloneAllocator;
 };
 
-template<typename AddrT>
+/*
+ * RoutesTreeT is the tree used for longest prefix matching, either a
+ * RadixTree or a MultibitTrie, which is smaller and faster to search for
+ * large tables. RouteTable holds RouteTableRibs with the default tree.
+ */
+template <typename AddrT, typename RoutesTreeT =
+  facebook::network::RadixTree<AddrT, std::shared_ptr<Route<AddrT>>>>
 class RouteTableRib : public NodeBase {
  public:
   using RoutesNodeMap = RouteTableRibNodeMap<AddrT>;
@@ -78,8 +82,7 @@ class RouteTableRib : public NodeBase {
 
   using Prefix =  RoutePrefix<AddrT>;
   using RouteType = Route<AddrT>;
-  using RoutesRadixTree = facebook::network::RadixTree<AddrT,
-        std::shared_ptr<Route<AddrT>>>;
+  using RoutesRadixTree = RoutesTreeT;
 
   bool empty() const {
     return nodeMap_->empty();
@@ -247,6 +247,35 @@ void RouteUpdater::removeAllRoutesForClient(RouterID rid, ClientID clientId) {
   removeAllRoutesForClientImpl<IPAddressV6>(getRibV6(rid), clientId);
 }
 
+template<typename AddrT, typename RibT>
+void RouteUpdater::removeRoutesForClientIfImpl(
+    RibT *ribCloned, ClientID clientId, const PrefixPredicate& shouldRemove) {
+  if (!ribCloned) {
+    return;
+  }
+  // Find the routes to delete without cloning the rib, so that nothing gets
+  // copied when the client has no routes to remove.
+  std::vector<RoutePrefix<AddrT>> prefixesToDelete;
+  for (const auto& route : *ribCloned->rib->routes()) {
+    const auto& prefix = route->prefix();
+    if (route->getEntryForClient(clientId) &&
+        shouldRemove(folly::IPAddress(prefix.network), prefix.mask)) {
+      prefixesToDelete.push_back(prefix);
+    }
+  }
+  for (const auto& prefix : prefixesToDelete) {
+    delRouteImpl(prefix, ribCloned, clientId);
+  }
+}
+
+void RouteUpdater::removeRoutesForClientIf(
+    RouterID rid, ClientID clientId, const PrefixPredicate& shouldRemove) {
+  removeRoutesForClientIfImpl<IPAddressV4>(
+      getRibV4(rid, false), clientId, shouldRemove);
+  removeRoutesForClientIfImpl<IPAddressV6>(
+      getRibV6(rid, false), clientId, shouldRemove);
+}
+
 // Some helper functions for recursive weight resolution
 // These aren't really usefully reusable, but structuring them
 // this way helps with clarifying their meaning.
@@ -16,10 +16,13 @@
 #include "fboss/agent/state/RouteNextHopsMulti.h"
 #include "fboss/agent/state/RouteTypes.h"
 #include "fboss/agent/state/RouteTableMap.h"
+#include "fboss/agent/state/RouteTableRib.h"
 
 #include <boost/container/flat_map.hpp>
 #include <boost/container/flat_set.hpp>
 
+#include <functional>
+
 namespace facebook { namespace fboss {
 
 namespace cfg {
@@ -27,7 +30,6 @@ class SwitchConfig;
 }
 
 class InterfaceMap;
-template<typename Addr> class RouteTableRib;
 
 /**
  * Expected behavior of RouteUpdater::resolve():
@@ -77,6 +79,13 @@ class RouteUpdater {
   // method to delete all routes from a client
   void removeAllRoutesForClient(RouterID rid, ClientID clientId);
 
+  // method to delete the routes from a client for which shouldRemove()
+  // returns true, given the network and mask of the route
+  using PrefixPredicate =
+      std::function<bool(const folly::IPAddress&, uint8_t)>;
+  void removeRoutesForClientIf(
+      RouterID rid, ClientID clientId, const PrefixPredicate& shouldRemove);
+
   std::shared_ptr<RouteTableMap> updateDone();
 
   // Add all interface routes (directly connected routes) and link local routes
@@ -124,6 +133,9 @@ class RouteUpdater {
   void delRouteImpl(const PrefixT& prefix, RibT *ribCloned, ClientID clientId);
   template<typename AddrT, typename RibT>
   void removeAllRoutesForClientImpl(RibT *ribCloned, ClientID clientId);
+  template<typename AddrT, typename RibT>
+  void removeRoutesForClientIfImpl(
+      RibT *ribCloned, ClientID clientId, const PrefixPredicate& shouldRemove);
 
   // resolve all routes that are not resolved yet
   void resolve();
@@ -29,10 +29,18 @@ class FunctionStateUpdate : public StateUpdate {
     std::shared_ptr<SwitchState>(const std::shared_ptr<SwitchState>&)>
     StateUpdateFn;
 
+  typedef std::function<void()> SuccessFn;
+
+  /*
+   * successFn, if set, is called from onSuccess(), i.e. once the update has
+   * been handed to the HwSwitch.
+   */
   FunctionStateUpdate(folly::StringPiece name, StateUpdateFn fn,
-                      bool allowCoalesce = true)
+                      bool allowCoalesce = true,
+                      SuccessFn successFn = nullptr)
     : StateUpdate(name, allowCoalesce),
-      function_(fn) {}
+      function_(fn),
+      successFn_(std::move(successFn)) {}
 
   std::shared_ptr<SwitchState> applyUpdate(
       const std::shared_ptr<SwitchState>& origState) override {
@@ -44,8 +52,15 @@ class FunctionStateUpdate : public StateUpdate {
                 << ">: " << folly::exceptionStr(ex);
   }
 
+  void onSuccess() override {
+    if (successFn_) {
+      successFn_();
+    }
+  }
+
  private:
   StateUpdateFn function_;
+  SuccessFn successFn_;
 };
 
 /*
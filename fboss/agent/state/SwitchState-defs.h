@@ -62,4 +62,22 @@ void SwitchState::revertNewRouteEntry(
   CHECK_EQ(clonedRib->size(), clonedRib->writableRoutesRadixTree().size());
 }
 
+template <typename AddressT>
+void SwitchState::revertNewFibEntry(
+    const RouterID& id,
+    const std::shared_ptr<Route<AddressT>>& newRoute,
+    const std::shared_ptr<Route<AddressT>>& oldRoute,
+    std::shared_ptr<SwitchState>* appliedState) {
+  auto fib = (*appliedState)
+                 ->getFibs()
+                 ->getNode(id)
+                 ->template getFib<AddressT>();
+  auto clonedFib = fib->modify(id, appliedState);
+  if (oldRoute) {
+    clonedFib->updateNode(oldRoute);
+  } else {
+    clonedFib->removeNode(newRoute);
+  }
+}
+
 }}
@@ -15,6 +15,8 @@
 #include "fboss/agent/state/AggregatePort.h"
 #include "fboss/agent/state/AggregatePortMap.h"
 #include "fboss/agent/state/ControlPlane.h"
+#include "fboss/agent/state/ForwardingInformationBaseContainer.h"
+#include "fboss/agent/state/ForwardingInformationBaseMap.h"
 #include "fboss/agent/state/Interface.h"
 #include "fboss/agent/state/InterfaceMap.h"
 #include "fboss/agent/state/Port.h"
@@ -256,6 +258,11 @@ void SwitchState::resetMirrors(std::shared_ptr<MirrorMap> mirrors) {
   writableFields()->mirrors.swap(mirrors);
 }
 
+void SwitchState::resetForwardingInformationBases(
+    std::shared_ptr<ForwardingInformationBaseMap> fibs) {
+  writableFields()->fibs.swap(fibs);
+}
+
 const std::shared_ptr<MirrorMap>& SwitchState::getMirrors() const {
   return getFields()->mirrors;
 }
@@ -265,6 +272,26 @@ const std::shared_ptr<ForwardingInformationBaseMap>& SwitchState::getFibs()
   return getFields()->fibs;
 }
 
+template <typename AddressT>
+std::shared_ptr<Route<AddressT>> SwitchState::longestMatchRoute(
+    RouterID vrf,
+    const AddressT& address) const {
+  auto fibContainer = getFibs()->getFibContainerIf(vrf);
+  if (fibContainer) {
+    return fibContainer->getFib<AddressT>()->longestMatch(address);
+  }
+  auto routeTable = getRouteTables()->getRouteTableIf(vrf);
+  if (!routeTable) {
+    return nullptr;
+  }
+  return routeTable->getRib<AddressT>()->longestMatch(address);
+}
+
+template std::shared_ptr<Route<folly::IPAddressV4>>
+SwitchState::longestMatchRoute(RouterID, const folly::IPAddressV4&) const;
+template std::shared_ptr<Route<folly::IPAddressV6>>
+SwitchState::longestMatchRoute(RouterID, const folly::IPAddressV6&) const;
+
 template class NodeBaseT<SwitchState, SwitchStateFields>;
 
 }} // facebook::fboss
@@ -179,6 +179,13 @@ class SwitchState : public NodeBaseT<SwitchState, SwitchStateFields> {
       const std::shared_ptr<Route<AddressT>>& oldRoute,
       std::shared_ptr<SwitchState>* appliedState);
 
+  template <typename AddressT>
+  static void revertNewFibEntry(
+      const RouterID& id,
+      const std::shared_ptr<Route<AddressT>>& newRoute,
+      const std::shared_ptr<Route<AddressT>>& oldRoute,
+      std::shared_ptr<SwitchState>* appliedState);
+
   const std::shared_ptr<PortMap>& getPorts() const {
     return getFields()->ports;
   }
@@ -289,6 +296,19 @@ class SwitchState : public NodeBaseT<SwitchState, SwitchStateFields> {
   const std::shared_ptr<MirrorMap>& getMirrors() const;
   const std::shared_ptr<ForwardingInformationBaseMap>& getFibs() const;
 
+  /*
+   * Longest prefix match of address among the routes of vrf. The routes are
+   * looked up in the ForwardingInformationBase of vrf if there is one, which
+   * is the case when routes are kept in a standalone RIB, and in its
+   * RouteTable otherwise.
+   *
+   * Returns nullptr if there is no match.
+   */
+  template <typename AddressT>
+  std::shared_ptr<Route<AddressT>> longestMatchRoute(
+      RouterID vrf,
+      const AddressT& address) const;
+
   /*
    * The following functions modify the static state.
    * The should only be called on newly created SwitchState objects that are
@@ -314,6 +334,8 @@ class SwitchState : public NodeBaseT<SwitchState, SwitchStateFields> {
   void resetControlPlane(std::shared_ptr<ControlPlane> cpu);
   void resetLoadBalancers(std::shared_ptr<LoadBalancerMap> loadBalancers);
   void resetMirrors(std::shared_ptr<MirrorMap> mirrors);
+  void resetForwardingInformationBases(
+      std::shared_ptr<ForwardingInformationBaseMap> fibs);
 
  private:
   // Inherit the constructor required for clone()
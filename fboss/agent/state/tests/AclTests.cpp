@@ -16,10 +16,14 @@
 #include "fboss/agent/state/Port.h"
 #include "fboss/agent/state/SwitchState.h"
 
+#include <folly/Conv.h>
 #include <folly/IPAddress.h>
 #include <folly/MacAddress.h>
+#include <gflags/gflags.h>
 #include <gtest/gtest.h>
 
+DECLARE_int32(acl_priority_gap);
+
 using namespace facebook::fboss;
 using std::make_pair;
 using std::make_shared;
@@ -29,6 +33,11 @@ using folly::MacAddress;
 namespace {
 // We offset the start point in ApplyThriftConfig
 constexpr auto kAclStartPriority = 100000;
+
+// The priority of the k-th acl of a config applied to a state with no acls
+int newAclPriority(int k) {
+  return kAclStartPriority + (k + 1) * FLAGS_acl_priority_gap - 1;
+}
 }
 
 TEST(Acl, applyConfig) {
@@ -69,7 +78,7 @@ TEST(Acl, applyConfig) {
   ASSERT_NE(nullptr, aclV1);
   EXPECT_NE(aclV0, aclV1);
 
-  EXPECT_EQ(0 + kAclStartPriority, aclV1->getPriority());
+  EXPECT_EQ(newAclPriority(0), aclV1->getPriority());
   EXPECT_EQ(cfg::AclActionType::DENY, aclV1->getActionType());
   EXPECT_EQ(5, aclV1->getSrcPort());
   EXPECT_EQ(8, aclV1->getDstPort());
@@ -136,7 +145,7 @@ TEST(Acl, applyConfig) {
   auto aclV3 = stateV3->getAcl("acl3");
   ASSERT_NE(nullptr, aclV3);
   EXPECT_NE(aclV0, aclV3);
-  EXPECT_EQ(0 + kAclStartPriority, aclV3->getPriority());
+  EXPECT_EQ(newAclPriority(0), aclV3->getPriority());
   EXPECT_EQ(cfg::AclActionType::PERMIT, aclV3->getActionType());
   EXPECT_FALSE(!aclV3->getSrcL4PortRange());
   EXPECT_EQ(aclV3->getSrcL4PortRange().value().getMin(), 1);
@@ -311,7 +320,7 @@ TEST(Acl, Icmp) {
   EXPECT_NE(nullptr, stateV1);
   auto aclV1 = stateV1->getAcl("acl1");
   ASSERT_NE(nullptr, aclV1);
-  EXPECT_EQ(0 + kAclStartPriority, aclV1->getPriority());
+  EXPECT_EQ(newAclPriority(0), aclV1->getPriority());
   EXPECT_EQ(cfg::AclActionType::DENY, aclV1->getActionType());
   EXPECT_EQ(128, aclV1->getIcmpType().value());
   EXPECT_EQ(0, aclV1->getIcmpCode().value());
@@ -419,14 +428,11 @@ TEST(Acl, AclGeneration) {
   EXPECT_NE(acls->getEntryIf("acl3"), nullptr);
   EXPECT_NE(acls->getEntryIf("acl5"), nullptr);
 
-  EXPECT_EQ(acls->getEntryIf("acl1")->getPriority(), kAclStartPriority);
-  EXPECT_EQ(acls->getEntryIf("acl4")->getPriority(), kAclStartPriority + 1);
-  EXPECT_EQ(acls->getEntryIf("acl2")->getPriority(),
-      kAclStartPriority + 2);
-  EXPECT_EQ(acls->getEntryIf("acl3")->getPriority(),
-      kAclStartPriority + 3);
-  EXPECT_EQ(acls->getEntryIf("acl5")->getPriority(),
-      kAclStartPriority + 4);
+  EXPECT_EQ(acls->getEntryIf("acl1")->getPriority(), newAclPriority(0));
+  EXPECT_EQ(acls->getEntryIf("acl4")->getPriority(), newAclPriority(1));
+  EXPECT_EQ(acls->getEntryIf("acl2")->getPriority(), newAclPriority(2));
+  EXPECT_EQ(acls->getEntryIf("acl3")->getPriority(), newAclPriority(3));
+  EXPECT_EQ(acls->getEntryIf("acl5")->getPriority(), newAclPriority(4));
 
   // Ensure that the global actions in global traffic policy has been added to
   // the ACL entries
@@ -677,3 +683,139 @@ TEST(Acl, TrafficCounterCompatibility) {
   EXPECT_EQ(aclAction.getTrafficCounter()->types.size(), 1);
   EXPECT_EQ(aclAction.getTrafficCounter()->types[0], cfg::CounterType::PACKETS);
 }
+
+TEST(Acl, StablePriorities) {
+  auto platform = createMockPlatform();
+  auto stateV0 = make_shared<SwitchState>();
+
+  cfg::SwitchConfig config;
+  auto setAcls = [&](const std::vector<std::string>& names) {
+    config.acls.resize(names.size());
+    for (size_t i = 0; i < names.size(); ++i) {
+      config.acls[i].name = names[i];
+      config.acls[i].actionType = cfg::AclActionType::DENY;
+      config.acls[i].__isset.srcPort = true;
+      // Keep each acl the same from one config to the next
+      config.acls[i].srcPort = names[i].back() - '0' + 1;
+    }
+  };
+  auto getPriority = [](const shared_ptr<SwitchState>& state,
+                        const std::string& name) {
+    return state->getAcls()->getEntryIf(name)->getPriority();
+  };
+
+  setAcls({"acl1", "acl2", "acl3"});
+  auto stateV1 = publishAndApplyConfig(stateV0, &config, platform.get());
+  ASSERT_NE(nullptr, stateV1);
+  EXPECT_EQ(newAclPriority(0), getPriority(stateV1, "acl1"));
+  EXPECT_EQ(newAclPriority(1), getPriority(stateV1, "acl2"));
+  EXPECT_EQ(newAclPriority(2), getPriority(stateV1, "acl3"));
+
+  // Inserting an acl leaves the others where they are
+  setAcls({"acl0", "acl1", "acl4", "acl2", "acl3"});
+  auto stateV2 = publishAndApplyConfig(stateV1, &config, platform.get());
+  ASSERT_NE(nullptr, stateV2);
+  EXPECT_LT(getPriority(stateV2, "acl0"), getPriority(stateV2, "acl1"));
+  EXPECT_EQ(getPriority(stateV1, "acl1"), getPriority(stateV2, "acl1"));
+  EXPECT_LT(getPriority(stateV2, "acl1"), getPriority(stateV2, "acl4"));
+  EXPECT_LT(getPriority(stateV2, "acl4"), getPriority(stateV2, "acl2"));
+  EXPECT_EQ(getPriority(stateV1, "acl2"), getPriority(stateV2, "acl2"));
+  EXPECT_EQ(getPriority(stateV1, "acl3"), getPriority(stateV2, "acl3"));
+
+  auto delta = StateDelta(stateV1, stateV2);
+  size_t numChanged = 0;
+  for (const auto& aclDelta : delta.getAclsDelta()) {
+    EXPECT_EQ(nullptr, aclDelta.getOld());
+    ++numChanged;
+  }
+  EXPECT_EQ(2, numChanged);
+
+  // Removing one does too
+  setAcls({"acl0", "acl4", "acl2", "acl3"});
+  auto stateV3 = publishAndApplyConfig(stateV2, &config, platform.get());
+  ASSERT_NE(nullptr, stateV3);
+  for (const auto& name : {"acl0", "acl4", "acl2", "acl3"}) {
+    EXPECT_EQ(getPriority(stateV2, name), getPriority(stateV3, name));
+  }
+  EXPECT_EQ(nullptr, stateV3->getAcls()->getEntryIf("acl1"));
+
+  // Moving an acl only moves that acl
+  setAcls({"acl4", "acl2", "acl3", "acl0"});
+  auto stateV4 = publishAndApplyConfig(stateV3, &config, platform.get());
+  ASSERT_NE(nullptr, stateV4);
+  for (const auto& name : {"acl4", "acl2", "acl3"}) {
+    EXPECT_EQ(getPriority(stateV3, name), getPriority(stateV4, name));
+  }
+  EXPECT_GT(getPriority(stateV4, "acl0"), getPriority(stateV4, "acl3"));
+}
+
+TEST(Acl, RebalancePriorities) {
+  auto platform = createMockPlatform();
+  auto stateV0 = make_shared<SwitchState>();
+
+  cfg::SwitchConfig config;
+  auto setAcls = [&](const std::vector<std::string>& names) {
+    config.acls.resize(names.size());
+    for (size_t i = 0; i < names.size(); ++i) {
+      config.acls[i].name = names[i];
+      config.acls[i].actionType = cfg::AclActionType::DENY;
+    }
+  };
+  auto getPriority = [](const shared_ptr<SwitchState>& state,
+                        const std::string& name) {
+    return state->getAcls()->getEntryIf(name)->getPriority();
+  };
+  auto expectInOrder = [&](const shared_ptr<SwitchState>& state) {
+    for (size_t i = 1; i < config.acls.size(); ++i) {
+      EXPECT_LT(
+          getPriority(state, config.acls[i - 1].name),
+          getPriority(state, config.acls[i].name));
+    }
+  };
+  auto newAcls = [](const std::string& prefix, int count) {
+    std::vector<std::string> names;
+    for (int i = 0; i < count; ++i) {
+      names.push_back(folly::to<std::string>(prefix, i));
+    }
+    return names;
+  };
+
+  setAcls({"acl1", "acl2", "acl3", "acl4"});
+  auto stateV1 = publishAndApplyConfig(stateV0, &config, platform.get());
+  ASSERT_NE(nullptr, stateV1);
+
+  // More acls inserted at the top than fit above the first one only move
+  // the first one out of their way
+  auto gap = FLAGS_acl_priority_gap;
+  auto top = newAcls("top", gap + 2);
+  auto names = top;
+  names.insert(names.end(), {"acl1", "acl2", "acl3", "acl4"});
+  setAcls(names);
+  auto stateV2 = publishAndApplyConfig(stateV1, &config, platform.get());
+  ASSERT_NE(nullptr, stateV2);
+  expectInOrder(stateV2);
+  EXPECT_GE(getPriority(stateV2, "top0"), kAclStartPriority);
+  EXPECT_NE(getPriority(stateV1, "acl1"), getPriority(stateV2, "acl1"));
+  for (const auto& name : {"acl2", "acl3", "acl4"}) {
+    EXPECT_EQ(getPriority(stateV1, name), getPriority(stateV2, name));
+  }
+
+  // Filling the gap between two acls moves whichever neighbour leaves the
+  // most room, and nothing further away
+  auto mid = newAcls("mid", gap);
+  names = top;
+  names.insert(names.end(), {"acl1", "acl2"});
+  names.insert(names.end(), mid.begin(), mid.end());
+  names.insert(names.end(), {"acl3", "acl4"});
+  setAcls(names);
+  auto stateV3 = publishAndApplyConfig(stateV2, &config, platform.get());
+  ASSERT_NE(nullptr, stateV3);
+  expectInOrder(stateV3);
+  for (const auto& name : top) {
+    EXPECT_EQ(getPriority(stateV2, name), getPriority(stateV3, name));
+  }
+  EXPECT_EQ(getPriority(stateV2, "acl1"), getPriority(stateV3, "acl1"));
+  EXPECT_EQ(getPriority(stateV2, "acl2"), getPriority(stateV3, "acl2"));
+  EXPECT_NE(getPriority(stateV2, "acl3"), getPriority(stateV3, "acl3"));
+  EXPECT_EQ(getPriority(stateV2, "acl4"), getPriority(stateV3, "acl4"));
+}
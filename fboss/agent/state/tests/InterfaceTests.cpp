@@ -88,6 +88,83 @@ TEST(Interface, addrToReach) {
   EXPECT_EQ(0, ret.mask);
 }
 
+TEST(InterfaceMap, publishedLookups) {
+  auto platform = createMockPlatform();
+  cfg::SwitchConfig config;
+  config.vlans.resize(2);
+  config.vlans[0].id = 1;
+  config.vlans[1].id = 2;
+  config.interfaces.resize(2);
+  config.interfaces[0].intfID = 1;
+  config.interfaces[0].vlanID = 1;
+  config.interfaces[0].__isset.mac = true;
+  config.interfaces[0].mac = "00:02:00:11:22:33";
+  config.interfaces[0].ipAddresses = {"10.0.0.1/8", "2401:db00::1/48"};
+  config.interfaces[1].intfID = 2;
+  config.interfaces[1].vlanID = 2;
+  config.interfaces[1].__isset.mac = true;
+  config.interfaces[1].mac = "00:02:00:11:22:33";
+  config.interfaces[1].ipAddresses = {"10.1.0.1/16", "2401:db00:1::1/64"};
+
+  auto state = publishAndApplyConfig(
+      make_shared<SwitchState>(), &config, platform.get());
+  ASSERT_NE(nullptr, state);
+  auto intfs = state->getInterfaces();
+  auto intf1 = intfs->getInterface(InterfaceID(1));
+  auto intf2 = intfs->getInterface(InterfaceID(2));
+
+  // Published maps answer from their indices, unpublished ones by scanning,
+  // both must agree
+  auto checkLookups = [&]() {
+    EXPECT_EQ(
+        intf1, intfs->getInterfaceIf(RouterID(0), IPAddress("10.0.0.1")));
+    EXPECT_EQ(
+        intf2, intfs->getInterface(RouterID(0), IPAddress("2401:db00:1::1")));
+    EXPECT_EQ(
+        nullptr, intfs->getInterfaceIf(RouterID(0), IPAddress("10.0.0.2")));
+    EXPECT_EQ(
+        nullptr, intfs->getInterfaceIf(RouterID(1), IPAddress("10.0.0.1")));
+    EXPECT_THROW(
+        intfs->getInterface(RouterID(0), IPAddress("10.0.0.2")), FbossError);
+
+    EXPECT_EQ(intf2, intfs->getInterfaceInVlanIf(VlanID(2)));
+    EXPECT_EQ(nullptr, intfs->getInterfaceInVlanIf(VlanID(3)));
+
+    // The longest subnet wins
+    auto ret = intfs->getIntfAddrToReach(RouterID(0), IPAddress("10.1.2.3"));
+    EXPECT_EQ(intf2.get(), ret.intf);
+    EXPECT_EQ(IPAddress("10.1.0.1"), *ret.addr);
+    EXPECT_EQ(16, ret.mask);
+    ret = intfs->getIntfAddrToReach(RouterID(0), IPAddress("10.2.2.3"));
+    EXPECT_EQ(intf1.get(), ret.intf);
+    EXPECT_EQ(8, ret.mask);
+    ret = intfs->getIntfAddrToReach(RouterID(0), IPAddress("2401:db00:1::9"));
+    EXPECT_EQ(intf2.get(), ret.intf);
+    EXPECT_EQ(64, ret.mask);
+    ret = intfs->getIntfAddrToReach(RouterID(0), IPAddress("11.0.0.1"));
+    EXPECT_EQ(nullptr, ret.intf);
+    ret = intfs->getIntfAddrToReach(RouterID(1), IPAddress("10.1.2.3"));
+    EXPECT_EQ(nullptr, ret.intf);
+  };
+
+  ASSERT_FALSE(intfs->isPublished());
+  checkLookups();
+  state->publish();
+  ASSERT_TRUE(intfs->isPublished());
+  checkLookups();
+
+  // A clone goes back to scanning, and sees its own changes
+  auto newIntfs = intfs->clone();
+  newIntfs->removeNode(InterfaceID(2));
+  auto ret = newIntfs->getIntfAddrToReach(RouterID(0), IPAddress("10.1.2.3"));
+  EXPECT_EQ(intf1.get(), ret.intf);
+  EXPECT_EQ(nullptr, newIntfs->getInterfaceInVlanIf(VlanID(2)));
+  newIntfs->publish();
+  ret = newIntfs->getIntfAddrToReach(RouterID(0), IPAddress("10.1.2.3"));
+  EXPECT_EQ(intf1.get(), ret.intf);
+  EXPECT_EQ(nullptr, newIntfs->getInterfaceInVlanIf(VlanID(2)));
+}
+
 TEST(Interface, applyConfig) {
   auto platform = createMockPlatform();
   cfg::SwitchConfig config;
@@ -0,0 +1,168 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/state/PersistentNodeContainer.h"
+
+#include <map>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace facebook::fboss;
+
+namespace {
+
+// Use a small node size so that the tests exercise multi level trees
+using TestContainer =
+    PersistentNodeContainer<int, std::shared_ptr<int>, std::less<int>, 4>;
+
+void checkSame(
+    const std::map<int, int>& expected,
+    const TestContainer& actual) {
+  ASSERT_EQ(expected.size(), actual.size());
+  auto expectedIt = expected.begin();
+  for (const auto& entry : actual) {
+    ASSERT_EQ(expectedIt->first, entry.first);
+    ASSERT_EQ(expectedIt->second, *entry.second);
+    ++expectedIt;
+  }
+  auto expectedRit = expected.rbegin();
+  for (auto rit = actual.rbegin(); rit != actual.rend(); ++rit) {
+    ASSERT_EQ(expectedRit->first, rit->first);
+    ++expectedRit;
+  }
+  EXPECT_EQ(expected.rend(), expectedRit);
+}
+
+} // unnamed namespace
+
+TEST(PersistentNodeContainer, InsertFindErase) {
+  TestContainer nodes;
+  EXPECT_TRUE(nodes.empty());
+  EXPECT_EQ(nodes.begin(), nodes.end());
+
+  for (int i = 0; i < 100; ++i) {
+    auto ret = nodes.insert(std::make_pair(i * 2, std::make_shared<int>(i)));
+    EXPECT_TRUE(ret.second);
+    EXPECT_EQ(i * 2, ret.first->first);
+  }
+  EXPECT_EQ(100, nodes.size());
+  EXPECT_FALSE(nodes.insert(std::make_pair(10, nullptr)).second);
+  EXPECT_EQ(5, *nodes.find(10)->second);
+  EXPECT_EQ(nodes.end(), nodes.find(11));
+  EXPECT_EQ(12, nodes.lower_bound(11)->first);
+  EXPECT_EQ(12, nodes.upper_bound(10)->first);
+  EXPECT_EQ(nodes.cend(), nodes.lower_bound(1000));
+
+  EXPECT_EQ(1, nodes.erase(10));
+  EXPECT_EQ(0, nodes.erase(10));
+  EXPECT_EQ(99, nodes.size());
+  auto next = nodes.erase(nodes.find(12));
+  EXPECT_EQ(14, next->first);
+  EXPECT_EQ(98, nodes.size());
+
+  nodes.clear();
+  EXPECT_TRUE(nodes.empty());
+  EXPECT_EQ(nodes.begin(), nodes.end());
+}
+
+TEST(PersistentNodeContainer, RandomOperations) {
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<int> keyDist(0, 500);
+  std::map<int, int> expected;
+  TestContainer nodes;
+  for (int i = 0; i < 5000; ++i) {
+    auto key = keyDist(gen);
+    if (gen() % 3 == 0) {
+      EXPECT_EQ(expected.erase(key), nodes.erase(key));
+    } else {
+      auto added = expected.emplace(key, i).second;
+      EXPECT_EQ(added, nodes.emplace(key, std::make_shared<int>(i)).second);
+    }
+    if (i % 250 == 0) {
+      checkSame(expected, nodes);
+    }
+  }
+  checkSame(expected, nodes);
+}
+
+TEST(PersistentNodeContainer, CopiesAreIndependent) {
+  std::map<int, int> expected;
+  TestContainer nodes;
+  for (int i = 0; i < 200; ++i) {
+    expected.emplace(i, i);
+    nodes.emplace(i, std::make_shared<int>(i));
+  }
+  auto origExpected = expected;
+  auto copy = nodes;
+
+  // Modify the copy through every mutating API
+  copy.erase(50);
+  expected.erase(50);
+  copy.emplace(1000, std::make_shared<int>(1000));
+  expected.emplace(1000, 1000);
+  copy.find(60)->second = std::make_shared<int>(-60);
+  expected[60] = -60;
+  copy[70] = std::make_shared<int>(-70);
+  expected[70] = -70;
+  for (auto& entry : copy) {
+    if (entry.first % 10 == 1) {
+      entry.second = std::make_shared<int>(-entry.first);
+      expected[entry.first] = -entry.first;
+    }
+  }
+
+  checkSame(expected, copy);
+  checkSame(origExpected, nodes);
+
+  // Unmodified entries are still shared between the two containers
+  EXPECT_EQ(nodes.find(2)->second, copy.find(2)->second);
+}
+
+TEST(PersistentNodeContainer, SkipSharedSubtrees) {
+  TestContainer oldNodes;
+  for (int i = 0; i < 10000; ++i) {
+    oldNodes.emplace(i, std::make_shared<int>(i));
+  }
+  auto newNodes = oldNodes;
+  newNodes.find(10)->second = std::make_shared<int>(-10);
+  newNodes.erase(5000);
+  newNodes.emplace(20000, std::make_shared<int>(20000));
+
+  // Walk both containers the way NodeMapDelta does, collecting differences
+  const auto& constOld = oldNodes;
+  const auto& constNew = newNodes;
+  auto oldIt = constOld.begin();
+  auto newIt = constNew.begin();
+  std::vector<int> changed;
+  int steps = 0;
+  while (oldIt != constOld.end() || newIt != constNew.end()) {
+    ++steps;
+    if (oldIt == constOld.end()) {
+      changed.push_back((newIt++)->first);
+    } else if (newIt == constNew.end()) {
+      changed.push_back((oldIt++)->first);
+    } else if (oldIt->first < newIt->first) {
+      changed.push_back((oldIt++)->first);
+    } else if (newIt->first < oldIt->first) {
+      changed.push_back((newIt++)->first);
+    } else if (oldIt->second != newIt->second) {
+      changed.push_back(oldIt->first);
+      ++oldIt;
+      ++newIt;
+    } else if (!skipSharedSubtree(oldIt, newIt)) {
+      ++oldIt;
+      ++newIt;
+    }
+  }
+  EXPECT_EQ((std::vector<int>{10, 5000, 20000}), changed);
+  // Only the unshared leaves around each change should have been visited
+  EXPECT_LT(steps, 200);
+}
@@ -19,8 +19,11 @@
 #include "fboss/agent/state/StateDelta.h"
 #include "fboss/agent/state/SwitchState.h"
 
+#include <gflags/gflags.h>
 #include <gtest/gtest.h>
 
+DECLARE_bool(incremental_config_apply);
+
 using namespace facebook::fboss;
 using std::make_pair;
 using std::make_shared;
@@ -120,6 +123,50 @@ TEST(Port, applyConfig) {
     publishAndApplyConfig(stateV3, &config, platform.get()), FbossError);
 }
 
+TEST(Port, incrementalConfigApply) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_incremental_config_apply = true;
+  auto platform = createMockPlatform();
+  auto stateV0 = make_shared<SwitchState>();
+  stateV0->registerPort(PortID(1), "port1");
+
+  cfg::SwitchConfig config;
+  config.ports.resize(1);
+  config.ports[0].logicalID = 1;
+  config.ports[0].name_ref().value_unchecked() = "port1";
+  config.ports[0].state = cfg::PortState::ENABLED;
+  auto stateV1 = publishAndApplyConfig(stateV0, &config, platform.get());
+  ASSERT_NE(nullptr, stateV1);
+  EXPECT_EQ(
+      cfg::PortState::ENABLED, stateV1->getPort(PortID(1))->getAdminState());
+
+  // Disable the port other than through the config
+  stateV1->publish();
+  auto stateV2 = stateV1->clone();
+  stateV2->getPorts()->getPort(PortID(1))->modify(&stateV2)->setAdminState(
+      cfg::PortState::DISABLED);
+
+  // Reapplying the config the state was built from leaves the ports alone
+  EXPECT_EQ(
+      nullptr,
+      publishAndApplyConfig(stateV2, &config, platform.get(), &config));
+
+  // Without a previous config, every section is applied
+  auto stateV3 = publishAndApplyConfig(stateV2, &config, platform.get());
+  ASSERT_NE(nullptr, stateV3);
+  EXPECT_EQ(
+      cfg::PortState::ENABLED, stateV3->getPort(PortID(1))->getAdminState());
+
+  // So is any section whose config changed
+  auto prevConfig = config;
+  config.ports[0].state = cfg::PortState::DISABLED;
+  auto stateV4 =
+      publishAndApplyConfig(stateV3, &config, platform.get(), &prevConfig);
+  ASSERT_NE(nullptr, stateV4);
+  EXPECT_EQ(
+      cfg::PortState::DISABLED, stateV4->getPort(PortID(1))->getAdminState());
+}
+
 TEST(Port, ToFromJSON) {
   std::string jsonStr = R"(
         {
@@ -16,8 +16,11 @@
 #include "fboss/agent/test/TestUtils.h"
 
 #include <boost/container/flat_map.hpp>
+#include <gflags/gflags.h>
 #include <gtest/gtest.h>
 
+DECLARE_bool(incremental_config_apply);
+
 using namespace facebook::fboss;
 using std::make_shared;
 using std::shared_ptr;
@@ -304,3 +307,26 @@ TEST(QosPolicy, QosPolicyDelta) {
   auto qosPoliciesV4 = stateV4->getQosPolicies();
   checkDelta(qosPoliciesV3, qosPoliciesV4, {}, {}, {"qosPolicy_1"});
 }
+
+TEST(QosPolicy, IncrementalApplyWithoutPreviousConfig) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_incremental_config_apply = true;
+  auto platform = createMockPlatform();
+  auto stateV0 = make_shared<SwitchState>();
+
+  cfg::SwitchConfig config;
+  cfg::QosPolicy p1;
+  p1.name = "qosPolicy_1";
+  p1.rules = dscpRules({{7, {46}}});
+  config.qosPolicies.push_back(p1);
+  auto stateV1 = publishAndApplyConfig(stateV0, &config, platform.get());
+  checkQosSwState(config, stateV1);
+
+  // With no previous config to compare with, as on the first apply after a
+  // warm boot, the state is reconciled with the whole config: the policy the
+  // config lacks is removed even though the config has no policies at all
+  cfg::SwitchConfig emptyConfig;
+  auto stateV2 = publishAndApplyConfig(stateV1, &emptyConfig, platform.get());
+  ASSERT_NE(nullptr, stateV2);
+  EXPECT_EQ(0, stateV2->getQosPolicies()->size());
+}
@@ -7,6 +7,7 @@
  *  of patent rights can be found in the PATENTS file in the same directory.
  *
  */
+#include <folly/Format.h>
 #include <folly/Memory.h>
 #include <folly/io/Cursor.h>
 #include <folly/io/IOBuf.h>
@@ -15,6 +16,7 @@
 #include "fboss/agent/ArpHandler.h"
 #include "fboss/agent/FbossError.h"
 #include "fboss/agent/NeighborUpdater.h"
+#include "fboss/agent/ParkedPacketQueue.h"
 #include "fboss/agent/SwSwitch.h"
 #include "fboss/agent/SwitchStats.h"
 #include "fboss/agent/ThriftHandler.h"
@@ -22,6 +24,7 @@
 #include "fboss/agent/hw/mock/MockHwSwitch.h"
 #include "fboss/agent/hw/mock/MockPlatform.h"
 #include "fboss/agent/hw/mock/MockRxPacket.h"
+#include "fboss/agent/packet/IPv4Hdr.h"
 #include "fboss/agent/packet/PktUtil.h"
 #include "fboss/agent/state/ArpEntry.h"
 #include "fboss/agent/state/ArpResponseTable.h"
@@ -37,10 +40,14 @@
 #include "fboss/agent/test/TestUtils.h"
 
 #include <boost/range/combine.hpp>
+#include <gflags/gflags.h>
 #include <gtest/gtest.h>
 #include <array>
+#include <atomic>
 #include <future>
+#include <set>
 #include <string>
+#include <thread>
 
 using namespace facebook::fboss;
 using facebook::network::toBinaryAddress;
@@ -58,6 +65,11 @@ using std::unique_ptr;
 
 using ::testing::_;
 
+DECLARE_int32(max_parked_pkts_per_neighbor);
+DECLARE_int32(neighbor_update_batch_ms);
+DECLARE_int32(neighbor_update_batch_size);
+DECLARE_int32(neighbor_probe_rate);
+
 namespace {
 
 unique_ptr<HwTestHandle> setupTestHandle(
@@ -288,6 +300,23 @@ TEST(ArpTest, BasicSendRequest) {
   counters.checkDelta(SwitchStats::kCounterPrefix + "arp.reply.rx.sum", 0);
 }
 
+TEST(ArpTest, FloodGratuitousArp) {
+  auto handle = setupTestHandle();
+  auto sw = handle->getSw();
+
+  int numV4Addrs = 0;
+  for (const auto& intf : *sw->getState()->getInterfaces()) {
+    for (const auto& addr : intf->getAddresses()) {
+      numV4Addrs += addr.first.isV4();
+    }
+  }
+  EXPECT_GT(numV4Addrs, 0);
+
+  // All gratuitous ARPs go down as one batch, which the mock sends one by one
+  EXPECT_HW_CALL(sw, sendPacketSwitchedAsync_(_)).Times(numV4Addrs);
+  sw->getArpHandler()->floodGratuituousArp();
+}
+
 TEST(ArpTest, TableUpdates) {
   auto handle = setupTestHandle();
   auto sw = handle->getSw();
@@ -893,6 +922,314 @@ TEST(ArpTest, PendingArp) {
   EXPECT_EQ(entry->isPending(), false);
 };
 
+TEST(ArpTest, ParkedPacketSentOnResolve) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_max_parked_pkts_per_neighbor = 2;
+  auto handle = setupTestHandle();
+  auto sw = handle->getSw();
+  ASSERT_NE(nullptr, sw->getParkedPacketQueue());
+
+  VlanID vlanID(1);
+  IPAddressV4 targetIP("10.0.0.10");
+  CounterCache counters(sw);
+
+  // Create an IP pkt for 10.0.0.10
+  auto hex = PktUtil::parseHexData(
+    // dst mac, src mac
+    "02 00 01 00 00 01  02 00 02 01 02 03"
+    // 802.1q, VLAN 1
+    "81 00 00 01"
+    // IPv4
+    "08 00"
+    // Version(4), IHL(5), DSCP(0), ECN(0), Total Length(20)
+    "45  00  00 14"
+    // Identification(0), Flags(0), Fragment offset(0)
+    "00 00  00 00"
+    // TTL(31), Protocol(6), Checksum (0, fake)
+    "1F  06  00 00"
+    // Source IP (1.2.3.4)
+    "01 02 03 04"
+    // Destination IP (10.0.0.10)
+    "0a 00 00 0a"
+  );
+
+  // The first packet triggers an ARP request, and is parked along with the
+  // ones that follow it. Only the last two fit.
+  EXPECT_HW_CALL(sw, stateChanged(_)).Times(1);
+  EXPECT_PKT(sw, "ARP request",
+             checkArpRequest(IPAddressV4("10.0.0.1"),
+                             MacAddress("00:02:00:00:00:01"),
+                             targetIP, vlanID));
+  handle->rxPacket(make_unique<IOBuf>(hex), PortID(1), vlanID);
+  waitForStateUpdates(sw);
+  EXPECT_HW_CALL(sw, stateChanged(_)).Times(0);
+  handle->rxPacket(make_unique<IOBuf>(hex), PortID(1), vlanID);
+  handle->rxPacket(make_unique<IOBuf>(hex), PortID(1), vlanID);
+  waitForStateUpdates(sw);
+  EXPECT_EQ(2, sw->getParkedPacketQueue()->packets());
+  EXPECT_EQ(40, sw->getParkedPacketQueue()->bytes());
+
+  counters.update();
+  counters.checkDelta(SwitchStats::kCounterPrefix + "trapped.parked.sum", 3);
+  counters.checkDelta(SwitchStats::kCounterPrefix + "parked.drops.sum", 1);
+  counters.checkDelta(SwitchStats::kCounterPrefix + "trapped.drops.sum", 1);
+
+  // Resolving the entry sends the parked packets on, to be routed by the
+  // hardware
+  EXPECT_HW_CALL(sw, stateChanged(_)).Times(1);
+  auto checkParkedPkt = [&](const TxPacket* pkt) {
+    Cursor c(pkt->buf());
+    // dst mac, src mac, 802.1q, ethertype
+    c += 18;
+    IPv4Hdr v4Hdr(c);
+    if (v4Hdr.dstAddr != targetIP) {
+      throw FbossError("expected dest IP to be ", targetIP,
+                       "; got ", v4Hdr.dstAddr);
+    }
+  };
+  EXPECT_PKT(sw, "parked packet", checkParkedPkt).Times(2);
+  sendArpReply(handle.get(), "10.0.0.10", "02:10:20:30:40:22", 1);
+  waitForStateUpdates(sw);
+  EXPECT_EQ(0, sw->getParkedPacketQueue()->packets());
+  EXPECT_EQ(0, sw->getParkedPacketQueue()->bytes());
+
+  counters.update();
+  counters.checkDelta(SwitchStats::kCounterPrefix + "parked.sent.sum", 2);
+  counters.checkDelta(SwitchStats::kCounterPrefix + "trapped.drops.sum", 0);
+}
+
+namespace {
+
+/*
+ * Hold off the update thread until the returned promise is fulfilled, so
+ * that the updates scheduled meanwhile are all pending at once, as they
+ * would be on a busy switch.
+ */
+std::shared_ptr<std::promise<void>> blockStateUpdates(SwSwitch* sw) {
+  auto blocked = std::make_shared<std::promise<void>>();
+  auto release = std::make_shared<std::promise<void>>();
+  auto blockedFuture = blocked->get_future();
+  auto released = release->get_future().share();
+  sw->updateState(
+      "block state updates",
+      [blocked, released](const shared_ptr<SwitchState>&)
+          -> shared_ptr<SwitchState> {
+        blocked->set_value();
+        released.wait();
+        return nullptr;
+      });
+  blockedFuture.wait();
+  return release;
+}
+
+auto arpEntryDelta(IPAddressV4 ip, bool pending, VlanID vlanID = VlanID(1)) {
+  return testing::Truly([ip, pending, vlanID](const StateDelta& delta) {
+    auto entry = NeighborEntryTestUtil<IPAddressV4>::getNeighborEntryDelta(
+                     delta, ip, vlanID)
+                     .getNew();
+    return entry && entry->isPending() == pending;
+  });
+}
+
+} // unnamed namespace
+
+TEST(ArpTest, BatchFlushedWhenFull) {
+  gflags::FlagSaver flagSaver;
+  // Only a full batch gets programmed within the test
+  FLAGS_neighbor_update_batch_ms = 3600 * 1000;
+  FLAGS_neighbor_update_batch_size = 3;
+  auto handle = setupTestHandle();
+  auto sw = handle->getSw();
+
+  EXPECT_HW_CALL(sw, stateChanged(_)).Times(0);
+  sendArpReply(handle.get(), "10.0.0.11", "02:10:20:30:40:11", 2);
+  sendArpReply(handle.get(), "10.0.0.15", "02:10:20:30:40:15", 3);
+  waitForStateUpdates(sw);
+  EXPECT_EQ(nullptr, getArpEntry(sw, IPAddressV4("10.0.0.11")));
+  EXPECT_EQ(nullptr, getArpEntry(sw, IPAddressV4("10.0.0.15")));
+
+  // Readers of the cache see the entries before they are programmed
+  ThriftHandler thriftHandler(sw);
+  std::vector<ArpEntryThrift> arpTable;
+  thriftHandler.getArpTable(arpTable);
+  EXPECT_EQ(2, arpTable.size());
+
+  // The third entry fills the batch, all three go in one update
+  EXPECT_HW_CALL(sw, stateChanged(_)).Times(1);
+  sendArpReply(handle.get(), "10.0.0.7", "02:10:20:30:40:07", 1);
+  waitForStateUpdates(sw);
+  for (auto ip : {"10.0.0.11", "10.0.0.15", "10.0.0.7"}) {
+    auto entry = getArpEntry(sw, IPAddressV4(ip));
+    ASSERT_NE(nullptr, entry) << ip;
+    EXPECT_FALSE(entry->isPending());
+  }
+}
+
+TEST(ArpTest, BatchFlushedAtDeadline) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_neighbor_update_batch_ms = 500;
+  FLAGS_neighbor_update_batch_size = 256;
+  std::chrono::milliseconds batchDelay(FLAGS_neighbor_update_batch_ms);
+  auto handle = setupTestHandle();
+  auto sw = handle->getSw();
+
+  WaitForArpEntryCreation create11(sw, IPAddressV4("10.0.0.11"));
+  WaitForArpEntryCreation create15(sw, IPAddressV4("10.0.0.15"));
+  EXPECT_HW_CALL(sw, stateChanged(_)).Times(1);
+  auto start = std::chrono::steady_clock::now();
+  sendArpReply(handle.get(), "10.0.0.11", "02:10:20:30:40:11", 2);
+  sendArpReply(handle.get(), "10.0.0.15", "02:10:20:30:40:15", 3);
+  waitForStateUpdates(sw);
+  if (std::chrono::steady_clock::now() - start < batchDelay) {
+    EXPECT_EQ(nullptr, getArpEntry(sw, IPAddressV4("10.0.0.11")));
+  }
+
+  // Both entries go in together, once the first has waited long enough
+  EXPECT_TRUE(create11.wait());
+  EXPECT_TRUE(create15.wait());
+  EXPECT_GE(std::chrono::steady_clock::now() - start, batchDelay);
+  waitForStateUpdates(sw);
+  EXPECT_NE(nullptr, getArpEntry(sw, IPAddressV4("10.0.0.11")));
+  EXPECT_NE(nullptr, getArpEntry(sw, IPAddressV4("10.0.0.15")));
+}
+
+TEST(ArpTest, BatchWithPendingEntryNotCoalesced) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_neighbor_update_batch_ms = 3600 * 1000;
+  FLAGS_neighbor_update_batch_size = 1;
+  auto handle = setupTestHandle();
+  auto sw = handle->getSw();
+  VlanID vlanID(1);
+  IPAddressV4 targetIP("10.0.0.10");
+
+  // The pending entry and its resolution are queued back to back behind a
+  // busy update thread. The pending entry must still reach the hardware on
+  // its own, as it does without batching, rather than be coalesced away
+  // into the update resolving it.
+  testing::InSequence seq;
+  EXPECT_HW_CALL(sw, stateChanged(arpEntryDelta(targetIP, true))).Times(1);
+  EXPECT_HW_CALL(sw, stateChanged(arpEntryDelta(targetIP, false))).Times(1);
+  auto release = blockStateUpdates(sw);
+  sw->getNeighborUpdater()->sentArpRequest(vlanID, targetIP);
+  sendArpReply(handle.get(), "10.0.0.10", "02:10:20:30:40:22", 1);
+  release->set_value();
+  waitForStateUpdates(sw);
+
+  auto entry = getArpEntry(sw, targetIP, vlanID);
+  ASSERT_NE(nullptr, entry);
+  EXPECT_FALSE(entry->isPending());
+}
+
+TEST(ArpTest, FlushDropsQueuedEntry) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_neighbor_update_batch_ms = 3600 * 1000;
+  FLAGS_neighbor_update_batch_size = 2;
+  auto handle = setupTestHandle();
+  auto sw = handle->getSw();
+  ThriftHandler thriftHandler(sw);
+
+  // Flushing an entry still waiting in a batch removes it from the batch,
+  // it is not in the switch state yet so there is nothing else to flush
+  EXPECT_HW_CALL(sw, stateChanged(_)).Times(0);
+  sendArpReply(handle.get(), "10.0.0.11", "02:10:20:30:40:11", 2);
+  auto binAddr = toBinaryAddress(IPAddressV4("10.0.0.11"));
+  EXPECT_EQ(
+      0,
+      thriftHandler.flushNeighborEntry(make_unique<BinaryAddress>(binAddr), 1));
+
+  // The flushed entry no longer counts towards the batch, nor is programmed
+  // with it
+  sendArpReply(handle.get(), "10.0.0.15", "02:10:20:30:40:15", 3);
+  waitForStateUpdates(sw);
+  EXPECT_EQ(nullptr, getArpEntry(sw, IPAddressV4("10.0.0.15")));
+
+  EXPECT_HW_CALL(sw, stateChanged(_)).Times(1);
+  sendArpReply(handle.get(), "10.0.0.7", "02:10:20:30:40:07", 1);
+  waitForStateUpdates(sw);
+  EXPECT_EQ(nullptr, getArpEntry(sw, IPAddressV4("10.0.0.11")));
+  EXPECT_NE(nullptr, getArpEntry(sw, IPAddressV4("10.0.0.15")));
+  EXPECT_NE(nullptr, getArpEntry(sw, IPAddressV4("10.0.0.7")));
+
+  std::vector<ArpEntryThrift> arpTable;
+  thriftHandler.getArpTable(arpTable);
+  EXPECT_EQ(2, arpTable.size());
+}
+
+TEST(ArpTest, ParkedPacketSentAfterBatch) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_max_parked_pkts_per_neighbor = 2;
+  FLAGS_neighbor_update_batch_ms = 3600 * 1000;
+  FLAGS_neighbor_update_batch_size = 3;
+  auto handle = setupTestHandle();
+  auto sw = handle->getSw();
+  ASSERT_NE(nullptr, sw->getParkedPacketQueue());
+
+  VlanID vlanID(1);
+  IPAddressV4 targetIP("10.0.0.10");
+  CounterCache counters(sw);
+
+  // Create an IP pkt for 10.0.0.10
+  auto hex = PktUtil::parseHexData(
+    // dst mac, src mac
+    "02 00 01 00 00 01  02 00 02 01 02 03"
+    // 802.1q, VLAN 1
+    "81 00 00 01"
+    // IPv4
+    "08 00"
+    // Version(4), IHL(5), DSCP(0), ECN(0), Total Length(20)
+    "45  00  00 14"
+    // Identification(0), Flags(0), Fragment offset(0)
+    "00 00  00 00"
+    // TTL(31), Protocol(6), Checksum (0, fake)
+    "1F  06  00 00"
+    // Source IP (1.2.3.4)
+    "01 02 03 04"
+    // Destination IP (10.0.0.10)
+    "0a 00 00 0a"
+  );
+
+  // The packet triggers an ARP request and is parked. The pending entry is
+  // queued, not programmed.
+  EXPECT_HW_CALL(sw, stateChanged(_)).Times(0);
+  EXPECT_PKT(sw, "ARP request",
+             checkArpRequest(IPAddressV4("10.0.0.1"),
+                             MacAddress("00:02:00:00:00:01"),
+                             targetIP, vlanID));
+  handle->rxPacket(make_unique<IOBuf>(hex), PortID(1), vlanID);
+  waitForStateUpdates(sw);
+  EXPECT_EQ(1, sw->getParkedPacketQueue()->packets());
+
+  // The reply resolves the entry in the cache, but the packet stays parked
+  // until the batch holding the entry reaches the hardware
+  sendArpReply(handle.get(), "10.0.0.10", "02:10:20:30:40:22", 1);
+  waitForStateUpdates(sw);
+  EXPECT_EQ(1, sw->getParkedPacketQueue()->packets());
+
+  // Another neighbor fills the batch
+  EXPECT_HW_CALL(sw, stateChanged(_)).Times(1);
+  auto checkParkedPkt = [&](const TxPacket* pkt) {
+    Cursor c(pkt->buf());
+    // dst mac, src mac, 802.1q, ethertype
+    c += 18;
+    IPv4Hdr v4Hdr(c);
+    if (v4Hdr.dstAddr != targetIP) {
+      throw FbossError("expected dest IP to be ", targetIP,
+                       "; got ", v4Hdr.dstAddr);
+    }
+  };
+  EXPECT_PKT(sw, "parked packet", checkParkedPkt).Times(1);
+  sendArpReply(handle.get(), "10.0.0.11", "02:10:20:30:40:11", 2);
+  waitForStateUpdates(sw);
+  EXPECT_EQ(0, sw->getParkedPacketQueue()->packets());
+  auto entry = getArpEntry(sw, targetIP, vlanID);
+  ASSERT_NE(nullptr, entry);
+  EXPECT_FALSE(entry->isPending());
+
+  counters.update();
+  counters.checkDelta(SwitchStats::kCounterPrefix + "parked.sent.sum", 1);
+  counters.checkDelta(SwitchStats::kCounterPrefix + "trapped.drops.sum", 0);
+}
+
 TEST(ArpTest, PendingArpCleanup) {
   auto handle = setupTestHandle(std::chrono::seconds(1));
   auto sw = handle->getSw();
@@ -942,6 +1279,115 @@ TEST(ArpTest, PendingArpCleanup) {
   }
 }
 
+TEST(ArpTest, ProbeRateLimitedEntriesAreProbed) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_neighbor_probe_rate = 1;
+  // Three probes per entry, one of which went out creating the entry
+  auto handle = setupTestHandle(std::chrono::seconds(0), 3);
+  auto sw = handle->getSw();
+  VlanID vlanID(1);
+  std::array<IPAddressV4, 4> targetIP = {IPAddressV4("10.0.0.2"),
+                                         IPAddressV4("10.0.0.3"),
+                                         IPAddressV4("10.0.0.4"),
+                                         IPAddressV4("10.0.0.5")};
+  CounterCache counters(sw);
+
+  std::array<unique_ptr<WaitForArpEntryExpiration>, 4> arpExpirations;
+  std::transform(
+      targetIP.begin(),
+      targetIP.end(),
+      arpExpirations.begin(),
+      [&](const IPAddressV4& ip) {
+        return make_unique<WaitForArpEntryExpiration>(sw, ip);
+      });
+
+  // The entries want 8 more probes between them, but only about one a second
+  // goes out. Probes held back by the rate are retried rather than lost, and
+  // held back for at most a probe interval, so every probe goes out before
+  // the entries expire, and they do not take much longer to.
+  EXPECT_HW_CALL(sw, stateChanged(_)).Times(testing::AtLeast(1));
+  EXPECT_HW_CALL(sw, sendPacketSwitchedAsync_(_)).Times(8);
+  auto start = std::chrono::steady_clock::now();
+  for (auto ip : targetIP) {
+    sw->getNeighborUpdater()->sentArpRequest(vlanID, ip);
+  }
+  for (auto& arpExpiry : arpExpirations) {
+    EXPECT_TRUE(arpExpiry->wait(std::chrono::seconds(10)));
+  }
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(8));
+
+  counters.update();
+  EXPECT_GT(
+      counters.value(
+          SwitchStats::kCounterPrefix + "neighbor.probe.rate_limited.sum"),
+      counters.prevValue(
+          SwitchStats::kCounterPrefix + "neighbor.probe.rate_limited.sum"));
+}
+
+TEST(ArpTest, CacheDataReadDuringChurn) {
+  auto handle = setupTestHandle();
+  auto sw = handle->getSw();
+  ThriftHandler thriftHandler(sw);
+  constexpr int kFirstHost = 10;
+  constexpr int kNumHosts = 32;
+  constexpr int kRounds = 20;
+
+  auto hostIP = [](int host) {
+    return IPAddressV4(folly::to<string>("10.0.0.", host));
+  };
+  // The last byte of each MAC matches its IP, the one before the round
+  auto hostMac = [](int host, int round) {
+    return folly::sformat("02:10:20:30:{:02x}:{:02x}", round, host);
+  };
+
+  // Readers of the cache do not take the cache lock, make sure they only
+  // ever see whole entries while entries are added, updated and flushed
+  std::atomic<bool> done{false};
+  std::atomic<int> reads{0};
+  std::thread reader([&] {
+    while (!done.load()) {
+      std::vector<ArpEntryThrift> arpTable;
+      sw->getNeighborUpdater()->getArpCacheData(arpTable);
+      EXPECT_LE(arpTable.size(), kNumHosts);
+      std::set<IPAddressV4> seen;
+      for (const auto& entry : arpTable) {
+        auto ip = toIPAddress(entry.ip).asV4();
+        EXPECT_TRUE(seen.insert(ip).second) << ip << " seen twice";
+        EXPECT_EQ(ip.toByteArray()[3], MacAddress(entry.mac).bytes()[5])
+            << ip << " has " << entry.mac;
+        EXPECT_EQ(1, entry.vlanID);
+      }
+      ++reads;
+    }
+  });
+
+  EXPECT_HW_CALL(sw, stateChanged(_)).Times(testing::AtLeast(1));
+  for (int round = 0; round < kRounds; ++round) {
+    for (int host = kFirstHost; host < kFirstHost + kNumHosts; ++host) {
+      sendArpReply(
+          handle.get(), hostIP(host).str(), hostMac(host, round), 1 + host % 4);
+    }
+    for (int host = kFirstHost; host < kFirstHost + kNumHosts; host += 2) {
+      auto binAddr = toBinaryAddress(hostIP(host));
+      thriftHandler.flushNeighborEntry(make_unique<BinaryAddress>(binAddr), 1);
+    }
+  }
+  waitForStateUpdates(sw);
+  done.store(true);
+  reader.join();
+  EXPECT_GT(reads.load(), 0);
+
+  // Only the entries of the last round that were not flushed are left
+  std::vector<ArpEntryThrift> arpTable;
+  thriftHandler.getArpTable(arpTable);
+  ASSERT_EQ(kNumHosts / 2, arpTable.size());
+  for (const auto& entry : arpTable) {
+    int host = toIPAddress(entry.ip).asV4().toByteArray()[3];
+    EXPECT_EQ(1, host % 2);
+    EXPECT_EQ(hostMac(host, kRounds - 1), entry.mac);
+  }
+}
+
 TEST(ArpTest, ArpTableSerialization) {
   auto handle = setupTestHandle();
   auto sw = handle->getSw();
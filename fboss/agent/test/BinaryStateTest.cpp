@@ -0,0 +1,45 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/Utils.h"
+#include "fboss/agent/state/SwitchState.h"
+#include "fboss/agent/test/TestUtils.h"
+
+#include <folly/FileUtil.h>
+#include <folly/experimental/TestUtil.h>
+#include <folly/json.h>
+#include <gtest/gtest.h>
+
+#include <string>
+
+using namespace facebook::fboss;
+using std::string;
+
+TEST(BinaryStateTest, RoundTrip) {
+  folly::test::TemporaryDirectory tmpDir;
+  auto file = (tmpDir.path() / "switch_state.bser").string();
+
+  auto state = testStateA();
+  auto dyn = state->toFollyDynamic();
+  ASSERT_TRUE(dumpBinaryStateToFile(file, dyn));
+  auto readBack = readBinaryStateFromFile(file);
+  EXPECT_EQ(dyn, readBack);
+
+  // And is smaller than the JSON written for the same state
+  string bser;
+  ASSERT_TRUE(folly::readFile(file.c_str(), bser));
+  EXPECT_LT(bser.size(), folly::toPrettyJson(dyn).size());
+}
+
+TEST(BinaryStateTest, NotBinary) {
+  folly::test::TemporaryDirectory tmpDir;
+  auto file = (tmpDir.path() / "switch_state").string();
+  ASSERT_TRUE(dumpStateToFile(file, testStateA()->toFollyDynamic()));
+  EXPECT_ANY_THROW(readBinaryStateFromFile(file));
+}
@@ -11,6 +11,7 @@
 
 #include "fboss/agent/AddressUtil.h"
 #include "fboss/agent/FbossError.h"
+#include "fboss/agent/NeighborUpdater.h"
 #include "fboss/agent/SwSwitch.h"
 #include "fboss/agent/SwitchStats.h"
 #include "fboss/agent/ThriftHandler.h"
@@ -32,6 +33,7 @@
 #include "fboss/agent/test/TestUtils.h"
 
 #include <future>
+#include <gflags/gflags.h>
 #include <netinet/icmp6.h>
 #include <folly/IPAddressV6.h>
 #include <folly/MacAddress.h>
@@ -54,6 +56,9 @@ using std::chrono::seconds;
 
 using ::testing::_;
 
+DECLARE_int32(neighbor_update_batch_ms);
+DECLARE_int32(neighbor_update_batch_size);
+
 namespace {
 
 const MacAddress kPlatformMac("02:01:02:03:04:05");
@@ -871,6 +876,171 @@ TEST(NdpTest, PendingNdp) {
   EXPECT_EQ(entry->isPending(), false);
 };
 
+namespace {
+
+const VlanID kBatchVlan(5);
+
+shared_ptr<NdpEntry> getNdpEntry(SwSwitch* sw, StringPiece ip) {
+  return sw->getState()
+      ->getVlans()
+      ->getVlanIf(kBatchVlan)
+      ->getNdpTable()
+      ->getEntryIf(IPAddressV6(ip));
+}
+
+// See blockStateUpdates() in ArpTest
+std::shared_ptr<std::promise<void>> blockStateUpdates(SwSwitch* sw) {
+  auto blocked = std::make_shared<std::promise<void>>();
+  auto release = std::make_shared<std::promise<void>>();
+  auto blockedFuture = blocked->get_future();
+  auto released = release->get_future().share();
+  sw->updateState(
+      "block state updates",
+      [blocked, released](const shared_ptr<SwitchState>&)
+          -> shared_ptr<SwitchState> {
+        blocked->set_value();
+        released.wait();
+        return nullptr;
+      });
+  blockedFuture.wait();
+  return release;
+}
+
+auto ndpEntryDelta(IPAddressV6 ip, bool pending) {
+  return testing::Truly([ip, pending](const StateDelta& delta) {
+    auto entry = NeighborEntryTestUtil<IPAddressV6>::getNeighborEntryDelta(
+                     delta, ip, kBatchVlan)
+                     .getNew();
+    return entry && entry->isPending() == pending;
+  });
+}
+
+} // unnamed namespace
+
+TEST(NdpTest, BatchFlushedWhenFull) {
+  gflags::FlagSaver flagSaver;
+  // Only a full batch gets programmed within the test
+  FLAGS_neighbor_update_batch_ms = 3600 * 1000;
+  FLAGS_neighbor_update_batch_size = 3;
+  auto handle = setupTestHandle();
+  auto sw = handle->getSw();
+
+  EXPECT_HW_CALL(sw, stateChanged(_)).Times(0);
+  sendNeighborAdvertisement(handle.get(), "2401:db00:2110:3004::b",
+                            "02:05:73:f9:46:fb", 1, kBatchVlan);
+  sendNeighborAdvertisement(handle.get(), "2401:db00:2110:3004::c",
+                            "02:05:73:f9:46:fc", 1, kBatchVlan);
+  waitForStateUpdates(sw);
+  EXPECT_EQ(nullptr, getNdpEntry(sw, "2401:db00:2110:3004::b"));
+  EXPECT_EQ(nullptr, getNdpEntry(sw, "2401:db00:2110:3004::c"));
+
+  // The third entry fills the batch, all three go in one update
+  EXPECT_HW_CALL(sw, stateChanged(_)).Times(1);
+  sendNeighborAdvertisement(handle.get(), "2401:db00:2110:3004::d",
+                            "02:05:73:f9:46:fd", 2, kBatchVlan);
+  waitForStateUpdates(sw);
+  for (auto ip : {"2401:db00:2110:3004::b",
+                  "2401:db00:2110:3004::c",
+                  "2401:db00:2110:3004::d"}) {
+    auto entry = getNdpEntry(sw, ip);
+    ASSERT_NE(nullptr, entry) << ip;
+    EXPECT_FALSE(entry->isPending());
+  }
+}
+
+TEST(NdpTest, BatchFlushedAtDeadline) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_neighbor_update_batch_ms = 500;
+  FLAGS_neighbor_update_batch_size = 256;
+  std::chrono::milliseconds batchDelay(FLAGS_neighbor_update_batch_ms);
+  auto handle = setupTestHandle();
+  auto sw = handle->getSw();
+
+  WaitForNdpEntryCreation createB(
+      sw, IPAddressV6("2401:db00:2110:3004::b"), kBatchVlan);
+  WaitForNdpEntryCreation createC(
+      sw, IPAddressV6("2401:db00:2110:3004::c"), kBatchVlan);
+  EXPECT_HW_CALL(sw, stateChanged(_)).Times(1);
+  auto start = std::chrono::steady_clock::now();
+  sendNeighborAdvertisement(handle.get(), "2401:db00:2110:3004::b",
+                            "02:05:73:f9:46:fb", 1, kBatchVlan);
+  sendNeighborAdvertisement(handle.get(), "2401:db00:2110:3004::c",
+                            "02:05:73:f9:46:fc", 1, kBatchVlan);
+  waitForStateUpdates(sw);
+  if (std::chrono::steady_clock::now() - start < batchDelay) {
+    EXPECT_EQ(nullptr, getNdpEntry(sw, "2401:db00:2110:3004::b"));
+  }
+
+  // Both entries go in together, once the first has waited long enough
+  EXPECT_TRUE(createB.wait());
+  EXPECT_TRUE(createC.wait());
+  EXPECT_GE(std::chrono::steady_clock::now() - start, batchDelay);
+  waitForStateUpdates(sw);
+}
+
+TEST(NdpTest, BatchWithPendingEntryNotCoalesced) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_neighbor_update_batch_ms = 3600 * 1000;
+  FLAGS_neighbor_update_batch_size = 1;
+  auto handle = setupTestHandle();
+  auto sw = handle->getSw();
+  IPAddressV6 targetIP("2401:db00:2110:3004::1:0");
+
+  // The pending entry and its resolution are queued back to back behind a
+  // busy update thread, the pending entry must still reach the hardware on
+  // its own
+  testing::InSequence seq;
+  EXPECT_HW_CALL(sw, stateChanged(ndpEntryDelta(targetIP, true))).Times(1);
+  EXPECT_HW_CALL(sw, stateChanged(ndpEntryDelta(targetIP, false))).Times(1);
+  auto release = blockStateUpdates(sw);
+  sw->getNeighborUpdater()->sentNeighborSolicitation(kBatchVlan, targetIP);
+  sendNeighborAdvertisement(handle.get(), "2401:db00:2110:3004::1:0",
+                            "02:10:20:30:40:22", 1, kBatchVlan);
+  release->set_value();
+  waitForStateUpdates(sw);
+
+  auto entry = getNdpEntry(sw, "2401:db00:2110:3004::1:0");
+  ASSERT_NE(nullptr, entry);
+  EXPECT_FALSE(entry->isPending());
+}
+
+TEST(NdpTest, FlushDropsQueuedEntry) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_neighbor_update_batch_ms = 3600 * 1000;
+  FLAGS_neighbor_update_batch_size = 2;
+  auto handle = setupTestHandle();
+  auto sw = handle->getSw();
+  ThriftHandler thriftHandler(sw);
+
+  // Flushing an entry still waiting in a batch removes it from the batch
+  EXPECT_HW_CALL(sw, stateChanged(_)).Times(0);
+  sendNeighborAdvertisement(handle.get(), "2401:db00:2110:3004::b",
+                            "02:05:73:f9:46:fb", 1, kBatchVlan);
+  auto binAddr = toBinaryAddress(IPAddressV6("2401:db00:2110:3004::b"));
+  EXPECT_EQ(
+      0,
+      thriftHandler.flushNeighborEntry(
+          make_unique<BinaryAddress>(binAddr), kBatchVlan));
+
+  // The flushed entry no longer counts towards the batch, nor is programmed
+  // with it
+  sendNeighborAdvertisement(handle.get(), "2401:db00:2110:3004::c",
+                            "02:05:73:f9:46:fc", 1, kBatchVlan);
+  waitForStateUpdates(sw);
+  EXPECT_EQ(nullptr, getNdpEntry(sw, "2401:db00:2110:3004::c"));
+
+  EXPECT_HW_CALL(sw, stateChanged(_)).Times(1);
+  sendNeighborAdvertisement(handle.get(), "2401:db00:2110:3004::d",
+                            "02:05:73:f9:46:fd", 2, kBatchVlan);
+  waitForStateUpdates(sw);
+  EXPECT_EQ(nullptr, getNdpEntry(sw, "2401:db00:2110:3004::b"));
+  EXPECT_NE(nullptr, getNdpEntry(sw, "2401:db00:2110:3004::c"));
+  EXPECT_NE(nullptr, getNdpEntry(sw, "2401:db00:2110:3004::d"));
+
+  std::vector<NdpEntryThrift> ndpTable;
+  thriftHandler.getNdpTable(ndpTable);
+  EXPECT_EQ(2, ndpTable.size());
+}
 
 TEST(NdpTest, PendingNdpCleanup) {
   seconds ndpTimeout(1);
@@ -0,0 +1,181 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include <folly/Benchmark.h>
+#include <folly/Memory.h>
+#include "fboss/agent/SwSwitch.h"
+#include "fboss/agent/Utils.h"
+#include "fboss/agent/hw/sim/SimPlatform.h"
+#include "fboss/agent/platforms/wedge/WedgePlatformInit.h"
+#include "fboss/agent/state/Interface.h"
+#include "fboss/agent/state/RouteUpdater.h"
+#include "fboss/agent/state/SwitchState.h"
+#include "fboss/agent/state/Vlan.h"
+
+/*
+ * Measures how fast a full table of routes makes it from a SwSwitch update
+ * down to the HwSwitch. The benchmarks take one iteration per route, so the
+ * iters/s column reads as routes/sec.
+ *
+ * By default this runs against SimSwitch, which only measures the SwSwitch
+ * side of an update. Run with --route_benchmark_hw on a wedge to measure
+ * programming through BcmSwitch and BcmRouteTable::programRoutes().
+ */
+
+DEFINE_int32(
+    route_benchmark_ecmp_groups,
+    16,
+    "Number of distinct next hop sets the benchmark routes are spread over");
+DEFINE_bool(
+    route_benchmark_hw,
+    false,
+    "Program routes to the Bcm ASIC of this wedge instead of SimSwitch");
+
+using namespace facebook::fboss;
+using folly::IPAddress;
+using folly::IPAddressV4;
+using folly::MacAddress;
+using std::make_shared;
+using std::make_unique;
+using std::shared_ptr;
+using std::unique_ptr;
+
+namespace {
+
+// Global state used by the benchmarks
+unique_ptr<SwSwitch> sw;
+shared_ptr<SwitchState> emptyRoutesState;
+
+unique_ptr<Platform> createPlatform() {
+  if (FLAGS_route_benchmark_hw) {
+    return initWedgePlatform();
+  }
+  return make_unique<SimPlatform>(MacAddress("02:00:01:00:00:01"), 10);
+}
+
+unique_ptr<SwSwitch> setupSwitch() {
+  auto sw = make_unique<SwSwitch>(createPlatform());
+  sw->init(nullptr /* No custom TunManager */);
+
+  auto updateFn = [&](const shared_ptr<SwitchState>& oldState) {
+    auto state = oldState->clone();
+
+    // Add VLAN 1, and ports 1-9 which belong to it.
+    auto vlan1 = make_shared<Vlan>(VlanID(1), "Vlan1");
+    state->addVlan(vlan1);
+    for (int idx = 1; idx < 10; ++idx) {
+      vlan1->addPort(PortID(idx), false);
+    }
+    // Add Interface 1 to VLAN 1, the next hops of all routes live on it
+    auto intf1 = make_shared<Interface>(
+        InterfaceID(1),
+        RouterID(0),
+        VlanID(1),
+        "interface1",
+        MacAddress("02:00:01:00:00:01"),
+        9000,
+        false, /* is virtual */
+        false  /* is state_sync disabled*/);
+    Interface::Addresses addrs1;
+    addrs1.emplace(IPAddress("10.0.0.1"), 16);
+    intf1->setAddresses(addrs1);
+    state->addIntf(intf1);
+    return state;
+  };
+
+  sw->updateStateBlocking("setup", updateFn);
+  return sw;
+}
+
+RouteNextHopEntry nextHopsForGroup(int group) {
+  // Each group is a 4 way ECMP, with neighboring groups sharing next hops
+  RouteNextHopSet nhops;
+  for (int i = 0; i < 4; ++i) {
+    nhops.emplace(UnresolvedNextHop(
+        IPAddressV4::fromLongHBO(IPAddressV4("10.0.1.0").toLongHBO() +
+                                 group + i),
+        ECMP_WEIGHT));
+  }
+  return RouteNextHopEntry(nhops, AdminDistance::EBGP);
+}
+
+// A /24 per route, carved out of 100.0.0.0/8 onwards
+IPAddressV4 routePrefix(size_t n) {
+  return IPAddressV4::fromLongHBO(
+      IPAddressV4("100.0.0.0").toLongHBO() + (n << 8));
+}
+
+shared_ptr<SwitchState> addRoutes(
+    const shared_ptr<SwitchState>& state,
+    size_t numRoutes) {
+  RouteUpdater updater(state->getRouteTables());
+  auto clientId = StdClientIds2ClientID(StdClientIds::BGPD);
+  for (size_t n = 0; n < numRoutes; ++n) {
+    updater.addRoute(
+        RouterID(0),
+        routePrefix(n),
+        24,
+        clientId,
+        nextHopsForGroup(n % FLAGS_route_benchmark_ecmp_groups));
+  }
+  auto newState = state->clone();
+  newState->resetRouteTables(updater.updateDone());
+  return newState;
+}
+
+void resetRoutes() {
+  sw->updateStateBlocking(
+      "reset routes", [](const shared_ptr<SwitchState>& /*oldState*/) {
+        return emptyRoutesState;
+      });
+}
+
+void init() {
+  sw = setupSwitch();
+  emptyRoutesState = sw->getState();
+}
+
+} // unnamed namespace
+
+BENCHMARK(RouteAdd, numRoutes) {
+  shared_ptr<SwitchState> withRoutes;
+  BENCHMARK_SUSPEND {
+    resetRoutes();
+    withRoutes = addRoutes(emptyRoutesState, numRoutes);
+  }
+
+  sw->updateStateBlocking(
+      "add routes", [&](const shared_ptr<SwitchState>& /*oldState*/) {
+        return withRoutes;
+      });
+}
+
+BENCHMARK(RouteDelete, numRoutes) {
+  BENCHMARK_SUSPEND {
+    resetRoutes();
+    auto withRoutes = addRoutes(emptyRoutesState, numRoutes);
+    sw->updateStateBlocking(
+        "add routes", [&](const shared_ptr<SwitchState>& /*oldState*/) {
+          return withRoutes;
+        });
+  }
+
+  resetRoutes();
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  // Setting up the switch is fairly expensive, so do it once up front rather
+  // than inside each benchmark.
+  init();
+
+  folly::runBenchmarks();
+  return 0;
+}
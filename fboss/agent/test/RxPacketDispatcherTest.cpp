@@ -0,0 +1,232 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/agent/RxPacketDispatcher.h"
+#include "fboss/agent/hw/mock/MockRxPacket.h"
+
+#include <folly/Format.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+using namespace facebook::fboss;
+using std::string;
+using std::unique_ptr;
+
+namespace {
+
+const string kMacs =
+    // dst mac, src mac
+    "ff ff ff ff ff ff  00 02 00 01 02 03";
+
+unique_ptr<MockRxPacket> makePkt(const string& hex, int port = 1) {
+  auto pkt = MockRxPacket::fromHex(kMacs + hex);
+  pkt->setSrcPort(PortID(port));
+  pkt->setSrcVlan(VlanID(1));
+  return pkt;
+}
+
+unique_ptr<MockRxPacket> arpPkt(int port = 1) {
+  return makePkt(
+      // 802.1q, VLAN 1
+      "81 00  00 01"
+      // ARP, htype: ethernet, ptype: IPv4, hlen: 6, plen: 4
+      "08 06  00 01  08 00  06  04"
+      // ARP Request
+      "00 01"
+      // Sender MAC, sender IP: 10.0.0.15
+      "00 02 00 01 02 03  0a 00 00 0f"
+      // Target MAC, target IP: 10.0.0.1
+      "00 00 00 00 00 00  0a 00 00 01",
+      port);
+}
+
+string ipv6Hdr(uint8_t nextHdr) {
+  return folly::sformat(
+      // IPv6
+      "86 dd"
+      // Version 6, traffic class, flow label
+      "60 00 00 00"
+      // Payload length, next header, hop limit
+      "00 20  {:02x}  ff"
+      // src addr: fe80::202:1ff:fe02:3
+      "fe 80 00 00 00 00 00 00  02 02 01 ff fe 02 00 03"
+      // dst addr: ff02::1:ff00:1
+      "ff 02 00 00 00 00 00 00  00 00 00 01 ff 00 00 01",
+      nextHdr);
+}
+
+RxPacketDispatcher::Queue classify(const unique_ptr<MockRxPacket>& pkt) {
+  return RxPacketDispatcher::classify(pkt.get());
+}
+
+} // unnamed namespace
+
+TEST(RxPacketDispatcher, Classify) {
+  EXPECT_EQ(RxPacketDispatcher::NEIGHBOR, classify(arpPkt()));
+  // LLDP, untagged
+  EXPECT_EQ(RxPacketDispatcher::CONTROL, classify(makePkt("88 cc  02 07")));
+  // LACP, tagged
+  EXPECT_EQ(
+      RxPacketDispatcher::CONTROL,
+      classify(makePkt("81 00  00 01  88 09  01 01")));
+  // ICMPv6 neighbor solicitation
+  EXPECT_EQ(
+      RxPacketDispatcher::NEIGHBOR,
+      classify(makePkt(ipv6Hdr(58) + "87 00 00 00")));
+  // ICMPv6 echo request
+  EXPECT_EQ(
+      RxPacketDispatcher::DEFAULT,
+      classify(makePkt(ipv6Hdr(58) + "80 00 00 00")));
+  // UDP over IPv6
+  EXPECT_EQ(
+      RxPacketDispatcher::DEFAULT,
+      classify(makePkt(ipv6Hdr(17) + "02 22 02 23")));
+  // IPv6 header cut short of the ICMPv6 type
+  EXPECT_EQ(
+      RxPacketDispatcher::DEFAULT,
+      classify(makePkt(ipv6Hdr(58).substr(0, 30))));
+}
+
+TEST(RxPacketDispatcher, DropWhenFull) {
+  std::vector<std::pair<PortID, RxPacketDispatcher::Queue>> drops;
+  RxPacketDispatcher dispatcher(
+      [](unique_ptr<RxPacket>) {},
+      [&](const RxPacket* pkt, RxPacketDispatcher::Queue queue) {
+        drops.emplace_back(pkt->getSrcPort(), queue);
+      },
+      {{1, 2, 1}},
+      4);
+
+  // Not started, so nothing is taken off the rings
+  EXPECT_TRUE(dispatcher.dispatch(arpPkt(1)));
+  EXPECT_TRUE(dispatcher.dispatch(arpPkt(2)));
+  EXPECT_FALSE(dispatcher.dispatch(arpPkt(3)));
+  // Other queues are unaffected
+  EXPECT_TRUE(dispatcher.dispatch(makePkt("88 cc  02 07", 4)));
+
+  ASSERT_EQ(1, drops.size());
+  EXPECT_EQ(PortID(3), drops[0].first);
+  EXPECT_EQ(RxPacketDispatcher::NEIGHBOR, drops[0].second);
+}
+
+TEST(RxPacketDispatcher, HandleInOrder) {
+  constexpr int kNumPkts = 100;
+  std::vector<PortID> handled;
+  std::promise<void> done;
+  RxPacketDispatcher dispatcher(
+      [&](unique_ptr<RxPacket> pkt) {
+        handled.push_back(pkt->getSrcPort());
+        if (handled.size() == kNumPkts) {
+          done.set_value();
+        }
+      },
+      [](const RxPacket*, RxPacketDispatcher::Queue) { FAIL(); },
+      {{16, kNumPkts, 16}},
+      8);
+
+  // Queue some before the threads start, and the rest after
+  for (int i = 0; i < kNumPkts / 2; ++i) {
+    EXPECT_TRUE(dispatcher.dispatch(arpPkt(i)));
+  }
+  dispatcher.start();
+  for (int i = kNumPkts / 2; i < kNumPkts; ++i) {
+    EXPECT_TRUE(dispatcher.dispatch(arpPkt(i)));
+  }
+
+  ASSERT_EQ(
+      std::future_status::ready,
+      done.get_future().wait_for(std::chrono::seconds(10)));
+  dispatcher.stop();
+  for (int i = 0; i < kNumPkts; ++i) {
+    EXPECT_EQ(PortID(i), handled[i]);
+  }
+}
+
+TEST(RxPacketDispatcher, RestartAfterStop) {
+  std::atomic<int> handled{0};
+  RxPacketDispatcher dispatcher(
+      [&](unique_ptr<RxPacket>) { ++handled; },
+      [](const RxPacket*, RxPacketDispatcher::Queue) { FAIL(); },
+      {{16, 16, 16}},
+      8);
+
+  auto waitForHandled = [&](int expected) {
+    auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (handled.load() < expected &&
+           std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return handled.load() == expected;
+  };
+
+  dispatcher.start();
+  EXPECT_TRUE(dispatcher.dispatch(arpPkt()));
+  EXPECT_TRUE(waitForHandled(1));
+  dispatcher.stop();
+
+  // The threads must not see the earlier stop
+  dispatcher.start();
+  EXPECT_TRUE(dispatcher.dispatch(arpPkt()));
+  EXPECT_TRUE(waitForHandled(2));
+  dispatcher.stop();
+}
+
+// Neighbor and default packets reach handlers that share state, so they
+// must be handled on the same thread
+TEST(RxPacketDispatcher, NeighborAndDefaultShareThread) {
+  EXPECT_EQ(
+      RxPacketDispatcher::queueThread(RxPacketDispatcher::NEIGHBOR),
+      RxPacketDispatcher::queueThread(RxPacketDispatcher::DEFAULT));
+  EXPECT_NE(
+      RxPacketDispatcher::queueThread(RxPacketDispatcher::CONTROL),
+      RxPacketDispatcher::queueThread(RxPacketDispatcher::DEFAULT));
+
+  constexpr int kNumPkts = 64;
+  std::mutex mutex;
+  std::map<RxPacketDispatcher::Queue, std::set<std::thread::id>> threads;
+  std::atomic<int> handled{0};
+  std::promise<void> done;
+  RxPacketDispatcher dispatcher(
+      [&](unique_ptr<RxPacket> pkt) {
+        {
+          std::lock_guard<std::mutex> guard(mutex);
+          threads[RxPacketDispatcher::classify(pkt.get())].insert(
+              std::this_thread::get_id());
+        }
+        if (++handled == kNumPkts) {
+          done.set_value();
+        }
+      },
+      [](const RxPacket*, RxPacketDispatcher::Queue) { FAIL(); },
+      {{kNumPkts, kNumPkts, kNumPkts}},
+      4);
+  dispatcher.start();
+  for (int i = 0; i < kNumPkts / 2; ++i) {
+    EXPECT_TRUE(dispatcher.dispatch(arpPkt(i)));
+    EXPECT_TRUE(dispatcher.dispatch(makePkt(ipv6Hdr(17) + "02 22 02 23", i)));
+  }
+  ASSERT_EQ(
+      std::future_status::ready,
+      done.get_future().wait_for(std::chrono::seconds(10)));
+  dispatcher.stop();
+
+  ASSERT_EQ(1, threads[RxPacketDispatcher::NEIGHBOR].size());
+  EXPECT_EQ(
+      threads[RxPacketDispatcher::NEIGHBOR],
+      threads[RxPacketDispatcher::DEFAULT]);
+}
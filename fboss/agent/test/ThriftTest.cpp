@@ -17,10 +17,14 @@
 #include "fboss/agent/state/SwitchState.h"
 #include "fboss/agent/ApplyThriftConfig.h"
 #include "fboss/agent/state/Route.h"
+#include "fboss/agent/state/StateDelta.h"
 
 #include <folly/IPAddress.h>
+#include <gflags/gflags.h>
 #include <gtest/gtest.h>
 
+#include <thread>
+
 using namespace facebook::fboss;
 using folly::IPAddress;
 using folly::IPAddressV4;
@@ -32,6 +36,8 @@ using testing::UnorderedElementsAreArray;
 using facebook::network::toBinaryAddress;
 using cfg::PortSpeed;
 
+DECLARE_int32(route_update_chunk_size);
+
 namespace {
 
 unique_ptr<HwTestHandle> setupTestHandle() {
@@ -300,3 +306,122 @@ TEST(ThriftTest, syncFib) {
   EXPECT_EQ(4 + 1, tables3->getRouteTable(rid)->getRibV4()->size());
   EXPECT_EQ(4 + 1, tables3->getRouteTable(rid)->getRibV6()->size());
 }
+
+// syncFib applied in chunks must end up with the same routes as an atomic one
+TEST(ThriftTest, syncFibChunked) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_route_update_chunk_size = 2;
+  RouterID rid = RouterID(0);
+
+  cfg::SwitchConfig config;
+  config.vlans.resize(1);
+  config.vlans[0].id = 1;
+  config.interfaces.resize(1);
+  config.interfaces[0].intfID = 1;
+  config.interfaces[0].vlanID = 1;
+  config.interfaces[0].routerID = 0;
+  config.interfaces[0].__isset.mac = true;
+  config.interfaces[0].mac_ref().value_unchecked() = "00:02:00:00:00:01";
+  config.interfaces[0].ipAddresses.resize(1);
+  config.interfaces[0].ipAddresses[0] = "10.0.0.1/24";
+
+  auto handle = createTestHandle(&config);
+  auto sw = handle->getSw();
+  sw->initialConfigApplied(std::chrono::steady_clock::now());
+  sw->fibSynced();
+  ThriftHandler handler(sw);
+
+  auto cli1_nhop4 = "11.11.11.11";
+  auto cli1_nhop4b = "11.11.11.12";
+  auto cli2_nhop4 = "22.22.22.22";
+
+  // prefixA4 is client 10 only, prefixB4 is shared with client 20
+  auto prefixA4 = "7.1.0.0/16";
+  auto prefixB4 = "7.2.0.0/16";
+  handler.addUnicastRoute(10, makeUnicastRoute(prefixA4, cli1_nhop4));
+  handler.addUnicastRoute(10, makeUnicastRoute(prefixB4, cli1_nhop4));
+  handler.addUnicastRoute(20, makeUnicastRoute(prefixB4, cli2_nhop4));
+
+  // Sync more routes than fit in one chunk, and leave prefixA4 and prefixB4
+  // out so that the final sweep has to remove client 10 from them
+  auto prefixD4 = "7.4.0.0/16";
+  auto prefixE4 = "7.5.0.0/16";
+  auto prefixF4 = "7.6.0.0/16";
+  auto newRoutes = std::make_unique<std::vector<UnicastRoute>>();
+  newRoutes->push_back(*makeUnicastRoute(prefixD4, cli1_nhop4b));
+  newRoutes->push_back(*makeUnicastRoute(prefixE4, cli1_nhop4b));
+  newRoutes->push_back(*makeUnicastRoute(prefixF4, cli1_nhop4b));
+  handler.syncFib(10, std::move(newRoutes));
+
+  auto tables = sw->getState()->getRouteTables();
+  GET_ROUTE_V4(tables, rid, "10.0.0.0/24");
+  EXPECT_NO_ROUTE(tables, rid, prefixA4);
+  auto rtB = GET_ROUTE_V4(tables, rid, prefixB4);
+  EXPECT_EQ(nullptr, rtB->getEntryForClient(ClientID(10)));
+  EXPECT_NE(nullptr, rtB->getEntryForClient(ClientID(20)));
+  GET_ROUTE_V4(tables, rid, prefixD4);
+  GET_ROUTE_V4(tables, rid, prefixE4);
+  GET_ROUTE_V4(tables, rid, prefixF4);
+  // interface route, prefixB4, 3 synced routes and the default route
+  EXPECT_EQ(1 + 1 + 3 + 1, tables->getRouteTable(rid)->getRibV4()->size());
+}
+
+// A route added between the chunks of a sync must not be overwritten by the
+// chunk of the sync that carries the same prefix
+TEST(ThriftTest, syncFibChunkedLateAdd) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_route_update_chunk_size = 1;
+  RouterID rid = RouterID(0);
+
+  cfg::SwitchConfig config;
+  config.vlans.resize(1);
+  config.vlans[0].id = 1;
+  config.interfaces.resize(1);
+  config.interfaces[0].intfID = 1;
+  config.interfaces[0].vlanID = 1;
+  config.interfaces[0].routerID = 0;
+  config.interfaces[0].__isset.mac = true;
+  config.interfaces[0].mac_ref().value_unchecked() = "00:02:00:00:00:01";
+  config.interfaces[0].ipAddresses.resize(1);
+  config.interfaces[0].ipAddresses[0] = "10.0.0.1/24";
+
+  auto handle = createTestHandle(&config);
+  auto sw = handle->getSw();
+  sw->initialConfigApplied(std::chrono::steady_clock::now());
+  sw->fibSynced();
+  ThriftHandler handler(sw);
+
+  auto syncNhop = "11.11.11.11";
+  auto lateNhop = "11.11.11.12";
+  auto firstPrefix = "7.0.0.0/16";
+  auto lastPrefix = "7.63.0.0/16";
+  auto newRoutes = std::make_unique<std::vector<UnicastRoute>>();
+  for (int i = 0; i < 64; ++i) {
+    auto prefix = folly::to<std::string>("7.", i, ".0.0/16");
+    newRoutes->push_back(*makeUnicastRoute(prefix, syncNhop));
+  }
+
+  WaitForSwitchState firstChunk(
+      sw,
+      [&](const StateDelta& delta) {
+        auto rib = delta.newState()
+                       ->getRouteTables()
+                       ->getRouteTableIf(rid)
+                       ->getRibV4();
+        return rib->exactMatch(makePrefixV4(firstPrefix)) != nullptr;
+      },
+      "syncFibChunkedLateAdd");
+  std::thread syncThread(
+      [&]() { handler.syncFib(10, std::move(newRoutes)); });
+  EXPECT_TRUE(firstChunk.wait());
+  handler.addUnicastRoute(10, makeUnicastRoute(lastPrefix, lateNhop));
+  syncThread.join();
+
+  auto tables = sw->getState()->getRouteTables();
+  GET_ROUTE_V4(tables, rid, firstPrefix);
+  auto rt = GET_ROUTE_V4(tables, rid, lastPrefix);
+  auto entry = rt->getEntryForClient(ClientID(10));
+  ASSERT_NE(nullptr, entry);
+  ASSERT_EQ(1, entry->getNextHopSet().size());
+  EXPECT_EQ(IPAddress(lateNhop), entry->getNextHopSet().begin()->addr());
+}
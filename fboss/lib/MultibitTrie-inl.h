@@ -0,0 +1,398 @@
+// Copyright 2004-present Facebook. All Rights Reserved.
+#ifndef MULTIBIT_TRIE_H
+#error "This should only be included by MultibitTrie.h"
+#endif
+
+namespace facebook { namespace network {
+
+template<typename IPADDRTYPE, typename T>
+constexpr uint32_t MultibitTrie<IPADDRTYPE, T>::kStride;
+template<typename IPADDRTYPE, typename T>
+constexpr uint32_t MultibitTrie<IPADDRTYPE, T>::kFanout;
+template<typename IPADDRTYPE, typename T>
+constexpr uint32_t MultibitTrie<IPADDRTYPE, T>::kRoot;
+template<typename IPADDRTYPE, typename T>
+constexpr uint32_t MultibitTrie<IPADDRTYPE, T>::kMaxDepth;
+template<typename IPADDRTYPE, typename T>
+constexpr uint32_t MultibitTrie<IPADDRTYPE, T>::kEntryChunkSize;
+
+template<typename IPADDRTYPE, typename T>
+MultibitTrie<IPADDRTYPE, T>& MultibitTrie<IPADDRTYPE, T>::operator=(
+    MultibitTrie&& r) noexcept {
+  if (this != &r) {
+    nodes_ = std::move(r.nodes_);
+    entryIds_ = std::move(r.entryIds_);
+    entryChunks_ = std::move(r.entryChunks_);
+    numEntries_ = r.numEntries_;
+    freeEntries_ = std::move(r.freeEntries_);
+    head_ = r.head_;
+    tail_ = r.tail_;
+    size_ = r.size_;
+    r.clear();
+  }
+  return *this;
+}
+
+template<typename IPADDRTYPE, typename T>
+void MultibitTrie<IPADDRTYPE, T>::clear() {
+  nodes_.clear();
+  entryIds_.clear();
+  entryChunks_.clear();
+  numEntries_ = 0;
+  freeEntries_.clear();
+  head_ = nullptr;
+  tail_ = nullptr;
+  size_ = 0;
+  // The root is always there, even in an empty trie
+  auto root = nodes_.allocate(1);
+  DCHECK_EQ(root, kRoot);
+}
+
+template<typename IPADDRTYPE, typename T>
+uint32_t MultibitTrie<IPADDRTYPE, T>::chunkAt(const Words& words,
+    uint32_t offset) {
+  auto word = offset / 64;
+  auto shift = offset % 64;
+  if (word >= words.size()) {
+    return 0;
+  }
+  uint64_t bits = words[word] << shift;
+  if (shift > 64 - kStride && word + 1 < words.size()) {
+    // The chunk straddles 2 words
+    bits |= words[word + 1] >> (64 - shift);
+  }
+  return static_cast<uint32_t>(bits >> (64 - kStride));
+}
+
+template<typename IPADDRTYPE, typename T>
+uint64_t MultibitTrie<IPADDRTYPE, T>::matchingPrefixes(uint32_t chunk,
+    uint32_t maxLen) {
+  // All the prefixes of each chunk, of any length
+  static const auto kPrefixesOfChunk = [] {
+    std::array<uint64_t, kFanout> prefixes;
+    for (uint32_t c = 0; c < kFanout; ++c) {
+      prefixes[c] = 0;
+      for (uint32_t len = 0; len < kStride; ++len) {
+        prefixes[c] |= bit(prefixIndex(c, len));
+      }
+    }
+    return prefixes;
+  }();
+  // Prefixes of up to maxLen bits have the lowest indices
+  return kPrefixesOfChunk[chunk] & (bit((1u << (maxLen + 1)) - 1) - 1);
+}
+
+template<typename IPADDRTYPE, typename T>
+const typename MultibitTrie<IPADDRTYPE, T>::Entry*
+MultibitTrie<IPADDRTYPE, T>::longestMatchImpl(const IPADDRTYPE& ipaddr,
+    uint8_t masklen, VecConstIterators* trail) const {
+  DCHECK_LE(masklen, IPADDRTYPE::bitCount());
+  // Bits past masklen are never looked at, so there is no need to mask
+  const auto words = MultibitTrieAddress<IPADDRTYPE>::toWords(ipaddr);
+  const Entry* match = nullptr;
+  uint32_t nodeIndex = kRoot;
+  uint32_t offset = 0;
+  while (true) {
+    const auto& node = nodes_[nodeIndex];
+    auto chunk = chunkAt(words, offset);
+    uint32_t remaining = masklen - offset;
+    auto prefixes = node.prefixes & matchingPrefixes(chunk,
+        remaining < kStride ? remaining : kStride - 1);
+    if (prefixes) {
+      if (trail) {
+        // Shorter prefixes have lower indices
+        for (auto p = prefixes; p; p &= p - 1) {
+          trail->push_back(
+              ConstIterator(&entryAt(node, folly::findFirstSet(p) - 1)));
+        }
+      }
+      match = &entryAt(node, folly::findLastSet(prefixes) - 1);
+    }
+    if (remaining < kStride || !(node.children & bit(chunk))) {
+      break;
+    }
+    nodeIndex = childIndex(node, chunk);
+    offset += kStride;
+  }
+  return match;
+}
+
+template<typename IPADDRTYPE, typename T>
+const typename MultibitTrie<IPADDRTYPE, T>::Entry*
+MultibitTrie<IPADDRTYPE, T>::exactMatchImpl(const IPADDRTYPE& ipaddr,
+    uint8_t masklen) const {
+  if (masklen > IPADDRTYPE::bitCount()) {
+    return nullptr;
+  }
+  const auto words = MultibitTrieAddress<IPADDRTYPE>::toWords(ipaddr);
+  uint32_t nodeIndex = kRoot;
+  uint32_t offset = 0;
+  while (masklen - offset >= kStride) {
+    const auto& node = nodes_[nodeIndex];
+    auto chunk = chunkAt(words, offset);
+    if (!(node.children & bit(chunk))) {
+      return nullptr;
+    }
+    nodeIndex = childIndex(node, chunk);
+    offset += kStride;
+  }
+  const auto& node = nodes_[nodeIndex];
+  auto index = prefixIndex(chunkAt(words, offset), masklen - offset);
+  return (node.prefixes & bit(index)) ? &entryAt(node, index) : nullptr;
+}
+
+template <typename IPADDRTYPE, typename T>
+template <typename VALUE>
+std::pair<typename MultibitTrie<IPADDRTYPE, T>::Iterator, bool>
+MultibitTrie<IPADDRTYPE, T>::insert(const IPADDRTYPE& ipaddr,
+    uint8_t masklen, VALUE&& value) {
+  CHECK_LE(masklen, IPADDRTYPE::bitCount());
+  // Can't trust the clients to have 0s in all bits after mask length
+  const auto toAdd = ipaddr.mask(masklen);
+  const auto words = MultibitTrieAddress<IPADDRTYPE>::toWords(toAdd);
+  uint32_t nodeIndex = kRoot;
+  uint32_t offset = 0;
+  while (masklen - offset >= kStride) {
+    auto chunk = chunkAt(words, offset);
+    if (nodes_[nodeIndex].children & bit(chunk)) {
+      nodeIndex = childIndex(nodes_[nodeIndex], chunk);
+    } else {
+      nodeIndex = addChild(nodeIndex, chunk);
+    }
+    offset += kStride;
+  }
+  auto index = prefixIndex(chunkAt(words, offset), masklen - offset);
+  if (nodes_[nodeIndex].prefixes & bit(index)) {
+    // Prefix already exists in the trie
+    return std::make_pair(Iterator(&entryAt(nodes_[nodeIndex], index)), false);
+  }
+  auto entryId = allocateEntry();
+  auto& newEntry = entry(entryId);
+  newEntry.ipAddress_ = toAdd;
+  newEntry.masklen_ = masklen;
+  newEntry.value_ = std::forward<VALUE>(value);
+  addPrefix(nodeIndex, index, entryId);
+  link(&newEntry, firstAfter(kRoot, 0, words, masklen));
+  ++size_;
+  return std::make_pair(Iterator(&newEntry), true);
+}
+
+template<typename IPADDRTYPE, typename T>
+bool MultibitTrie<IPADDRTYPE, T>::erase(const IPADDRTYPE& ipaddr,
+    uint8_t masklen) {
+  if (masklen > IPADDRTYPE::bitCount()) {
+    return false;
+  }
+  const auto words = MultibitTrieAddress<IPADDRTYPE>::toWords(ipaddr);
+  // (parent, chunk of child) for each node on the way to the prefix
+  std::array<std::pair<uint32_t, uint32_t>, kMaxDepth> path;
+  uint32_t depth = 0;
+  uint32_t nodeIndex = kRoot;
+  uint32_t offset = 0;
+  while (masklen - offset >= kStride) {
+    auto chunk = chunkAt(words, offset);
+    if (!(nodes_[nodeIndex].children & bit(chunk))) {
+      return false;
+    }
+    path[depth++] = std::make_pair(nodeIndex, chunk);
+    nodeIndex = childIndex(nodes_[nodeIndex], chunk);
+    offset += kStride;
+  }
+  auto index = prefixIndex(chunkAt(words, offset), masklen - offset);
+  const auto& node = nodes_[nodeIndex];
+  if (!(node.prefixes & bit(index))) {
+    return false;
+  }
+  auto entryId = entryIds_[node.entryBase + rank(node.prefixes, index)];
+  removePrefix(nodeIndex, index);
+  unlink(&entry(entryId));
+  freeEntry(entryId);
+  --size_;
+  // Nodes left with neither prefixes nor children go away, so that every
+  // node leads to some prefix
+  while (depth > 0 && !nodes_[nodeIndex].prefixes &&
+      !nodes_[nodeIndex].children) {
+    --depth;
+    removeChild(path[depth].first, path[depth].second);
+    nodeIndex = path[depth].first;
+  }
+  return true;
+}
+
+template<typename IPADDRTYPE, typename T>
+uint32_t MultibitTrie<IPADDRTYPE, T>::addChild(uint32_t nodeIndex,
+    uint32_t chunk) {
+  auto children = nodes_[nodeIndex].children;
+  auto childBase = nodes_.insert(nodes_[nodeIndex].childBase,
+      folly::popcount(children), rank(children, chunk), Node());
+  auto& node = nodes_[nodeIndex];
+  node.childBase = childBase;
+  node.children |= bit(chunk);
+  return childIndex(node, chunk);
+}
+
+template<typename IPADDRTYPE, typename T>
+void MultibitTrie<IPADDRTYPE, T>::removeChild(uint32_t nodeIndex,
+    uint32_t chunk) {
+  auto children = nodes_[nodeIndex].children;
+  auto childBase = nodes_.erase(nodes_[nodeIndex].childBase,
+      folly::popcount(children), rank(children, chunk));
+  auto& node = nodes_[nodeIndex];
+  node.childBase = childBase;
+  node.children &= ~bit(chunk);
+}
+
+template<typename IPADDRTYPE, typename T>
+void MultibitTrie<IPADDRTYPE, T>::addPrefix(uint32_t nodeIndex,
+    uint32_t index, uint32_t entryId) {
+  auto& node = nodes_[nodeIndex];
+  node.entryBase = entryIds_.insert(node.entryBase,
+      folly::popcount(node.prefixes), rank(node.prefixes, index), entryId);
+  node.prefixes |= bit(index);
+}
+
+template<typename IPADDRTYPE, typename T>
+void MultibitTrie<IPADDRTYPE, T>::removePrefix(uint32_t nodeIndex,
+    uint32_t index) {
+  auto& node = nodes_[nodeIndex];
+  node.entryBase = entryIds_.erase(node.entryBase,
+      folly::popcount(node.prefixes), rank(node.prefixes, index));
+  node.prefixes &= ~bit(index);
+}
+
+template<typename IPADDRTYPE, typename T>
+uint32_t MultibitTrie<IPADDRTYPE, T>::allocateEntry() {
+  if (!freeEntries_.empty()) {
+    auto id = freeEntries_.back();
+    freeEntries_.pop_back();
+    return id;
+  }
+  if (numEntries_ % kEntryChunkSize == 0) {
+    CHECK_LT(numEntries_, std::numeric_limits<uint32_t>::max());
+    entryChunks_.push_back(std::make_unique<Entry[]>(kEntryChunkSize));
+  }
+  return numEntries_++;
+}
+
+template<typename IPADDRTYPE, typename T>
+void MultibitTrie<IPADDRTYPE, T>::freeEntry(uint32_t id) {
+  auto& freed = entry(id);
+  freed.value_.clear();
+  freed.prev_ = nullptr;
+  freed.next_ = nullptr;
+  freeEntries_.push_back(id);
+}
+
+template<typename IPADDRTYPE, typename T>
+typename MultibitTrie<IPADDRTYPE, T>::Entry*
+MultibitTrie<IPADDRTYPE, T>::firstAfter(uint32_t nodeIndex, uint32_t offset,
+    const Words& words, uint32_t masklen) {
+  auto chunk = chunkAt(words, offset);
+  uint32_t remaining = masklen - offset;
+  if (remaining < kStride) {
+    // The prefix ends in this node. What follows it are the prefixes at the
+    // same position that are longer, and everything at later positions.
+    return firstInNode(nodeIndex, chunk, remaining + 1);
+  }
+  const auto& node = nodes_[nodeIndex];
+  if (node.children & bit(chunk)) {
+    auto next = firstAfter(childIndex(node, chunk), offset + kStride, words,
+        masklen);
+    if (next) {
+      return next;
+    }
+  }
+  return chunk + 1 < kFanout ? firstInNode(nodeIndex, chunk + 1, 0) : nullptr;
+}
+
+template<typename IPADDRTYPE, typename T>
+typename MultibitTrie<IPADDRTYPE, T>::Entry*
+MultibitTrie<IPADDRTYPE, T>::firstInNode(uint32_t nodeIndex, uint32_t chunk,
+    uint32_t len) {
+  const auto& node = nodes_[nodeIndex];
+  // Find the first prefix at or after (chunk, len), a prefix length at a
+  // time. The prefixes of a given length are ordered by chunk.
+  uint32_t prefixChunk = kFanout;
+  uint32_t prefixLen = 0;
+  for (uint32_t l = 0; l < kStride; ++l) {
+    auto shift = kStride - l;
+    auto ofLen = (node.prefixes >> ((1u << l) - 1)) & (bit(1u << l) - 1);
+    // Position of the first candidate: prefixes at chunk itself only follow
+    // (chunk, len) if they are at least len long
+    auto first = (chunk + (1u << shift) - 1) >> shift;
+    if ((chunk & ((1u << shift) - 1)) == 0 && l < len) {
+      ++first;
+    }
+    if (first >= (1u << l)) {
+      continue;
+    }
+    auto candidates = ofLen & ~(bit(first) - 1);
+    if (!candidates) {
+      continue;
+    }
+    // Shorter lengths come first at a given position, so only a strictly
+    // earlier position beats what we already have
+    uint32_t candidateChunk = (folly::findFirstSet(candidates) - 1) << shift;
+    if (candidateChunk < prefixChunk) {
+      prefixChunk = candidateChunk;
+      prefixLen = l;
+    }
+  }
+  // Children are at (child chunk, kStride), after any prefix at the same
+  // position
+  auto children = chunk < kFanout ? node.children & ~(bit(chunk) - 1) : 0;
+  while (children) {
+    uint32_t childChunk = folly::findFirstSet(children) - 1;
+    if (prefixChunk <= childChunk) {
+      break;
+    }
+    auto first = firstInNode(childIndex(node, childChunk), 0, 0);
+    if (first) {
+      return first;
+    }
+    children &= children - 1;
+  }
+  if (prefixChunk < kFanout) {
+    return &entryAt(node, prefixIndex(prefixChunk, prefixLen));
+  }
+  return nullptr;
+}
+
+template<typename IPADDRTYPE, typename T>
+void MultibitTrie<IPADDRTYPE, T>::link(Entry* entry, Entry* next) {
+  entry->next_ = next;
+  entry->prev_ = next ? next->prev_ : tail_;
+  (entry->prev_ ? entry->prev_->next_ : head_) = entry;
+  (next ? next->prev_ : tail_) = entry;
+}
+
+template<typename IPADDRTYPE, typename T>
+void MultibitTrie<IPADDRTYPE, T>::unlink(Entry* entry) {
+  (entry->prev_ ? entry->prev_->next_ : head_) = entry->next_;
+  (entry->next_ ? entry->next_->prev_ : tail_) = entry->prev_;
+}
+
+template<typename IPADDRTYPE, typename T>
+bool MultibitTrie<IPADDRTYPE, T>::operator==(const MultibitTrie& r) const {
+  if (size_ != r.size_) {
+    return false;
+  }
+  for (auto itr = begin(), ritr = r.begin(); itr != end(); ++itr, ++ritr) {
+    if (itr->ipAddress() != ritr->ipAddress() ||
+        itr->masklen() != ritr->masklen() ||
+        !(itr->value() == ritr->value())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template<typename IPADDRTYPE, typename T>
+size_t MultibitTrie<IPADDRTYPE, T>::memoryUsage() const {
+  return sizeof(*this) + nodes_.memoryUsage() + entryIds_.memoryUsage() +
+    entryChunks_.capacity() * sizeof(std::unique_ptr<Entry[]>) +
+    entryChunks_.size() * kEntryChunkSize * sizeof(Entry) +
+    freeEntries_.capacity() * sizeof(uint32_t);
+}
+
+}} //facebook::network
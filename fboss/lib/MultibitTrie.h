@@ -0,0 +1,662 @@
+// Copyright 2004-present Facebook. All Rights Reserved.
+
+#ifndef MULTIBIT_TRIE_H
+#define MULTIBIT_TRIE_H
+
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <folly/Bits.h>
+#include <folly/Conv.h>
+#include <folly/IPAddressV4.h>
+#include <folly/IPAddressV6.h>
+#include <folly/Optional.h>
+#include <glog/logging.h>
+
+namespace facebook { namespace network {
+/*
+ * MultibitTrie is an alternative to RadixTree for IPAddressV4 or IPAddressV6
+ * prefixes, built for large tables. It has the RadixTree API that
+ * RouteTableRib and rib::NetworkToRouteMap use, so either can be chosen
+ * through their tree template parameter.
+ *
+ * RadixTree is a binary trie with a heap allocated node per prefix, so a
+ * lookup chases a pointer for every bit that tells two prefixes apart.
+ * MultibitTrie consumes kStride bits of address per level instead, laid out
+ * in the manner of Tree Bitmap and Poptrie:
+ *  - Prefixes that end within a node are recorded in a bitmap with a bit
+ *    per prefix of 0 to kStride - 1 bits, and the node's children in a
+ *    bitmap with a bit per kStride bit value.
+ *  - A node's children, like the prefixes ending in it, are stored
+ *    contiguously in a pool and found by counting the bits set before
+ *    theirs. Nodes refer to pools by 32 bit index, which keeps them at
+ *    24 bytes.
+ * A lookup visits at most 6 nodes for IPv4 and 22 for IPv6, however many
+ * prefixes there are.
+ *
+ * There is no path compression: a prefix always has a node for each stride
+ * above it, even where those nodes have a single child and no prefixes of
+ * their own. Sparse tables of long prefixes, such as host routes scattered
+ * over IPv6, therefore cost more nodes per prefix than dense ones.
+ *
+ * Prefixes and their values are kept in stable storage, so that iterators
+ * and references to values are valid until the prefix is erased, as with
+ * RadixTree. Iteration is in the same order as RadixTree's: by address,
+ * then by mask length.
+ *
+ * As there are no non value nodes, includeNonValueNodes has no effect.
+ * There is no folly::IPAddress version.
+ */
+template <typename IPADDRTYPE, typename T>
+class MultibitTrie;
+
+/*
+ * Maps an address to the 64 bit words MultibitTrie reads it from, most
+ * significant bit first.
+ */
+template <typename IPADDRTYPE>
+struct MultibitTrieAddress;
+
+template <>
+struct MultibitTrieAddress<folly::IPAddressV4> {
+  typedef std::array<uint64_t, 1> Words;
+  static Words toWords(const folly::IPAddressV4& addr) {
+    return Words{{static_cast<uint64_t>(addr.toLongHBO()) << 32}};
+  }
+};
+
+template <>
+struct MultibitTrieAddress<folly::IPAddressV6> {
+  typedef std::array<uint64_t, 2> Words;
+  static Words toWords(const folly::IPAddressV6& addr) {
+    const auto bytes = addr.toByteArray();
+    Words words{{0, 0}};
+    for (size_t i = 0; i < bytes.size(); ++i) {
+      words[i / 8] = (words[i / 8] << 8) | bytes[i];
+    }
+    return words;
+  }
+};
+
+/*
+ * A prefix stored in a MultibitTrie. Entries are linked to each other in
+ * iteration order.
+ */
+template <typename IPADDRTYPE, typename T>
+class MultibitTrieEntry {
+ public:
+  const IPADDRTYPE& ipAddress() const { return ipAddress_; }
+  uint32_t masklen() const { return masklen_; }
+  bool isValueNode() const { return value_.hasValue(); }
+  bool isNonValueNode() const { return !isValueNode(); }
+  const T& value() const { return value_.value(); }
+  T& value() { return value_.value(); }
+  MultibitTrieEntry* next() const { return next_; }
+
+  template<typename VALUE>
+  void setValue(VALUE&& newValue) {
+    value_ = std::forward<VALUE>(newValue);
+  }
+
+  // Whether entry's prefix is this prefix or a more specific one
+  bool contains(const MultibitTrieEntry& entry) const {
+    return entry.masklen_ >= masklen_ &&
+      entry.ipAddress_.mask(masklen_) == ipAddress_;
+  }
+
+  std::string str(bool printValue = true) const {
+    auto entryStr = folly::to<std::string>(ipAddress_.str(), "/",
+        static_cast<uint32_t>(masklen_));
+    if (printValue) {
+      entryStr += folly::to<std::string>("(", this->value(), ")");
+    }
+    return entryStr;
+  }
+
+ private:
+  friend class MultibitTrie<IPADDRTYPE, T>;
+
+  IPADDRTYPE ipAddress_;
+  uint8_t masklen_{0};
+  folly::Optional<T> value_;
+  MultibitTrieEntry* prev_{nullptr};
+  MultibitTrieEntry* next_{nullptr};
+};
+
+/*
+ * Forward Iterator over a MultibitTrie, in RadixTree order
+ */
+template <typename IPADDRTYPE, typename T,
+         typename ENTRY, typename DESIREDITERTYPE>
+class MultibitTrieIteratorImpl :
+  public std::iterator<std::forward_iterator_tag, DESIREDITERTYPE> {
+ public:
+  typedef DESIREDITERTYPE ValueType;
+  typedef ENTRY Entry;
+
+  // default constructor
+  MultibitTrieIteratorImpl() {
+  }
+  explicit MultibitTrieIteratorImpl(ENTRY* entry): cursor_(entry) {}
+
+  DESIREDITERTYPE& operator++() {
+    checkDereference(); // check if we are already at end
+    cursor_ = cursor_->next();
+    if (cursor_ && subTreeRoot_ && !subTreeRoot_->contains(*cursor_)) {
+      cursor_ = nullptr;
+    }
+    normalize();
+    return static_cast<DESIREDITERTYPE&>(*this);
+  }
+
+  DESIREDITERTYPE  operator++(int) {
+    DESIREDITERTYPE tmp(static_cast<DESIREDITERTYPE&>(*this));
+    ++(*this);
+    return tmp;
+  }
+
+  // Returns iterator over the current prefix and the ones more specific
+  DESIREDITERTYPE subTreeIterator() const {
+    DESIREDITERTYPE tmp(static_cast<const DESIREDITERTYPE&>(*this));
+    tmp.subTreeRoot_ = cursor_;
+    return tmp;
+  }
+
+  void reset() {
+    cursor_ = nullptr;
+    subTreeRoot_ = nullptr;
+  }
+
+  // Iterators at the same prefix are equal, whether or not either is
+  // limited to a sub tree
+  bool operator==(const MultibitTrieIteratorImpl& r) const {
+    return cursor_ == r.cursor_;
+  }
+
+  bool operator!=(const MultibitTrieIteratorImpl& r) const {
+    return cursor_ != r.cursor_;
+  }
+
+  const DESIREDITERTYPE& operator*() const {
+    checkDereference();
+    return static_cast<const DESIREDITERTYPE&>(*this);
+  }
+
+  const DESIREDITERTYPE* operator->() const {
+    checkDereference();
+    return static_cast<const DESIREDITERTYPE*>(this);
+  }
+
+  DESIREDITERTYPE& operator*() {
+    checkDereference();
+    return static_cast<DESIREDITERTYPE&>(*this);
+  }
+
+  DESIREDITERTYPE* operator->() {
+    checkDereference();
+    return static_cast<DESIREDITERTYPE*>(this);
+  }
+
+  bool atEnd() const { return cursor_ == nullptr; }
+
+  T& value() const {
+    checkDereference();
+    return cursor_->value();
+  }
+
+  const IPADDRTYPE& ipAddress() const {
+    checkDereference();
+    return cursor_->ipAddress();
+  }
+
+  uint8_t masklen() const {
+    checkDereference();
+    return cursor_->masklen();
+  }
+
+  // Entry at this cursor location
+  ENTRY* entry() const { return cursor_; }
+  std::string str(bool printValue = true) const {
+    checkDereference();
+    return cursor_->str(printValue);
+  }
+  bool includeNonValueNodes() const { return false; }
+
+  void checkValueNode() const {
+    CHECK(cursor_->isValueNode());
+  }
+ protected:
+  void normalize() {
+    if (cursor_ == nullptr) {
+      reset();
+    }
+  }
+  void checkDereference() const {
+    CHECK(!atEnd());
+  }
+  ENTRY* cursor_{nullptr};
+  // Set for iterators over a sub tree, which end after the last prefix
+  // within subTreeRoot_
+  const ENTRY* subTreeRoot_{nullptr};
+};
+
+/*
+ * Iterator over a MultibitTrie
+ */
+template <typename IPADDRTYPE, typename T>
+class MultibitTrieIterator : public MultibitTrieIteratorImpl<IPADDRTYPE, T,
+  MultibitTrieEntry<IPADDRTYPE, T>, MultibitTrieIterator<IPADDRTYPE, T>> {
+ public:
+  typedef MultibitTrieIteratorImpl<IPADDRTYPE, T,
+          MultibitTrieEntry<IPADDRTYPE, T>,
+          MultibitTrieIterator<IPADDRTYPE, T>> IteratorImpl;
+  using IteratorImpl::entry;
+ private:
+  using IteratorImpl::cursor_;
+  using IteratorImpl::checkDereference;
+
+ public:
+  // Inherit constructors
+  using IteratorImpl::IteratorImpl;
+  // default constructor
+  MultibitTrieIterator() {
+  }
+
+  template<typename VALUE>
+  void setValue(VALUE&& value) const {
+    checkDereference();
+    cursor_->setValue(std::forward<VALUE>(value));
+  }
+};
+
+/*
+ * Const Iterator over a MultibitTrie
+ */
+template <typename IPADDRTYPE, typename T>
+class MultibitTrieConstIterator : public MultibitTrieIteratorImpl<IPADDRTYPE,
+  const T, const MultibitTrieEntry<IPADDRTYPE, T>,
+  MultibitTrieConstIterator<IPADDRTYPE, T>> {
+ public:
+  typedef MultibitTrieIteratorImpl<IPADDRTYPE, const T,
+          const MultibitTrieEntry<IPADDRTYPE, T>,
+          MultibitTrieConstIterator<IPADDRTYPE, T>> IteratorImpl;
+  typedef MultibitTrieIterator<IPADDRTYPE, T> NonConstIterator;
+
+  // Inherit constructors
+  using IteratorImpl::IteratorImpl;
+  // default constructor
+  MultibitTrieConstIterator() {
+  }
+  explicit MultibitTrieConstIterator(NonConstIterator itr) :
+    MultibitTrieConstIterator(itr.entry()) {}
+};
+
+/*
+ * Pool of the blocks MultibitTrie keeps a node's children, or the prefixes
+ * ending in a node, in. A block holds at most MAXBLOCK elements, one per bit
+ * of a node's bitmap, so freed blocks are simply kept on a free list per
+ * size for reuse.
+ */
+template <typename ELEM, uint32_t MAXBLOCK>
+class MultibitTrieBlockPool {
+ public:
+  ELEM& operator[](uint32_t index) { return elems_[index]; }
+  const ELEM& operator[](uint32_t index) const { return elems_[index]; }
+
+  // NOTE: may reallocate the pool, invalidating references into it
+  uint32_t allocate(uint32_t count) {
+    DCHECK(count > 0 && count <= MAXBLOCK);
+    auto& freeBlocks = freeBlocks_[count];
+    if (!freeBlocks.empty()) {
+      auto base = freeBlocks.back();
+      freeBlocks.pop_back();
+      return base;
+    }
+    auto base = elems_.size();
+    CHECK_LE(base + count, std::numeric_limits<uint32_t>::max());
+    elems_.resize(base + count);
+    return static_cast<uint32_t>(base);
+  }
+
+  void free(uint32_t base, uint32_t count) {
+    if (count) {
+      freeBlocks_[count].push_back(base);
+    }
+  }
+
+  /*
+   * Move the block of count elements at base to a block with elem inserted
+   * at position rank, and return the new block's base.
+   */
+  uint32_t insert(uint32_t base, uint32_t count, uint32_t rank, ELEM elem) {
+    auto newBase = allocate(count + 1);
+    for (uint32_t i = 0; i < rank; ++i) {
+      elems_[newBase + i] = elems_[base + i];
+    }
+    elems_[newBase + rank] = elem;
+    for (uint32_t i = rank; i < count; ++i) {
+      elems_[newBase + i + 1] = elems_[base + i];
+    }
+    free(base, count);
+    return newBase;
+  }
+
+  /*
+   * Move the block of count elements at base to a block without the element
+   * at position rank, and return the new block's base.
+   */
+  uint32_t erase(uint32_t base, uint32_t count, uint32_t rank) {
+    DCHECK_LT(rank, count);
+    uint32_t newBase = 0;
+    if (count > 1) {
+      newBase = allocate(count - 1);
+      for (uint32_t i = 0; i < rank; ++i) {
+        elems_[newBase + i] = elems_[base + i];
+      }
+      for (uint32_t i = rank + 1; i < count; ++i) {
+        elems_[newBase + i - 1] = elems_[base + i];
+      }
+    }
+    free(base, count);
+    return newBase;
+  }
+
+  // Free all blocks, along with the memory backing them
+  void clear() {
+    std::vector<ELEM>().swap(elems_);
+    for (auto& freeBlocks : freeBlocks_) {
+      std::vector<uint32_t>().swap(freeBlocks);
+    }
+  }
+
+  size_t memoryUsage() const {
+    auto bytes = elems_.capacity() * sizeof(ELEM);
+    for (const auto& freeBlocks : freeBlocks_) {
+      bytes += freeBlocks.capacity() * sizeof(uint32_t);
+    }
+    return bytes;
+  }
+
+ private:
+  std::vector<ELEM> elems_;
+  std::array<std::vector<uint32_t>, MAXBLOCK + 1> freeBlocks_;
+};
+
+template<typename IPADDRTYPE, typename T>
+class MultibitTrie {
+ public:
+  typedef MultibitTrieEntry<IPADDRTYPE, T>         Entry;
+  typedef MultibitTrieIterator<IPADDRTYPE, T>      Iterator;
+  typedef MultibitTrieConstIterator<IPADDRTYPE, T> ConstIterator;
+  typedef typename std::vector<ConstIterator>      VecConstIterators;
+
+  // Bits of address consumed by each level of the trie
+  static constexpr uint32_t kStride = 6;
+
+  MultibitTrie() {
+    clear();
+  }
+
+  MultibitTrie(const MultibitTrie& r) = delete;
+  MultibitTrie& operator=(const MultibitTrie& r) = delete;
+
+  MultibitTrie(MultibitTrie&& r) noexcept {
+    *this = std::move(r);
+  }
+  // Move trie onto this, leaving r empty
+  MultibitTrie& operator=(MultibitTrie&& r) noexcept;
+
+  Iterator  begin()  { return Iterator(head_); }
+  Iterator  end()    { return Iterator(); }
+  ConstIterator begin() const { return ConstIterator(head_); }
+  ConstIterator end()   const { return ConstIterator();  }
+
+  // Free all prefixes and clear the trie.
+  void clear();
+
+  // Nodes and entries always come from pools, this is for RadixTree parity
+  void enableNodePool() {}
+
+  // Clone this trie onto another
+  template <typename U = T>
+  typename std::enable_if<std::is_copy_constructible<U>::value,
+                          MultibitTrie>::type
+    clone() const {
+    static_assert(std::is_same<T, U>::value,
+        "clone template type must be the same as trie value type");
+    MultibitTrie copy;
+    for (const auto& itr : *this) {
+      copy.insert(itr.ipAddress(), itr.masklen(), itr.value());
+    }
+    return copy;
+  }
+
+  /*
+   * Insert a IP, mask, value in trie. Returns inserted prefix, true
+   * if a prefix was inserted. If IP, mask already existed in the trie
+   * we return that prefix, false.
+   */
+  template <typename VALUE>
+  std::pair<Iterator, bool>  insert(const IPADDRTYPE& ipaddr,
+      uint8_t masklen, VALUE&& value);
+
+  // Erase a IP, mask
+  bool erase(const IPADDRTYPE& ipaddr, uint8_t masklen);
+
+  // Erase prefix pointed to by iterator
+  bool erase(Iterator itr) {
+    if (itr.atEnd()) {
+      return false;
+    }
+    // Copy the prefix, the entry it lives in is freed by the erase
+    const auto ipaddr = itr->ipAddress();
+    return erase(ipaddr, itr->masklen());
+  }
+
+  // Given a IP, mask return the prefix with longest match for it
+  // NOTE: masklen is unsigned and must be <= ipaddr.bitCount()
+  ConstIterator longestMatch(const IPADDRTYPE& ipaddr,
+      uint8_t masklen) const {
+    return ConstIterator(longestMatchImpl(ipaddr, masklen));
+  }
+
+  // Non const longest match
+  Iterator longestMatch(const IPADDRTYPE& ipaddr, uint8_t masklen) {
+    return itrConstCast(
+        const_cast<const MultibitTrie*>(this)->longestMatch(ipaddr, masklen));
+  }
+
+  // Given a IP, mask return the prefix that matches it exactly
+  ConstIterator exactMatch(const IPADDRTYPE& ipaddr,
+      uint8_t masklen) const {
+    return ConstIterator(exactMatchImpl(ipaddr, masklen));
+  }
+
+  // Non const exact match
+  Iterator exactMatch(const IPADDRTYPE& ipaddr, uint8_t masklen) {
+    return itrConstCast(
+        const_cast<const MultibitTrie*>(this)->exactMatch(ipaddr, masklen));
+  }
+
+  /*
+   * Get longest match as with the longestMatch api, but in addition record
+   * all the prefixes that match, least specific first, as RadixTree does
+   * for the path from its root. trail is modified only on a successful
+   * match.
+   */
+  ConstIterator longestMatchWithTrail(const IPADDRTYPE& ipaddr,
+      uint8_t masklen, VecConstIterators& trail,
+      bool /*includeNonValueNodes*/ = false) const {
+    VecConstIterators trailInternal;
+    trailInternal.reserve(IPADDRTYPE::bitCount());
+    auto match = longestMatchImpl(ipaddr, masklen, &trailInternal);
+    if (match) {
+      trail.swap(trailInternal);
+    }
+    return ConstIterator(match);
+  }
+
+  // Non const longestMatchWithTrail
+  Iterator longestMatchWithTrail(const IPADDRTYPE& ipaddr,
+      uint8_t masklen, VecConstIterators& trail,
+      bool includeNonValueNodes = false) {
+    return itrConstCast(
+        const_cast<const MultibitTrie*>(this)->longestMatchWithTrail(
+          ipaddr, masklen, trail, includeNonValueNodes));
+  }
+
+  /*
+   * Same as longestMatchWithTrail, but returns a prefix, trail only if there
+   * is a exact match.
+   */
+  ConstIterator exactMatchWithTrail(const IPADDRTYPE& ipaddr,
+      uint8_t masklen, VecConstIterators& trail,
+      bool /*includeNonValueNodes*/ = false) const {
+    VecConstIterators trailInternal;
+    trailInternal.reserve(IPADDRTYPE::bitCount());
+    auto match = longestMatchImpl(ipaddr, masklen, &trailInternal);
+    if (match && match->masklen() == masklen) {
+      trail.swap(trailInternal);
+      return ConstIterator(match);
+    }
+    return ConstIterator();
+  }
+
+  // Non const counterpart of exactMatchWithTrail
+  Iterator exactMatchWithTrail(const IPADDRTYPE& ipaddr,
+      uint8_t masklen, VecConstIterators& trail,
+      bool includeNonValueNodes = false) {
+    return itrConstCast(
+      const_cast<const MultibitTrie*>(this)->exactMatchWithTrail(
+        ipaddr, masklen, trail, includeNonValueNodes));
+  }
+
+  // Equality, of prefixes and values
+  bool operator==(const MultibitTrie& r) const;
+
+  // Inequality
+  bool operator!=(const MultibitTrie& r) const {
+    return !(*this == r);
+  }
+
+  size_t size()  const { return size_; }
+
+  // Bytes of memory held by the trie, excluding allocator overhead
+  size_t memoryUsage() const;
+
+ private:
+  static constexpr uint32_t kFanout = 1 << kStride;
+  // Index of the root in nodes_
+  static constexpr uint32_t kRoot = 0;
+  // Nodes on the path to a prefix, for the longest addresses we support
+  static constexpr uint32_t kMaxDepth = 128 / kStride + 1;
+  static constexpr uint32_t kEntryChunkSize = 1024;
+
+  typedef typename MultibitTrieAddress<IPADDRTYPE>::Words Words;
+
+  struct Node {
+    // Bit prefixIndex(chunk, len) is set for each prefix ending in the node
+    uint64_t prefixes{0};
+    // Bit chunk is set for each child
+    uint64_t children{0};
+    // Index of the first child in nodes_
+    uint32_t childBase{0};
+    // Index of the first prefix in entryIds_
+    uint32_t entryBase{0};
+  };
+
+  static uint64_t bit(uint32_t index) {
+    return uint64_t(1) << index;
+  }
+  // Number of bits set in bitmap before index
+  static uint32_t rank(uint64_t bitmap, uint32_t index) {
+    return folly::popcount(bitmap & (bit(index) - 1));
+  }
+  // Index in Node::prefixes of the prefix of the first len bits of chunk
+  static uint32_t prefixIndex(uint32_t chunk, uint32_t len) {
+    return (1u << len) - 1 + (chunk >> (kStride - len));
+  }
+  // The kStride bits of words starting at offset, 0 padded
+  static uint32_t chunkAt(const Words& words, uint32_t offset);
+  // Node::prefixes bits of the prefixes of chunk of up to maxLen bits
+  static uint64_t matchingPrefixes(uint32_t chunk, uint32_t maxLen);
+
+  static uint32_t childIndex(const Node& node, uint32_t chunk) {
+    return node.childBase + rank(node.children, chunk);
+  }
+
+  Entry& entry(uint32_t id) {
+    return entryChunks_[id / kEntryChunkSize][id % kEntryChunkSize];
+  }
+  const Entry& entry(uint32_t id) const {
+    return entryChunks_[id / kEntryChunkSize][id % kEntryChunkSize];
+  }
+  Entry& entryAt(const Node& node, uint32_t index) {
+    return entry(entryIds_[node.entryBase + rank(node.prefixes, index)]);
+  }
+  const Entry& entryAt(const Node& node, uint32_t index) const {
+    return entry(entryIds_[node.entryBase + rank(node.prefixes, index)]);
+  }
+
+  Iterator itrConstCast(ConstIterator citr) const {
+    return Iterator(const_cast<Entry*>(citr.entry()));
+  }
+
+  // Worker function to do the actual longest match lookup.
+  const Entry* longestMatchImpl(const IPADDRTYPE& ipaddr, uint8_t masklen,
+      VecConstIterators* trail = nullptr) const;
+  const Entry* exactMatchImpl(const IPADDRTYPE& ipaddr,
+      uint8_t masklen) const;
+
+  // Add a child to the node for chunk and return its index.
+  // NOTE: may reallocate nodes_, invalidating references into it
+  uint32_t addChild(uint32_t nodeIndex, uint32_t chunk);
+  void removeChild(uint32_t nodeIndex, uint32_t chunk);
+  void addPrefix(uint32_t nodeIndex, uint32_t index, uint32_t entryId);
+  void removePrefix(uint32_t nodeIndex, uint32_t index);
+
+  uint32_t allocateEntry();
+  void freeEntry(uint32_t id);
+
+  /*
+   * The first entry in iteration order after the prefix of the first
+   * masklen bits of words, which must be below the node at nodeIndex,
+   * at offset bits.
+   */
+  Entry* firstAfter(uint32_t nodeIndex, uint32_t offset, const Words& words,
+      uint32_t masklen);
+  /*
+   * The first entry in iteration order at or after position (chunk, len) in
+   * the node at nodeIndex. Prefixes ending in the node are at the position
+   * of their first len bits 0 padded to a chunk, children at (chunk,
+   * kStride).
+   */
+  Entry* firstInNode(uint32_t nodeIndex, uint32_t chunk, uint32_t len);
+  // Link entry into the iteration order, before next
+  void link(Entry* entry, Entry* next);
+  void unlink(Entry* entry);
+
+  MultibitTrieBlockPool<Node, kFanout> nodes_;
+  // Ids of the entries of the prefixes ending in each node
+  MultibitTrieBlockPool<uint32_t, kFanout - 1> entryIds_;
+  // Entries never move, so that iterators and references to values stay
+  // valid across updates
+  std::vector<std::unique_ptr<Entry[]>> entryChunks_;
+  uint32_t numEntries_{0};
+  std::vector<uint32_t> freeEntries_;
+  Entry* head_{nullptr};
+  Entry* tail_{nullptr};
+  size_t size_{0};
+};
+
+}} // facebook::network
+
+#include "MultibitTrie-inl.h"
+
+#endif //MULTIBIT_TRIE_H
@@ -140,7 +140,7 @@ RadixTree<IPADDRTYPE, T, TreeTraits>::insert(const IPADDRTYPE& ipaddr,
       // specific root.
       auto prefix = IPADDRTYPE::longestCommonPrefix(
         {root_->ipAddress(), root_->masklen()}, {toAdd, mask});
-      std::unique_ptr<TreeNode> newRoot = nullptr;
+      TreeNodePtr newRoot = nullptr;
       if (prefix.first == toAdd && prefix.second == mask) {
         // To be added node is the new root
         newRoot = std::move(newNode);
@@ -209,7 +209,7 @@ RadixTree<IPADDRTYPE, T, TreeTraits>::insert(const IPADDRTYPE& ipaddr,
         // bestMatchChild and new node.
         auto internalNode = makeNode(prefix.first, prefix.second);
         auto internalNodeRaw = internalNode.get();
-        std::unique_ptr<TreeNode> oldBestMatchChild = nullptr;
+        TreeNodePtr oldBestMatchChild = nullptr;
         if (toAddDirection ==  TreeDirection::LEFT) {
           oldBestMatchChild = bestMatch->resetLeft(std::move(internalNode));
         } else {
@@ -228,7 +228,7 @@ RadixTree<IPADDRTYPE, T, TreeTraits>::insert(const IPADDRTYPE& ipaddr,
         CHECK(internalNode == nullptr);
       } else {
         // New node needs to be inserted  b/w bestMatch and bestMatchChild
-        std::unique_ptr<TreeNode> oldBestMatchChild = nullptr;
+        TreeNodePtr oldBestMatchChild = nullptr;
         if (toAddDirection ==  TreeDirection::LEFT) {
           oldBestMatchChild = bestMatch->resetLeft(std::move(newNode));
         } else {
@@ -391,17 +391,17 @@ bool RadixTree<IPADDRTYPE, T, TreeTraits>::radixSubTreesEqual(
 
 
 template<typename IPADDRTYPE, typename T, typename TreeTraits>
-std::unique_ptr<typename RadixTree<IPADDRTYPE, T, TreeTraits>::TreeNode>
+typename RadixTree<IPADDRTYPE, T, TreeTraits>::TreeNodePtr
 RadixTree<IPADDRTYPE, T, TreeTraits>::cloneSubTree(const TreeNode* node) {
   if (!node) {
     return nullptr;
   }
-  std::unique_ptr<TreeNode> copy;
+  TreeNodePtr copy;
   if (node->isValueNode()) {
-    copy = std::make_unique<TreeNode>(node->ipAddress(),
+    copy = allocateNode(node->ipAddress(),
       node->masklen(), node->value(), node->nodeDeleteCallback());
   } else {
-    copy = std::make_unique<TreeNode>(node->ipAddress(),
+    copy = allocateNode(node->ipAddress(),
       node->masklen(), node->nodeDeleteCallback());
   }
   copy->resetLeft(cloneSubTree(node->left()));
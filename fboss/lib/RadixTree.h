@@ -9,6 +9,7 @@
 #include <functional>
 #include <memory>
 #include <string>
+#include <type_traits>
 #include <utility>
 #include <vector>
 #include <folly/Conv.h>
@@ -19,6 +20,10 @@
 #include <folly/IPAddressV6.h>
 
 namespace facebook { namespace network {
+
+template<typename NODE>
+class RadixTreeNodePool;
+
 /*
  * Node in RadixTree, holds IP, mask. Will hold  value for nodes
  * created as a result of user inserts. Other type of nodes are
@@ -33,6 +38,20 @@ class RadixTreeNode {
   typedef std::function<void(const RadixTreeNode<IPADDRTYPE, T>&)>
     NodeDeleteCallback;
 
+  // Returns the node to the pool it was allocated from, if any
+  struct Deleter {
+    void operator()(RadixTreeNode* node) const {
+      auto pool = node->pool_;
+      if (pool) {
+        node->~RadixTreeNode();
+        pool->deallocate(node);
+      } else {
+        delete node;
+      }
+    }
+  };
+  typedef std::unique_ptr<RadixTreeNode, Deleter> UniquePtr;
+
   RadixTreeNode(const IPADDRTYPE& ipAddr, uint8_t mlen,
       NodeDeleteCallback deleteCallback):
     ipAddress_(ipAddr), masklen_(mlen), deleteCallback_(deleteCallback) {}
@@ -90,8 +109,7 @@ class RadixTreeNode {
           this->value() == r.value());
   }
 
-  std::unique_ptr<RadixTreeNode>
-    resetLeft(std::unique_ptr<RadixTreeNode> newLeft) {
+  UniquePtr resetLeft(UniquePtr newLeft) {
     auto old = std::move(left_);
     left_ = std::move(newLeft);
     if (left_) {
@@ -100,8 +118,7 @@ class RadixTreeNode {
     return old;
   }
 
-  std::unique_ptr<RadixTreeNode>
-    resetRight(std::unique_ptr<RadixTreeNode> newRight) {
+  UniquePtr resetRight(UniquePtr newRight) {
     auto old = std::move(right_);
     right_ = std::move(newRight);
     if (right_) {
@@ -126,12 +143,138 @@ class RadixTreeNode {
   IPADDRTYPE ipAddress_;
   uint32_t masklen_{0}; // Number of bits to match.
   folly::Optional<T> value_;
-  std::unique_ptr<RadixTreeNode> left_{nullptr};
-  std::unique_ptr<RadixTreeNode> right_{nullptr};
+  UniquePtr left_{nullptr};
+  UniquePtr right_{nullptr};
   RadixTreeNode* parent_{nullptr};
   NodeDeleteCallback deleteCallback_;
+  RadixTreeNodePool<RadixTreeNode>* pool_{nullptr};
+
+  friend class RadixTreeNodePool<RadixTreeNode>;
 };
 
+/*
+ * Slab allocator for the nodes of a RadixTree. Nodes are carved out of
+ * slabs allocated in bulk, and freed nodes are kept on a free list for
+ * reuse, so inserts do not go to the heap every time and repeatedly
+ * rebuilding a tree reuses the same memory instead of fragmenting the
+ * heap. A pool belongs to a single tree and must outlive its nodes.
+ */
+template<typename NODE>
+class RadixTreeNodePool {
+ public:
+  RadixTreeNodePool() {}
+  ~RadixTreeNodePool() {
+    DCHECK_EQ(live_, 0);
+  }
+  RadixTreeNodePool(const RadixTreeNodePool&) = delete;
+  RadixTreeNodePool& operator=(const RadixTreeNodePool&) = delete;
+
+  template<typename... Args>
+  typename NODE::UniquePtr make(Args&&... args) {
+    auto storage = allocate();
+    NODE* node = nullptr;
+    try {
+      node = new (storage) NODE(std::forward<Args>(args)...);
+    } catch (...) {
+      deallocate(storage);
+      throw;
+    }
+    node->pool_ = this;
+    return typename NODE::UniquePtr(node);
+  }
+
+  void* allocate() {
+    ++live_;
+    if (freeList_) {
+      auto slot = freeList_;
+      freeList_ = slot->next;
+      return slot;
+    }
+    while (nextSlot_ == slabEnd_) {
+      if (slabIndex_ + 1 < slabs_.size()) {
+        useSlab(slabIndex_ + 1);
+      } else {
+        addSlab(std::min(kMaxSlabNodes, std::max(kMinSlabNodes, capacity_)));
+      }
+    }
+    return nextSlot_++;
+  }
+
+  void deallocate(void* storage) {
+    DCHECK_GT(live_, 0);
+    --live_;
+    auto slot = static_cast<Slot*>(storage);
+    slot->next = freeList_;
+    freeList_ = slot;
+  }
+
+  // Make room for count more nodes, in a single slab if we need any
+  void reserve(size_t count) {
+    auto available = static_cast<size_t>(slabEnd_ - nextSlot_);
+    for (auto i = slabIndex_ + 1; i < slabs_.size(); ++i) {
+      available += slabs_[i].second;
+    }
+    if (available < count) {
+      // Start carving nodes out of it right away if we had no slab yet
+      addSlab(std::max(kMinSlabNodes, count - available),
+          nextSlot_ == nullptr);
+    }
+  }
+
+  /*
+   * Make all the slabs available again. Any node still allocated
+   * must not be used or destroyed after this.
+   */
+  void reset() {
+    live_ = 0;
+    freeList_ = nullptr;
+    if (slabs_.empty()) {
+      return;
+    }
+    useSlab(0);
+  }
+
+  size_t live() const { return live_; }
+  size_t capacity() const { return capacity_; }
+  size_t bytesAllocated() const { return capacity_ * sizeof(Slot); }
+
+ private:
+  union Slot {
+    Slot* next;
+    typename std::aligned_storage<sizeof(NODE), alignof(NODE)>::type node;
+  };
+  static constexpr size_t kMinSlabNodes = 64;
+  static constexpr size_t kMaxSlabNodes = 4096;
+
+  void useSlab(size_t index) {
+    slabIndex_ = index;
+    nextSlot_ = slabs_[index].first.get();
+    slabEnd_ = nextSlot_ + slabs_[index].second;
+  }
+
+  void addSlab(size_t count, bool use = true) {
+    // No need to zero the memory, nodes are constructed in place
+    slabs_.emplace_back(std::unique_ptr<Slot[]>(new Slot[count]), count);
+    capacity_ += count;
+    if (use) {
+      useSlab(slabs_.size() - 1);
+    }
+  }
+
+  std::vector<std::pair<std::unique_ptr<Slot[]>, size_t>> slabs_;
+  size_t slabIndex_{0};
+  Slot* nextSlot_{nullptr};
+  Slot* slabEnd_{nullptr};
+  Slot* freeList_{nullptr};
+  size_t live_{0};
+  size_t capacity_{0};
+};
+
+template<typename NODE>
+constexpr size_t RadixTreeNodePool<NODE>::kMinSlabNodes;
+template<typename NODE>
+constexpr size_t RadixTreeNodePool<NODE>::kMaxSlabNodes;
+
 
 /*
  * Forward Iterator to traverse a Radix tree
@@ -342,6 +485,8 @@ template<typename IPADDRTYPE, typename T,
 class RadixTree {
  public:
   typedef RadixTreeNode<IPADDRTYPE, T>           TreeNode;
+  typedef typename TreeNode::UniquePtr           TreeNodePtr;
+  typedef RadixTreeNodePool<TreeNode>            NodePool;
   typedef typename TreeNode::TreeDirection       TreeDirection;
   typedef typename TreeNode::NodeDeleteCallback  NodeDeleteCallback;
   typedef typename TreeTraits::Iterator          Iterator;
@@ -356,6 +501,10 @@ class RadixTree {
   RadixTree(const RadixTree& r) = delete;
   RadixTree& operator=(const RadixTree& r) = delete;
 
+  ~RadixTree() {
+    clear();
+  }
+
   Iterator  begin()  { return traits_.makeItr(root_.get()); }
   Iterator  end()    { return traits_.makeItr(nullptr); }
   ConstIterator begin() const { return traits_.makeCItr(root_.get()); }
@@ -363,9 +512,33 @@ class RadixTree {
 
   // Free all nodes and clear the tree.
   void clear() {
-    root_.reset(nullptr);
+    if (pool_ && !heapNodes_ && nodesTriviallyDestructible()) {
+      // Nothing to run on destruction, so skip walking the tree
+      root_.release();
+    } else {
+      root_.reset(nullptr);
+    }
+    if (pool_) {
+      // Keep the slabs around for the next nodes we insert
+      pool_->reset();
+    }
+    heapNodes_ = false;
     size_ = 0;
   }
+
+  /*
+   * Allocate nodes from a slab allocator owned by this tree, rather than
+   * one at a time from the heap. Clones of the tree use one too. Must be
+   * called while the tree is empty.
+   */
+  void enableNodePool() {
+    CHECK(!root_);
+    if (!pool_) {
+      pool_ = std::make_unique<NodePool>();
+    }
+  }
+  const NodePool* nodePool() const { return pool_.get(); }
+
   RadixTree(RadixTree&& r) noexcept
    : nodeDeleteCallback_(r.nodeDeleteCallback_),
   traits_(r.traits_) {
@@ -378,6 +551,16 @@ class RadixTree {
     size_ = r.size_;
     makeRoot(std::move(r.root_));
     r.size_ = 0;
+    // Our nodes are gone, and the nodes we took come from r's pool if it has
+    // one, so take that along. Otherwise they come from the heap, and we keep
+    // our pool for the nodes we allocate from now on.
+    if (r.pool_) {
+      std::swap(pool_, r.pool_);
+      heapNodes_ = r.heapNodes_;
+    } else {
+      heapNodes_ = pool_ && root_;
+    }
+    r.heapNodes_ = false;
     return *this;
   }
   // Clone this radix tree onto another
@@ -387,8 +570,13 @@ class RadixTree {
     static_assert(std::is_same<T, U>::value,
         "clone template type must be the same as Radix tree value type");
     RadixTree copy(nodeDeleteCallback_, traits_);
+    if (pool_) {
+      copy.enableNodePool();
+      // Allocate all the nodes of the copy at once
+      copy.pool_->reserve(countNodes(root_.get()));
+    }
     copy.size_ = size_;
-    copy.root_ = cloneSubTree(root_.get());
+    copy.root_ = copy.cloneSubTree(root_.get());
     return copy;
   }
   /*
@@ -529,7 +717,18 @@ class RadixTree {
   NodeDeleteCallback nodeDeleteCallback() const { return nodeDeleteCallback_; }
   const TreeTraits&  traits() const { return traits_; }
  private:
-  static std::unique_ptr<TreeNode> cloneSubTree(const TreeNode* node);
+  TreeNodePtr cloneSubTree(const TreeNode* node);
+  static size_t countNodes(const TreeNode* node) {
+    return node ? 1 + countNodes(node->left()) + countNodes(node->right()) : 0;
+  }
+
+  // Whether freeing the nodes requires nothing but releasing their memory
+  bool nodesTriviallyDestructible() const {
+    return std::is_trivially_destructible<T>::value &&
+      std::is_trivially_destructible<IPADDRTYPE>::value &&
+      !nodeDeleteCallback_;
+  }
+
   // Worker function to do the actual longest match lookup.
   const TreeNode* longestMatchImpl(const IPADDRTYPE& ipaddr,
       uint8_t masklen, bool& foundExact, bool includeNonValueNodes = false,
@@ -544,20 +743,26 @@ class RadixTree {
             masklen, foundExact, includeNonValueNodes, trail));
   }
 
-  std::unique_ptr<TreeNode> makeNode(const IPADDRTYPE& ip,
-      uint8_t masklen) {
-    return std::make_unique<TreeNode>(ip, masklen, nodeDeleteCallback_);
+  TreeNodePtr makeNode(const IPADDRTYPE& ip, uint8_t masklen) {
+    return allocateNode(ip, masklen, nodeDeleteCallback_);
   }
 
   template<typename VALUE>
-  std::unique_ptr<TreeNode> makeNode(const IPADDRTYPE& ip,
-      uint8_t masklen, VALUE&& value) {
-    return std::make_unique<TreeNode>(ip, masklen,
-                                        std::forward<VALUE>(value),
-                                        nodeDeleteCallback_);
+  TreeNodePtr makeNode(const IPADDRTYPE& ip, uint8_t masklen,
+      VALUE&& value) {
+    return allocateNode(ip, masklen, std::forward<VALUE>(value),
+        nodeDeleteCallback_);
   }
 
-  void makeRoot(std::unique_ptr<TreeNode> newRoot) {
+  template<typename... Args>
+  TreeNodePtr allocateNode(Args&&... args) {
+    if (pool_) {
+      return pool_->make(std::forward<Args>(args)...);
+    }
+    return TreeNodePtr(new TreeNode(std::forward<Args>(args)...));
+  }
+
+  void makeRoot(TreeNodePtr newRoot) {
     CHECK(root_ != newRoot || root_ == nullptr);
     if (newRoot) {
         newRoot->setParent(nullptr);
@@ -568,7 +773,12 @@ class RadixTree {
   inline void trailAppend(VecConstIterators* trail,
   bool includeNonValueNodes, const TreeNode* node) const;
 
-  std::unique_ptr<TreeNode> root_{nullptr};
+  // Declared before root_, so that it outlives the nodes
+  std::unique_ptr<NodePool> pool_;
+  // Whether some nodes were allocated from the heap rather than pool_, as
+  // when a tree without a pool is moved onto one with a pool
+  bool heapNodes_{false};
+  TreeNodePtr root_{nullptr};
   size_t  size_{0};
   NodeDeleteCallback nodeDeleteCallback_;
   TreeTraits  traits_;
@@ -930,6 +1140,12 @@ class RadixTree<folly::IPAddress, T> {
     ipv6Tree_.clear();
   }
 
+  // Allocate nodes from slab allocators, see RadixTree::enableNodePool()
+  void enableNodePool() {
+    ipv4Tree_.enableNodePool();
+    ipv6Tree_.enableNodePool();
+  }
+
   size_t  size()  const { return ipv4Tree_.size() + ipv6Tree_.size(); }
   size_t  size4()  const { return ipv4Tree_.size(); }
   size_t  size6()  const { return ipv6Tree_.size(); }
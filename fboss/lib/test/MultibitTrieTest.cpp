@@ -0,0 +1,348 @@
+// Copyright 2004-present Facebook. All Rights Reserved.
+
+#include <memory>
+#include <gtest/gtest.h>
+
+#include "common/base/Random.h"
+#include <folly/IPAddressV4.h>
+#include <folly/IPAddressV6.h>
+
+#include "fboss/lib/MultibitTrie.h"
+#include "fboss/lib/RadixTree.h"
+
+using namespace facebook;
+using namespace facebook::network;
+using namespace std;
+
+namespace {
+using IPAddress = folly::IPAddress;
+using IPAddressV4 = folly::IPAddressV4;
+using IPAddressV6 = folly::IPAddressV6;
+
+template<typename IPAddrType>
+IPAddrType randomIP();
+
+template<>
+IPAddressV4 randomIP<IPAddressV4>() {
+  return IPAddressV4::fromLongHBO(folly::Random::rand32());
+}
+
+template<>
+IPAddressV6 randomIP<IPAddressV6>() {
+  folly::ByteArray16 bytes;
+  for (auto& byte : bytes) {
+    byte = folly::Random::rand32(256);
+  }
+  return IPAddressV6(bytes);
+}
+
+/*
+ * Prefixes are drawn from a few short random networks, so that they
+ * nest and share trie nodes the way routes do.
+ */
+template<typename IPAddrType>
+vector<pair<IPAddrType, uint8_t>> randomPrefixes(int count) {
+  vector<IPAddrType> networks;
+  for (auto i = 0; i < 8; ++i) {
+    networks.push_back(randomIP<IPAddrType>());
+  }
+  vector<pair<IPAddrType, uint8_t>> prefixes;
+  for (auto i = 0; i < count; ++i) {
+    const auto& network = networks[folly::Random::rand32(networks.size())];
+    // Keep the first few bits of a network and randomize the rest
+    auto common = folly::Random::rand32(IPAddrType::bitCount() + 1);
+    auto mask = folly::Random::rand32(IPAddrType::bitCount() + 1);
+    auto bytes = network.toByteArray();
+    auto randomBytes = randomIP<IPAddrType>().toByteArray();
+    for (auto bit = common; bit < IPAddrType::bitCount(); ++bit) {
+      auto byte = bit / 8;
+      uint8_t bitMask = 0x80 >> (bit % 8);
+      bytes[byte] = (bytes[byte] & ~bitMask) | (randomBytes[byte] & bitMask);
+    }
+    prefixes.emplace_back(IPAddrType(bytes).mask(mask), mask);
+  }
+  return prefixes;
+}
+
+template<typename IPAddrType>
+void expectSame(const RadixTree<IPAddrType, int>& rtree,
+    const MultibitTrie<IPAddrType, int>& trie) {
+  EXPECT_EQ(rtree.size(), trie.size());
+  auto titr = trie.begin();
+  for (auto ritr = rtree.begin(); ritr != rtree.end(); ++ritr, ++titr) {
+    ASSERT_NE(titr, trie.end());
+    EXPECT_EQ(ritr->ipAddress(), titr->ipAddress());
+    EXPECT_EQ(ritr->masklen(), titr->masklen());
+    EXPECT_EQ(ritr->value(), titr->value());
+  }
+  EXPECT_EQ(titr, trie.end());
+}
+
+template<typename IPAddrType>
+void expectSameMatches(const RadixTree<IPAddrType, int>& rtree,
+    const MultibitTrie<IPAddrType, int>& trie,
+    const IPAddrType& ip, uint8_t mask) {
+  auto rmatch = rtree.exactMatch(ip, mask);
+  auto tmatch = trie.exactMatch(ip, mask);
+  ASSERT_EQ(rmatch == rtree.end(), tmatch == trie.end());
+  if (rmatch != rtree.end()) {
+    EXPECT_EQ(rmatch->value(), tmatch->value());
+  }
+
+  typename RadixTree<IPAddrType, int>::VecConstIterators rtrail;
+  typename MultibitTrie<IPAddrType, int>::VecConstIterators ttrail;
+  rmatch = rtree.longestMatchWithTrail(ip, mask, rtrail);
+  tmatch = trie.longestMatchWithTrail(ip, mask, ttrail);
+  ASSERT_EQ(rmatch == rtree.end(), tmatch == trie.end());
+  if (rmatch == rtree.end()) {
+    return;
+  }
+  EXPECT_EQ(rmatch->ipAddress(), tmatch->ipAddress());
+  EXPECT_EQ(rmatch->masklen(), tmatch->masklen());
+  EXPECT_EQ(rmatch, rtree.longestMatch(ip, mask));
+  EXPECT_EQ(tmatch, trie.longestMatch(ip, mask));
+  ASSERT_EQ(rtrail.size(), ttrail.size());
+  for (auto i = 0; i < rtrail.size(); ++i) {
+    EXPECT_EQ(rtrail[i]->ipAddress(), ttrail[i]->ipAddress());
+    EXPECT_EQ(rtrail[i]->masklen(), ttrail[i]->masklen());
+  }
+}
+
+/*
+ * Insert a set of random prefixes in both a RadixTree and a MultibitTrie,
+ * and compare iteration order and lookups. Then erase some of them from
+ * both and compare again.
+ */
+template<typename IPAddrType>
+void compareWithRadixTree() {
+  RadixTree<IPAddrType, int> rtree;
+  MultibitTrie<IPAddrType, int> trie;
+  auto const kInsertCount = 2000;
+  auto prefixes = randomPrefixes<IPAddrType>(kInsertCount);
+  for (auto i = 0; i < prefixes.size(); ++i) {
+    auto rinserted = rtree.insert(prefixes[i].first, prefixes[i].second, i);
+    auto tinserted = trie.insert(prefixes[i].first, prefixes[i].second, i);
+    EXPECT_EQ(rinserted.second, tinserted.second);
+    EXPECT_EQ(rinserted.first->value(), tinserted.first->value());
+  }
+  expectSame(rtree, trie);
+  for (const auto& prefix : prefixes) {
+    expectSameMatches(rtree, trie, prefix.first, prefix.second);
+    expectSameMatches(rtree, trie, randomIP<IPAddrType>(),
+        IPAddrType::bitCount());
+  }
+
+  auto const kEraseCount = kInsertCount / 2;
+  for (auto i = 0; i < kEraseCount; ++i) {
+    const auto& prefix = prefixes[folly::Random::rand32(prefixes.size())];
+    EXPECT_EQ(rtree.erase(prefix.first, prefix.second),
+        trie.erase(prefix.first, prefix.second));
+  }
+  expectSame(rtree, trie);
+  for (const auto& prefix : prefixes) {
+    expectSameMatches(rtree, trie, prefix.first, prefix.second);
+  }
+
+  for (const auto& prefix : prefixes) {
+    rtree.erase(prefix.first, prefix.second);
+    trie.erase(prefix.first, prefix.second);
+  }
+  EXPECT_EQ(0, trie.size());
+  EXPECT_EQ(trie.begin(), trie.end());
+}
+}
+
+TEST(MultibitTrie, RadixTreeCompare4) {
+  compareWithRadixTree<IPAddressV4>();
+}
+
+TEST(MultibitTrie, RadixTreeCompare6) {
+  compareWithRadixTree<IPAddressV6>();
+}
+
+TEST(MultibitTrie, Inserts4) {
+  MultibitTrie<IPAddressV4, int> trie;
+  IPAddressV4 ip0_0_0_0("0.0.0.0");
+  IPAddressV4 ip10_0_0_0("10.0.0.0");
+  IPAddressV4 ip10_0_0_1("10.0.0.1");
+
+  EXPECT_TRUE(trie.insert(ip0_0_0_0, 0, 0).second);
+  EXPECT_TRUE(trie.insert(ip10_0_0_0, 8, 8).second);
+  EXPECT_TRUE(trie.insert(ip10_0_0_1, 32, 32).second);
+  // Duplicate inserts return the existing prefix
+  auto inserted = trie.insert(ip10_0_0_0, 8, 42);
+  EXPECT_FALSE(inserted.second);
+  EXPECT_EQ(8, inserted.first->value());
+  EXPECT_EQ(3, trie.size());
+
+  EXPECT_EQ(0, trie.longestMatch(IPAddressV4("11.0.0.1"), 32)->value());
+  EXPECT_EQ(8, trie.longestMatch(IPAddressV4("10.0.0.2"), 32)->value());
+  EXPECT_EQ(32, trie.longestMatch(ip10_0_0_1, 32)->value());
+  EXPECT_EQ(8, trie.longestMatch(ip10_0_0_1, 31)->value());
+  EXPECT_EQ(trie.end(), trie.exactMatch(ip10_0_0_0, 16));
+
+  MultibitTrie<IPAddressV4, int>::VecConstIterators trail;
+  auto matchItr = trie.exactMatchWithTrail(ip10_0_0_1, 32, trail);
+  EXPECT_EQ(32, matchItr->value());
+  ASSERT_EQ(3, trail.size());
+  EXPECT_EQ(0, trail[0]->value());
+  EXPECT_EQ(8, trail[1]->value());
+  EXPECT_EQ(32, trail[2]->value());
+
+  // Trail is left alone if there is no exact match
+  matchItr = trie.exactMatchWithTrail(ip10_0_0_0, 16, trail);
+  EXPECT_EQ(trie.end(), matchItr);
+  EXPECT_EQ(3, trail.size());
+
+  EXPECT_FALSE(trie.erase(ip10_0_0_0, 16));
+  EXPECT_TRUE(trie.erase(ip0_0_0_0, 0));
+  EXPECT_EQ(trie.end(), trie.longestMatch(IPAddressV4("11.0.0.1"), 32));
+  EXPECT_TRUE(trie.erase(trie.exactMatch(ip10_0_0_1, 32)));
+  EXPECT_EQ(8, trie.longestMatch(ip10_0_0_1, 32)->value());
+  EXPECT_EQ(1, trie.size());
+}
+
+TEST(MultibitTrie, Inserts6) {
+  MultibitTrie<IPAddressV6, int> trie;
+  IPAddressV6 ip6_0("::");
+  IPAddressV6 ip6_2001("2001:db8::");
+  IPAddressV6 ip6_2001_1("2001:db8::1");
+
+  EXPECT_TRUE(trie.insert(ip6_0, 0, 0).second);
+  EXPECT_TRUE(trie.insert(ip6_2001, 64, 64).second);
+  // /66 is looked up in a stride straddling both words of the address
+  EXPECT_TRUE(trie.insert(ip6_2001, 66, 66).second);
+  EXPECT_TRUE(trie.insert(ip6_2001_1, 128, 128).second);
+  EXPECT_EQ(4, trie.size());
+
+  EXPECT_EQ(0, trie.longestMatch(IPAddressV6("2002::1"), 128)->value());
+  EXPECT_EQ(64,
+      trie.longestMatch(IPAddressV6("2001:db8::ffff:0:0:1"), 128)->value());
+  EXPECT_EQ(66, trie.longestMatch(IPAddressV6("2001:db8::2"), 128)->value());
+  EXPECT_EQ(128, trie.longestMatch(ip6_2001_1, 128)->value());
+  EXPECT_EQ(66, trie.longestMatch(ip6_2001_1, 127)->value());
+
+  MultibitTrie<IPAddressV6, int>::VecConstIterators trail;
+  trie.longestMatchWithTrail(ip6_2001_1, 128, trail);
+  ASSERT_EQ(4, trail.size());
+  EXPECT_EQ(0, trail[0]->value());
+  EXPECT_EQ(64, trail[1]->value());
+  EXPECT_EQ(66, trail[2]->value());
+  EXPECT_EQ(128, trail[3]->value());
+
+  EXPECT_TRUE(trie.erase(ip6_2001_1, 128));
+  EXPECT_EQ(66, trie.longestMatch(ip6_2001_1, 128)->value());
+  EXPECT_EQ(3, trie.size());
+}
+
+TEST(MultibitTrie, MoveConstructible) {
+  MultibitTrie<IPAddressV4, std::unique_ptr<int>> trie;
+  auto const kInsertCount = 100;
+  auto prefixes = randomPrefixes<IPAddressV4>(kInsertCount);
+  for (auto i = 0; i < prefixes.size(); ++i) {
+    trie.insert(prefixes[i].first, prefixes[i].second,
+        std::make_unique<int>(i));
+  }
+  auto size = trie.size();
+
+  // Set value via iterator
+  trie.exactMatch(prefixes[0].first, prefixes[0].second)->setValue(
+      std::make_unique<int>(42));
+
+  MultibitTrie<IPAddressV4, std::unique_ptr<int>> moved(std::move(trie));
+  EXPECT_EQ(size, moved.size());
+  EXPECT_EQ(0, trie.size());
+  EXPECT_EQ(trie.begin(), trie.end());
+  EXPECT_EQ(42,
+      *moved.exactMatch(prefixes[0].first, prefixes[0].second)->value());
+
+  trie = std::move(moved);
+  EXPECT_EQ(size, trie.size());
+  EXPECT_EQ(0, moved.size());
+}
+
+TEST(MultibitTrie, Clone) {
+  MultibitTrie<IPAddressV4, int> v4Trie;
+  MultibitTrie<IPAddressV6, int> v6Trie;
+
+  // Ensure clone() works on empty tries
+  EXPECT_TRUE(v4Trie == v4Trie.clone());
+  EXPECT_TRUE(v6Trie == v6Trie.clone());
+
+  auto v4Prefixes = randomPrefixes<IPAddressV4>(500);
+  for (auto i = 0; i < v4Prefixes.size(); ++i) {
+    v4Trie.insert(v4Prefixes[i].first, v4Prefixes[i].second, i);
+  }
+  auto v6Prefixes = randomPrefixes<IPAddressV6>(500);
+  for (auto i = 0; i < v6Prefixes.size(); ++i) {
+    v6Trie.insert(v6Prefixes[i].first, v6Prefixes[i].second, i);
+  }
+  auto v4TrieCopy = v4Trie.clone();
+  auto v6TrieCopy = v6Trie.clone();
+  EXPECT_TRUE(v4Trie == v4TrieCopy);
+  EXPECT_TRUE(v6Trie == v6TrieCopy);
+
+  v4TrieCopy.begin()->setValue(-1);
+  EXPECT_TRUE(v4Trie != v4TrieCopy);
+}
+
+TEST(MultibitTrie, SubTreeIterator) {
+  MultibitTrie<IPAddressV4, int> trie;
+  vector<pair<string, pair<int, int>>> subnets = {
+    // { prefix, {begin, end} } - prefix should contain numbers [begin, end)
+    {"0.0.0.0/0", {0, 12}},
+    {"1.0.0.0/8", {1, 12}},
+    {"1.1.0.0/16", {2, 7}},
+    {"1.1.1.0/24", {3, 5}},
+    {"1.1.1.254/32", {4, 5}},
+    {"1.1.254.0/24", {5, 7}},
+    {"1.1.254.1/32", {6, 7}},
+    {"1.254.1.0/24", {7, 10}},
+    {"1.254.1.0/28", {8, 10}},
+    {"1.254.1.1/32", {9, 10}},
+    {"1.254.254.0/24", {10, 12}},
+    {"1.254.254.254/32", {11, 12}},
+  };
+  for (int i = 0; i < subnets.size(); ++i) {
+    auto subnet = IPAddress::createNetwork(subnets[i].first);
+    int value = subnets[i].second.first;
+    EXPECT_TRUE(
+        trie.insert(subnet.first.asV4(), subnet.second, value).second);
+  }
+
+  for (int i = 0; i < subnets.size(); ++i) {
+    auto subnet = IPAddress::createNetwork(subnets[i].first);
+    auto iter = trie.exactMatch(subnet.first.asV4(), subnet.second);
+    int begin = subnets[i].second.first;
+    int end = subnets[i].second.second;
+    for (iter = iter.subTreeIterator(); !iter.atEnd(); ++iter, ++begin) {
+      EXPECT_EQ(iter->value(), begin);
+    }
+    EXPECT_EQ(begin, end);
+    EXPECT_TRUE(iter.atEnd());
+  }
+  EXPECT_EQ(trie.end().subTreeIterator(), trie.end());
+
+  // Sub tree iterators compare by position only
+  auto iter = trie.exactMatch(IPAddressV4("1.1.0.0"), 16);
+  EXPECT_EQ(iter.subTreeIterator(), iter);
+  auto next = iter;
+  ++next;
+  auto subTreeNext = iter.subTreeIterator();
+  ++subTreeNext;
+  EXPECT_EQ(subTreeNext, next);
+  EXPECT_FALSE(subTreeNext != next);
+}
+
+TEST(MultibitTrie, MemoryUsage) {
+  MultibitTrie<IPAddressV4, int> trie;
+  auto emptyUsage = trie.memoryUsage();
+  auto prefixes = randomPrefixes<IPAddressV4>(1000);
+  for (auto i = 0; i < prefixes.size(); ++i) {
+    trie.insert(prefixes[i].first, prefixes[i].second, i);
+  }
+  EXPECT_GT(trie.memoryUsage(), emptyUsage);
+  trie.clear();
+  EXPECT_EQ(0, trie.size());
+  EXPECT_EQ(trie.begin(), trie.end());
+}
@@ -7,6 +7,7 @@
 #include <folly/IPAddressV4.h>
 #include <folly/IPAddressV6.h>
 #include <folly/Benchmark.h>
+#include "fboss/lib/MultibitTrie.h"
 #include "fboss/lib/RadixTree.h"
 #include "PyRadixWrapper.h"
 
@@ -51,6 +52,11 @@ BENCHMARK_RELATIVE(RadixTreeInsert4) {
   setupTree4(rtree);
 }
 
+BENCHMARK_RELATIVE(MultibitTrieInsert4) {
+  MultibitTrie<IPAddressV4, int> trie;
+  setupTree4(trie);
+}
+
 BENCHMARK(PyRadixErase4) {
   PyRadixWrapper<IPAddressV4, int> pyrtree;
   BENCHMARK_SUSPEND {
@@ -71,6 +77,16 @@ BENCHMARK_RELATIVE(RadixTreeErase4) {
   }
 }
 
+BENCHMARK_RELATIVE(MultibitTrieErase4) {
+  MultibitTrie<IPAddressV4, int> trie;
+  BENCHMARK_SUSPEND {
+    setupTree4(trie);
+  }
+  for (auto pfx: eraseSet4) {
+    trie.erase(pfx.ip, pfx.mask);
+  }
+}
+
 BENCHMARK(PyRadixExactMatch4) {
   PyRadixWrapper<IPAddressV4, int> pyrtree;
   BENCHMARK_SUSPEND {
@@ -91,6 +107,16 @@ BENCHMARK_RELATIVE(RadixTreeExactMatch4) {
   }
 }
 
+BENCHMARK_RELATIVE(MultibitTrieExactMatch4) {
+  MultibitTrie<IPAddressV4, int> trie;
+  BENCHMARK_SUSPEND {
+    setupTree4(trie);
+  }
+  for (auto pfx: exactMatchSet4) {
+    trie.exactMatch(pfx.ip, pfx.mask);
+  }
+}
+
 BENCHMARK(PyRadixLongestMatch4) {
   PyRadixWrapper<IPAddressV4, int> pyrtree;
   BENCHMARK_SUSPEND {
@@ -111,6 +137,16 @@ BENCHMARK_RELATIVE(RadixTreeLongestMatch4) {
   }
 }
 
+BENCHMARK_RELATIVE(MultibitTrieLongestMatch4) {
+  MultibitTrie<IPAddressV4, int> trie;
+  BENCHMARK_SUSPEND {
+    setupTree4(trie);
+  }
+  for (auto pfx: longestMatchSet4) {
+    trie.longestMatch(pfx.ip, pfx.mask);
+  }
+}
+
 // V6 benchmarks
 
 template<typename TREE>
@@ -131,6 +167,11 @@ BENCHMARK_RELATIVE(RadixTreeInsert6) {
   setupTree6(rtree);
 }
 
+BENCHMARK_RELATIVE(MultibitTrieInsert6) {
+  MultibitTrie<IPAddressV6, int> trie;
+  setupTree6(trie);
+}
+
 BENCHMARK(PyRadixErase6) {
   PyRadixWrapper<IPAddressV6, int> pyrtree;
   BENCHMARK_SUSPEND {
@@ -151,6 +192,16 @@ BENCHMARK_RELATIVE(RadixTreeErase6) {
   }
 }
 
+BENCHMARK_RELATIVE(MultibitTrieErase6) {
+  MultibitTrie<IPAddressV6, int> trie;
+  BENCHMARK_SUSPEND {
+    setupTree6(trie);
+  }
+  for (auto pfx: eraseSet6) {
+    trie.erase(pfx.ip, pfx.mask);
+  }
+}
+
 BENCHMARK(PyRadixExactMatch6) {
   PyRadixWrapper<IPAddressV6, int> pyrtree;
   BENCHMARK_SUSPEND {
@@ -171,6 +222,16 @@ BENCHMARK_RELATIVE(RadixTreeExactMatch6) {
   }
 }
 
+BENCHMARK_RELATIVE(MultibitTrieExactMatch6) {
+  MultibitTrie<IPAddressV6, int> trie;
+  BENCHMARK_SUSPEND {
+    setupTree6(trie);
+  }
+  for (auto pfx: exactMatchSet6) {
+    trie.exactMatch(pfx.ip, pfx.mask);
+  }
+}
+
 BENCHMARK(PyRadixLongestMatch6) {
   PyRadixWrapper<IPAddressV6, int> pyrtree;
   BENCHMARK_SUSPEND {
@@ -191,6 +252,40 @@ BENCHMARK_RELATIVE(RadixTreeLongestMatch6) {
   }
 }
 
+BENCHMARK_RELATIVE(MultibitTrieLongestMatch6) {
+  MultibitTrie<IPAddressV6, int> trie;
+  BENCHMARK_SUSPEND {
+    setupTree6(trie);
+  }
+  for (auto pfx: longestMatchSet6) {
+    trie.longestMatch(pfx.ip, pfx.mask);
+  }
+}
+
+/*
+ * Bytes per prefix of each tree holding the insert set. For the RadixTree
+ * this counts its nodes, including the ones without a value.
+ */
+template<typename IPAddrType, typename PREFIX>
+void printBytesPerPrefix(const set<PREFIX>& prefixes) {
+  RadixTree<IPAddrType, int> rtree;
+  MultibitTrie<IPAddrType, int> trie;
+  for (const auto& pfx: prefixes) {
+    rtree.insert(pfx.ip, pfx.mask, 0);
+    trie.insert(pfx.ip, pfx.mask, 0);
+  }
+  size_t nodes = 0;
+  for (RadixTreeConstIterator<IPAddrType, int> itr(rtree.root(), true);
+      !itr.atEnd(); ++itr) {
+    ++nodes;
+  }
+  auto rtreeBytes = nodes * sizeof(RadixTreeNode<IPAddrType, int>);
+  printf("IPv%d bytes/prefix: RadixTree %.1f, MultibitTrie %.1f\n",
+      IPAddrType::bitCount() == 32 ? 4 : 6,
+      double(rtreeBytes) / rtree.size(),
+      double(trie.memoryUsage()) / trie.size());
+}
+
 }
 
 int main(int /*argc*/, char* /*argv*/ []) {
@@ -246,6 +341,8 @@ int main(int /*argc*/, char* /*argv*/ []) {
     auto newIp = pfx.ip.mask(newMask);
     longestMatchSet6.insert(Prefix6(newIp, newMask));
   }
+  printBytesPerPrefix<IPAddressV4>(insertSet4);
+  printBytesPerPrefix<IPAddressV6>(insertSet6);
   runBenchmarks();
 }
 
@@ -1467,3 +1467,81 @@ TEST(RadixTree, SubTreeIterator) {
   }
   EXPECT_EQ(rtree.end().subTreeIterator(), rtree.end());
 }
+
+TEST(RadixTree, NodePool) {
+  RadixTree<IPAddressV4, int> rtree;
+  RadixTree<IPAddressV4, int> pooledTree;
+  pooledTree.enableNodePool();
+  auto countNodes = [](const RadixTree<IPAddressV4, int>& tree) {
+    auto count = 0;
+    for (RadixTreeConstIterator<IPAddressV4, int> itr(tree.root(), true);
+        !itr.atEnd(); ++itr) {
+      ++count;
+    }
+    return count;
+  };
+  auto const kInsertCount = 1000;
+  vector<Prefix4> inserted;
+  for (auto i = 0; i < kInsertCount; ++i) {
+    auto mask = folly::Random::rand32(32);
+    auto ip = IPAddressV4::fromLongHBO(folly::Random::rand32()).mask(mask);
+    if (rtree.insert(ip, mask, i).second) {
+      EXPECT_TRUE(pooledTree.insert(ip, mask, i).second);
+      inserted.push_back(Prefix4(ip, mask));
+    }
+  }
+  EXPECT_TRUE(rtree == pooledTree);
+  EXPECT_EQ(countNodes(pooledTree), pooledTree.nodePool()->live());
+
+  for (auto i = 0; i < inserted.size(); i += 2) {
+    rtree.erase(inserted[i].ip, inserted[i].mask);
+    pooledTree.erase(inserted[i].ip, inserted[i].mask);
+  }
+  EXPECT_TRUE(rtree == pooledTree);
+  EXPECT_EQ(countNodes(pooledTree), pooledTree.nodePool()->live());
+
+  // Clones of a pooled tree allocate all their nodes in one go
+  auto clone = pooledTree.clone();
+  EXPECT_TRUE(clone == pooledTree);
+  ASSERT_NE(nullptr, clone.nodePool());
+  EXPECT_EQ(countNodes(clone), clone.nodePool()->capacity());
+  EXPECT_EQ(nullptr, rtree.clone().nodePool());
+
+  // Rebuilding the tree reuses the memory it already has
+  auto capacity = pooledTree.nodePool()->capacity();
+  pooledTree.clear();
+  EXPECT_EQ(0, pooledTree.nodePool()->live());
+  for (auto i = 0; i < inserted.size(); ++i) {
+    pooledTree.insert(inserted[i].ip, inserted[i].mask, i);
+  }
+  EXPECT_EQ(capacity, pooledTree.nodePool()->capacity());
+
+  // Moving a pooled tree takes its pool along with its nodes
+  RadixTree<IPAddressV4, int> movedTree;
+  movedTree = std::move(pooledTree);
+  ASSERT_NE(nullptr, movedTree.nodePool());
+  EXPECT_EQ(countNodes(movedTree), movedTree.nodePool()->live());
+  EXPECT_EQ(0, pooledTree.size());
+
+  // While moving a tree without one onto a pooled tree keeps the pool
+  auto heapTree = rtree.clone();
+  movedTree = std::move(heapTree);
+  EXPECT_TRUE(movedTree == rtree);
+  ASSERT_NE(nullptr, movedTree.nodePool());
+  EXPECT_EQ(0, movedTree.nodePool()->live());
+  movedTree.clear();
+  movedTree.insert(inserted[0].ip, inserted[0].mask, 0);
+  EXPECT_EQ(1, movedTree.nodePool()->live());
+
+  // Node delete callbacks still run for pooled nodes
+  auto deleted = 0;
+  RadixTree<IPAddressV4, int> callbackTree(
+      [&deleted](const RadixTreeNode<IPAddressV4, int>&) { ++deleted; });
+  callbackTree.enableNodePool();
+  for (auto i = 0; i < inserted.size(); ++i) {
+    callbackTree.insert(inserted[i].ip, inserted[i].mask, i);
+  }
+  auto nodes = countNodes(callbackTree);
+  callbackTree.clear();
+  EXPECT_EQ(nodes, deleted);
+}
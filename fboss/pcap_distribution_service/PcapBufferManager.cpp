@@ -2,23 +2,42 @@
 
 #include "fboss/pcap_distribution_service/if/gen-cpp2/pcap_pubsub_types.h"
 
+#include <gflags/gflags.h>
+
+DEFINE_int32(
+    pcap_buffer_pkts,
+    1024,
+    "Packets of each ethertype kept for dumps");
+DEFINE_int32(
+    pcap_buffer_pkt_bytes,
+    2048,
+    "Bytes kept of each packet buffered for dumps, longer ones are truncated");
+
 namespace facebook { namespace fboss {
 
 uint16_t PcapBufferManager::UNKNOWN = 0xFFFF;
 
 PcapBufferManager::PcapBufferManager() {
   for(auto e : PcapBufferManager::getEthertypes()){
-    buffers_[e] = PcapCircularBuffer();
+    buffers_[e] = std::make_unique<PcapCircularBuffer>(
+        FLAGS_pcap_buffer_pkts, FLAGS_pcap_buffer_pkt_bytes);
   }
 }
 
-void PcapBufferManager::addPkt(PcapPkt&& pkt, uint16_t ethertype) {
+PcapCircularBuffer* PcapBufferManager::getBuffer(uint16_t ethertype) {
   auto it = buffers_.find(ethertype);
   if (it == buffers_.end()) {
-    buffers_[UNKNOWN].addPkt(std::move(pkt));
-  } else {
-    it->second.addPkt(std::move(pkt));
+    return buffers_[UNKNOWN].get();
   }
+  return it->second.get();
+}
+
+void PcapBufferManager::addRxPkt(const RxPacketData& pkt, uint16_t ethertype) {
+  getBuffer(ethertype)->addRxPkt(pkt);
+}
+
+void PcapBufferManager::addTxPkt(const TxPacketData& pkt, uint16_t ethertype) {
+  getBuffer(ethertype)->addTxPkt(pkt);
 }
 
 /*
@@ -27,31 +46,13 @@ void PcapBufferManager::addPkt(PcapPkt&& pkt, uint16_t ethertype) {
  */
 void PcapBufferManager::dumpPackets(
     std::vector<CapturedPacket>& out,
-    uint16_t ethertype) {
-  auto buf = buffers_[ethertype].release();
-  for (int i = 0; i < buf.size(); i++) {
-    CapturedPacket p;
-    p.rx = buf[i].isRx();
-
-    PacketData data;
-    folly::IOBuf packetData;
-
-    if (p.rx) {
-      RxPacketData r;
-      r.srcPort = buf[i].port();
-      r.srcVlan = buf[i].vlan();
-      buf[i].buf()->cloneInto(packetData);
-      r.packetData = packetData.moveToFbString();
-      r.reasons = buf[i].getReasons();
-      data.set_rxpkt(r);
-    } else {
-      TxPacketData t;
-      buf[i].buf()->cloneInto(packetData);
-      t.packetData = packetData.moveToFbString();
-      data.set_txpkt(t);
-    }
-    p.pkt = data;
-    out.emplace_back(std::move(p));
+    uint16_t ethertype,
+    int64_t startNs,
+    int64_t endNs) {
+  // Unknown ethertypes are only kept together, and dumped as UNKNOWN
+  auto it = buffers_.find(ethertype);
+  if (it != buffers_.end()) {
+    it->second->dumpPackets(out, startNs, endNs);
   }
 }
 }}
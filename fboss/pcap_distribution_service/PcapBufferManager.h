@@ -8,7 +8,9 @@
 #include "fboss/agent/IPv6Handler.h"
 #include "fboss/agent/LldpManager.h"
 
+#include <limits>
 #include <map>
+#include <memory>
 #include <vector>
 
 namespace facebook {
@@ -16,11 +18,20 @@ namespace fboss {
 
 class CapturedPacket;
 
+/*
+ * Keeps the most recently captured packets of each ethertype. Packets can
+ * be added and dumped from any thread without locking.
+ */
 class PcapBufferManager {
  public:
   PcapBufferManager();
-  void addPkt(PcapPkt&& pkt, uint16_t ethertype);
-  void dumpPackets(std::vector<CapturedPacket>& out, uint16_t ethertype);
+  void addRxPkt(const RxPacketData& pkt, uint16_t ethertype);
+  void addTxPkt(const TxPacketData& pkt, uint16_t ethertype);
+  void dumpPackets(
+      std::vector<CapturedPacket>& out,
+      uint16_t ethertype,
+      int64_t startNs = std::numeric_limits<int64_t>::min(),
+      int64_t endNs = std::numeric_limits<int64_t>::max());
   static uint16_t UNKNOWN;
   static const std::vector<uint16_t>& getEthertypes() {
     static const std::vector<uint16_t> ethertypes = {
@@ -33,7 +44,10 @@ class PcapBufferManager {
   }
 
  private:
-  std::map<uint16_t, PcapCircularBuffer> buffers_;
+  PcapCircularBuffer* getBuffer(uint16_t ethertype);
+
+  // Only populated on construction, so lookups need no lock
+  std::map<uint16_t, std::unique_ptr<PcapCircularBuffer>> buffers_;
 };
 }
 }
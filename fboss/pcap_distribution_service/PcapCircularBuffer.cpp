@@ -0,0 +1,227 @@
+#include "fboss/pcap_distribution_service/PcapCircularBuffer.h"
+
+#include "fboss/agent/FbossError.h"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+namespace facebook { namespace fboss {
+
+PcapCircularBuffer::PcapCircularBuffer(uint32_t capacity, uint32_t slotBytes)
+    : capacity_(capacity),
+      slotBytes_(slotBytes),
+      // Keep each slot on its own cache lines
+      slotStride_((sizeof(Slot) + slotBytes + 63) & ~size_t(63)) {
+  if (capacity_ == 0) {
+    throw FbossError("packet buffer needs room for at least one packet");
+  }
+  slab_.reset(new uint8_t[size_t(capacity_) * slotStride_]);
+  for (uint32_t i = 0; i < capacity_; ++i) {
+    new (slot(i)) Slot();
+  }
+}
+
+void PcapCircularBuffer::addRxPkt(const RxPacketData& pkt) {
+  addPkt(true, pkt.srcPort, pkt.srcVlan, pkt.reasons, pkt.packetData);
+}
+
+void PcapCircularBuffer::addTxPkt(const TxPacketData& pkt) {
+  static const std::vector<RxReason> kNoReasons;
+  addPkt(false, 0, 0, kNoReasons, pkt.packetData);
+}
+
+void PcapCircularBuffer::addPkt(
+    bool rx,
+    int32_t port,
+    int32_t vlan,
+    const std::vector<RxReason>& reasons,
+    folly::StringPiece data) {
+  auto index = head_.fetch_add(1, std::memory_order_relaxed);
+  auto s = slot(index);
+
+  // Claim the slot. If a thread a whole lap behind is still writing it, or a
+  // thread a lap ahead already did, drop the packet rather than tear a write.
+  auto seq = s->seq.load(std::memory_order_relaxed);
+  if ((seq & 1) || seq > 2 * index ||
+      !s->seq.compare_exchange_strong(
+          seq, 2 * index + 1, std::memory_order_acq_rel)) {
+    drops_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  s->timestampNs = nowNs();
+  s->port = port;
+  s->vlan = vlan;
+  s->rx = rx;
+
+  // The reasons go first, then as much of the packet as fits
+  auto out = slotData(index);
+  uint32_t reasonsLen = 0;
+  uint8_t numReasons = 0;
+  for (const auto& r : reasons) {
+    uint16_t descLen = std::min<size_t>(r.description.size(), UINT16_MAX);
+    auto len = sizeof(int32_t) + sizeof(uint16_t) + descLen;
+    if (numReasons == UINT8_MAX || reasonsLen + len > slotBytes_) {
+      break;
+    }
+    int32_t bytes = r.bytes;
+    memcpy(out, &bytes, sizeof(bytes));
+    out += sizeof(bytes);
+    memcpy(out, &descLen, sizeof(descLen));
+    out += sizeof(descLen);
+    memcpy(out, r.description.data(), descLen);
+    out += descLen;
+    reasonsLen += len;
+    ++numReasons;
+  }
+  uint32_t pktLen = std::min<size_t>(data.size(), slotBytes_ - reasonsLen);
+  memcpy(out, data.data(), pktLen);
+  s->reasonsLen = reasonsLen;
+  s->numReasons = numReasons;
+  s->pktLen = pktLen;
+
+  s->seq.store(2 * index + 2, std::memory_order_release);
+}
+
+uint32_t PcapCircularBuffer::size() const {
+  return std::min<uint64_t>(head_.load(std::memory_order_relaxed), capacity_);
+}
+
+bool PcapCircularBuffer::readTimestamp(uint64_t index, int64_t* timestampNs)
+    const {
+  auto s = slot(index);
+  auto seq = s->seq.load(std::memory_order_acquire);
+  if (seq != 2 * index + 2) {
+    return false;
+  }
+  *timestampNs = s->timestampNs;
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return s->seq.load(std::memory_order_relaxed) == seq;
+}
+
+bool PcapCircularBuffer::readPacket(
+    uint64_t index,
+    CapturedPacket* pkt,
+    int64_t* timestampNs) const {
+  auto s = slot(index);
+  auto seq = s->seq.load(std::memory_order_acquire);
+  if (seq != 2 * index + 2) {
+    return false;
+  }
+  *timestampNs = s->timestampNs;
+  bool rx = s->rx;
+  int32_t port = s->port;
+  int32_t vlan = s->vlan;
+  uint32_t reasonsLen = std::min(s->reasonsLen, slotBytes_);
+  uint32_t pktLen = std::min(s->pktLen, slotBytes_ - reasonsLen);
+  uint8_t numReasons = s->numReasons;
+  auto data = slotData(index);
+  folly::fbstring reasonBytes(reinterpret_cast<char*>(data), reasonsLen);
+  folly::fbstring packetData(
+      reinterpret_cast<char*>(data) + reasonsLen, pktLen);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (s->seq.load(std::memory_order_relaxed) != seq) {
+    // Overwritten while we copied it out
+    return false;
+  }
+
+  pkt->rx = rx;
+  if (!rx) {
+    TxPacketData t;
+    t.packetData = std::move(packetData);
+    pkt->pkt.set_txpkt(std::move(t));
+    return true;
+  }
+  RxPacketData r;
+  r.srcPort = port;
+  r.srcVlan = vlan;
+  r.packetData = std::move(packetData);
+  auto in = reasonBytes.data();
+  auto end = in + reasonBytes.size();
+  for (int i = 0; i < numReasons; ++i) {
+    int32_t bytes;
+    uint16_t descLen;
+    if (in + sizeof(bytes) + sizeof(descLen) > end) {
+      break;
+    }
+    memcpy(&bytes, in, sizeof(bytes));
+    memcpy(&descLen, in + sizeof(bytes), sizeof(descLen));
+    in += sizeof(bytes) + sizeof(descLen);
+    if (in + descLen > end) {
+      break;
+    }
+    RxReason reason;
+    reason.bytes = bytes;
+    reason.description = std::string(in, descLen);
+    in += descLen;
+    r.reasons.push_back(std::move(reason));
+  }
+  pkt->pkt.set_rxpkt(std::move(r));
+  return true;
+}
+
+/*
+ * This function will append to the back of the
+ * vector reference that is passed in as an argument
+ */
+void PcapCircularBuffer::dumpPackets(
+    std::vector<CapturedPacket>& out,
+    int64_t startNs,
+    int64_t endNs) const {
+  // Slots hold monotonic timestamps, move the window to the same clock
+  auto offset = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::system_clock::now().time_since_epoch())
+                    .count() -
+      nowNs();
+  auto toMonotonic = [offset](int64_t ns) {
+    // Leave an open ended window open, rather than overflow
+    if (ns == std::numeric_limits<int64_t>::min() ||
+        ns == std::numeric_limits<int64_t>::max()) {
+      return ns;
+    }
+    return ns - offset;
+  };
+  auto start = toMonotonic(startNs);
+  auto end = toMonotonic(endNs);
+
+  auto head = head_.load(std::memory_order_acquire);
+  uint64_t lo = head > capacity_ ? head - capacity_ : 0;
+  uint64_t hi = head;
+
+  // Find the oldest packet at or after start. Packets already overwritten
+  // count as older, and packets still being written as newer.
+  while (lo < hi) {
+    auto mid = lo + (hi - lo) / 2;
+    int64_t ts;
+    bool older;
+    if (readTimestamp(mid, &ts)) {
+      older = ts < start;
+    } else {
+      older = slot(mid)->seq.load(std::memory_order_relaxed) > 2 * mid + 2;
+    }
+    if (older) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  for (auto index = lo; index < head; ++index) {
+    CapturedPacket pkt;
+    int64_t ts;
+    if (!readPacket(index, &pkt, &ts)) {
+      continue;
+    }
+    if (ts > end) {
+      break;
+    } else if (ts < start) {
+      continue;
+    }
+    pkt.timestampNs = ts + offset;
+    pkt.__isset.timestampNs = true;
+    out.push_back(std::move(pkt));
+  }
+}
+
+}}
@@ -1,47 +1,116 @@
 #pragma once
 
-#include <boost/circular_buffer.hpp>
+#include <folly/Range.h>
 
-#include "fboss/agent/capture/PcapPkt.h"
-
-#include "folly/Synchronized.h"
+#include "fboss/pcap_distribution_service/if/gen-cpp2/pcap_pubsub_types.h"
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
 #include <memory>
-#include <mutex>
+#include <vector>
 
 namespace facebook { namespace fboss {
 
+/*
+ * A ring of the most recently captured packets, which packets can be added
+ * to from any number of threads without taking a lock, and which can be
+ * dumped by time window while packets keep being added.
+ *
+ * Packets are copied into a slab of fixed size slots allocated up front,
+ * packets larger than a slot are truncated. Each slot carries a sequence
+ * number, odd while the slot is being written, so that readers can tell
+ * whether the slot they copied out was overwritten meanwhile, and skip it.
+ *
+ * Packets are timestamped from the monotonic clock as they are added, so
+ * slots are in timestamp order, up to the jitter between threads adding
+ * packets at the same time, and a time window is found by binary search.
+ * Timestamps are converted to and from the wall clock when dumping.
+ */
 class PcapCircularBuffer {
  public:
-  explicit PcapCircularBuffer(int n = 100)
-      : buf_(boost::circular_buffer<PcapPkt>(n)) {}
+  explicit PcapCircularBuffer(
+      uint32_t capacity = 100,
+      uint32_t slotBytes = 2048);
 
-  void addPkt(PcapPkt pkt) {
-    buf_.wlock()->push_back(std::move(pkt));
-  }
+  void addRxPkt(const RxPacketData& pkt);
+  void addTxPkt(const TxPacketData& pkt);
+
+  /*
+   * Append the packets captured between startNs and endNs, in ns since the
+   * epoch, to out, oldest first.
+   */
+  void dumpPackets(
+      std::vector<CapturedPacket>& out,
+      int64_t startNs = std::numeric_limits<int64_t>::min(),
+      int64_t endNs = std::numeric_limits<int64_t>::max()) const;
 
-  void resize(int n) {
-    buf_.wlock()->set_capacity(n);
+  uint32_t size() const;
+  uint32_t capacity() const {
+    return capacity_;
   }
 
-  int size() {
-    return buf_.rlock()->size();
+  // Packets not added because another thread was still writing their slot
+  uint64_t drops() const {
+    return drops_.load(std::memory_order_relaxed);
   }
 
-  int capacity() {
-    return buf_.rlock()->capacity();
+ private:
+  struct Slot {
+    // 2 * index + 1 while packet index is written to the slot, 2 * index + 2
+    // once it is written
+    std::atomic<uint64_t> seq{0};
+    int64_t timestampNs{0};
+    int32_t port{0};
+    int32_t vlan{0};
+    uint32_t pktLen{0};
+    uint32_t reasonsLen{0};
+    uint8_t rx{0};
+    uint8_t numReasons{0};
+  };
+
+  // Forbidden copy constructor and assignment operator
+  PcapCircularBuffer(PcapCircularBuffer const &) = delete;
+  PcapCircularBuffer& operator=(PcapCircularBuffer const &) = delete;
+
+  void addPkt(
+      bool rx,
+      int32_t port,
+      int32_t vlan,
+      const std::vector<RxReason>& reasons,
+      folly::StringPiece data);
+
+  Slot* slot(uint64_t index) const {
+    return reinterpret_cast<Slot*>(
+        slab_.get() + (index % capacity_) * slotStride_);
+  }
+  uint8_t* slotData(uint64_t index) const {
+    return reinterpret_cast<uint8_t*>(slot(index)) + sizeof(Slot);
   }
 
-  // release the buffer to a user to dump, and swap in
-  // a new buffer
-  boost::circular_buffer<PcapPkt> release() {
-    return buf_.copy();
+  /*
+   * Read the timestamp of packet index. Returns false if the packet is no
+   * longer, or not yet, in the ring.
+   */
+  bool readTimestamp(uint64_t index, int64_t* timestampNs) const;
+  bool readPacket(uint64_t index, CapturedPacket* pkt, int64_t* timestampNs)
+      const;
+
+  static int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
   }
 
-  // can add new functions, such as get after timestamp
+  const uint32_t capacity_;
+  const uint32_t slotBytes_;
+  const size_t slotStride_;
+  std::unique_ptr<uint8_t[]> slab_;
 
- private:
-  folly::Synchronized<boost::circular_buffer<PcapPkt>> buf_;
+  // Index of the next packet added
+  alignas(64) std::atomic<uint64_t> head_{0};
+  alignas(64) std::atomic<uint64_t> drops_{0};
 };
 
 }}
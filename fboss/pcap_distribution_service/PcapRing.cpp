@@ -0,0 +1,328 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/pcap_distribution_service/PcapRing.h"
+
+#include "fboss/agent/FbossError.h"
+#include "fboss/agent/RxPacket.h"
+#include "fboss/agent/TxPacket.h"
+#include "fboss/pcap_distribution_service/if/gen-cpp2/pcap_pubsub_types.h"
+
+#include <folly/Exception.h>
+#include <folly/Format.h>
+#include <folly/io/IOBuf.h>
+#include <folly/logging/xlog.h>
+
+#include <climits>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <linux/memfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+using facebook::fboss::PcapRingHeader;
+using facebook::fboss::PcapRingSlot;
+
+constexpr auto kMemfdName = "fboss_pcap_ring";
+
+size_t slotsOffset() {
+  // Keep the slots on their own cache lines too
+  return (sizeof(PcapRingHeader) + 63) & ~size_t(63);
+}
+
+size_t ringSize(uint32_t numSlots, uint32_t slotSize) {
+  return slotsOffset() + size_t(numSlots) * slotSize;
+}
+
+void* mapRing(int fd, size_t size) {
+  auto addr =
+      ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (addr == MAP_FAILED) {
+    folly::throwSystemError("Cannot mmap pcap ring of size ", size);
+  }
+  return addr;
+}
+
+// Only ever map a memfd created by PcapRingWriter, not whatever file the
+// peer happens to point us at
+void checkIsRing(const std::string& path) {
+  char target[PATH_MAX];
+  auto len = ::readlink(path.c_str(), target, sizeof(target) - 1);
+  folly::checkUnixError(len, "Cannot resolve pcap ring ", path);
+  auto expected = folly::sformat("/memfd:{}", kMemfdName);
+  if (std::string(target, len).compare(0, expected.size(), expected) != 0) {
+    throw facebook::fboss::FbossError(
+        path, " is ", std::string(target, len), ", not a pcap ring");
+  }
+}
+
+uint8_t* copyOut(const folly::IOBuf* buf, uint8_t* out) {
+  for (auto range : *buf) {
+    memcpy(out, range.data(), range.size());
+    out += range.size();
+  }
+  return out;
+}
+
+} // unnamed namespace
+
+namespace facebook { namespace fboss {
+
+PcapRingWriter::PcapRingWriter(uint32_t numSlots, uint32_t slotSize) {
+  if (numSlots == 0 || slotSize <= sizeof(PcapRingSlot) || slotSize % 8) {
+    throw FbossError(
+        "invalid pcap ring geometry: ",
+        numSlots,
+        " slots of ",
+        slotSize,
+        " bytes");
+  }
+  auto fd = syscall(SYS_memfd_create, kMemfdName, MFD_CLOEXEC);
+  if (fd < 0) {
+    folly::throwSystemError("Cannot create memfd for the pcap ring");
+  }
+  file_ = folly::File(fd, true);
+  size_ = ringSize(numSlots, slotSize);
+  folly::checkUnixError(
+      ::ftruncate(file_.fd(), size_), "Cannot size the pcap ring");
+
+  auto addr = static_cast<uint8_t*>(mapRing(file_.fd(), size_));
+  header_ = reinterpret_cast<PcapRingHeader*>(addr);
+  slots_ = addr + slotsOffset();
+  header_->numSlots = numSlots;
+  header_->slotSize = slotSize;
+  header_->version = PcapRingHeader::kVersion;
+  header_->head.store(0, std::memory_order_relaxed);
+  header_->tail.store(0, std::memory_order_relaxed);
+  header_->drops.store(0, std::memory_order_relaxed);
+  // The reader checks the magic last, write it once the rest is set
+  std::atomic_thread_fence(std::memory_order_release);
+  header_->magic = PcapRingHeader::kMagic;
+  XLOG(DBG1) << "created pcap ring of " << numSlots << " slots of "
+             << slotSize << " bytes on fd " << file_.fd();
+}
+
+PcapRingWriter::~PcapRingWriter() {
+  if (header_) {
+    ::munmap(header_, size_);
+  }
+}
+
+PcapRingWriter::Result PcapRingWriter::write(
+    RxPacket* pkt,
+    uint16_t ethertype) {
+  auto reasons = pkt->getReasons();
+  uint32_t reasonsLen = 0;
+  for (const auto& r : reasons) {
+    reasonsLen += sizeof(int32_t) + sizeof(uint16_t) + r.description.size();
+  }
+  auto pktLen = pkt->buf()->computeChainDataLength();
+  if (reasons.size() > UINT8_MAX ||
+      sizeof(PcapRingSlot) + reasonsLen + pktLen > header_->slotSize) {
+    return Result::TOO_BIG;
+  }
+
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto slot = nextSlotLocked();
+  if (!slot) {
+    return Result::FULL;
+  }
+  PcapRingSlot meta;
+  meta.pktLen = pktLen;
+  meta.reasonsLen = reasonsLen;
+  meta.srcPort = pkt->getSrcPort();
+  meta.srcVlan = pkt->getSrcVlan();
+  meta.ethertype = ethertype;
+  meta.rx = 1;
+  meta.numReasons = reasons.size();
+  memcpy(slot, &meta, sizeof(meta));
+  auto out = slot + sizeof(meta);
+  for (const auto& r : reasons) {
+    int32_t bytes = r.bytes;
+    uint16_t descLen = r.description.size();
+    memcpy(out, &bytes, sizeof(bytes));
+    out += sizeof(bytes);
+    memcpy(out, &descLen, sizeof(descLen));
+    out += sizeof(descLen);
+    memcpy(out, r.description.data(), descLen);
+    out += descLen;
+  }
+  copyOut(pkt->buf(), out);
+  commitLocked();
+  return Result::WRITTEN;
+}
+
+PcapRingWriter::Result PcapRingWriter::write(
+    const TxPacket* pkt,
+    uint16_t ethertype) {
+  auto pktLen = pkt->buf()->computeChainDataLength();
+  if (sizeof(PcapRingSlot) + pktLen > header_->slotSize) {
+    return Result::TOO_BIG;
+  }
+
+  std::lock_guard<std::mutex> guard(mutex_);
+  auto slot = nextSlotLocked();
+  if (!slot) {
+    return Result::FULL;
+  }
+  PcapRingSlot meta;
+  meta.pktLen = pktLen;
+  meta.reasonsLen = 0;
+  meta.srcPort = 0;
+  meta.srcVlan = 0;
+  meta.ethertype = ethertype;
+  meta.rx = 0;
+  meta.numReasons = 0;
+  memcpy(slot, &meta, sizeof(meta));
+  copyOut(pkt->buf(), slot + sizeof(meta));
+  commitLocked();
+  return Result::WRITTEN;
+}
+
+uint64_t PcapRingWriter::drops() const {
+  return header_->drops.load(std::memory_order_relaxed);
+}
+
+uint8_t* PcapRingWriter::nextSlotLocked() {
+  auto numSlots = header_->numSlots;
+  if (head_ - cachedTail_ >= numSlots) {
+    cachedTail_ = header_->tail.load(std::memory_order_acquire);
+    if (head_ - cachedTail_ >= numSlots) {
+      header_->drops.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    }
+  }
+  return slots_ + (head_ % numSlots) * header_->slotSize;
+}
+
+void PcapRingWriter::commitLocked() {
+  ++head_;
+  header_->head.store(head_, std::memory_order_release);
+}
+
+PcapRingReader::PcapRingReader(pid_t pid, int fd) {
+  auto path = folly::sformat("/proc/{}/fd/{}", pid, fd);
+  // Check before opening so we never open anything else, and again on what
+  // we opened in case the peer swapped its fd in between
+  checkIsRing(path);
+  file_ = folly::File(path, O_RDWR | O_CLOEXEC);
+  checkIsRing(folly::sformat("/proc/self/fd/{}", file_.fd()));
+
+  // Map the header alone first to learn the size of the ring
+  auto header = static_cast<PcapRingHeader*>(
+      mapRing(file_.fd(), sizeof(PcapRingHeader)));
+  auto magic = header->magic;
+  std::atomic_thread_fence(std::memory_order_acquire);
+  auto version = header->version;
+  auto numSlots = header->numSlots;
+  auto slotSize = header->slotSize;
+  ::munmap(header, sizeof(PcapRingHeader));
+  if (magic != PcapRingHeader::kMagic || version != PcapRingHeader::kVersion) {
+    throw FbossError(
+        "not a pcap ring at ", path, ", magic ", magic, " version ", version);
+  }
+  if (numSlots == 0 || slotSize <= sizeof(PcapRingSlot)) {
+    throw FbossError(
+        "invalid pcap ring geometry at ",
+        path,
+        ": ",
+        numSlots,
+        " slots of ",
+        slotSize,
+        " bytes");
+  }
+
+  size_ = ringSize(numSlots, slotSize);
+  auto addr = static_cast<uint8_t*>(mapRing(file_.fd(), size_));
+  header_ = reinterpret_cast<PcapRingHeader*>(addr);
+  slots_ = addr + slotsOffset();
+  XLOG(INFO) << "attached to pcap ring of " << numSlots << " slots of "
+             << slotSize << " bytes at " << path;
+}
+
+PcapRingReader::~PcapRingReader() {
+  if (header_) {
+    ::munmap(header_, size_);
+  }
+}
+
+uint32_t PcapRingReader::read(
+    uint32_t maxPkts,
+    const RxCallback& onRx,
+    const TxCallback& onTx) {
+  auto numSlots = header_->numSlots;
+  auto slotSize = header_->slotSize;
+  auto tail = header_->tail.load(std::memory_order_relaxed);
+  auto head = header_->head.load(std::memory_order_acquire);
+  auto count = std::min<uint64_t>(head - tail, maxPkts);
+
+  for (uint64_t i = 0; i < count; ++i) {
+    auto slot = slots_ + ((tail + i) % numSlots) * slotSize;
+    PcapRingSlot meta;
+    memcpy(&meta, slot, sizeof(meta));
+    // The agent is trusted, but don't read past the slot if it misbehaves
+    if (sizeof(meta) + size_t(meta.reasonsLen) + meta.pktLen > slotSize) {
+      XLOG(ERR) << "skipping corrupt pcap ring slot " << tail + i;
+      continue;
+    }
+    auto in = slot + sizeof(meta);
+    auto end = in + meta.reasonsLen;
+    auto data = reinterpret_cast<const char*>(end);
+
+    if (!meta.rx) {
+      TxPacketData pkt;
+      pkt.packetData = folly::fbstring(data, meta.pktLen);
+      onTx(&pkt, meta.ethertype);
+      continue;
+    }
+    RxPacketData pkt;
+    pkt.srcPort = meta.srcPort;
+    pkt.srcVlan = meta.srcVlan;
+    pkt.packetData = folly::fbstring(data, meta.pktLen);
+    for (int r = 0; r < meta.numReasons; ++r) {
+      int32_t bytes;
+      uint16_t descLen;
+      if (in + sizeof(bytes) + sizeof(descLen) > end) {
+        break;
+      }
+      memcpy(&bytes, in, sizeof(bytes));
+      in += sizeof(bytes);
+      memcpy(&descLen, in, sizeof(descLen));
+      in += sizeof(descLen);
+      if (in + descLen > end) {
+        break;
+      }
+      RxReason reason;
+      reason.bytes = bytes;
+      reason.description =
+          std::string(reinterpret_cast<const char*>(in), descLen);
+      in += descLen;
+      pkt.reasons.push_back(std::move(reason));
+    }
+    onRx(&pkt, meta.ethertype);
+  }
+
+  // Release the whole batch to the writer at once
+  if (count) {
+    header_->tail.store(tail + count, std::memory_order_release);
+  }
+  return count;
+}
+
+uint64_t PcapRingReader::drops() const {
+  return header_->drops.load(std::memory_order_relaxed);
+}
+
+}} // facebook::fboss
@@ -0,0 +1,150 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#pragma once
+
+#include <folly/File.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <sys/types.h>
+
+namespace facebook { namespace fboss {
+
+class RxPacket;
+class TxPacket;
+class RxPacketData;
+class TxPacketData;
+
+/*
+ * The pcap ring carries packets published by the agent to the pcap
+ * distribution service through shared memory, so that publishing a packet
+ * is a copy into a ring slot rather than an RPC per packet.
+ *
+ * The agent creates the ring in a memfd and tells the service its pid and
+ * the fd of the memfd, the service then maps the same memory through
+ * /proc/<pid>/fd/<fd>. The memory starts with a PcapRingHeader, followed by
+ * numSlots slots of slotSize bytes each. Each slot holds a PcapRingSlot,
+ * followed by the encoded rx reasons and then the packet bytes.
+ *
+ * head and tail count slots ever written and ever read, they never wrap and
+ * the slot used is the count modulo numSlots. Only the agent moves head and
+ * only the service moves tail, so the ring needs no lock across processes.
+ */
+struct PcapRingHeader {
+  static constexpr uint32_t kMagic = 0x50524e47; // "PRNG"
+  static constexpr uint32_t kVersion = 1;
+
+  uint32_t magic;
+  uint32_t version;
+  uint32_t numSlots;
+  uint32_t slotSize;
+
+  // Keep the indices on their own cache lines, they are written by different
+  // processes
+  alignas(64) std::atomic<uint64_t> head;
+  alignas(64) std::atomic<uint64_t> tail;
+  // Packets not published because the ring was full
+  alignas(64) std::atomic<uint64_t> drops;
+};
+
+struct PcapRingSlot {
+  uint32_t pktLen;
+  uint32_t reasonsLen;
+  int32_t srcPort;
+  int32_t srcVlan;
+  uint16_t ethertype;
+  uint8_t rx;
+  uint8_t numReasons;
+};
+
+/*
+ * The agent end of the ring.
+ *
+ * The agent publishes packets from several threads, rx threads as well as
+ * the threads sending packets, so writes are serialized with a mutex. The
+ * critical section is just the copy into the slot.
+ */
+class PcapRingWriter {
+ public:
+  enum class Result {
+    WRITTEN,
+    // The service is not keeping up, the packet was dropped
+    FULL,
+    // The packet does not fit in a slot, it has to be published some other way
+    TOO_BIG,
+  };
+
+  PcapRingWriter(uint32_t numSlots, uint32_t slotSize);
+  ~PcapRingWriter();
+
+  Result write(RxPacket* pkt, uint16_t ethertype);
+  Result write(const TxPacket* pkt, uint16_t ethertype);
+
+  int fd() const {
+    return file_.fd();
+  }
+
+  uint64_t drops() const;
+
+ private:
+  // Forbidden copy constructor and assignment operator
+  PcapRingWriter(PcapRingWriter const &) = delete;
+  PcapRingWriter& operator=(PcapRingWriter const &) = delete;
+
+  // Returns the slot to write next, or nullptr if the ring is full
+  uint8_t* nextSlotLocked();
+  void commitLocked();
+
+  folly::File file_;
+  size_t size_{0};
+  PcapRingHeader* header_{nullptr};
+  uint8_t* slots_{nullptr};
+
+  std::mutex mutex_;
+  uint64_t head_{0};
+  // The last tail seen, so the shared tail is only read when the ring looks
+  // full
+  uint64_t cachedTail_{0};
+};
+
+/*
+ * The service end of the ring, only used from one thread.
+ */
+class PcapRingReader {
+ public:
+  using RxCallback = std::function<void(RxPacketData*, uint16_t ethertype)>;
+  using TxCallback = std::function<void(TxPacketData*, uint16_t ethertype)>;
+
+  PcapRingReader(pid_t pid, int fd);
+  ~PcapRingReader();
+
+  /*
+   * Hand up to maxPkts packets to the callbacks, and release their slots to
+   * the writer all at once. Returns the number of packets read.
+   */
+  uint32_t
+  read(uint32_t maxPkts, const RxCallback& onRx, const TxCallback& onTx);
+
+  uint64_t drops() const;
+
+ private:
+  // Forbidden copy constructor and assignment operator
+  PcapRingReader(PcapRingReader const &) = delete;
+  PcapRingReader& operator=(PcapRingReader const &) = delete;
+
+  folly::File file_;
+  size_t size_{0};
+  PcapRingHeader* header_{nullptr};
+  const uint8_t* slots_{nullptr};
+};
+
+}} // facebook::fboss
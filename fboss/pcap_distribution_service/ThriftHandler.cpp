@@ -2,15 +2,40 @@
 
 #include "fboss/pcap_distribution_service/PcapBufferManager.h"
 #include "fboss/pcap_distribution_service/PcapDistributor.h"
+#include "fboss/pcap_distribution_service/PcapRing.h"
 
-#include "fboss/agent/capture/PcapPkt.h"
+#include "fboss/agent/FbossError.h"
 
+#include <folly/Format.h>
+#include <folly/Logging.h>
+#include <folly/SocketAddress.h>
+#include <folly/system/ThreadName.h>
+#include <gflags/gflags.h>
+
+#include <chrono>
 #include <memory>
 
+#include <sys/stat.h>
+#include <unistd.h>
+
+DEFINE_int32(
+    pcap_ring_batch_size,
+    64,
+    "Max packets read from the pcap ring before releasing their slots");
+DEFINE_int32(
+    pcap_ring_poll_interval_us,
+    500,
+    "How long to wait before looking at an empty pcap ring again (us)");
+
 using namespace std;
 
 namespace facebook { namespace fboss {
 
+ThriftHandler::~ThriftHandler() {
+  lock_guard<mutex> guard(ringMutex_);
+  stopRingThreadLocked();
+}
+
 void ThriftHandler::subscribe(unique_ptr<string> hostname, int port) {
   dist_->subscribe(move(hostname), port);
 }
@@ -23,14 +48,89 @@ void ThriftHandler::receiveRxPacket(
     unique_ptr<RxPacketData> pkt,
     int16_t ethertype) {
   dist_->distributeRxPacket(pkt.get());
-  buffMgr_->addPkt(PcapPkt(pkt.get()), ethertype);
+  buffMgr_->addRxPkt(*pkt, ethertype);
 }
 
 void ThriftHandler::receiveTxPacket(
     unique_ptr<TxPacketData> pkt,
     int16_t ethertype) {
   dist_->distributeTxPacket(pkt.get());
-  buffMgr_->addPkt(PcapPkt(pkt.get()), ethertype);
+  buffMgr_->addTxPkt(*pkt, ethertype);
+}
+
+void ThriftHandler::attachRing(int32_t pid, int32_t fd) {
+  checkRingOwner(pid);
+  // Open the ring before stopping the current one, a bad request must not
+  // cost us the ring we are reading from
+  auto ring = make_unique<PcapRingReader>(pid, fd);
+
+  lock_guard<mutex> guard(ringMutex_);
+  // The agent attaches again whenever it reconnects, e.g. after a restart
+  stopRingThreadLocked();
+  ring_ = std::move(ring);
+  ringThreadStop_.store(false);
+  auto reader = ring_.get();
+  ringThread_ = make_unique<thread>([this, reader] { readRing(reader); });
+}
+
+void ThriftHandler::checkRingOwner(int32_t pid) const {
+  // The ring is opened read-write through /proc, so only let a local process
+  // of our own user hand us one
+  auto ctx = getConnectionContext();
+  auto peer = ctx ? ctx->getPeerAddress() : nullptr;
+  if (!peer || !peer->isLoopbackAddress()) {
+    throw FbossError(
+        "refusing pcap ring from non local peer ",
+        peer ? peer->describe() : "<unknown>");
+  }
+  struct stat st;
+  auto path = folly::sformat("/proc/{}", pid);
+  if (pid <= 0 || ::stat(path.c_str(), &st) != 0) {
+    throw FbossError("refusing pcap ring of unknown process ", pid);
+  }
+  if (st.st_uid != ::geteuid()) {
+    throw FbossError(
+        "refusing pcap ring of process ",
+        pid,
+        " owned by uid ",
+        st.st_uid,
+        ", expected uid ",
+        ::geteuid());
+  }
+}
+
+void ThriftHandler::readRing(PcapRingReader* ring) {
+  folly::setThreadName("PcapRingReader");
+  auto onRx = [this](RxPacketData* pkt, uint16_t ethertype) {
+    dist_->distributeRxPacket(pkt);
+    buffMgr_->addRxPkt(*pkt, ethertype);
+  };
+  auto onTx = [this](TxPacketData* pkt, uint16_t ethertype) {
+    dist_->distributeTxPacket(pkt);
+    buffMgr_->addTxPkt(*pkt, ethertype);
+  };
+  uint64_t drops = 0;
+  while (!ringThreadStop_.load()) {
+    auto read = ring->read(FLAGS_pcap_ring_batch_size, onRx, onTx);
+    if (ring->drops() != drops) {
+      drops = ring->drops();
+      FB_LOG_EVERY_MS(WARNING, 1000)
+          << "agent dropped " << drops << " packets on a full pcap ring";
+    }
+    if (read == 0) {
+      this_thread::sleep_for(
+          chrono::microseconds(FLAGS_pcap_ring_poll_interval_us));
+    }
+  }
+}
+
+void ThriftHandler::stopRingThreadLocked() {
+  if (ringThread_) {
+    ringThreadStop_.store(true);
+    ringThread_->join();
+    ringThread_.reset();
+  }
+  ring_.reset();
 }
 
 void ThriftHandler::kill(){
@@ -51,4 +151,14 @@ void ThriftHandler::dumpPacketsByType(
     buffMgr_->dumpPackets(out, type);
   }
 }
+
+void ThriftHandler::dumpPacketsByTime(
+    vector<CapturedPacket>& out,
+    unique_ptr<vector<int16_t>> ethertypes,
+    int64_t startNs,
+    int64_t endNs) {
+  for (const auto& type : *ethertypes) {
+    buffMgr_->dumpPackets(out, type, startNs, endNs);
+  }
+}
 }}
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <thread>
 
 #include "fboss/pcap_distribution_service/if/gen-cpp2/PcapPushSubscriber.h"
 
@@ -8,6 +11,7 @@ namespace facebook { namespace fboss {
 
 class PcapDistributor;
 class PcapBufferManager;
+class PcapRingReader;
 
 /*
  * This class handles users connecting to the service,
@@ -19,6 +23,8 @@ class ThriftHandler : virtual public PcapPushSubscriberSvIf {
       std::unique_ptr<PcapDistributor> d,
       std::unique_ptr<PcapBufferManager> b)
       : dist_(std::move(d)), buffMgr_(std::move(b)) {}
+  ~ThriftHandler() override;
+
   /*
    * Called by clients to subscribe to the distribution service
    */
@@ -32,6 +38,14 @@ class ThriftHandler : virtual public PcapPushSubscriberSvIf {
       override;
   void receiveTxPacket(std::unique_ptr<TxPacketData> pkt, int16_t ethertype)
       override;
+
+  /*
+   * Called by SwSwitch to publish packets through a shared memory ring,
+   * which is then drained on its own thread. Only a local process running
+   * as the same user as the service may attach, and only a pcap ring.
+   */
+  void attachRing(int32_t pid, int32_t fd) override;
+
   /*
    * A thrift kill switch for the service
    */
@@ -44,9 +58,25 @@ class ThriftHandler : virtual public PcapPushSubscriberSvIf {
   void dumpPacketsByType(
       std::vector<CapturedPacket>& out,
       std::unique_ptr<std::vector<int16_t>> ethertypes) override;
+  void dumpPacketsByTime(
+      std::vector<CapturedPacket>& out,
+      std::unique_ptr<std::vector<int16_t>> ethertypes,
+      int64_t startNs,
+      int64_t endNs) override;
 
  private:
+  void readRing(PcapRingReader* ring);
+  // Must be called with ringMutex_ held
+  void stopRingThreadLocked();
+  void checkRingOwner(int32_t pid) const;
+
   std::unique_ptr<PcapDistributor> dist_;
   std::unique_ptr<PcapBufferManager> buffMgr_;
+
+  // Serializes attachRing() calls against each other and the destructor
+  std::mutex ringMutex_;
+  std::unique_ptr<PcapRingReader> ring_;
+  std::unique_ptr<std::thread> ringThread_;
+  std::atomic<bool> ringThreadStop_{false};
 };
 }}
@@ -40,7 +40,9 @@ union PacketData {
 
 struct CapturedPacket {
   1: required bool rx,
-  2: required PacketData pkt
+  2: required PacketData pkt,
+  // When the service received the packet, in ns since the epoch
+  3: optional i64 timestampNs
 }
 
 // This interface is for a user to connect to the service,
@@ -51,6 +53,11 @@ service PcapPushSubscriber {
   void receiveRxPacket(1: RxPacketData packet, 2: i16 type)
   void receiveTxPacket(1: TxPacketData packet, 2: i16 type)
 
+  // Called by the switch to publish packets through a shared memory ring
+  // instead, fd is the switch's fd for the ring in process pid. Packets
+  // that do not fit in the ring still come through the calls above.
+  void attachRing(1: i32 pid, 2: i32 fd)
+
   // Give the switch the ability to kill the distribution
   // process if needed
   void kill()
@@ -64,6 +71,13 @@ service PcapPushSubscriber {
   // Request by type of packet, or get all ethertypes
   list<CapturedPacket> dumpAllPackets()
   list<CapturedPacket> dumpPacketsByType(1: list<i16> ethertypes)
+  // Dump the packets of the given ethertypes received between startNs and
+  // endNs, in ns since the epoch, oldest first
+  list<CapturedPacket> dumpPacketsByTime(
+    1: list<i16> ethertypes,
+    2: i64 startNs,
+    3: i64 endNs,
+  )
 }
 
 // This interface is for a subscriber to receive a packet stream
@@ -0,0 +1,282 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/pcap_distribution_service/PcapBufferManager.h"
+#include "fboss/pcap_distribution_service/PcapCircularBuffer.h"
+
+#include "fboss/agent/FbossError.h"
+
+#include <folly/Conv.h>
+#include <gflags/gflags.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+DECLARE_int32(pcap_buffer_pkts);
+
+using namespace facebook::fboss;
+using std::string;
+using std::vector;
+
+namespace {
+
+RxPacketData makeRxPkt(int32_t port, const string& data) {
+  RxPacketData pkt;
+  pkt.srcPort = port;
+  pkt.srcVlan = 1;
+  pkt.packetData = data;
+  return pkt;
+}
+
+TxPacketData makeTxPkt(const string& data) {
+  TxPacketData pkt;
+  pkt.packetData = data;
+  return pkt;
+}
+
+int64_t wallNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+vector<int32_t> ports(const vector<CapturedPacket>& pkts) {
+  vector<int32_t> out;
+  for (const auto& pkt : pkts) {
+    out.push_back(pkt.pkt.get_rxpkt().srcPort);
+  }
+  return out;
+}
+
+} // unnamed namespace
+
+TEST(PcapCircularBufferTest, ZeroCapacity) {
+  EXPECT_THROW(PcapCircularBuffer(0, 64), FbossError);
+}
+
+TEST(PcapCircularBufferTest, RxTxRoundTrip) {
+  PcapCircularBuffer buf(4, 64);
+  auto rx = makeRxPkt(3, "rx packet");
+  RxReason reason;
+  reason.bytes = 12;
+  reason.description = "arp";
+  rx.reasons.push_back(reason);
+  buf.addRxPkt(rx);
+  buf.addTxPkt(makeTxPkt("tx packet"));
+
+  vector<CapturedPacket> out;
+  buf.dumpPackets(out);
+  ASSERT_EQ(2, out.size());
+  EXPECT_TRUE(out[0].rx);
+  const auto& rxGot = out[0].pkt.get_rxpkt();
+  EXPECT_EQ(3, rxGot.srcPort);
+  EXPECT_EQ(1, rxGot.srcVlan);
+  EXPECT_EQ("rx packet", rxGot.packetData.toStdString());
+  ASSERT_EQ(1, rxGot.reasons.size());
+  EXPECT_EQ(12, rxGot.reasons[0].bytes);
+  EXPECT_EQ("arp", rxGot.reasons[0].description);
+  EXPECT_FALSE(out[1].rx);
+  EXPECT_EQ("tx packet", out[1].pkt.get_txpkt().packetData.toStdString());
+  EXPECT_TRUE(out[0].__isset.timestampNs);
+  EXPECT_LE(out[0].timestampNs, out[1].timestampNs);
+}
+
+TEST(PcapCircularBufferTest, Truncates) {
+  PcapCircularBuffer buf(4, 8);
+  buf.addTxPkt(makeTxPkt("0123456789"));
+  vector<CapturedPacket> out;
+  buf.dumpPackets(out);
+  ASSERT_EQ(1, out.size());
+  EXPECT_EQ("01234567", out[0].pkt.get_txpkt().packetData.toStdString());
+}
+
+TEST(PcapCircularBufferTest, WrapAround) {
+  constexpr uint32_t kCapacity = 4;
+  PcapCircularBuffer buf(kCapacity, 64);
+  EXPECT_EQ(0, buf.size());
+  for (int32_t port = 0; port < 10; ++port) {
+    buf.addRxPkt(makeRxPkt(port, folly::to<string>("pkt ", port)));
+    EXPECT_EQ(std::min<uint32_t>(port + 1, kCapacity), buf.size());
+  }
+
+  // Only the newest packets are left, oldest first
+  vector<CapturedPacket> out;
+  buf.dumpPackets(out);
+  EXPECT_EQ((vector<int32_t>{6, 7, 8, 9}), ports(out));
+  EXPECT_EQ("pkt 9", out.back().pkt.get_rxpkt().packetData.toStdString());
+  EXPECT_EQ(0, buf.drops());
+
+  // A dump appends to what is already there
+  buf.dumpPackets(out);
+  EXPECT_EQ(2 * kCapacity, out.size());
+}
+
+TEST(PcapCircularBufferTest, DumpByTime) {
+  PcapCircularBuffer buf(16, 64);
+  auto pause = [] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  };
+
+  buf.addRxPkt(makeRxPkt(1, "before"));
+  buf.addRxPkt(makeRxPkt(2, "before"));
+  pause();
+  auto start = wallNs();
+  pause();
+  buf.addRxPkt(makeRxPkt(3, "during"));
+  buf.addRxPkt(makeRxPkt(4, "during"));
+  buf.addRxPkt(makeRxPkt(5, "during"));
+  pause();
+  auto end = wallNs();
+  pause();
+  buf.addRxPkt(makeRxPkt(6, "after"));
+
+  vector<CapturedPacket> out;
+  buf.dumpPackets(out, start, end);
+  EXPECT_EQ((vector<int32_t>{3, 4, 5}), ports(out));
+  for (const auto& pkt : out) {
+    EXPECT_GE(pkt.timestampNs, start);
+    EXPECT_LE(pkt.timestampNs, end);
+  }
+
+  // Open ended windows on either side
+  out.clear();
+  buf.dumpPackets(out, start);
+  EXPECT_EQ((vector<int32_t>{3, 4, 5, 6}), ports(out));
+  out.clear();
+  buf.dumpPackets(out, std::numeric_limits<int64_t>::min(), end);
+  EXPECT_EQ((vector<int32_t>{1, 2, 3, 4, 5}), ports(out));
+
+  // A window with nothing in it, and one entirely in the future
+  out.clear();
+  buf.dumpPackets(out, start, start + 1);
+  EXPECT_TRUE(out.empty());
+  buf.dumpPackets(out, wallNs() + 1000000000);
+  EXPECT_TRUE(out.empty());
+}
+
+TEST(PcapCircularBufferTest, DumpByTimeAfterWrap) {
+  // Once the oldest packets are overwritten the window is searched among the
+  // packets still in the buffer only
+  PcapCircularBuffer buf(4, 64);
+  for (int32_t port = 0; port < 6; ++port) {
+    buf.addRxPkt(makeRxPkt(port, "old"));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  auto start = wallNs();
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  buf.addRxPkt(makeRxPkt(6, "new"));
+  buf.addRxPkt(makeRxPkt(7, "new"));
+
+  vector<CapturedPacket> out;
+  buf.dumpPackets(out, start);
+  EXPECT_EQ((vector<int32_t>{6, 7}), ports(out));
+  out.clear();
+  buf.dumpPackets(out, std::numeric_limits<int64_t>::min(), start);
+  EXPECT_EQ((vector<int32_t>{4, 5}), ports(out));
+}
+
+TEST(PcapCircularBufferTest, ConcurrentAddAndDump) {
+  // Writers lap a small buffer while a reader dumps it. A slot overwritten
+  // while the reader copies it out must be skipped, so every packet dumped
+  // must be whole: its payload names its own port.
+  constexpr int kWriters = 4;
+  constexpr int kPktsPerWriter = 20000;
+  PcapCircularBuffer buf(8, 256);
+
+  std::atomic<bool> done{false};
+  vector<std::thread> writers;
+  for (int w = 0; w < kWriters; ++w) {
+    writers.emplace_back([&buf, w] {
+      for (int i = 0; i < kPktsPerWriter; ++i) {
+        int32_t port = w * kPktsPerWriter + i;
+        // Long enough that a torn copy would mix two packets' bytes
+        auto data = folly::to<string>(port, ":", string(200, 'a' + port % 26));
+        buf.addRxPkt(makeRxPkt(port, data));
+      }
+    });
+  }
+
+  std::thread reader([&] {
+    while (!done.load()) {
+      vector<CapturedPacket> out;
+      buf.dumpPackets(out);
+      EXPECT_LE(out.size(), buf.capacity());
+      int64_t lastTs = 0;
+      for (const auto& pkt : out) {
+        const auto& rx = pkt.pkt.get_rxpkt();
+        auto expected = folly::to<string>(
+            rx.srcPort, ":", string(200, 'a' + rx.srcPort % 26));
+        EXPECT_EQ(expected, rx.packetData.toStdString());
+        // Writers racing to add packets may timestamp them slightly out of
+        // order, but never by much
+        EXPECT_GE(pkt.timestampNs, lastTs - 100000000);
+        lastTs = pkt.timestampNs;
+      }
+    }
+  });
+
+  for (auto& writer : writers) {
+    writer.join();
+  }
+  done.store(true);
+  reader.join();
+
+  // Once the writers are done only slots whose write was dropped are
+  // missing from a dump
+  vector<CapturedPacket> out;
+  buf.dumpPackets(out);
+  EXPECT_GT(out.size(), 0);
+  EXPECT_LE(out.size(), buf.capacity());
+}
+
+TEST(PcapBufferManagerTest, DumpByEthertypeAndTime) {
+  auto oldPkts = FLAGS_pcap_buffer_pkts;
+  FLAGS_pcap_buffer_pkts = 4;
+  PcapBufferManager mgr;
+  FLAGS_pcap_buffer_pkts = oldPkts;
+
+  uint16_t kArp = ArpHandler::ETHERTYPE_ARP;
+  uint16_t kIPv6 = IPv6Handler::ETHERTYPE_IPV6;
+  mgr.addRxPkt(makeRxPkt(1, "arp"), kArp);
+  mgr.addTxPkt(makeTxPkt("ipv6"), kIPv6);
+  // Ethertypes without a buffer of their own are kept as UNKNOWN
+  mgr.addRxPkt(makeRxPkt(2, "mpls"), 0x8847);
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  auto start = wallNs();
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  for (int32_t port = 10; port < 16; ++port) {
+    mgr.addRxPkt(makeRxPkt(port, "arp"), kArp);
+  }
+
+  vector<CapturedPacket> out;
+  mgr.dumpPackets(out, kIPv6);
+  ASSERT_EQ(1, out.size());
+  EXPECT_FALSE(out[0].rx);
+
+  out.clear();
+  mgr.dumpPackets(out, PcapBufferManager::UNKNOWN);
+  EXPECT_EQ((vector<int32_t>{2}), ports(out));
+  out.clear();
+  mgr.dumpPackets(out, 0x8847);
+  EXPECT_TRUE(out.empty());
+
+  // The arp buffer holds FLAGS_pcap_buffer_pkts packets at the time the
+  // manager was created, all from after start
+  out.clear();
+  mgr.dumpPackets(out, kArp, start);
+  EXPECT_EQ((vector<int32_t>{12, 13, 14, 15}), ports(out));
+  out.clear();
+  mgr.dumpPackets(out, kArp, std::numeric_limits<int64_t>::min(), start);
+  EXPECT_TRUE(out.empty());
+}
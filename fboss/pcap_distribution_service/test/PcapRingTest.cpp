@@ -0,0 +1,228 @@
+/*
+ *  Copyright (c) 2004-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+#include "fboss/pcap_distribution_service/PcapRing.h"
+
+#include "fboss/agent/FbossError.h"
+#include "fboss/agent/hw/mock/MockRxPacket.h"
+#include "fboss/agent/hw/mock/MockTxPacket.h"
+#include "fboss/pcap_distribution_service/if/gen-cpp2/pcap_pubsub_types.h"
+
+#include <folly/File.h>
+#include <folly/io/IOBuf.h>
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace facebook::fboss;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+/*
+ * Both ends of the ring live in the test process, the reader maps the
+ * writer's memfd through /proc/<our pid>/fd/<fd> like the service does.
+ */
+namespace {
+
+constexpr uint32_t kSlotSize = 128;
+
+class ReasonRxPacket : public MockRxPacket {
+ public:
+  ReasonRxPacket(unique_ptr<folly::IOBuf> buf, vector<RxReason> reasons)
+      : MockRxPacket(std::move(buf)), reasons_(std::move(reasons)) {}
+
+  vector<RxReason> getReasons() override {
+    return reasons_;
+  }
+
+ private:
+  vector<RxReason> reasons_;
+};
+
+string payload(size_t len, uint8_t seed) {
+  string data;
+  for (size_t i = 0; i < len; ++i) {
+    data.push_back(static_cast<char>(seed + i));
+  }
+  return data;
+}
+
+unique_ptr<ReasonRxPacket> makeRxPkt(
+    const string& data,
+    vector<RxPacket::RxReason> reasons = {}) {
+  auto pkt = std::make_unique<ReasonRxPacket>(
+      folly::IOBuf::copyBuffer(data), std::move(reasons));
+  pkt->setSrcPort(PortID(5));
+  pkt->setSrcVlan(VlanID(7));
+  return pkt;
+}
+
+unique_ptr<MockTxPacket> makeTxPkt(const string& data) {
+  auto pkt = std::make_unique<MockTxPacket>(data.size());
+  memcpy(pkt->buf()->writableData(), data.data(), data.size());
+  return pkt;
+}
+
+struct Received {
+  vector<RxPacketData> rx;
+  vector<TxPacketData> tx;
+  vector<uint16_t> ethertypes;
+};
+
+uint32_t readAll(PcapRingReader& reader, Received& got, uint32_t max = 1000) {
+  return reader.read(
+      max,
+      [&](RxPacketData* pkt, uint16_t ethertype) {
+        got.rx.push_back(*pkt);
+        got.ethertypes.push_back(ethertype);
+      },
+      [&](TxPacketData* pkt, uint16_t ethertype) {
+        got.tx.push_back(*pkt);
+        got.ethertypes.push_back(ethertype);
+      });
+}
+
+} // unnamed namespace
+
+TEST(PcapRingTest, BadGeometry) {
+  EXPECT_THROW(PcapRingWriter(0, kSlotSize), FbossError);
+  EXPECT_THROW(PcapRingWriter(4, sizeof(PcapRingSlot)), FbossError);
+  EXPECT_THROW(PcapRingWriter(4, kSlotSize + 1), FbossError);
+}
+
+TEST(PcapRingTest, RxTxRoundTrip) {
+  PcapRingWriter writer(8, kSlotSize);
+  PcapRingReader reader(getpid(), writer.fd());
+
+  auto rxData = payload(40, 1);
+  auto txData = payload(30, 100);
+  auto rx = makeRxPkt(rxData, {{1, "arp"}, {-1, "cpu queue 3"}});
+  auto tx = makeTxPkt(txData);
+  EXPECT_EQ(PcapRingWriter::Result::WRITTEN, writer.write(rx.get(), 0x0806));
+  EXPECT_EQ(PcapRingWriter::Result::WRITTEN, writer.write(tx.get(), 0x86dd));
+
+  Received got;
+  EXPECT_EQ(2, readAll(reader, got));
+  ASSERT_EQ(1, got.rx.size());
+  ASSERT_EQ(1, got.tx.size());
+  EXPECT_EQ((vector<uint16_t>{0x0806, 0x86dd}), got.ethertypes);
+
+  const auto& rxGot = got.rx[0];
+  EXPECT_EQ(rxData, rxGot.packetData.toStdString());
+  EXPECT_EQ(5, rxGot.srcPort);
+  EXPECT_EQ(7, rxGot.srcVlan);
+  ASSERT_EQ(2, rxGot.reasons.size());
+  EXPECT_EQ(1, rxGot.reasons[0].bytes);
+  EXPECT_EQ("arp", rxGot.reasons[0].description);
+  EXPECT_EQ(-1, rxGot.reasons[1].bytes);
+  EXPECT_EQ("cpu queue 3", rxGot.reasons[1].description);
+
+  EXPECT_EQ(txData, got.tx[0].packetData.toStdString());
+
+  // Nothing is left behind
+  EXPECT_EQ(0, readAll(reader, got));
+}
+
+TEST(PcapRingTest, WrapAround) {
+  constexpr uint32_t kNumSlots = 4;
+  PcapRingWriter writer(kNumSlots, kSlotSize);
+  PcapRingReader reader(getpid(), writer.fd());
+
+  // Go around the ring several times, reading in batches that do not line
+  // up with the end of the ring
+  uint8_t seed = 0;
+  uint8_t expected = 0;
+  for (int round = 0; round < 5; ++round) {
+    for (int i = 0; i < 3; ++i) {
+      auto pkt = makeTxPkt(payload(20 + seed, seed));
+      ASSERT_EQ(PcapRingWriter::Result::WRITTEN, writer.write(pkt.get(), 0));
+      ++seed;
+    }
+    Received got;
+    EXPECT_EQ(2, readAll(reader, got, 2));
+    EXPECT_EQ(1, readAll(reader, got));
+    ASSERT_EQ(3, got.tx.size());
+    for (const auto& pkt : got.tx) {
+      EXPECT_EQ(payload(20 + expected, expected), pkt.packetData.toStdString());
+      ++expected;
+    }
+  }
+  EXPECT_EQ(0, writer.drops());
+}
+
+TEST(PcapRingTest, FullRingDrops) {
+  constexpr uint32_t kNumSlots = 4;
+  PcapRingWriter writer(kNumSlots, kSlotSize);
+  PcapRingReader reader(getpid(), writer.fd());
+
+  for (uint8_t i = 0; i < kNumSlots; ++i) {
+    auto pkt = makeTxPkt(payload(16, i));
+    EXPECT_EQ(PcapRingWriter::Result::WRITTEN, writer.write(pkt.get(), 0));
+  }
+  for (uint8_t i = 0; i < 3; ++i) {
+    auto pkt = makeTxPkt(payload(16, 100 + i));
+    EXPECT_EQ(PcapRingWriter::Result::FULL, writer.write(pkt.get(), 0));
+  }
+  // Both ends see the drops through the shared header
+  EXPECT_EQ(3, writer.drops());
+  EXPECT_EQ(3, reader.drops());
+
+  // The dropped packets never show up, the ones already in the ring do
+  Received got;
+  EXPECT_EQ(1, readAll(reader, got, 1));
+  EXPECT_EQ(payload(16, 0), got.tx[0].packetData.toStdString());
+
+  // Releasing a slot makes room for exactly one more packet
+  auto pkt = makeTxPkt(payload(16, 50));
+  EXPECT_EQ(PcapRingWriter::Result::WRITTEN, writer.write(pkt.get(), 0));
+  EXPECT_EQ(PcapRingWriter::Result::FULL, writer.write(pkt.get(), 0));
+  EXPECT_EQ(4, writer.drops());
+
+  got = Received();
+  EXPECT_EQ(kNumSlots, readAll(reader, got));
+  ASSERT_EQ(kNumSlots, got.tx.size());
+  EXPECT_EQ(payload(16, 1), got.tx[0].packetData.toStdString());
+  EXPECT_EQ(payload(16, 50), got.tx[3].packetData.toStdString());
+}
+
+TEST(PcapRingTest, TooBig) {
+  PcapRingWriter writer(4, kSlotSize);
+  PcapRingReader reader(getpid(), writer.fd());
+
+  // The largest packet that fits, and one byte more
+  auto maxLen = kSlotSize - sizeof(PcapRingSlot);
+  auto fits = makeTxPkt(payload(maxLen, 0));
+  auto tooBig = makeTxPkt(payload(maxLen + 1, 0));
+  EXPECT_EQ(PcapRingWriter::Result::WRITTEN, writer.write(fits.get(), 0));
+  EXPECT_EQ(PcapRingWriter::Result::TOO_BIG, writer.write(tooBig.get(), 0));
+
+  // The reasons take up room in the slot too
+  auto rxFits = makeRxPkt(payload(maxLen, 0));
+  auto rxTooBig = makeRxPkt(payload(maxLen, 0), {{0, "x"}});
+  EXPECT_EQ(PcapRingWriter::Result::WRITTEN, writer.write(rxFits.get(), 0));
+  EXPECT_EQ(PcapRingWriter::Result::TOO_BIG, writer.write(rxTooBig.get(), 0));
+
+  // Packets that are too big are left to the caller, not counted as drops
+  EXPECT_EQ(0, writer.drops());
+  Received got;
+  EXPECT_EQ(2, readAll(reader, got));
+  EXPECT_EQ(maxLen, got.tx[0].packetData.size());
+  EXPECT_EQ(maxLen, got.rx[0].packetData.size());
+}
+
+TEST(PcapRingTest, RejectsFilesOtherThanRings) {
+  // An fd that is not a pcap ring memfd must not be mapped
+  folly::File other("/dev/null", O_RDWR);
+  EXPECT_THROW(PcapRingReader(getpid(), other.fd()), FbossError);
+}
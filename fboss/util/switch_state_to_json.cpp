@@ -0,0 +1,41 @@
+// Copyright 2004-present Facebook. All Rights Reserved.
+#include "fboss/agent/Utils.h"
+
+#include <folly/FileUtil.h>
+#include <folly/json.h>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include <cstdio>
+
+/*
+ * Convert a binary (BSER) switch state file, as written for warm boot when
+ * --binary_switch_state is set, to pretty printed JSON for debugging.
+ *
+ * usage: switch_state_to_json BINARY_STATE_FILE [JSON_OUTPUT_FILE]
+ *
+ * The JSON is written to stdout if no output file is given.
+ */
+int main(int argc, char* argv[]) {
+  google::InitGoogleLogging(argv[0]);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  if (argc < 2 || argc > 3) {
+    fprintf(stderr, "usage: %s BINARY_STATE_FILE [JSON_OUTPUT_FILE]\n",
+            argv[0]);
+    return 1;
+  }
+
+  auto state = facebook::fboss::readBinaryStateFromFile(argv[1]);
+  if (argc == 3) {
+    if (!facebook::fboss::dumpStateToFile(argv[2], state)) {
+      fprintf(stderr, "error: unable to write %s\n", argv[2]);
+      return 1;
+    }
+    return 0;
+  }
+  auto json = folly::toPrettyJson(state);
+  fwrite(json.data(), 1, json.size(), stdout);
+  fputc('\n', stdout);
+  return 0;
+}